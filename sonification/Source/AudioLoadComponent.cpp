@@ -0,0 +1,128 @@
+#include "AudioLoadComponent.h"
+
+#include <numeric>
+
+AudioLoadComponent::AudioLoadComponent(AudioLoadMonitor &monitorToDisplay) : monitor(monitorToDisplay) {
+    setOpaque(false);
+    startTimerHz(REFRESH_RATE_HZ);
+}
+
+AudioLoadComponent::~AudioLoadComponent() {
+    stopTimer();
+}
+
+void AudioLoadComponent::timerCallback() {
+    statistics = monitor.getStatistics();
+    repaint();
+}
+
+void AudioLoadComponent::paint(Graphics &g) {
+    auto bounds = getLocalBounds();
+    auto histogramBounds = bounds.removeFromRight(HISTOGRAM_WIDTH).reduced(1);
+
+    // Name the two stages taking longest.
+    std::array<int, AudioLoadMonitor::NUM_STAGES> stages{};
+    std::iota(stages.begin(), stages.end(), 0);
+    std::partial_sort(stages.begin(), stages.begin() + 2, stages.end(), [this](int a, int b) {
+        return statistics.meanStageMicroseconds[static_cast<size_t>(a)] >
+               statistics.meanStageMicroseconds[static_cast<size_t>(b)];
+    });
+    juce::String stageText;
+    for (auto i = 0; i < 2; ++i) {
+        auto stage = stages[static_cast<size_t>(i)];
+        auto microseconds = statistics.meanStageMicroseconds[static_cast<size_t>(stage)];
+        if (microseconds > 0.0) {
+            stageText << "  " << AudioLoadMonitor::getStageName(static_cast<AudioLoadMonitor::Stage>(stage)) << " "
+                      << juce::String(microseconds, 0) << "us";
+        }
+    }
+
+    g.setFont(juce::Font{"Monaco", 12.f, juce::Font::plain});
+    juce::String underrunText;
+    if (statistics.numFileUnderruns > 0) {
+        underrunText << "  file underruns " << juce::String(statistics.numFileUnderruns);
+    }
+
+    g.setColour(statistics.numOverruns > 0 || statistics.numFileUnderruns > 0 ? Colours::orange : Colours::lightgreen);
+    g.drawText("DSP " + juce::String(100.0 * statistics.meanLoad, 1) + "% (peak " +
+               juce::String(100.f * statistics.peakLoad, 0) + "%)  overruns " + juce::String(statistics.numOverruns) +
+               "  late " + juce::String(statistics.numLateBlocks) + underrunText + stageText,
+               bounds.reduced(4, 0),
+               juce::Justification::centredLeft);
+
+    // Bar heights on a log scale, so rare slow callbacks show up.
+    g.setColour(Colours::white.withAlpha(.1f));
+    g.fillRect(histogramBounds);
+    auto maxCount = *std::max_element(statistics.histogram.begin(), statistics.histogram.end());
+    if (maxCount == 0) {
+        return;
+    }
+    auto logMax = std::log1p(static_cast<float>(maxCount));
+    auto barWidth = static_cast<float>(histogramBounds.getWidth()) / AudioLoadMonitor::NUM_HISTOGRAM_BINS;
+    // Bins at or beyond the deadline.
+    auto overrunBin = juce::roundToInt(1.f / AudioLoadMonitor::HISTOGRAM_BIN_WIDTH);
+    for (auto bin = 0; bin < AudioLoadMonitor::NUM_HISTOGRAM_BINS; ++bin) {
+        auto count = statistics.histogram[static_cast<size_t>(bin)];
+        if (count == 0) {
+            continue;
+        }
+        auto height = static_cast<float>(histogramBounds.getHeight()) * std::log1p(static_cast<float>(count)) / logMax;
+        g.setColour(bin >= overrunBin ? Colours::orange : Colours::lightgreen);
+        g.fillRect(static_cast<float>(histogramBounds.getX()) + barWidth * static_cast<float>(bin),
+                   static_cast<float>(histogramBounds.getBottom()) - height,
+                   barWidth,
+                   height);
+    }
+}
+
+void AudioLoadComponent::mouseDown(const MouseEvent &event) {
+    juce::ignoreUnused(event);
+
+    juce::PopupMenu menu;
+    menu.addItem("Reset", [this] { monitor.reset(); });
+    menu.addItem("Save to file...", [this] { saveToFile(); });
+#if GAIT_SONIFICATION_TRACING
+    menu.addItem("Save trace...", [this] { saveTrace(); });
+#endif
+    menu.showMenuAsync(juce::PopupMenu::Options{}.withTargetComponent(this));
+}
+
+void AudioLoadComponent::saveTrace() {
+    fileChooser = std::make_unique<FileChooser>("Save trace",
+                                                File("~/Documents").getChildFile("trace.json"),
+                                                "*.json");
+    fileChooser->launchAsync(
+            FileBrowserComponent::saveMode | FileBrowserComponent::canSelectFiles |
+            FileBrowserComponent::warnAboutOverwriting,
+            [](const FileChooser &chooser) {
+                auto file = chooser.getResult();
+                if (file == File{}) {
+                    return;
+                }
+                auto result = Trace::writeChromeTrace(file);
+                if (result.failed()) {
+                    juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon,
+                                                           "Trace",
+                                                           result.getErrorMessage());
+                }
+            }
+    );
+}
+
+void AudioLoadComponent::saveToFile() {
+    fileChooser = std::make_unique<FileChooser>("Save audio load statistics",
+                                                File("~/Documents").getChildFile("audio_load.txt"),
+                                                "*.txt");
+    fileChooser->launchAsync(
+            FileBrowserComponent::saveMode | FileBrowserComponent::canSelectFiles |
+            FileBrowserComponent::warnAboutOverwriting,
+            [this](const FileChooser &chooser) {
+                auto file = chooser.getResult();
+                if (file != File{} && !monitor.writeToFile(file)) {
+                    juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon,
+                                                           "Audio load",
+                                                           "Failed to write " + file.getFullPathName());
+                }
+            }
+    );
+}
@@ -0,0 +1,42 @@
+#ifndef GAIT_SONIFICATION_AUDIOLOADCOMPONENT_H
+#define GAIT_SONIFICATION_AUDIOLOADCOMPONENT_H
+
+#include <JuceHeader.h>
+#include "Processing/AudioLoadMonitor.h"
+
+/**
+ * A one-line overlay of audio callback load: mean and peak load, overruns and late callbacks, the costliest stages,
+ * and a histogram of load.
+ *
+ * Click for a menu to reset the statistics or save them to a file.
+ */
+class AudioLoadComponent : public juce::Component, juce::Timer {
+public:
+    explicit AudioLoadComponent(AudioLoadMonitor &monitorToDisplay);
+
+    ~AudioLoadComponent() override;
+
+    void timerCallback() override;
+
+    void paint(Graphics &g) override;
+
+    void mouseDown(const MouseEvent &event) override;
+
+private:
+    static constexpr int REFRESH_RATE_HZ{4};
+    static constexpr int HISTOGRAM_WIDTH{82};
+
+    void saveToFile();
+
+    /**
+     * Export the trace recorded so far; only offered when built with tracing.
+     */
+    void saveTrace();
+
+    AudioLoadMonitor &monitor;
+    AudioLoadMonitor::Statistics statistics;
+
+    std::unique_ptr<juce::FileChooser> fileChooser;
+};
+
+#endif //GAIT_SONIFICATION_AUDIOLOADCOMPONENT_H
@@ -0,0 +1,192 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Command-line tool that times FM rendering for each preset patch: the
+    per-sample FMOsc::computeNextSample() path against FMAlgorithm's block
+    renderer.
+
+        GaitSonificationBenchmark [options]
+
+        --patch=default|bell|reed|vibrato  Patch to time (default: all)
+        --seconds=<s>                   Audio rendered per run (default 10)
+        --runs=<n>                      Runs per path; the fastest is
+                                        reported (default 5)
+        --block=<samples>               Block size (default 512)
+        --rate=<Hz>                     Sample rate (default 48000)
+
+    Each run renders one note from its onset, with a decay longer than the
+    run, so every operator renders throughout. Times are in nanoseconds per
+    sample of output.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iomanip>
+#include <iostream>
+#include "../SonificationEngine.h"
+
+namespace {
+    constexpr double NOTE_FREQUENCY{300.0};
+    constexpr float NOTE_AMPLITUDE{.5f};
+
+    // Each block's first sample goes here, so the compiler can't drop the rendering.
+    volatile float sink;
+
+    struct Settings {
+        std::vector<SonificationEngine::SynthPatch> patches;
+        double seconds{10.0};
+        int numRuns{5};
+        int blockSize{512};
+        double sampleRate{48000.0};
+    };
+
+    void printUsage() {
+        std::cerr << "Usage: GaitSonificationBenchmark [--patch=default|bell|reed|vibrato] [--seconds=<s>]"
+                     " [--runs=<n>] [--block=<samples>] [--rate=<Hz>]" << std::endl;
+    }
+
+    bool parseOptions(const juce::ArgumentList &args, Settings &settings) {
+        if (args.containsOption("--patch")) {
+            auto patch = SonificationEngine::PatchDefault;
+            auto result = SonificationEngine::parsePatchName(args.getValueForOption("--patch"), patch);
+            if (result.failed()) {
+                std::cerr << result.getErrorMessage() << std::endl;
+                return false;
+            }
+            settings.patches = {patch};
+        } else {
+            settings.patches = {SonificationEngine::PatchDefault, SonificationEngine::PatchBell,
+                                SonificationEngine::PatchReed, SonificationEngine::PatchVibrato};
+        }
+
+        if (args.containsOption("--seconds")) {
+            settings.seconds = args.getValueForOption("--seconds").getDoubleValue();
+            if (settings.seconds <= 0.0) {
+                std::cerr << "Invalid length: " << settings.seconds << std::endl;
+                return false;
+            }
+        }
+
+        if (args.containsOption("--runs")) {
+            settings.numRuns = args.getValueForOption("--runs").getIntValue();
+            if (settings.numRuns < 1) {
+                std::cerr << "Invalid number of runs: " << settings.numRuns << std::endl;
+                return false;
+            }
+        }
+
+        if (args.containsOption("--block")) {
+            settings.blockSize = args.getValueForOption("--block").getIntValue();
+            if (settings.blockSize < 1) {
+                std::cerr << "Invalid block size: " << settings.blockSize << std::endl;
+                return false;
+            }
+        }
+
+        if (args.containsOption("--rate")) {
+            auto result = SonificationEngine::parseSampleRate(args.getValueForOption("--rate"), settings.sampleRate);
+            if (result.failed()) {
+                std::cerr << result.getErrorMessage() << std::endl;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Time render(output, numSamples) over settings.seconds of audio, a block at a time.
+     * @return The fastest of settings.numRuns runs, each set up afresh by prepare(), in ns per sample.
+     */
+    template<typename Prepare, typename Render>
+    double time(const Settings &settings, Prepare &&prepare, Render &&render) {
+        auto totalSamples = static_cast<juce::int64>(settings.seconds * settings.sampleRate);
+        std::vector<float> block(static_cast<size_t>(settings.blockSize));
+        auto best = std::numeric_limits<double>::max();
+
+        for (auto run = 0; run < settings.numRuns; ++run) {
+            prepare();
+            auto start = juce::Time::getHighResolutionTicks();
+            for (auto remaining = totalSamples; remaining > 0; remaining -= settings.blockSize) {
+                auto numSamples = static_cast<int>(std::min<juce::int64>(remaining, settings.blockSize));
+                std::fill(block.begin(), block.end(), 0.f);
+                render(block.data(), numSamples);
+                sink = block[0];
+            }
+            auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            best = std::min(best, elapsed * 1e9 / static_cast<double>(totalSamples));
+        }
+        return best;
+    }
+
+    double timeReference(const Settings &settings, const FMSynth::Parameters &patch) {
+        std::unique_ptr<FMOsc> osc;
+        auto prepare = [&] {
+            osc = std::make_unique<FMOsc>(patch.carrierMode);
+            for (auto params: patch.modulatorParameters) {
+                osc->addModulator(params.generateOscillator());
+            }
+            auto envParams = patch.envParams;
+            osc->setEnvelope(envParams);
+            auto spec = juce::dsp::ProcessSpec{settings.sampleRate, static_cast<juce::uint32>(settings.blockSize), 1};
+            osc->prepareToPlay(spec);
+            osc->setupNote(NOTE_FREQUENCY, NOTE_AMPLITUDE);
+        };
+        auto render = [&osc](float *output, int numSamples) {
+            for (auto n = 0; n < numSamples; ++n) {
+                output[n] += osc->computeNextSample();
+            }
+        };
+        return time(settings, prepare, render);
+    }
+
+    double timeAlgorithm(const Settings &settings, const FMSynth::Parameters &patch) {
+        FMAlgorithm algorithm;
+        auto prepare = [&] {
+            algorithm = FMAlgorithm(patch.carrierMode, patch.modulatorParameters, patch.envParams);
+            algorithm.prepareToPlay(settings.sampleRate, settings.blockSize);
+            algorithm.setupNote(NOTE_FREQUENCY, NOTE_AMPLITUDE);
+        };
+        auto render = [&algorithm](float *output, int numSamples) {
+            algorithm.renderNextBlock(output, numSamples);
+        };
+        return time(settings, prepare, render);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    juce::ArgumentList args{argc, argv};
+
+    Settings settings;
+    if (!parseOptions(args, settings)) {
+        printUsage();
+        return 1;
+    }
+
+    std::cout << "Sample rate " << settings.sampleRate << " Hz, block " << settings.blockSize << " samples, "
+              << settings.seconds << " s per run, best of " << settings.numRuns << std::endl;
+    std::cout << std::left << std::setw(10) << "Patch" << std::right << std::setw(10) << "Operators"
+              << std::setw(16) << "FMOsc ns/smp" << std::setw(20) << "FMAlgorithm ns/smp" << std::setw(10)
+              << "Speed-up" << std::endl;
+
+    auto patchNames = SonificationEngine::getPatchNames();
+    for (auto patch: settings.patches) {
+        // Long enough that no envelope finishes during a run.
+        auto parameters = SonificationEngine::createSynthPatch(patch, static_cast<float>(settings.seconds + 1.0));
+        auto numOperators = FMAlgorithm(parameters.carrierMode, parameters.modulatorParameters,
+                                        parameters.envParams).getNumOperators();
+
+        auto reference = timeReference(settings, parameters);
+        auto algorithm = timeAlgorithm(settings, parameters);
+
+        std::cout << std::left << std::setw(10) << patchNames[patch] << std::right << std::setw(10) << numOperators
+                  << std::fixed << std::setprecision(1) << std::setw(16) << reference << std::setw(20) << algorithm
+                  << std::setw(9) << reference / algorithm << "x"
+                  << std::defaultfloat << std::endl;
+    }
+
+    return 0;
+}
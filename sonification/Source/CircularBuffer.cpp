@@ -3,7 +3,7 @@
 //
 
 #include "CircularBuffer.h"
-#include "GaitEventDetectorComponent.h"
+#include "GaitEventDetector.h"
 
 template<typename T>
 CircularBuffer<T>::CircularBuffer(unsigned int bufferLength, T init) {
@@ -27,12 +27,12 @@ void CircularBuffer<T>::write(T valueToWrite) {
 }
 
 template<typename T>
-T CircularBuffer<T>::getCurrent() {
+T CircularBuffer<T>::getCurrent() const {
     return buffer[writeIndex];
 }
 
 template<typename T>
-T CircularBuffer<T>::getPrevious(unsigned int delay) {
+T CircularBuffer<T>::getPrevious(unsigned int delay) const {
     int readIndex = static_cast<int>(writeIndex) - static_cast<int>(delay);
     // Return something sensible even if the specified delay wasn't.
     while (readIndex < 0) {
@@ -76,13 +76,13 @@ std::vector<T> CircularBuffer<T>::getSamples(unsigned int samplesToGet) {
 }
 
 template
-class CircularBuffer<GaitEventDetectorComponent::ImuSample>;
+class CircularBuffer<GaitEventDetector::ImuSample>;
 
 template
-class CircularBuffer<GaitEventDetectorComponent::GroundContact>;
+class CircularBuffer<GaitEventDetector::GroundContact>;
 
 template
-class CircularBuffer<GaitEventDetectorComponent::GaitEvent>;
+class CircularBuffer<GaitEventDetector::GaitEvent>;
 
 template
 class CircularBuffer<float>;
\ No newline at end of file
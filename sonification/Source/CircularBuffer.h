@@ -16,9 +16,9 @@ public:
 
     void write(T);
 
-    T getCurrent();
+    T getCurrent() const;
 
-    T getPrevious(unsigned int delay = 1);
+    T getPrevious(unsigned int delay = 1) const;
 
     std::vector<T> getCircle();
 
@@ -0,0 +1,96 @@
+#include "ClockFollower.h"
+
+ClockFollower::ClockFollower(const MasterClock &clockToFollow, Follower &followerToDrive) :
+        clock(clockToFollow),
+        follower(followerToDrive) {
+}
+
+ClockFollower::~ClockFollower() {
+    stopTimer();
+}
+
+void ClockFollower::setOffset(double seconds) {
+    offset = seconds;
+}
+
+void ClockFollower::resync() {
+    resyncRequested = true;
+}
+
+void ClockFollower::start() {
+    hasLastUpdate = false;
+    // Whatever rate the follower was left at, set it afresh.
+    rate = 0.0;
+    startTimerHz(UPDATE_RATE_HZ);
+}
+
+void ClockFollower::stop() {
+    stopTimer();
+    hasLastUpdate = false;
+}
+
+void ClockFollower::update() {
+    auto clockSeconds = clock.getTimeSeconds();
+    auto speed = clock.getSpeed();
+    auto followerSeconds = follower.getPosition();
+    auto target = clockSeconds + offset;
+    error = followerSeconds - target;
+
+    if (resyncRequested || std::abs(error) > HARD_SEEK_THRESHOLD) {
+        seek(target, speed);
+        return;
+    }
+
+    // How far each has moved since the last update tells how fast the follower really runs for the rate it was set.
+    // Not across a speed change, though, as the follower was running at a rate set for the old speed.
+    auto clockDelta = clockSeconds - lastClockSeconds;
+    if (hasLastUpdate && speed == lastSpeed && clockDelta > 0.0 && rate > 0.0 && speed > 0.0) {
+        auto observedDrift = (followerSeconds - lastFollowerSeconds) / clockDelta * speed / rate;
+        drift += DRIFT_SMOOTHING * (juce::jlimit(.5, 2.0, observedDrift) - drift);
+    }
+    lastClockSeconds = clockSeconds;
+    lastFollowerSeconds = followerSeconds;
+    lastSpeed = speed;
+    hasLastUpdate = true;
+
+    if (speed <= 0.0) {
+        setRate(0.0);
+        return;
+    }
+
+    // Close the error over CORRECTION_TIME of media, within limits.
+    auto correction = juce::jlimit(-MAX_RATE_CORRECTION, MAX_RATE_CORRECTION, -error / (CORRECTION_TIME * speed));
+    setRate(speed / drift * (1.0 + correction));
+}
+
+double ClockFollower::getError() const {
+    return error;
+}
+
+double ClockFollower::getDrift() const {
+    return drift;
+}
+
+int ClockFollower::getNumSeeks() const {
+    return numSeeks;
+}
+
+void ClockFollower::timerCallback() {
+    update();
+}
+
+void ClockFollower::seek(double target, double speed) {
+    follower.setPosition(target);
+    ++numSeeks;
+    resyncRequested = false;
+    // The follower has jumped, so the next update can't measure drift against this one.
+    hasLastUpdate = false;
+    setRate(speed / drift);
+}
+
+void ClockFollower::setRate(double newRate) {
+    if (std::abs(newRate - rate) > RATE_TOLERANCE) {
+        follower.setRate(newRate);
+        rate = newRate;
+    }
+}
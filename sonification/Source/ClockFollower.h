@@ -0,0 +1,117 @@
+#ifndef GAIT_SONIFICATION_CLOCKFOLLOWER_H
+#define GAIT_SONIFICATION_CLOCKFOLLOWER_H
+
+#include <JuceHeader.h>
+#include "MasterClock.h"
+
+/**
+ * Keeps a media player, e.g. a video, in step with a MasterClock.
+ *
+ * Rather than seeking the follower every so often, which stutters, it nudges the follower's playback rate: an estimate
+ * of how fast the follower actually runs for the rate it is asked for (its drift) is refined on every update, and the
+ * rate is trimmed by up to MAX_RATE_CORRECTION to pull in whatever error remains. Only an error beyond
+ * HARD_SEEK_THRESHOLD, e.g. after the clock jumps, gets a seek.
+ *
+ * update() does all the work and can be driven by hand, e.g. against a simulated follower; start() drives it from a
+ * timer on the message thread instead.
+ */
+class ClockFollower : private juce::Timer {
+public:
+    /**
+     * What a ClockFollower drives.
+     */
+    class Follower {
+    public:
+        virtual ~Follower() = default;
+
+        /**
+         * @return The follower's position, in seconds.
+         */
+        virtual double getPosition() = 0;
+
+        virtual void setPosition(double seconds) = 0;
+
+        /**
+         * @param rate Playback rate, 1 for real time.
+         */
+        virtual void setRate(double rate) = 0;
+    };
+
+    // An error beyond this, in seconds, is fixed with a seek.
+    static constexpr double HARD_SEEK_THRESHOLD{.5};
+    // The most the rate is trimmed by to pull in an error, relative to the clock's speed.
+    static constexpr double MAX_RATE_CORRECTION{.05};
+    // The time over which an error is pulled in, before MAX_RATE_CORRECTION limits it, in seconds.
+    static constexpr double CORRECTION_TIME{2.0};
+    // Per-update smoothing of the drift estimate.
+    static constexpr double DRIFT_SMOOTHING{.1};
+    // Rate changes smaller than this aren't passed on to the follower.
+    static constexpr double RATE_TOLERANCE{1e-4};
+    static constexpr int UPDATE_RATE_HZ{10};
+
+    ClockFollower(const MasterClock &clockToFollow, Follower &followerToDrive);
+
+    ~ClockFollower() override;
+
+    /**
+     * Set where the follower should be when the clock reads 0, in follower seconds. An error this makes is corrected
+     * like any other.
+     */
+    void setOffset(double seconds);
+
+    /**
+     * Seek the follower on the next update, whatever the error.
+     */
+    void resync();
+
+    /**
+     * Update from a timer on the message thread until stop() is called.
+     */
+    void start();
+
+    void stop();
+
+    /**
+     * Compare the follower to the clock and correct it. Call straight after changing the clock's speed too, or the
+     * follower carries on at the old speed until the next update.
+     */
+    void update();
+
+    /**
+     * @return Follower position minus where it should be, as of the last update, in seconds.
+     */
+    double getError() const;
+
+    /**
+     * @return How fast the follower runs relative to the rate it's asked for.
+     */
+    double getDrift() const;
+
+    int getNumSeeks() const;
+
+private:
+    void timerCallback() override;
+
+    void seek(double target, double speed);
+
+    void setRate(double newRate);
+
+    const MasterClock &clock;
+    Follower &follower;
+    double offset{0.0};
+    bool resyncRequested{false};
+
+    double error{0.0};
+    double drift{1.0};
+    double rate{0.0};
+    int numSeeks{0};
+
+    // Where both were at the last update, and the clock's speed, for measuring drift.
+    double lastClockSeconds{0.0};
+    double lastFollowerSeconds{0.0};
+    double lastSpeed{0.0};
+    bool hasLastUpdate{false};
+};
+
+
+#endif //GAIT_SONIFICATION_CLOCKFOLLOWER_H
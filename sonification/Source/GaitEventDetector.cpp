@@ -0,0 +1,461 @@
+//
+// Created by Tommy Rushton on 31/05/2022.
+//
+
+#include "GaitEventDetector.h"
+#include "Trace.h"
+
+GaitEventDetector::GaitEventDetector(juce::File &file) :
+        captureFile(file),
+        imuData(SAMPLE_BUFFER_LENGTH, {0.f, 0.f, 0.0}),
+        jerk(3, 0.f),
+        gaitEvents(EVENT_BUFFER_LENGTH, {GaitEventType::Unknown, Foot::Unknown, 0.0, 0, 0.f, 0.f}),
+        groundContacts(EVENT_BUFFER_LENGTH, {{
+                                                     GaitEventType::Unknown, Foot::Unknown, 0.0, 0, 0.f, 0.f
+                                             }, {
+                                                     GaitEventType::Unknown, Foot::Unknown, 0.0, 0, 0.f, 0.f
+                                             }, 0.f, Foot::Unknown}) {
+}
+
+GaitEventDetector::GaitEventDetector() : GaitEventDetector(noCaptureFile) {
+}
+
+bool GaitEventDetector::prepareToProcess() {
+    // Open the file
+    fileStream = std::make_unique<juce::FileInputStream>(captureFile);
+
+    if (!fileStream->openedOk())
+        return false;
+
+    // Get the header lines out of the way.
+    for (unsigned int l = 0; l < NUM_HEADER_LINES; ++l) {
+        fileStream->readNextLine();
+    }
+
+    reset();
+    isProcessing = true;
+    publishSnapshot();
+
+    return true;
+}
+
+void GaitEventDetector::prepareToProcessSamples() {
+    fileStream.reset();
+    reset();
+    isProcessing = true;
+    publishSnapshot();
+}
+
+void GaitEventDetector::processNextSample() {
+    TRACE_SCOPE("GaitEventDetector::processNextSample");
+    applySettings();
+    parseImuLine();
+
+    if (doneProcessing) {
+        isProcessing = false;
+        publishSnapshot();
+        return;
+    }
+
+    processCurrentSample();
+}
+
+void GaitEventDetector::processSample(float accelY, float gyroY, double captureTimeMs) {
+    TRACE_SCOPE("GaitEventDetector::processSample");
+    applySettings();
+    writeSample(accelY, gyroY, captureTimeMs);
+    processCurrentSample();
+}
+
+void GaitEventDetector::processCurrentSample() {
+    isProcessing = true;
+
+    ++elapsedSamples;
+
+    // Calculate jerk, over the time between the samples if the capture says it wasn't the nominal period.
+    auto currentAccelY = imuData.getCurrent().accelY;
+    auto sampleIntervalMs = imuData.getCurrent().timeMs - imuData.getPrevious().timeMs;
+    if (sampleIntervalMs <= 0.0) {
+        sampleIntervalMs = IMU_SAMPLE_PERIOD_MS;
+    }
+    jerk.write(
+            (currentAccelY - imuData.getPrevious().accelY) /
+            static_cast<float>(sampleIntervalMs * .001)
+    );
+
+    // Filter the gyro data.
+    auto currentGyroY = gyroFilter.processSample(imuData.getCurrent().gyroY);
+
+    auto j = jerk.getSamples(3);
+
+    // Looking for the last local minimum before a toe-off...
+    if (isInflection(j, InflectionType::Minimum)) {
+        lastLocalMinimum = currentAccelY;
+    }
+
+    // Detect stance reversal phase -- approaching a toe-off.
+    if (gaitPhase != GaitPhase::StanceReversal &&
+        jerk.getCurrent() > 0 &&
+        currentAccelY > STANCE_REVERSAL_WINDOW.first &&
+        currentAccelY < STANCE_REVERSAL_WINDOW.second &&
+        lastLocalMinimum < -1.5) {
+        gaitPhase = GaitPhase::StanceReversal;
+    }
+
+    if (isToeOff()) {
+        // Use sign of gyro for detecting L (+ve) vs R (-ve) foot.
+        // Make sure it's not the same foot again.
+        auto prevFoot = lastToeOff.foot;
+        auto nextFoot = currentGyroY > 0 ? Foot::Left : Foot::Right;
+
+        // ...but try to treat the gyro as authoritative.
+        if (nextFoot == prevFoot) {
+            if (canSwapFeet) {
+                nextFoot = nextFoot == Foot::Left ? Foot::Right : Foot::Left;
+                canSwapFeet = false;
+            } else {
+                canSwapFeet = true;
+            }
+        }
+
+        auto timestamp = imuData.getPrevious().timeMs;
+
+        auto toeOff = GaitEvent{
+                GaitEventType::ToeOff,
+                nextFoot,
+                timestamp,
+                elapsedSamples - 1,
+                imuData.getPrevious().accelY,
+                static_cast<float>(timestamp - lastToeOff.timeStampMs)
+        };
+
+        gaitEvents.write(toeOff);
+        ++numGaitEventsWritten;
+        lastToeOff = toeOff;
+
+        gaitPhase = GaitPhase::SwingReversal;
+
+        // Toe off marks the end of a ground contact. Register a ground contact
+        // if there's a preceding initial contact.
+        if (lastInitialContact.type == GaitEventType::InitialContact) {
+            auto groundContactTime = static_cast<float>(lastToeOff.timeStampMs - lastInitialContact.timeStampMs);
+//            if (groundContactTime < MAX_GCT_MS) {
+            groundContacts.write({lastInitialContact, lastToeOff, groundContactTime, nextFoot});
+            ++numGroundContactsWritten;
+            (nextFoot == Foot::Left ? leftGctMedian : rightGctMedian).write(groundContactTime);
+//            }
+        }
+
+        updateGroundContactInfo();
+    } else if (isInitialContact(currentAccelY)) {
+        auto timestamp = imuData.getPrevious(IC_LOOKBACK_SAMPS).timeMs;
+
+        auto initialContact = GaitEvent{
+                GaitEventType::InitialContact,
+                lastToeOff.foot == Foot::Right ? Foot::Left : Foot::Right,
+                timestamp,
+                elapsedSamples - IC_LOOKBACK_SAMPS,
+                imuData.getPrevious(IC_LOOKBACK_SAMPS).accelY,
+                static_cast<float>(timestamp - lastInitialContact.timeStampMs)
+        };
+
+        gaitEvents.write(initialContact);
+        ++numGaitEventsWritten;
+        lastInitialContact = initialContact;
+
+        gaitPhase = GaitPhase::Unknown;
+
+        updateGroundContactInfo();
+    }
+
+    gctBalance.getNext();
+    cadence.getNext();
+    publishSnapshot();
+}
+
+bool GaitEventDetector::isInflection(std::vector<float> v, InflectionType type) {
+    // Expect most recent first...
+    switch (type) {
+        case InflectionType::Minimum:
+            return (v[0] > 0 && v[1] < 0) ||
+                   (v[0] > 0 && v[1] == 0 && v[2] < 0);
+        case InflectionType::Maximum:
+            return (v[0] < 0 && v[1] > 0) ||
+                   (v[0] < 0 && v[1] == 0 && v[2] > 0);
+    }
+}
+
+bool GaitEventDetector::isToeOff() {
+    // Detect toe-off via acceleration local maximum.
+    return gaitPhase == GaitPhase::StanceReversal &&
+           isInflection(jerk.getSamples(3), InflectionType::Maximum) &&
+           imuData.getPrevious().timeMs - lastInitialContact.timeStampMs > IC_TO_INTERVAL_MS;
+}
+
+bool GaitEventDetector::isInitialContact(float currentAccelY) {
+    // Detect initial contact. First high negative jerk event an arbitrary
+    // interval after last toe off.
+    return imuData.getPrevious().timeMs - lastToeOff.timeStampMs > TO_IC_INTERVAL_MS &&
+           jerk.getCurrent() < IC_JERK_THRESH &&
+           gaitPhase == GaitPhase::SwingReversal &&
+           currentAccelY < IC_ACCEL_THRESH;
+}
+
+
+void GaitEventDetector::parseImuLine() {
+    TRACE_SCOPE("GaitEventDetector::parseImuLine");
+    // Detect end of data.
+    if (fileStream->isExhausted()) {
+        doneProcessing = true;
+        return;
+    }
+
+    auto line = fileStream->readNextLine();
+    juce::StringArray fields;
+
+    do {
+        fields.add(line.upToFirstOccurrenceOf(",", false, true));
+        line = line.fromFirstOccurrenceOf(",", false, true);
+    } while (line != "");
+
+    if (fields[TRUNK_ACCEL_Y_INDEX] == "") {
+        doneProcessing = true;
+        return;
+    }
+
+    auto captureTimeMs = timestampSource == TimestampSource::Capture
+                         ? std::stod(fields[TRUNK_ACCEL_Y_SAMPLE_INDEX].toStdString()) * IMU_SAMPLE_PERIOD_MS : 0.0;
+    writeSample(std::stof(fields[TRUNK_ACCEL_Y_INDEX].toStdString()),
+                std::stof(fields[TRUNK_GYRO_Y_INDEX].toStdString()),
+                captureTimeMs);
+}
+
+void GaitEventDetector::writeSample(float accelY, float gyroY, double captureTimeMs) {
+    // The sample about to be processed.
+    auto sampleIndex = elapsedSamples + 1;
+    auto timeMs = static_cast<double>(sampleIndex) * IMU_SAMPLE_PERIOD_MS;
+    if (timestampSource == TimestampSource::Capture) {
+        if (sampleIndex == 1) {
+            captureTimeOriginMs = captureTimeMs - IMU_SAMPLE_PERIOD_MS;
+        }
+        timeMs = captureTimeMs - captureTimeOriginMs;
+    }
+
+    imuData.write({accelY, gyroY, timeMs});
+}
+
+bool GaitEventDetector::isDoneProcessing() const {
+    return doneProcessing;
+}
+
+void GaitEventDetector::reset() {
+    gyroFilter.reset();
+    elapsedSamples = 0;
+    timestampSource = requestedTimestampSource.load();
+    captureTimeOriginMs = 0.0;
+    imuData.clear();
+    jerk.clear();
+    gaitEvents.clear();
+    numGaitEventsWritten = 0;
+    lastToeOff = GaitEvent{};
+    lastInitialContact = GaitEvent{};
+    groundContacts.clear();
+    numGroundContactsWritten = 0;
+    leftGctMedian.clear();
+    rightGctMedian.clear();
+    gaitPhase = GaitPhase::Unknown;
+    lastLocalMinimum = 0.f;
+    gctBalance.set(.5f, true);
+    cadence.set(0.f, true);
+    currentGroundContactInfo = {{}, 0.f, 0.f, .5f, balanceEstimator};
+    doneProcessing = false;
+    ++generation;
+}
+
+void GaitEventDetector::stop(bool andReset) {
+    isProcessing = false;
+    if (andReset) {
+        reset();
+    }
+    publishSnapshot();
+}
+
+double GaitEventDetector::getCurrentTime() const {
+    return imuData.getCurrent().timeMs;
+}
+
+juce::int64 GaitEventDetector::getElapsedSamples() const {
+    return elapsedSamples;
+}
+
+GaitEventDetector::ImuSample GaitEventDetector::getCurrentSample() {
+    return imuData.getCurrent();
+}
+
+GaitEventDetector::GroundContactInfo GaitEventDetector::getGroundContactInfo() {
+    TRACE_SCOPE("GaitEventDetector::getGroundContactInfo");
+    auto nl{0}, nr{0};
+    auto tl{0.f}, tr{0.f};
+    auto gcs = groundContacts.getSamples(std::min(strideLookback, static_cast<unsigned int>(MAX_MEAN_STRIDE_LOOKBACK)) * 2);
+
+    if (balanceEstimator == BalanceEstimator::SlidingMedian) {
+        tl = leftGctMedian.getMedian(0.f);
+        tr = rightGctMedian.getMedian(0.f);
+        return {gcs, tl, tr, tl == 0 || tr == 0 ? .5f : tr / (tl + tr), balanceEstimator};
+    }
+
+    // Update GCT balance
+    for (auto gc: gcs) {
+        if (gc.duration > 0) {
+            switch (gc.foot) {
+                case Foot::Left:
+                    ++nl;
+                    tl += gc.duration;
+                    break;
+                case Foot::Right:
+                    ++nr;
+                    tr += gc.duration;
+                    break;
+                case Foot::Unknown:
+                    break;
+            }
+        }
+    }
+
+    tl = nl == 0 ? 0 : tl / nl;
+    tr = nr == 0 ? 0 : tr / nr;
+
+    return {gcs, tl, tr, tl == 0 || tr == 0 ? .5f : tr / (tl + tr), balanceEstimator};
+}
+
+void GaitEventDetector::setStrideLookback(int numStrides) {
+    requestedStrideLookback = static_cast<unsigned int>(numStrides);
+}
+
+void GaitEventDetector::setBalanceEstimator(BalanceEstimator estimatorToUse) {
+    requestedBalanceEstimator = estimatorToUse;
+}
+
+void GaitEventDetector::setTimestampSource(TimestampSource sourceToUse) {
+    requestedTimestampSource = sourceToUse;
+}
+
+void GaitEventDetector::applySettings() {
+    auto lookback = requestedStrideLookback.load();
+    auto estimator = requestedBalanceEstimator.load();
+
+    if (lookback != strideLookback || estimator != balanceEstimator) {
+        strideLookback = lookback;
+        balanceEstimator = estimator;
+        // One contact per foot per stride.
+        leftGctMedian.setWindowSize(strideLookback);
+        rightGctMedian.setWindowSize(strideLookback);
+        updateGroundContactInfo();
+    }
+}
+
+void GaitEventDetector::updateGroundContactInfo() {
+    currentGroundContactInfo = getGroundContactInfo();
+    gctBalance.set(currentGroundContactInfo.balance);
+    cadence.set(calculateCadence());
+}
+
+float GaitEventDetector::getGtcBalance() {
+    return gctBalance.getCurrent();
+}
+
+float GaitEventDetector::getCadence() {
+    return cadence.getCurrent();
+}
+
+float GaitEventDetector::calculateCadence() {
+    auto numEvents{0};
+    auto totalTimeMs{0.f};
+    for (auto event: gaitEvents.getSamples(strideLookback * 4)) {
+        if (event.type == GaitEventType::ToeOff) {
+            ++numEvents;
+            totalTimeMs += event.interval;
+        }
+    }
+
+    if (numEvents == 0) {
+        return 0.f;
+    }
+
+    auto mean = (totalTimeMs / static_cast<float>(numEvents));
+    return 60000.f / mean;
+}
+
+bool GaitEventDetector::hasEventNow(GaitEventDetector::GaitEventType type) {
+    auto sampleOffset{0};
+    GaitEvent event{};
+    switch (type) {
+        case GaitEventType::Unknown:
+            return false;
+        case GaitEventType::ToeOff:
+            event = lastToeOff;
+            sampleOffset = 1;
+            break;
+        case GaitEventType::InitialContact:
+            event = lastInitialContact;
+            sampleOffset = IC_LOOKBACK_SAMPS;
+            break;
+    }
+    return event.sampleIndex == elapsedSamples - sampleOffset;
+}
+
+GaitEventDetector::GaitEvent GaitEventDetector::getLastEvent(GaitEventDetector::GaitEventType type) {
+    return type == GaitEventType::InitialContact ? lastInitialContact : lastToeOff;
+}
+
+const GaitEventDetector::Snapshot *GaitEventDetector::getLatestSnapshot() {
+    return snapshots.fetch() ? &snapshots.getReadBuffer() : nullptr;
+}
+
+void GaitEventDetector::publishSnapshot() {
+    auto &snapshot = snapshots.getWriteBuffer();
+    auto isUpToDate = snapshot.generation == generation;
+
+    snapshot.isProcessing = isProcessing;
+    snapshot.elapsedTimeMs = getCurrentTime();
+
+    // Copy only the samples this buffer hasn't already got; usually just the latest one.
+    auto numSamples = std::min<juce::int64>(elapsedSamples, SAMPLE_BUFFER_LENGTH);
+    if (isUpToDate && snapshot.elapsedSamples <= elapsedSamples) {
+        numSamples = std::min(numSamples, elapsedSamples - snapshot.elapsedSamples);
+    }
+    for (auto n = elapsedSamples - numSamples + 1; n <= elapsedSamples && numSamples > 0; ++n) {
+        snapshot.accelY[static_cast<size_t>(n % SAMPLE_BUFFER_LENGTH)] =
+                imuData.getPrevious(static_cast<unsigned int>(elapsedSamples - n)).accelY;
+    }
+    snapshot.elapsedSamples = elapsedSamples;
+
+    if (!isUpToDate || snapshot.numGaitEventsWritten != numGaitEventsWritten) {
+        snapshot.numGaitEvents = std::min(numGaitEventsWritten, EVENT_BUFFER_LENGTH);
+        for (unsigned int n = 0; n < snapshot.numGaitEvents; ++n) {
+            snapshot.gaitEvents[n] = gaitEvents.getPrevious(snapshot.numGaitEvents - 1 - n);
+        }
+        snapshot.numGaitEventsWritten = numGaitEventsWritten;
+    }
+
+    if (!isUpToDate || snapshot.numGroundContactsWritten != numGroundContactsWritten) {
+        snapshot.numGroundContacts = std::min(numGroundContactsWritten, EVENT_BUFFER_LENGTH);
+        for (unsigned int n = 0; n < snapshot.numGroundContacts; ++n) {
+            snapshot.groundContacts[n] = groundContacts.getPrevious(snapshot.numGroundContacts - 1 - n);
+        }
+        snapshot.numGroundContactsWritten = numGroundContactsWritten;
+    }
+
+    snapshot.numGroundContactsInLookback = std::min(
+            std::min(strideLookback, static_cast<unsigned int>(MAX_MEAN_STRIDE_LOOKBACK)) * 2,
+            snapshot.numGroundContacts
+    );
+    snapshot.leftGctMs = currentGroundContactInfo.leftAvgMs;
+    snapshot.rightGctMs = currentGroundContactInfo.rightAvgMs;
+    snapshot.estimator = currentGroundContactInfo.estimator;
+    snapshot.balance = gctBalance.getCurrent();
+    snapshot.cadence = cadence.getCurrent();
+    snapshot.generation = generation;
+
+    snapshots.publish();
+}
@@ -0,0 +1,337 @@
+//
+// Created by Tommy Rushton on 31/05/2022.
+//
+
+#ifndef GAIT_SONIFICATION_GAITEVENTDETECTOR_H
+#define GAIT_SONIFICATION_GAITEVENTDETECTOR_H
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include "CircularBuffer.h"
+#include "BiquadFilter.h"
+#include "SmoothedParameter.h"
+#include "SlidingMedian.h"
+#include "TripleBuffer.h"
+
+/**
+ * Detects gait events in IMU capture data, one sample at a time. Samples are read from a capture file, or passed in
+ * from elsewhere, e.g. a live stream.
+ *
+ * Processing happens on whichever thread calls processNextSample() or processSample(). After each sample the detector
+ * publishes an immutable Snapshot of its state, which a display can pick up on another thread via getLatestSnapshot()
+ * without locking or blocking the processing thread.
+ */
+class GaitEventDetector {
+public:
+    static constexpr float IMU_SAMPLE_PERIOD_MS{6.75f};
+    // The maximum number of strides over which the mean GCT can be calculated.
+    static constexpr int MAX_MEAN_STRIDE_LOOKBACK{10};
+    // The maximum number of strides over which the median GCT can be calculated.
+    static constexpr int MAX_MEDIAN_STRIDE_LOOKBACK{500};
+    // The number of recent samples held, and published to displays.
+    static constexpr unsigned int SAMPLE_BUFFER_LENGTH{5000};
+    // The number of recent gait events and ground contacts to hold on to.
+    static constexpr unsigned int EVENT_BUFFER_LENGTH{50};
+    // Capture files: header lines, then one line of comma-separated fields per IMU sample.
+    static constexpr unsigned int NUM_HEADER_LINES{215};
+    // Each channel's field follows an X field numbering that channel's samples; this is the trunk accel Y channel's.
+    // Field 0 is the EMG channel's, which is sampled at a different rate.
+    static constexpr unsigned int TRUNK_ACCEL_Y_SAMPLE_INDEX{4};
+    static constexpr unsigned int TRUNK_ACCEL_X_INDEX{3};
+    static constexpr unsigned int TRUNK_ACCEL_Y_INDEX{5};
+    static constexpr unsigned int TRUNK_ACCEL_Z_INDEX{7};
+    static constexpr unsigned int TRUNK_GYRO_X_INDEX{9};
+    static constexpr unsigned int TRUNK_GYRO_Y_INDEX{11};
+    static constexpr unsigned int TRUNK_GYRO_Z_INDEX{13};
+
+    enum class Foot {
+        Unknown,
+        Left,
+        Right
+    };
+
+    enum class GaitPhase {
+        Unknown,
+        // Phase between an initial contact and the next toe off.
+        StanceReversal,
+        // Phase between a toe off and the next initial contact.
+        SwingReversal
+    };
+
+    enum class GaitEventType {
+        Unknown,
+        ToeOff,
+        InitialContact
+    };
+
+    struct GaitEvent {
+        GaitEventType type;
+        Foot foot;
+        double timeStampMs;
+        juce::int64 sampleIndex;
+        float accelValue;
+        float interval;
+    };
+
+    struct GroundContact {
+        GaitEvent initialContact;
+        GaitEvent toeOff;
+        float duration;
+        Foot foot;
+    };
+
+    /**
+     * How the per-foot GCT used for the balance is estimated.
+     */
+    enum class BalanceEstimator {
+        // Mean of the contacts in the stride lookback.
+        Mean,
+        // Median of the contacts in the stride lookback; robust to spurious ground contacts.
+        SlidingMedian
+    };
+
+    struct GroundContactInfo {
+        std::vector<GroundContact> groundContacts;
+        float leftAvgMs;
+        float rightAvgMs;
+        float balance;
+        BalanceEstimator estimator;
+    };
+
+    /**
+     * Where sample times come from.
+     */
+    enum class TimestampSource {
+        // The sample count times the nominal sample period.
+        SampleClock,
+        // The capture's own sample numbers times the nominal sample period, relative to its first sample's; gaps in
+        // the numbering show up as gaps in time.
+        Capture
+    };
+
+    struct ImuSample {
+        float accelY, gyroY;
+        // Ms since the first sample, which is at IMU_SAMPLE_PERIOD_MS.
+        double timeMs;
+    };
+
+    /**
+     * The state of the detector after a given sample, for display. Fixed-size so that publishing one never allocates.
+     */
+    struct Snapshot {
+        bool isProcessing{false};
+        juce::int64 elapsedSamples{0};
+        double elapsedTimeMs{0.0};
+
+        // The most recent accelY samples, indexed by sample index modulo SAMPLE_BUFFER_LENGTH.
+        std::array<float, SAMPLE_BUFFER_LENGTH> accelY{};
+
+        /**
+         * @return The number of samples available, up to and including sample elapsedSamples.
+         */
+        unsigned int getNumSamples() const {
+            return static_cast<unsigned int>(std::min<juce::int64>(elapsedSamples, SAMPLE_BUFFER_LENGTH));
+        }
+
+        float getAccelY(juce::int64 sampleIndex) const {
+            return accelY[static_cast<size_t>(sampleIndex % SAMPLE_BUFFER_LENGTH)];
+        }
+
+        // The most recent gait events and ground contacts, oldest first.
+        std::array<GaitEvent, EVENT_BUFFER_LENGTH> gaitEvents{};
+        unsigned int numGaitEvents{0};
+        // The total number written since the detector was reset.
+        unsigned int numGaitEventsWritten{0};
+        std::array<GroundContact, EVENT_BUFFER_LENGTH> groundContacts{};
+        unsigned int numGroundContacts{0};
+        unsigned int numGroundContactsWritten{0};
+        // How many of the most recent ground contacts are in the stride lookback.
+        unsigned int numGroundContactsInLookback{0};
+
+        float leftGctMs{0.f};
+        float rightGctMs{0.f};
+        BalanceEstimator estimator{BalanceEstimator::Mean};
+        // Smoothed GCT balance, 0 (L) to 1 (R).
+        float balance{.5f};
+        // Smoothed cadence, steps/min.
+        float cadence{0.f};
+
+        // Incremented each time the detector is reset; sample and event data from another generation is stale.
+        unsigned int generation{0};
+    };
+
+    explicit GaitEventDetector(juce::File &file);
+
+    /**
+     * A detector without a capture file, for samples passed to processSample().
+     */
+    GaitEventDetector();
+
+    bool prepareToProcess();
+
+    /**
+     * Get ready to process samples passed to processSample(), rather than read from the capture file.
+     */
+    void prepareToProcessSamples();
+
+    /**
+     * Read the next sample from the capture file and process it.
+     */
+    void processNextSample();
+
+    /**
+     * Process a sample from elsewhere. The capture time is used if the timestamp source is Capture.
+     */
+    void processSample(float accelY, float gyroY, double captureTimeMs);
+
+    void stop(bool andReset = false);
+
+    bool isDoneProcessing() const;
+
+    /**
+     * @return The time of the sample most recently processed, in ms.
+     */
+    double getCurrentTime() const;
+
+    juce::int64 getElapsedSamples() const;
+
+    /**
+     * @return The IMU sample most recently processed.
+     */
+    ImuSample getCurrentSample();
+
+    GroundContactInfo getGroundContactInfo();
+
+    /**
+     * May be called from any thread; takes effect on the next sample processed.
+     */
+    void setStrideLookback(int numStrides);
+
+    /**
+     * May be called from any thread; takes effect on the next sample processed.
+     */
+    void setBalanceEstimator(BalanceEstimator estimatorToUse);
+
+    /**
+     * May be called from any thread; takes effect when the detector is next prepared or reset. Captures without
+     * timestamps should use the sample clock, the default.
+     */
+    void setTimestampSource(TimestampSource sourceToUse);
+
+    float getGtcBalance();
+
+    float getCadence();
+
+    bool hasEventNow(GaitEventType);
+
+    /**
+     * @return The most recent event of the given type, toe-off or initial contact.
+     */
+    GaitEvent getLastEvent(GaitEventType);
+
+    /**
+     * Get the most recently published snapshot. Must only be called from one thread, i.e. by one display.
+     * @return nullptr if nothing has been published since the last call.
+     */
+    const Snapshot *getLatestSnapshot();
+
+private:
+    enum class InflectionType {
+        Minimum,
+        Maximum
+    };
+
+    // AccelY must be in this window to detect stance reversal.
+    const std::pair<float, float> STANCE_REVERSAL_WINDOW{-1.2f, -.5f};
+    // Jerk threshold for initial contact detection.
+    static constexpr float IC_JERK_THRESH{-12.5f};
+    // Acceleration threshold for initial contact detection.
+    static constexpr float IC_ACCEL_THRESH{-1.f};
+    // Minimum time interval between a toe-off and the following initial contact.
+    static constexpr float TO_IC_INTERVAL_MS{75.f};
+    // Minimum time interval between an initial contact and the following toe-off.
+    static constexpr float IC_TO_INTERVAL_MS{125.f};
+    // Based one the above, initial contact happened this many samples ago:
+    static constexpr int IC_LOOKBACK_SAMPS{4};
+    // Ground contact probably won't exceed this duration.
+    static constexpr float MAX_GCT_MS{750};
+    // Per-sample smoothing applied to GCT balance and cadence: 1 - (1 - .1)^(30 Hz * IMU_SAMPLE_PERIOD_MS), the
+    // same ~316 ms time constant as the q of .1 once applied per 30 Hz repaint.
+    static constexpr float SMOOTHING_Q{.0211f};
+
+    void parseImuLine();
+
+    void writeSample(float accelY, float gyroY, double captureTimeMs);
+
+    /**
+     * Look for gait events up to the sample just written.
+     */
+    void processCurrentSample();
+
+    static bool isInflection(std::vector<float> v, InflectionType type);
+
+    bool isToeOff();
+
+    bool isInitialContact(float currentAccelY);
+
+    void reset();
+
+    /**
+     * Apply any stride lookback or estimator changes requested from other threads.
+     */
+    void applySettings();
+
+    void updateGroundContactInfo();
+
+    float calculateCadence();
+
+    void publishSnapshot();
+
+    // What captureFile refers to if there isn't one.
+    juce::File noCaptureFile;
+    juce::File &captureFile;
+    std::unique_ptr<juce::FileInputStream> fileStream;
+
+    bool doneProcessing{false};
+    bool isProcessing{false};
+    unsigned int generation{0};
+    // Counts samples since the start; times are derived from it, or taken from the capture, never accumulated.
+    juce::int64 elapsedSamples{0};
+    std::atomic<TimestampSource> requestedTimestampSource{TimestampSource::SampleClock};
+    TimestampSource timestampSource{TimestampSource::SampleClock};
+    // What the capture's timestamps are relative to.
+    double captureTimeOriginMs{0.0};
+
+    CircularBuffer<ImuSample> imuData;
+    CircularBuffer<float> jerk;
+
+    std::atomic<unsigned int> requestedStrideLookback{4};
+    unsigned int strideLookback{4};
+
+    GaitPhase gaitPhase{GaitPhase::Unknown};
+    float lastLocalMinimum{0.f};
+
+    CircularBuffer<GaitEvent> gaitEvents;
+    unsigned int numGaitEventsWritten{0};
+    bool canSwapFeet{true};
+    GaitEvent lastToeOff;
+    GaitEvent lastInitialContact;
+    CircularBuffer<GroundContact> groundContacts;
+    unsigned int numGroundContactsWritten{0};
+    GroundContactInfo currentGroundContactInfo;
+    std::atomic<BalanceEstimator> requestedBalanceEstimator{BalanceEstimator::Mean};
+    BalanceEstimator balanceEstimator{BalanceEstimator::Mean};
+    SlidingMedian<float> leftGctMedian{4};
+    SlidingMedian<float> rightGctMedian{4};
+    SmoothedParameter<float> gctBalance{.5f, SMOOTHING_Q};
+    SmoothedParameter<float> cadence{0.f, SMOOTHING_Q};
+
+    BiquadFilter gyroFilter{0.002943989366965, 0.005887978733929, 0.002943989366965,
+                            1.840758682071433, -0.852534639539291};
+
+    TripleBuffer<Snapshot> snapshots;
+};
+
+
+#endif //GAIT_SONIFICATION_GAITEVENTDETECTOR_H
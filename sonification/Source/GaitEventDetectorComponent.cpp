@@ -3,343 +3,200 @@
 //
 
 #include "GaitEventDetectorComponent.h"
+#include "Trace.h"
 #include "Utils.h"
 
+namespace {
+    // Displayed until the detector publishes something.
+    const GaitEventDetector::Snapshot emptySnapshot{};
+}
+
 GaitEventDetectorComponent::GaitEventDetectorComponent(
-        File &file,
+        GaitEventDetector &detectorToDisplay,
         float &toleratedAsymmetryThreshold,
         float &extremeAsymmetryThreshold
 ) :
-        captureFile(file),
-        imuData(500, {0.f, 0.f}),
-        jerk(3, 0.f),
-        gaitEvents(50, {GaitEventType::Unknown, Foot::Unknown, 0.f, 0, 0.f, 0.f}),
-        groundContacts(50, {{
-                                    GaitEventType::Unknown, Foot::Unknown, 0.f, 0, 0.f, 0.f
-                            }, {
-                                    GaitEventType::Unknown, Foot::Unknown, 0.f, 0, 0.f, 0.f
-                            }, 0.f, Foot::Unknown}),
+        detector(detectorToDisplay),
+        snapshot(&emptySnapshot),
         asymmetryThresholdLow(toleratedAsymmetryThreshold),
         asymmetryThresholdHigh(extremeAsymmetryThreshold) {
+    accelPlot.setLookback(DEFAULT_PLOT_LOOKBACK);
+    startTimerHz(DISPLAY_RATE_HZ);
 }
 
-bool GaitEventDetectorComponent::prepareToProcess() {
-    // Open the file
-    fileStream = std::make_unique<juce::FileInputStream>(captureFile);
-
-    if (!fileStream->openedOk())
-        return false;
-
-    // Get the header lines out of the way.
-    for (unsigned int l = 0; l < NUM_HEADER_LINES; ++l) {
-        fileStream->readNextLine();
-    }
-
-    reset();
-    startTimerHz(30);
-
-    return true;
+GaitEventDetectorComponent::~GaitEventDetectorComponent() {
+    stopTimer();
 }
 
-void GaitEventDetectorComponent::processNextSample() {
-    parseImuLine();
-
-    if (doneProcessing) {
-        stopTimer();
-        return;
+void GaitEventDetectorComponent::paint(Graphics &g) {
+    TRACE_SCOPE("GaitEventDetectorComponent::paint");
+
+    // Render at the physical resolution of the display so the cached layer stays sharp.
+    auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (!staticLayerIsValid ||
+        staticLayerThresholdLow != asymmetryThresholdLow ||
+        staticLayerThresholdHigh != asymmetryThresholdHigh ||
+        staticLayer.getWidth() != roundToInt(static_cast<float>(getWidth()) * scale)) {
+        renderStaticLayer(scale);
     }
 
-    ++elapsedSamples;
-    elapsedTimeMs += IMU_SAMPLE_PERIOD_MS;
+    g.drawImage(staticLayer, getLocalBounds().toFloat());
 
-    // Calculate jerk.
-    auto currentAccelY = imuData.getCurrent().accelY;
-    jerk.write(
-            (currentAccelY - imuData.getPrevious().accelY) /
-            (IMU_SAMPLE_PERIOD_MS * .001f)
-    );
+    updateAccelPlot(scale);
+    plotAccelerometerData(g);
 
-    // Filter the gyro data.
-    auto currentGyroY = gyroFilter.processSample(imuData.getCurrent().gyroY);
+    // List ground contact times
+    displayGctList(g);
+    // Draw GCT balance
+    displayGctBalance(g);
+}
 
-    auto j = jerk.getSamples(3);
+void GaitEventDetectorComponent::renderStaticLayer(float scale) {
+    TRACE_SCOPE("GaitEventDetectorComponent::renderStaticLayer");
+    staticLayer = juce::Image{juce::Image::ARGB,
+                              std::max(1, roundToInt(static_cast<float>(getWidth()) * scale)),
+                              std::max(1, roundToInt(static_cast<float>(getHeight()) * scale)),
+                              true};
+    juce::Graphics g{staticLayer};
+    g.addTransform(juce::AffineTransform::scale(scale));
 
-    // Looking for the last local minimum before a toe-off...
-    if (isInflection(j, InflectionType::Minimum)) {
-        lastLocalMinimum = currentAccelY;
-    }
+    g.setColour(juce::Colours::grey);
+    g.drawRect(getLocalBounds(), 1);   // draw an outline around the component
 
-    // Detect stance reversal phase -- approaching a toe-off.
-    if (gaitPhase != GaitPhase::StanceReversal &&
-        jerk.getCurrent() > 0 &&
-        currentAccelY > STANCE_REVERSAL_WINDOW.first &&
-        currentAccelY < STANCE_REVERSAL_WINDOW.second &&
-        lastLocalMinimum < -1.5) {
-        gaitPhase = GaitPhase::StanceReversal;
-    }
+    // Draw an x-axis for the accelerometer plot.
+    g.drawHorizontalLine(floor(static_cast<float>(getHeight()) * ACCEL_PLOT_Y_ZERO_POSITION), 0.f,
+                         static_cast<float>(getRight()));
 
-    if (isToeOff()) {
-        // Use sign of gyro for detecting L (+ve) vs R (-ve) foot.
-        // Make sure it's not the same foot again.
-        auto prevFoot = lastToeOff.foot;
-        auto nextFoot = currentGyroY > 0 ? Foot::Left : Foot::Right;
-
-        // ...but try to treat the gyro as authoritative.
-        if (nextFoot == prevFoot) {
-            if (canSwapFeet) {
-                nextFoot = nextFoot == Foot::Left ? Foot::Right : Foot::Left;
-                canSwapFeet = false;
-            } else {
-                canSwapFeet = true;
-            }
-        }
+    drawGctListHeaders(g);
+    drawBalanceIndicatorScale(g);
 
-        auto toeOff = GaitEvent{
-                GaitEventType::ToeOff,
-                nextFoot,
-                elapsedTimeMs - IMU_SAMPLE_PERIOD_MS,
-                elapsedSamples - 1,
-                imuData.getPrevious().accelY,
-                elapsedTimeMs - IMU_SAMPLE_PERIOD_MS - lastToeOff.timeStampMs
-        };
-
-        gaitEvents.write(toeOff);
-        lastToeOff = toeOff;
-
-        gaitPhase = GaitPhase::SwingReversal;
-
-        // Toe off marks the end of a ground contact. Register a ground contact
-        // if there's a preceding initial contact.
-        if (lastInitialContact.type == GaitEventType::InitialContact) {
-            auto groundContactTime = lastToeOff.timeStampMs - lastInitialContact.timeStampMs;
-//            if (groundContactTime < MAX_GCT_MS) {
-            groundContacts.write({lastInitialContact, lastToeOff, groundContactTime, nextFoot});
-//            }
-        }
-    } else if (isInitialContact(currentAccelY)) {
-        auto timestamp = elapsedTimeMs - IC_LOOKBACK_SAMPS * IMU_SAMPLE_PERIOD_MS;
-
-        auto initialContact = GaitEvent{
-                GaitEventType::InitialContact,
-                lastToeOff.foot == Foot::Right ? Foot::Left : Foot::Right,
-                timestamp,
-                elapsedSamples - IC_LOOKBACK_SAMPS,
-                imuData.getPrevious(IC_LOOKBACK_SAMPS).accelY,
-                timestamp - lastInitialContact.timeStampMs
-        };
-
-        gaitEvents.write(initialContact);
-        lastInitialContact = initialContact;
-
-        gaitPhase = GaitPhase::Unknown;
-    }
+    staticLayerThresholdLow = asymmetryThresholdLow;
+    staticLayerThresholdHigh = asymmetryThresholdHigh;
+    staticLayerIsValid = true;
 }
 
-bool GaitEventDetectorComponent::isInflection(std::vector<float> v, InflectionType type) {
-    // Expect most recent first...
-    switch (type) {
-        case InflectionType::Minimum:
-            return (v[0] > 0 && v[1] < 0) ||
-                   (v[0] > 0 && v[1] == 0 && v[2] < 0);
-        case InflectionType::Maximum:
-            return (v[0] < 0 && v[1] > 0) ||
-                   (v[0] < 0 && v[1] == 0 && v[2] > 0);
+void GaitEventDetectorComponent::plotAccelerometerData(Graphics &g) {
+    TRACE_SCOPE("GaitEventDetectorComponent::plotAccelerometerData");
+    if (snapshot->isProcessing) {
+        accelPlot.draw(g, getLocalBounds());
     }
 }
 
-bool GaitEventDetectorComponent::isToeOff() {
-    // Detect toe-off via acceleration local maximum.
-    return gaitPhase == GaitPhase::StanceReversal &&
-           isInflection(jerk.getSamples(3), InflectionType::Maximum) &&
-           (elapsedTimeMs - IMU_SAMPLE_PERIOD_MS) - lastInitialContact.timeStampMs > IC_TO_INTERVAL_MS;
-}
-
-bool GaitEventDetectorComponent::isInitialContact(float currentAccelY) {
-    // Detect initial contact. First high negative jerk event an arbitrary
-    // interval after last toe off.
-    return (elapsedTimeMs - IMU_SAMPLE_PERIOD_MS) - lastToeOff.timeStampMs > TO_IC_INTERVAL_MS &&
-           jerk.getCurrent() < IC_JERK_THRESH &&
-           gaitPhase == GaitPhase::SwingReversal &&
-           currentAccelY < IC_ACCEL_THRESH;
-}
-
-
-void GaitEventDetectorComponent::parseImuLine() {
-    // Detect end of data.
-    if (fileStream->isExhausted()) {
-        doneProcessing = true;
-        return;
+void GaitEventDetectorComponent::updateAccelPlot(float scale) {
+    TRACE_SCOPE("GaitEventDetectorComponent::updateAccelPlot");
+    auto newestSample = snapshot->elapsedSamples;
+    auto lastPlotted = accelPlot.getLastSampleIndex();
+    auto numNewSamples = newestSample - lastPlotted;
+
+    if (accelPlot.setSize(getWidth(), getHeight(), scale) ||
+        accelPlotGeneration != snapshot->generation ||
+        lastPlotted < 0 ||
+        numNewSamples < 0 ||
+        numNewSamples >= accelPlot.getLookback()) {
+        rebuildAccelPlot();
+    } else {
+        auto yZero = static_cast<float>(getHeight()) * ACCEL_PLOT_Y_ZERO_POSITION;
+        for (auto n = lastPlotted + 1; n <= newestSample; ++n) {
+            accelPlot.appendSample(n,
+                                   yZero - snapshot->getAccelY(n) * PLOT_Y_SCALING,
+                                   Colours::lightgrey);
+        }
     }
 
-    auto line = fileStream->readNextLine();
-    juce::StringArray fields;
-
-    do {
-        fields.add(line.upToFirstOccurrenceOf(",", false, true));
-        line = line.fromFirstOccurrenceOf(",", false, true);
-    } while (line != "");
-
-    if (fields[TRUNK_ACCEL_Y_INDEX] == "") {
-        doneProcessing = true;
-        return;
+    // Mark any events that have happened since the last update, oldest first.
+    auto numNewEvents = std::min(snapshot->numGaitEventsWritten - numGaitEventsPlotted, snapshot->numGaitEvents);
+    for (auto n = snapshot->numGaitEvents - numNewEvents; n < snapshot->numGaitEvents; ++n) {
+        plotEvent(snapshot->gaitEvents[n]);
     }
+    numGaitEventsPlotted = snapshot->numGaitEventsWritten;
 
-    imuData.write({std::stof(fields[TRUNK_ACCEL_Y_INDEX].toStdString()),
-                   std::stof(fields[TRUNK_GYRO_Y_INDEX].toStdString())});
-}
-
-bool GaitEventDetectorComponent::isDoneProcessing() const {
-    return doneProcessing;
-}
-
-void GaitEventDetectorComponent::reset() {
-    gyroFilter.reset();
-    elapsedTimeMs = 0.f;
-    elapsedSamples = 0;
-    imuData.clear();
-    jerk.clear();
-    gaitEvents.clear();
-    lastToeOff = GaitEvent{};
-    lastInitialContact = GaitEvent{};
-    groundContacts.clear();
-    gaitPhase = GaitPhase::Unknown;
-    lastLocalMinimum = 0.f;
-    gctBalance.set(.5f, true);
-    cadence.set(0.f, true);
-    doneProcessing = false;
+    auto numNewContacts = std::min(snapshot->numGroundContactsWritten - numGroundContactsPlotted,
+                                   snapshot->numGroundContacts);
+    for (auto n = snapshot->numGroundContacts - numNewContacts; n < snapshot->numGroundContacts; ++n) {
+        plotGroundContact(snapshot->groundContacts[n]);
+    }
+    numGroundContactsPlotted = snapshot->numGroundContactsWritten;
 }
 
-void GaitEventDetectorComponent::paint(Graphics &g) {
-    g.setColour(juce::Colours::grey);
-    g.drawRect(getLocalBounds(), 1);   // draw an outline around the component
-
-    plotAccelerometerData(g);
+void GaitEventDetectorComponent::rebuildAccelPlot() {
+    TRACE_SCOPE("GaitEventDetectorComponent::rebuildAccelPlot");
+    accelPlot.clear();
+    accelPlotGeneration = snapshot->generation;
+
+    auto newestSample = snapshot->elapsedSamples;
+    auto yZero = static_cast<float>(getHeight()) * ACCEL_PLOT_Y_ZERO_POSITION;
+    auto numSamples = std::min(static_cast<juce::int64>(accelPlot.getLookback()),
+                               static_cast<juce::int64>(snapshot->getNumSamples()));
+    for (auto n = newestSample - numSamples + 1; n <= newestSample && numSamples > 0; ++n) {
+        accelPlot.appendSample(n, yZero - snapshot->getAccelY(n) * PLOT_Y_SCALING, Colours::lightgrey);
+    }
 
-    // List ground contact times
-    displayGctList(g);
-    // Draw GCT balance
-    displayGctBalance(g);
+    // Have the update redraw whatever is still held in the snapshot.
+    numGaitEventsPlotted = snapshot->numGaitEventsWritten - snapshot->numGaitEvents;
+    numGroundContactsPlotted = snapshot->numGroundContactsWritten - snapshot->numGroundContacts;
 }
 
-void GaitEventDetectorComponent::plotAccelerometerData(Graphics &g) {
-    // Draw an x-axis for the plot.
-    g.drawHorizontalLine(floor(static_cast<float>(getHeight()) * ACCEL_PLOT_Y_ZERO_POSITION), 0.f,
-                         static_cast<float>(getRight()));
-
-    if (isTimerRunning()) {
-        // Draw accelY
-        g.setColour(Colours::lightgrey);
-        g.strokePath(generateAccelYPath(), PathStrokeType(2.0f));
-
-        // Mark events
-        markEvents(g);
+void GaitEventDetectorComponent::plotEvent(const GaitEvent &event) {
+    auto top = static_cast<float>(getHeight()) * .5f;
+    auto bottom = static_cast<float>(getHeight());
+    juce::String text = "";
+    juce::Colour colour;
+    switch (event.foot) {
+        case Foot::Left:
+            text = "L";
+            colour = LEFT_COLOUR;
+            break;
+        case Foot::Right:
+            text = "R";
+            colour = RIGHT_COLOUR;
+            break;
+        case Foot::Unknown:
+            break;
     }
-}
-
-juce::Path GaitEventDetectorComponent::generateAccelYPath() {
-    // Get the accelerometer data.
-    auto data = imuData.getSamples(PLOT_LOOKBACK);
-
-    auto width = static_cast<float>(getWidth());
-    auto height = static_cast<float>(getHeight());
-    auto right = static_cast<float>(getRight()) - static_cast<float>(getX());
 
-    // Y-axis is in the vertical middle of the component
-    auto yZero = height * ACCEL_PLOT_Y_ZERO_POSITION;
-
-    // Initialise path
-    juce::Path stringPath;
-
-    // Start path
-    stringPath.startNewSubPath(right, yZero - data[0].accelY * PLOT_Y_SCALING);
-    auto N = data.size();
-
-    // Visual spacing between points.
-    auto spacing = width / static_cast<float>(N - 1);
-    auto x = right - spacing;
-
-    for (unsigned long n = 1; n < N; ++n) {
-        auto newY = yZero - data[n].accelY * PLOT_Y_SCALING;
-
-        // Prevent NaN values throwing an exception.
-        if (isnan(newY)) {
-            newY = 0;
-        }
-
-        stringPath.lineTo(x, newY);
-        x -= spacing;
+    switch (event.type) {
+        case GaitEventType::ToeOff:
+            colour = colour.brighter(.2f);
+            text = "TO-" + text;
+            break;
+        case GaitEventType::InitialContact:
+            colour = colour.darker(.2f);
+            text = "IC-" + text;
+            break;
+        case GaitEventType::Unknown:
+            break;
     }
 
-    return stringPath;
+    // The label goes to the left of the marker, over samples that have already been plotted; anything to the right
+    // would be erased as new samples arrive.
+    accelPlot.markSample(event.sampleIndex, [=](Graphics &g, float x) {
+        g.setColour(colour);
+        g.drawVerticalLine(juce::roundToInt(x), top, bottom);
+        g.drawText(text, x - 53, top + 30, 50, 20, juce::Justification::centredRight);
+    });
 }
 
-void GaitEventDetectorComponent::markEvents(Graphics &g) {
-    unsigned int z = 0;
-    auto event = gaitEvents.getCurrent();
-    auto width = static_cast<float>(getWidth());
+void GaitEventDetectorComponent::plotGroundContact(const GroundContact &groundContact) {
     auto top = static_cast<float>(getHeight()) * .5f;
-    auto bottom = static_cast<float>(getBottom());
-    auto spacing = width / static_cast<float>(PLOT_LOOKBACK - 1);
-    auto plotSampleLimit = static_cast<int>(elapsedSamples) - PLOT_LOOKBACK;
-    while (event.type != GaitEventType::Unknown &&
-           static_cast<int>(event.sampleIndex) > plotSampleLimit) {
-        auto x = width - (elapsedSamples - event.sampleIndex) * spacing;
-        juce::String text = "";
-        juce::Colour colour;
-        switch (event.foot) {
-            case Foot::Left:
-                text = "L";
-                colour = LEFT_COLOUR;
-                break;
-            case Foot::Right:
-                text = "R";
-                colour = RIGHT_COLOUR;
-                break;
-            case Foot::Unknown:
-                break;
-        }
+    auto bottom = static_cast<float>(getHeight());
+    auto w = static_cast<float>(groundContact.toeOff.sampleIndex - groundContact.initialContact.sampleIndex) *
+             accelPlot.getSampleSpacing();
+    auto colour = groundContact.foot == Foot::Left ? LEFT_COLOUR : RIGHT_COLOUR;
+    auto text = juce::String{groundContact.duration} + " ms";
 
-        switch (event.type) {
-            case GaitEventType::ToeOff:
-                g.setColour(colour.brighter(.2f));
-                text = "TO-" + text;
-                break;
-            case GaitEventType::InitialContact:
-                g.setColour(colour.darker(.2f));
-                text = "IC-" + text;
-                break;
-            case GaitEventType::Unknown:
-                break;
-        }
-        g.drawVerticalLine(x, top, bottom);
-        g.drawText(text, x + 3, top + 30, 50, 20, juce::Justification::centredLeft);
-        event = gaitEvents.getPrevious(++z);
-    }
-
-    // Mark ground contact region.
-    z = 0;
-    auto gc = groundContacts.getCurrent();
-    while (gc.duration > 0 &&
-           static_cast<int>(gc.toeOff.sampleIndex) > plotSampleLimit) {
-        auto x = std::max(0.f, width - (elapsedSamples - gc.initialContact.sampleIndex) * spacing);
-        auto w = std::max(0.f, width - x - (elapsedSamples - gc.toeOff.sampleIndex) * spacing);
+    accelPlot.markSample(groundContact.initialContact.sampleIndex, [=](Graphics &g, float x) {
         g.setColour(juce::Colours::white.withAlpha(.025f));
         g.fillRect(x, top, w, bottom - top);
-        g.setColour(gc.foot == Foot::Left ? LEFT_COLOUR : RIGHT_COLOUR);
-        g.drawText(juce::String{gc.duration} + " ms",
-                   x, top + 10, w, 20, juce::Justification::centredRight);
-        gc = groundContacts.getPrevious(++z);
-    }
+        g.setColour(colour);
+        g.drawText(text, x, top + 10, w, 20, juce::Justification::centredRight);
+    });
 }
 
-void GaitEventDetectorComponent::displayGctList(Graphics &g) {
+void GaitEventDetectorComponent::drawGctListHeaders(Graphics &g) {
     auto x{static_cast<float>(getX())},
             y{10.f},
-            h{static_cast<float>(getHeight())},
             padding{10.f},
-            right{static_cast<float>(getRight())},
             columnWidth{90.f};
-    // List recent contact times
     g.setColour(juce::Colours::lightgrey);
     g.drawText("GCTs", x + padding, y, columnWidth * 2, 20, juce::Justification::centred);
     y += 20;
@@ -350,9 +207,20 @@ void GaitEventDetectorComponent::displayGctList(Graphics &g) {
     y += 20;
     g.setColour(juce::Colours::grey);
     g.drawHorizontalLine(y, x + padding, x + padding + columnWidth * 2);
-    y += 10;
+}
+
+void GaitEventDetectorComponent::displayGctList(Graphics &g) {
+    TRACE_SCOPE("GaitEventDetectorComponent::displayGctList");
+    // Headers are on the static layer; start below them.
+    auto x{static_cast<float>(getX())},
+            y{60.f},
+            padding{10.f},
+            columnWidth{90.f};
+    // List recent contact times
     auto n = 0;
-    for (auto gc: currentGroundContactInfo.groundContacts) {
+    // Most recent first.
+    for (auto i = snapshot->numGroundContacts; i > snapshot->numGroundContacts - snapshot->numGroundContactsInLookback;) {
+        auto &gc = snapshot->groundContacts[--i];
         if (gc.foot != Foot::Unknown) {
             g.setColour(gc.foot == Foot::Left ? LEFT_COLOUR : RIGHT_COLOUR);
             g.drawText(juce::String{gc.duration, 2} + " ms",
@@ -366,67 +234,78 @@ void GaitEventDetectorComponent::displayGctList(Graphics &g) {
     }
 
     // Display averages
-    if (currentGroundContactInfo.rightAvgMs > 0 && currentGroundContactInfo.leftAvgMs > 0) {
+    if (snapshot->rightGctMs > 0 && snapshot->leftGctMs > 0) {
         y = 230.f;
         g.setColour(juce::Colours::grey);
         g.drawHorizontalLine(y, x + padding, x + padding + columnWidth * 2);
         y += 10;
         g.setColour(juce::Colours::lightgrey);
-        g.drawText("Mean", x + padding, y, columnWidth * 2, 20, juce::Justification::centred);
+        g.drawText(snapshot->estimator == BalanceEstimator::SlidingMedian ? "Median" : "Mean",
+                   x + padding, y, columnWidth * 2, 20, juce::Justification::centred);
         y += 15;
         g.setColour(LEFT_COLOUR);
-        g.drawText(juce::String{currentGroundContactInfo.leftAvgMs, 2} + " ms",
+        g.drawText(juce::String{snapshot->leftGctMs, 2} + " ms",
                    x + padding, y, columnWidth, 20,
                    juce::Justification::centred);
         g.setColour(RIGHT_COLOUR);
-        g.drawText(juce::String{currentGroundContactInfo.rightAvgMs, 2} + " ms",
+        g.drawText(juce::String{snapshot->rightGctMs, 2} + " ms",
                    x + padding + columnWidth, y, columnWidth, 20,
                    juce::Justification::centred);
     }
 }
 
-void GaitEventDetectorComponent::displayGctBalance(Graphics &g) {
-    auto w{static_cast<float>(getWidth())},
-            h{static_cast<float>(getHeight())},
+GaitEventDetectorComponent::BalanceIndicatorGeometry GaitEventDetectorComponent::getBalanceIndicatorGeometry() const {
+    auto h{static_cast<float>(getHeight())},
             padding{10.f},
             right{static_cast<float>(getRight())},
             indicatorLeft{225.f},
-            indicatorWidth{right - indicatorLeft - 2.f * padding},
-            indicatorRight{indicatorLeft + indicatorWidth},
-            indicatorVcentre{floor(h * .25f)},
-            indicatorHcentre{indicatorLeft + indicatorWidth * .5f};
+            indicatorWidth{right - indicatorLeft - 2.f * padding};
+    return {indicatorLeft,
+            indicatorWidth,
+            indicatorLeft + indicatorWidth,
+            floor(h * .25f),
+            indicatorLeft + indicatorWidth * .5f};
+}
+
+void GaitEventDetectorComponent::drawBalanceIndicatorScale(Graphics &g) {
+    auto indicator = getBalanceIndicatorGeometry();
     // Markers for low/high asymmetry thresholds.
-    auto indicatorLow{((asymmetryThresholdLow * 100.f - 50.f) / 5.f) * indicatorWidth * .5f},
-            indicatorHigh{((asymmetryThresholdHigh * 100.f - 50.f) / 5.f) * indicatorWidth * .5f};
+    auto indicatorLow{((asymmetryThresholdLow * 100.f - 50.f) / 5.f) * indicator.width * .5f},
+            indicatorHigh{((asymmetryThresholdHigh * 100.f - 50.f) / 5.f) * indicator.width * .5f};
 
     // Draw line to represent 55L, 50:50, and 55R, plus a y-axis.
     g.setColour(juce::Colours::grey);
-    g.drawHorizontalLine(indicatorVcentre, indicatorLeft, indicatorRight);
-    g.drawVerticalLine(indicatorLeft, indicatorVcentre - 30, indicatorVcentre + 30);
-    g.drawVerticalLine(indicatorHcentre - indicatorHigh, indicatorVcentre - 20, indicatorVcentre + 20);
-    g.drawVerticalLine(indicatorHcentre - indicatorLow, indicatorVcentre - 10, indicatorVcentre + 10);
-    g.drawVerticalLine(indicatorHcentre, indicatorVcentre - 40, indicatorVcentre + 40);
-    g.drawVerticalLine(indicatorHcentre + indicatorLow, indicatorVcentre - 10, indicatorVcentre + 10);
-    g.drawVerticalLine(indicatorHcentre + indicatorHigh, indicatorVcentre - 20, indicatorVcentre + 20);
-    g.drawVerticalLine(indicatorRight, indicatorVcentre - 30, indicatorVcentre + 30);
+    g.drawHorizontalLine(indicator.vCentre, indicator.left, indicator.right);
+    g.drawVerticalLine(indicator.left, indicator.vCentre - 30, indicator.vCentre + 30);
+    g.drawVerticalLine(indicator.hCentre - indicatorHigh, indicator.vCentre - 20, indicator.vCentre + 20);
+    g.drawVerticalLine(indicator.hCentre - indicatorLow, indicator.vCentre - 10, indicator.vCentre + 10);
+    g.drawVerticalLine(indicator.hCentre, indicator.vCentre - 40, indicator.vCentre + 40);
+    g.drawVerticalLine(indicator.hCentre + indicatorLow, indicator.vCentre - 10, indicator.vCentre + 10);
+    g.drawVerticalLine(indicator.hCentre + indicatorHigh, indicator.vCentre - 20, indicator.vCentre + 20);
+    g.drawVerticalLine(indicator.right, indicator.vCentre - 30, indicator.vCentre + 30);
     g.setFont(10.);
 
     auto asymHighLabel = juce::String{asymmetryThresholdHigh * 100.f, 1} + "%";
     auto asymLowLabel = juce::String{asymmetryThresholdLow * 100.f, 1} + "%";
-    g.drawText("55% L", indicatorLeft - 20, indicatorVcentre - 40, 40, 10, juce::Justification::centredTop);
-    g.drawText(asymHighLabel + " L", indicatorHcentre - indicatorHigh - 20, indicatorVcentre - 30, 40, 10,
+    g.drawText("55% L", indicator.left - 20, indicator.vCentre - 40, 40, 10, juce::Justification::centredTop);
+    g.drawText(asymHighLabel + " L", indicator.hCentre - indicatorHigh - 20, indicator.vCentre - 30, 40, 10,
                juce::Justification::centredTop);
-    g.drawText(asymLowLabel + " L", indicatorHcentre - indicatorLow - 20, indicatorVcentre - 20, 40, 10,
+    g.drawText(asymLowLabel + " L", indicator.hCentre - indicatorLow - 20, indicator.vCentre - 20, 40, 10,
                juce::Justification::centredTop);
-    g.drawText("50%", indicatorHcentre - 20, indicatorVcentre - 50, 40, 10, juce::Justification::centredTop);
-    g.drawText(asymLowLabel + " R", indicatorHcentre + indicatorLow - 20, indicatorVcentre - 20, 40, 10,
+    g.drawText("50%", indicator.hCentre - 20, indicator.vCentre - 50, 40, 10, juce::Justification::centredTop);
+    g.drawText(asymLowLabel + " R", indicator.hCentre + indicatorLow - 20, indicator.vCentre - 20, 40, 10,
                juce::Justification::centredTop);
-    g.drawText(asymHighLabel + " R", indicatorHcentre + indicatorHigh - 20, indicatorVcentre - 30, 40, 10,
+    g.drawText(asymHighLabel + " R", indicator.hCentre + indicatorHigh - 20, indicator.vCentre - 30, 40, 10,
                juce::Justification::centredTop);
-    g.drawText("55% R", indicatorRight - 20, indicatorVcentre - 40, 40, 10, juce::Justification::centredTop);
+    g.drawText("55% R", indicator.right - 20, indicator.vCentre - 40, 40, 10, juce::Justification::centredTop);
+}
+
+void GaitEventDetectorComponent::displayGctBalance(Graphics &g) {
+    TRACE_SCOPE("GaitEventDetectorComponent::displayGctBalance");
+    auto indicator = getBalanceIndicatorGeometry();
 
     // Draw a marker to represent the GCT balance
-    auto balance = gctBalance.getNext();
+    auto balance = snapshot->balance;
     auto absBalance = fabsf(balance - .5f) + .5f;
     auto colour = juce::Colours::lightgrey;
     if (balance > asymmetryThresholdLow) {
@@ -440,7 +319,7 @@ void GaitEventDetectorComponent::displayGctBalance(Graphics &g) {
     }
     g.setColour(colour);
     auto markerProportion = 10.f * Utils::clamp(balance - .45f, 0.f, .1f);
-    g.fillRect((indicatorLeft + markerProportion * indicatorWidth) - 2.5f, indicatorVcentre - 30.f, 6.f, 60.f);
+    g.fillRect((indicator.left + markerProportion * indicator.width) - 2.5f, indicator.vCentre - 30.f, 6.f, 60.f);
 
     // Display GCT as text
     juce::String foot = balance > .5f ? "R" : balance < .5f ? "L" : "";
@@ -448,116 +327,49 @@ void GaitEventDetectorComponent::displayGctBalance(Graphics &g) {
     g.setFont(20.f);
     g.drawText(
             juce::String{balanceToDisplay, 2} + "% " + foot,
-            indicatorHcentre - 50, indicatorVcentre - 100, 100, 20,
+            indicator.hCentre - 50, indicator.vCentre - 100, 100, 20,
             juce::Justification::centredTop);
 
     // Display cadence.
     g.setColour(juce::Colours::lightgrey);
     g.setFont(14.f);
-    if (isTimerRunning()) {
+    if (snapshot->isProcessing) {
         g.drawText(
-                "Cadence: " + juce::String{cadence.getNext(), 2} + " steps/min",
-                indicatorRight - 200, 10, 200, 20,
+                "Cadence: " + juce::String{snapshot->cadence, 2} + " steps/min",
+                indicator.right - 200, 10, 200, 20,
                 juce::Justification::centredRight);
     }
 }
 
-void GaitEventDetectorComponent::resized() {}
-
-void GaitEventDetectorComponent::timerCallback() {
-    currentGroundContactInfo = getGroundContactInfo();
-    gctBalance.set(currentGroundContactInfo.balance);
-    cadence.set(calculateCadence());
-    this->repaint();
+void GaitEventDetectorComponent::resized() {
+    staticLayerIsValid = false;
 }
 
-void GaitEventDetectorComponent::stop(bool andReset) {
-    stopTimer();
-    if (andReset) {
-        reset();
-    }
-}
 
-float GaitEventDetectorComponent::getCurrentTime() const {
-    return elapsedTimeMs;
-}
-
-int GaitEventDetectorComponent::getElapsedSamples() const {
-    return static_cast<int>(elapsedSamples);
-}
+void GaitEventDetectorComponent::timerCallback() {
+    TRACE_SCOPE("GaitEventDetectorComponent::timerCallback");
+    if (auto latest = detector.getLatestSnapshot()) {
+        snapshot = latest;
+        repaint();
 
-GaitEventDetectorComponent::GroundContactInfo GaitEventDetectorComponent::getGroundContactInfo() {
-    auto nl{0}, nr{0};
-    auto tl{0.f}, tr{0.f};
-    auto gcs = groundContacts.getSamples(strideLookback * 2);
-    // Update GCT balance
-    for (auto gc: gcs) {
-        if (gc.duration > 0) {
-            switch (gc.foot) {
-                case Foot::Left:
-                    ++nl;
-                    tl += gc.duration;
-                    break;
-                case Foot::Right:
-                    ++nr;
-                    tr += gc.duration;
-                    break;
-                case Foot::Unknown:
-                    break;
-            }
+        if (onNewSnapshot != nullptr) {
+            onNewSnapshot();
         }
     }
-
-    tl = nl == 0 ? 0 : tl / nl;
-    tr = nr == 0 ? 0 : tr / nr;
-
-    return {gcs, tl, tr, tl == 0 || tr == 0 ? .5f : tr / (tl + tr)};
-}
-
-void GaitEventDetectorComponent::setStrideLookback(int numStrides) {
-    strideLookback = static_cast<unsigned int>(numStrides);
-}
-
-float GaitEventDetectorComponent::getGtcBalance() {
-    return gctBalance.getCurrent();
-}
-
-float GaitEventDetectorComponent::getCadence() {
-    return cadence.getCurrent();
 }
 
-float GaitEventDetectorComponent::calculateCadence() {
-    auto numEvents{0};
-    auto totalTimeMs{0.f};
-    for (auto event: gaitEvents.getSamples(strideLookback * 4)) {
-        if (event.type == GaitEventType::ToeOff) {
-            ++numEvents;
-            totalTimeMs += event.interval;
-        }
-    }
-
-    if (numEvents == 0) {
-        return 0.f;
+void GaitEventDetectorComponent::setPlotLookback(int numSamples) {
+    if (accelPlot.setLookback(juce::jlimit(MIN_PLOT_LOOKBACK, MAX_PLOT_LOOKBACK, numSamples))) {
+        repaint();
     }
+}
 
-    auto mean = (totalTimeMs / static_cast<float>(numEvents));
-    return 60000.f / mean;
+void GaitEventDetectorComponent::mouseWheelMove(const MouseEvent &, const MouseWheelDetails &wheel) {
+    // Scrolling up zooms in.
+    auto factor = std::pow(2.f, -wheel.deltaY * 2.f);
+    setPlotLookback(juce::roundToInt(static_cast<float>(accelPlot.getLookback()) * factor));
 }
 
-bool GaitEventDetectorComponent::hasEventNow(GaitEventDetectorComponent::GaitEventType type) {
-    auto sampleOffset{0};
-    GaitEvent event{};
-    switch (type) {
-        case GaitEventType::Unknown:
-            return false;
-        case GaitEventType::ToeOff:
-            event = lastToeOff;
-            sampleOffset = 1;
-            break;
-        case GaitEventType::InitialContact:
-            event = lastInitialContact;
-            sampleOffset = IC_LOOKBACK_SAMPS;
-            break;
-    }
-    return event.sampleIndex == elapsedSamples - sampleOffset;
+const GaitEventDetector::Snapshot &GaitEventDetectorComponent::getSnapshot() const {
+    return *snapshot;
 }
@@ -0,0 +1,189 @@
+/*
+  ==============================================================================
+
+    LatencyHarness.cpp
+
+  ==============================================================================
+*/
+
+#include "LatencyHarness.h"
+
+#include <numeric>
+#include <utility>
+
+LatencyHarness::LatencyHarness(Options optionsToUse) : options(std::move(optionsToUse)) {
+}
+
+juce::Result LatencyHarness::run() {
+    measurements.clear();
+    numSpuriousToeOffs = 0;
+    numSpuriousInitialContacts = 0;
+    outputLevel.clear();
+
+    SyntheticGait gait{options.gait};
+    for (auto &event: gait.getEvents()) {
+        measurements.push_back({event.type, event.timeMs});
+    }
+
+    juce::TemporaryFile captureFile{".csv"};
+    auto result = gait.writeCapture(captureFile.getFile());
+    if (result.failed()) {
+        return result;
+    }
+    auto capture = captureFile.getFile();
+    GaitEventDetector detector{capture};
+    if (!detector.prepareToProcess()) {
+        return juce::Result::fail("Failed to load synthetic capture from " + capture.getFullPathName());
+    }
+
+    engine.setMode(SonificationEngine::SynthRhythmic);
+    engine.setSynthPatch(options.patch, options.settings.synthDecayTime);
+    engine.prepareToPlay(options.sampleRate, options.blockSize);
+    juce::AudioBuffer<float> buffer{SonificationEngine::NUM_OUTPUT_CHANNELS, options.blockSize};
+    outputLevel.reserve(static_cast<size_t>((gait.getDurationMs() + TAIL_MS) * .001 * options.sampleRate)
+                        + static_cast<size_t>(options.blockSize));
+
+    engine.start(options.settings);
+
+    // The same jitter on every run.
+    juce::Random random{1};
+    auto nextArrivalMs{0.0}, nextProcessedMs{0.0};
+    juce::int64 numImuSamples{0};
+    auto scheduleNextImuSample = [&] {
+        auto nominalMs = static_cast<double>(++numImuSamples) * GaitEventDetector::IMU_SAMPLE_PERIOD_MS;
+        nextArrivalMs = std::max(nextArrivalMs, nominalMs + random.nextDouble() * options.arrivalJitterMs);
+        // Picked up on the timer's next tick.
+        nextProcessedMs = std::ceil(nextArrivalMs / options.timerIntervalMs) * options.timerIntervalMs;
+    };
+    scheduleNextImuSample();
+
+    auto imuDone{false};
+    auto endMs{0.0};
+    for (juce::int64 block = 0;; ++block) {
+        auto blockStartMs = static_cast<double>(block * options.blockSize) * 1000.0 / options.sampleRate;
+        if (imuDone && blockStartMs >= endMs) {
+            break;
+        }
+
+        // Whatever the timer processed before this callback is what the callback gets to hear about.
+        while (!imuDone && nextProcessedMs <= blockStartMs) {
+            detector.processNextSample();
+            if (detector.isDoneProcessing()) {
+                imuDone = true;
+                engine.stop();
+                endMs = blockStartMs + TAIL_MS;
+                break;
+            }
+
+            engine.update(detector, options.settings);
+            for (auto type: {GaitEventDetector::GaitEventType::ToeOff,
+                             GaitEventDetector::GaitEventType::InitialContact}) {
+                if (detector.hasEventNow(type)) {
+                    recordDetection(type, nextProcessedMs);
+                }
+            }
+            scheduleNextImuSample();
+        }
+
+        juce::AudioSourceChannelInfo bufferToFill{&buffer, 0, options.blockSize};
+        engine.getNextAudioBlock(bufferToFill);
+        for (auto i = 0; i < options.blockSize; ++i) {
+            auto level{0.f};
+            for (auto channel = 0; channel < buffer.getNumChannels(); ++channel) {
+                level = std::max(level, std::abs(buffer.getSample(channel, i)));
+            }
+            outputLevel.push_back(level);
+        }
+    }
+
+    for (auto &measurement: measurements) {
+        // Only toe-offs trigger notes.
+        if (measurement.type == GaitEventDetector::GaitEventType::ToeOff && measurement.detectedMs >= 0.0) {
+            findOnset(measurement);
+        }
+    }
+
+    return juce::Result::ok();
+}
+
+const std::vector<LatencyHarness::Measurement> &LatencyHarness::getMeasurements() const {
+    return measurements;
+}
+
+int LatencyHarness::getNumSpuriousDetections(GaitEventDetector::GaitEventType type) const {
+    switch (type) {
+        case GaitEventDetector::GaitEventType::ToeOff:
+            return numSpuriousToeOffs;
+        case GaitEventDetector::GaitEventType::InitialContact:
+            return numSpuriousInitialContacts;
+        case GaitEventDetector::GaitEventType::Unknown:
+            break;
+    }
+    return 0;
+}
+
+LatencyHarness::Statistics LatencyHarness::getStatistics(std::vector<double> values) {
+    Statistics statistics;
+    if (values.empty()) {
+        return statistics;
+    }
+
+    std::sort(values.begin(), values.end());
+    // Nearest rank.
+    auto percentile = [&values](double p) {
+        auto rank = static_cast<size_t>(std::ceil(p * static_cast<double>(values.size())));
+        return values[std::max(rank, static_cast<size_t>(1)) - 1];
+    };
+    statistics.count = static_cast<int>(values.size());
+    statistics.min = values.front();
+    statistics.median = percentile(.5);
+    statistics.p95 = percentile(.95);
+    statistics.max = values.back();
+    statistics.mean = std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+    return statistics;
+}
+
+void LatencyHarness::recordDetection(GaitEventDetector::GaitEventType type, double detectedMs) {
+    // Match the latest event of this type that has happened and isn't matched yet.
+    for (auto it = measurements.rbegin(); it != measurements.rend(); ++it) {
+        if (it->type != type || it->eventMs > detectedMs) {
+            continue;
+        }
+        if (it->detectedMs < 0.0 && detectedMs - it->eventMs <= MAX_DETECTION_LATENCY_MS) {
+            it->detectedMs = detectedMs;
+            return;
+        }
+        break;
+    }
+
+    if (type == GaitEventDetector::GaitEventType::ToeOff) {
+        ++numSpuriousToeOffs;
+    } else {
+        ++numSpuriousInitialContacts;
+    }
+}
+
+void LatencyHarness::findOnset(Measurement &measurement) const {
+    auto samplesPerMs = options.sampleRate * .001;
+    auto eventSample = static_cast<size_t>(std::ceil(measurement.eventMs * samplesPerMs));
+    auto baselineStart = eventSample - std::min(eventSample, static_cast<size_t>(ONSET_BASELINE_MS * samplesPerMs));
+    auto searchEnd = std::min(outputLevel.size(),
+                              eventSample + static_cast<size_t>(MAX_ONSET_LATENCY_MS * samplesPerMs));
+    if (eventSample >= searchEnd) {
+        return;
+    }
+
+    auto baseline{0.f};
+    for (auto n = baselineStart; n < eventSample; ++n) {
+        baseline = std::max(baseline, outputLevel[n]);
+    }
+    auto threshold = std::max(juce::Decibels::decibelsToGain(options.onsetFloorDb),
+                              baseline * juce::Decibels::decibelsToGain(options.onsetRiseDb));
+
+    for (auto n = eventSample; n < searchEnd; ++n) {
+        if (outputLevel[n] > threshold) {
+            measurement.onsetMs = static_cast<double>(n) / samplesPerMs + options.outputLatencyMs;
+            return;
+        }
+    }
+}
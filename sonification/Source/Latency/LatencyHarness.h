@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    LatencyHarness.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../SonificationEngine.h"
+#include "SyntheticGait.h"
+
+/**
+ * Measures the latency from a gait event happening to the sonification responding: first to the engine hearing of it,
+ * then to the note it triggers becoming audible.
+ *
+ * A synthetic capture with known event times is fed through the detector and engine on a simulated timeline that
+ * follows the app's: IMU samples arrive every sample period (plus any jitter), are processed on the next tick of a
+ * timer, and reach the audio when the next block is rendered. Onsets are then found in the rendered audio. What the
+ * render can't see, the audio device's own buffering, is added as a fixed output latency.
+ */
+class LatencyHarness {
+public:
+    struct Options {
+        SonificationEngine::SynthPatch patch{SonificationEngine::PatchDefault};
+        SonificationEngine::Settings settings;
+        SyntheticGait::Options gait;
+        double sampleRate{48000.0};
+        int blockSize{512};
+        // Period of the timer that processes IMU samples.
+        double timerIntervalMs{1.0};
+        // Up to this much random delay is added to each IMU sample's arrival; arrivals stay in order.
+        double arrivalJitterMs{0.0};
+        // The audio device's output latency.
+        double outputLatencyMs{0.0};
+        // An onset is where the output first rises this far above what was already playing, and above the floor.
+        float onsetRiseDb{20.f};
+        float onsetFloorDb{-60.f};
+    };
+
+    struct Measurement {
+        GaitEventDetector::GaitEventType type;
+        double eventMs;
+        // When the engine was updated with the event; negative if it never was.
+        double detectedMs{-1.0};
+        // When the event was heard; negative if no onset was found, or the event doesn't make a sound.
+        double onsetMs{-1.0};
+    };
+
+    struct Statistics {
+        int count{0};
+        double min{0.0}, median{0.0}, p95{0.0}, max{0.0}, mean{0.0};
+    };
+
+    explicit LatencyHarness(Options optionsToUse);
+
+    juce::Result run();
+
+    /**
+     * @return One measurement per event in the synthetic capture, from the last run.
+     */
+    const std::vector<Measurement> &getMeasurements() const;
+
+    /**
+     * @return Detections in the last run that matched no event in the capture.
+     */
+    int getNumSpuriousDetections(GaitEventDetector::GaitEventType type) const;
+
+    static Statistics getStatistics(std::vector<double> values);
+
+private:
+    // Detections further than this after the event they'd match are counted as spurious.
+    static constexpr double MAX_DETECTION_LATENCY_MS{250.0};
+    // How long after an event to look for its onset.
+    static constexpr double MAX_ONSET_LATENCY_MS{500.0};
+    // What was already playing is measured over this long before an event.
+    static constexpr double ONSET_BASELINE_MS{5.0};
+    // Rendered after the last IMU sample.
+    static constexpr double TAIL_MS{1000.0};
+
+    void recordDetection(GaitEventDetector::GaitEventType type, double detectedMs);
+
+    void findOnset(Measurement &measurement) const;
+
+    Options options;
+
+    SonificationEngine engine;
+    std::vector<Measurement> measurements;
+    int numSpuriousToeOffs{0}, numSpuriousInitialContacts{0};
+    // Peak level across channels, per output sample.
+    std::vector<float> outputLevel;
+};
@@ -0,0 +1,214 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Command-line tool that measures the latency from gait events to the
+    sonification's response, using a synthetic capture with known event times:
+
+        GaitSonificationLatency [options]
+
+        --patch=default|bell|reed|vibrato  Synth patch (default default)
+        --rate=<Hz>                     Sample rate (default 48000)
+        --block=<samples>               Audio block size (default 512)
+        --timer=<ms>                    IMU timer period (default 1)
+        --jitter=<ms>                   Maximum random delay to IMU sample
+                                        arrival (default 0)
+        --output-latency=<ms>           Audio device output latency (default 0)
+        --steps=<n>                     Steps in the capture (default 200)
+        --step-period=<ms>              Time between steps (default 600)
+        --csv=<file>                    Write each event's timings to a CSV
+        --max-latency=<ms>              Fail if the 95th percentile toe-off to
+                                        onset latency exceeds this
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "LatencyHarness.h"
+
+namespace {
+    void printUsage() {
+        std::cerr << "Usage: GaitSonificationLatency [--patch=default|bell|reed|vibrato] [--rate=<Hz>]"
+                     " [--block=<samples>] [--timer=<ms>] [--jitter=<ms>] [--output-latency=<ms>] [--steps=<n>]"
+                     " [--step-period=<ms>] [--csv=<file>] [--max-latency=<ms>]" << std::endl;
+    }
+
+    bool parseOptions(const juce::ArgumentList &args, LatencyHarness::Options &options) {
+        if (args.containsOption("--patch")) {
+            auto result = SonificationEngine::parsePatchName(args.getValueForOption("--patch"), options.patch);
+            if (result.failed()) {
+                std::cerr << result.getErrorMessage() << std::endl;
+                return false;
+            }
+        }
+
+        if (args.containsOption("--rate")) {
+            auto result = SonificationEngine::parseSampleRate(args.getValueForOption("--rate"), options.sampleRate);
+            if (result.failed()) {
+                std::cerr << result.getErrorMessage() << std::endl;
+                return false;
+            }
+        }
+
+        if (args.containsOption("--block")) {
+            options.blockSize = args.getValueForOption("--block").getIntValue();
+            if (options.blockSize < 1) {
+                std::cerr << "Invalid block size: " << options.blockSize << std::endl;
+                return false;
+            }
+        }
+
+        if (args.containsOption("--timer")) {
+            options.timerIntervalMs = args.getValueForOption("--timer").getDoubleValue();
+            if (options.timerIntervalMs <= 0.0) {
+                std::cerr << "Invalid timer period: " << options.timerIntervalMs << std::endl;
+                return false;
+            }
+        }
+
+        if (args.containsOption("--jitter")) {
+            options.arrivalJitterMs = std::max(0.0, args.getValueForOption("--jitter").getDoubleValue());
+        }
+
+        if (args.containsOption("--output-latency")) {
+            options.outputLatencyMs = std::max(0.0, args.getValueForOption("--output-latency").getDoubleValue());
+        }
+
+        if (args.containsOption("--steps")) {
+            options.gait.numSteps = args.getValueForOption("--steps").getIntValue();
+            if (options.gait.numSteps < 1) {
+                std::cerr << "Invalid number of steps: " << options.gait.numSteps << std::endl;
+                return false;
+            }
+        }
+
+        if (args.containsOption("--step-period")) {
+            options.gait.stepPeriodMs = args.getValueForOption("--step-period").getDoubleValue();
+            if (options.gait.stepPeriodMs < SyntheticGait::getMinStepPeriodMs()) {
+                std::cerr << "Step period must be at least " << SyntheticGait::getMinStepPeriodMs() << " ms"
+                          << std::endl;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    juce::String getEventName(GaitEventDetector::GaitEventType type) {
+        switch (type) {
+            case GaitEventDetector::GaitEventType::ToeOff:
+                return "toe-off";
+            case GaitEventDetector::GaitEventType::InitialContact:
+                return "initial contact";
+            case GaitEventDetector::GaitEventType::Unknown:
+                break;
+        }
+        return "unknown";
+    }
+
+    void printStatistics(const juce::String &label, const LatencyHarness::Statistics &statistics) {
+        std::cout << "  " << label.paddedRight(' ', 10);
+        if (statistics.count == 0) {
+            std::cout << "-" << std::endl;
+            return;
+        }
+        std::cout << "min " << juce::String(statistics.min, 2) << "  median " << juce::String(statistics.median, 2)
+                  << "  p95 " << juce::String(statistics.p95, 2) << "  max " << juce::String(statistics.max, 2)
+                  << "  mean " << juce::String(statistics.mean, 2) << " ms" << std::endl;
+    }
+
+    juce::Result writeCsv(const juce::File &file, const std::vector<LatencyHarness::Measurement> &measurements) {
+        file.deleteFile();
+        juce::FileOutputStream stream{file};
+        if (!stream.openedOk()) {
+            return juce::Result::fail("Failed to open " + file.getFullPathName() + " for writing");
+        }
+
+        stream << "event,event_ms,detected_ms,onset_ms\n";
+        for (auto &measurement: measurements) {
+            auto formatTime = [](double ms) { return ms < 0.0 ? juce::String{} : juce::String(ms, 3); };
+            stream << getEventName(measurement.type) << "," << juce::String(measurement.eventMs, 3) << ","
+                   << formatTime(measurement.detectedMs) << "," << formatTime(measurement.onsetMs) << "\n";
+        }
+
+        stream.flush();
+        return stream.getStatus();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    juce::ArgumentList args{argc, argv};
+
+    LatencyHarness::Options options;
+    if (!parseOptions(args, options)) {
+        printUsage();
+        return 1;
+    }
+
+    LatencyHarness harness{options};
+    auto result = harness.run();
+    if (result.failed()) {
+        std::cerr << result.getErrorMessage() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Sample rate " << options.sampleRate << " Hz, block " << options.blockSize << " samples, timer "
+              << options.timerIntervalMs << " ms, jitter " << options.arrivalJitterMs << " ms, output latency "
+              << options.outputLatencyMs << " ms" << std::endl;
+
+    LatencyHarness::Statistics toeOffOnsets;
+    for (auto type: {GaitEventDetector::GaitEventType::ToeOff, GaitEventDetector::GaitEventType::InitialContact}) {
+        std::vector<double> detectionLatencies, onsetLatencies;
+        auto numEvents{0};
+        for (auto &measurement: harness.getMeasurements()) {
+            if (measurement.type != type) {
+                continue;
+            }
+            ++numEvents;
+            if (measurement.detectedMs >= 0.0) {
+                detectionLatencies.push_back(measurement.detectedMs - measurement.eventMs);
+            }
+            if (measurement.onsetMs >= 0.0) {
+                onsetLatencies.push_back(measurement.onsetMs - measurement.eventMs);
+            }
+        }
+
+        auto detections = LatencyHarness::getStatistics(detectionLatencies);
+        auto onsets = LatencyHarness::getStatistics(onsetLatencies);
+        std::cout << getEventName(type) << ": " << numEvents << " events, " << detections.count << " detected, "
+                  << harness.getNumSpuriousDetections(type) << " spurious, " << onsets.count << " heard"
+                  << std::endl;
+        printStatistics("detected", detections);
+        printStatistics("heard", onsets);
+
+        if (type == GaitEventDetector::GaitEventType::ToeOff) {
+            toeOffOnsets = onsets;
+        }
+    }
+
+    if (args.containsOption("--csv")) {
+        auto csvFile = args.getFileForOption("--csv");
+        result = writeCsv(csvFile, harness.getMeasurements());
+        if (result.failed()) {
+            std::cerr << result.getErrorMessage() << std::endl;
+            return 1;
+        }
+    }
+
+    if (args.containsOption("--max-latency")) {
+        auto maxLatencyMs = args.getValueForOption("--max-latency").getDoubleValue();
+        if (toeOffOnsets.count == 0) {
+            std::cerr << "No toe-offs were heard" << std::endl;
+            return 1;
+        }
+        if (toeOffOnsets.p95 > maxLatencyMs) {
+            std::cerr << "Toe-off to onset latency p95 of " << toeOffOnsets.p95 << " ms exceeds " << maxLatencyMs
+                      << " ms" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
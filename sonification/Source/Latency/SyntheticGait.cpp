@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    SyntheticGait.cpp
+
+  ==============================================================================
+*/
+
+#include "SyntheticGait.h"
+
+SyntheticGait::SyntheticGait(const Options &options) {
+    auto samplesPerStep = std::max(static_cast<int>(std::lround(options.stepPeriodMs /
+                                                                GaitEventDetector::IMU_SAMPLE_PERIOD_MS)),
+                                   DROP_SAMPLES + RISE_SAMPLES + RECOVERY_SAMPLES);
+    auto numLeadInSamples = static_cast<int>(std::lround(options.leadInMs / GaitEventDetector::IMU_SAMPLE_PERIOD_MS));
+
+    auto addEvent = [this](GaitEventDetector::GaitEventType type) {
+        // The sample just added.
+        auto sampleIndex = static_cast<juce::int64>(samples.size());
+        events.push_back({type, sampleIndex,
+                          static_cast<double>(sampleIndex) * GaitEventDetector::IMU_SAMPLE_PERIOD_MS});
+    };
+
+    for (auto n = 0; n < numLeadInSamples; ++n) {
+        addSample(0.f, 1.f);
+    }
+
+    for (auto step = 0; step < options.numSteps; ++step) {
+        auto gyroY = step % 2 == 0 ? -1.f : 1.f;
+        auto stepStart = samples.size();
+
+        for (auto n = 1; n <= DROP_SAMPLES; ++n) {
+            addSample(MIN_ACCEL * static_cast<float>(n) / DROP_SAMPLES, gyroY);
+            if (n == 1) {
+                addEvent(GaitEventDetector::GaitEventType::InitialContact);
+            }
+        }
+        for (auto n = 1; n <= RISE_SAMPLES; ++n) {
+            addSample(MIN_ACCEL + (PEAK_ACCEL - MIN_ACCEL) * static_cast<float>(n) / RISE_SAMPLES, gyroY);
+        }
+        addEvent(GaitEventDetector::GaitEventType::ToeOff);
+        for (auto n = 1; n <= RECOVERY_SAMPLES; ++n) {
+            addSample(PEAK_ACCEL * (1.f - static_cast<float>(n) / RECOVERY_SAMPLES), gyroY);
+        }
+        while (samples.size() < stepStart + static_cast<size_t>(samplesPerStep)) {
+            addSample(0.f, gyroY);
+        }
+    }
+
+    // Rest after the last step, so its toe-off is followed by enough samples to be detected.
+    for (auto n = 0; n < numLeadInSamples; ++n) {
+        addSample(0.f, 1.f);
+    }
+}
+
+juce::Result SyntheticGait::writeCapture(const juce::File &file) const {
+    file.deleteFile();
+    juce::FileOutputStream stream{file};
+    if (!stream.openedOk()) {
+        return juce::Result::fail("Failed to open " + file.getFullPathName() + " for writing");
+    }
+
+    for (unsigned int l = 0; l < GaitEventDetector::NUM_HEADER_LINES; ++l) {
+        stream << "Synthetic gait\n";
+    }
+
+    juce::StringArray fields;
+    for (unsigned int i = 0; i <= GaitEventDetector::TRUNK_GYRO_Z_INDEX; ++i) {
+        fields.add("0");
+    }
+    juce::int64 sampleIndex{0};
+    for (auto &sample: samples) {
+        fields.set(GaitEventDetector::TRUNK_ACCEL_Y_SAMPLE_INDEX, juce::String(++sampleIndex));
+        fields.set(GaitEventDetector::TRUNK_ACCEL_Y_INDEX, juce::String(sample.first, 4));
+        fields.set(GaitEventDetector::TRUNK_GYRO_Y_INDEX, juce::String(sample.second, 4));
+        stream << fields.joinIntoString(",") << "\n";
+    }
+
+    stream.flush();
+    return stream.getStatus();
+}
+
+const std::vector<SyntheticGait::Event> &SyntheticGait::getEvents() const {
+    return events;
+}
+
+double SyntheticGait::getDurationMs() const {
+    return static_cast<double>(samples.size()) * GaitEventDetector::IMU_SAMPLE_PERIOD_MS;
+}
+
+double SyntheticGait::getMinStepPeriodMs() {
+    return (DROP_SAMPLES + RISE_SAMPLES + RECOVERY_SAMPLES) * GaitEventDetector::IMU_SAMPLE_PERIOD_MS;
+}
+
+void SyntheticGait::addSample(float accelY, float gyroY) {
+    samples.emplace_back(accelY, gyroY);
+}
@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    SyntheticGait.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../GaitEventDetector.h"
+
+/**
+ * A synthetic capture: trunk IMU data for a steady gait whose initial contacts and toe-offs happen at known samples.
+ *
+ * Each step is an idealised vertical trunk acceleration: a sharp drop at initial contact, a rise through the stance
+ * reversal window to a peak at toe-off, then a slow return to rest. The gyroscope's sign alternates from step to step,
+ * as it does between the feet.
+ */
+class SyntheticGait {
+public:
+    struct Options {
+        int numSteps{200};
+        // Initial contact to initial contact; at least getMinStepPeriodMs().
+        double stepPeriodMs{600.0};
+        // Rest before the first step, for the detector's filters to settle.
+        double leadInMs{1000.0};
+    };
+
+    struct Event {
+        GaitEventDetector::GaitEventType type;
+        // As counted by the detector: the first sample of the capture is sample 1.
+        juce::int64 sampleIndex;
+        double timeMs;
+    };
+
+    explicit SyntheticGait(const Options &options);
+
+    /**
+     * Write the capture in the format GaitEventDetector reads, overwriting the file if it exists.
+     */
+    juce::Result writeCapture(const juce::File &file) const;
+
+    /**
+     * @return The events the capture contains, in order.
+     */
+    const std::vector<Event> &getEvents() const;
+
+    double getDurationMs() const;
+
+    static double getMinStepPeriodMs();
+
+private:
+    // Samples over which the acceleration drops at initial contact, rises to toe-off, and returns to rest.
+    static constexpr int DROP_SAMPLES{3};
+    static constexpr int RISE_SAMPLES{20};
+    static constexpr int RECOVERY_SAMPLES{40};
+    static constexpr float MIN_ACCEL{-2.5f};
+    static constexpr float PEAK_ACCEL{.5f};
+
+    void addSample(float accelY, float gyroY);
+
+    std::vector<std::pair<float, float>> samples;
+    std::vector<Event> events;
+};
@@ -1,11 +1,17 @@
 #include "MainComponent.h"
+#include "Trace.h"
 
 #include <utility>
-#include "Utils.h"
 
 //==============================================================================
 MainComponent::MainComponent() :
-        gaitEventDetector(captureFile, asymmetryThresholdLow, asymmetryThresholdHigh) {
+        gaitEventDetector(captureFile),
+        gaitEventDetectorComponent(gaitEventDetector,
+                                   sonificationSettings.asymmetryThresholdLow,
+                                   sonificationSettings.asymmetryThresholdHigh) {
+    TRACE_THREAD("Message");
+    sonificationEngine.setAudioFileSource(&transportSource);
+
     // Make sure you set the size of the component after
     // you add any child components.
     setSize(1000, 800);
@@ -23,6 +29,7 @@ MainComponent::MainComponent() :
     }
 
     formatManager.registerBasicFormats();
+    readAheadThread.startThread();
 
     addAndMakeVisible(openCaptureBrowserButton);
     openCaptureBrowserButton.setButtonText("Select capture file");
@@ -50,6 +57,18 @@ MainComponent::MainComponent() :
     addAndMakeVisible(selectedAudioFileLabel);
     selectedAudioFileLabel.setJustificationType(Justification::centredLeft);
 
+    // Shares the audio file button's spot; patches can be auditioned while playing.
+    addAndMakeVisible(synthPatchSelector);
+    synthPatchSelector.addItem("Default patch", SynthPatch::PatchDefault);
+    synthPatchSelector.addItem("Bell", SynthPatch::PatchBell);
+    synthPatchSelector.addItem("Reed", SynthPatch::PatchReed);
+    synthPatchSelector.addItem("Vibrato", SynthPatch::PatchVibrato);
+    synthPatchSelector.setSelectedId(SynthPatch::PatchDefault, juce::dontSendNotification);
+    synthPatchSelector.onChange = [this] {
+        synthPatch = static_cast<SynthPatch>(synthPatchSelector.getSelectedId());
+        sonificationEngine.setSynthPatch(synthPatch, sonificationSettings.synthDecayTime);
+    };
+
     //==========================================================================
     addAndMakeVisible(playButton);
     playButton.setButtonText("Play");
@@ -95,16 +114,27 @@ MainComponent::MainComponent() :
 
     addAndMakeVisible(asymmetryThresholdsSlider);
     asymmetryThresholdsSlider.onValueChange = [this] {
-        asymmetryThresholdLow = asymmetryThresholdsSlider.getMinValue() * .01f;
-        asymmetryThresholdHigh = asymmetryThresholdsSlider.getMaxValue() * .01f;
-        gaitEventDetector.repaint();
+        sonificationSettings.asymmetryThresholdLow = asymmetryThresholdsSlider.getMinValue() * .01f;
+        sonificationSettings.asymmetryThresholdHigh = asymmetryThresholdsSlider.getMaxValue() * .01f;
+        gaitEventDetectorComponent.repaint();
     };
     asymmetryThresholdsSlider.setSliderStyle(juce::Slider::TwoValueHorizontal);
     asymmetryThresholdsSlider.setNormalisableRange({50.f, 55.f, .1f});
-    asymmetryThresholdsSlider.setMinAndMaxValues(asymmetryThresholdLow * 100.f, asymmetryThresholdHigh * 100.f,
+    asymmetryThresholdsSlider.setMinAndMaxValues(sonificationSettings.asymmetryThresholdLow * 100.f,
+                                                 sonificationSettings.asymmetryThresholdHigh * 100.f,
                                                  juce::dontSendNotification);
     asymmetryThresholdsSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
 
+    addAndMakeVisible(balanceEstimatorSelector);
+    balanceEstimatorSelector.addItem("Mean", 1);
+    balanceEstimatorSelector.addItem("Median", 2);
+    balanceEstimatorSelector.onChange = [this] { setBalanceEstimator(); };
+    balanceEstimatorSelector.setSelectedId(1, juce::dontSendNotification);
+
+    addAndMakeVisible(balanceEstimatorLabel);
+    balanceEstimatorLabel.attachToComponent(&balanceEstimatorSelector, true);
+    balanceEstimatorLabel.setText("GCT estimate", juce::dontSendNotification);
+
     //==========================================================================
     addAndMakeVisible(carrierFreqLabel);
     carrierFreqLabel.attachToComponent(&carrierFreqSlider, true);
@@ -112,13 +142,14 @@ MainComponent::MainComponent() :
 
     addAndMakeVisible(carrierFreqSlider);
     carrierFreqSlider.onValueChange = [this] {
-        carrierFrequencyRange.first = carrierFreqSlider.getMinValue();
-        carrierFrequencyRange.second = carrierFreqSlider.getMaxValue();
+        sonificationSettings.carrierFrequencyRange.first = carrierFreqSlider.getMinValue();
+        sonificationSettings.carrierFrequencyRange.second = carrierFreqSlider.getMaxValue();
     };
     carrierFreqSlider.setSliderStyle(juce::Slider::TwoValueHorizontal);
     carrierFreqSlider.setNormalisableRange({100, 1000, .1});
     carrierFreqSlider.setSkewFactor(.75);
-    carrierFreqSlider.setMinAndMaxValues(carrierFrequencyRange.first, carrierFrequencyRange.second);
+    carrierFreqSlider.setMinAndMaxValues(sonificationSettings.carrierFrequencyRange.first,
+                                         sonificationSettings.carrierFrequencyRange.second);
     carrierFreqSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
 
     addAndMakeVisible(modulationAmountLabel);
@@ -126,10 +157,12 @@ MainComponent::MainComponent() :
     modulationAmountLabel.setText("Modulation factor", juce::dontSendNotification);
 
     addAndMakeVisible(modulationAmountSlider);
-    modulationAmountSlider.onValueChange = [this] { fmModMultiplier = modulationAmountSlider.getValue(); };
+    modulationAmountSlider.onValueChange = [this] {
+        sonificationSettings.fmModMultiplier = modulationAmountSlider.getValue();
+    };
     modulationAmountSlider.setNormalisableRange({0.f, 200.f, .01f});
     modulationAmountSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    modulationAmountSlider.setValue(fmModMultiplier);
+    modulationAmountSlider.setValue(sonificationSettings.fmModMultiplier);
     modulationAmountSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
 
     addAndMakeVisible(decayTimeLabel);
@@ -137,10 +170,12 @@ MainComponent::MainComponent() :
     decayTimeLabel.setText("Decay time", juce::dontSendNotification);
 
     addAndMakeVisible(decayTimeSlider);
-    decayTimeSlider.onValueChange = [this] { synthDecayTime = decayTimeSlider.getValue(); };
+    decayTimeSlider.onValueChange = [this] {
+        sonificationSettings.synthDecayTime = decayTimeSlider.getValue();
+    };
     decayTimeSlider.setNormalisableRange({.01f, .5f, .01f});
     decayTimeSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    decayTimeSlider.setValue(synthDecayTime);
+    decayTimeSlider.setValue(sonificationSettings.synthDecayTime);
     decayTimeSlider.setTextValueSuffix("s");
     decayTimeSlider.setTextBoxStyle(juce::Slider::TextBoxLeft, false, 60, decayTimeSlider.getTextBoxHeight());
 
@@ -150,12 +185,11 @@ MainComponent::MainComponent() :
 
     addChildComponent(allpass1GainSlider);
     allpass1GainSlider.onValueChange = [this] {
-        allpass1Gain = allpass1GainSlider.getValue();
-        allpass1.setGain(1.f - allpass1Gain);
+        sonificationSettings.allpass1Gain = allpass1GainSlider.getValue();
     };
     allpass1GainSlider.setNormalisableRange({0.f, 1.f, .01f});
     allpass1GainSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    allpass1GainSlider.setValue(allpass1Gain);
+    allpass1GainSlider.setValue(sonificationSettings.allpass1Gain);
     allpass1GainSlider.setTextBoxStyle(juce::Slider::TextBoxLeft, false, 60, allpass1GainSlider.getTextBoxHeight());
 
     addAndMakeVisible(allpass2GainLabel);
@@ -164,23 +198,35 @@ MainComponent::MainComponent() :
 
     addChildComponent(allpass2GainSlider);
     allpass2GainSlider.onValueChange = [this] {
-        allpass2Gain = allpass2GainSlider.getValue();
-        allpass2.setGain(1.f - allpass2Gain);
+        sonificationSettings.allpass2Gain = allpass2GainSlider.getValue();
     };
     allpass2GainSlider.setNormalisableRange({0.f, 1.f, .01f});
     allpass2GainSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    allpass2GainSlider.setValue(allpass2Gain);
+    allpass2GainSlider.setValue(sonificationSettings.allpass2Gain);
     allpass2GainSlider.setTextBoxStyle(juce::Slider::TextBoxLeft, false, 60, allpass2GainSlider.getTextBoxHeight());
 
 
     //==========================================================================
     addChildComponent(video);
 
-    addAndMakeVisible(gaitEventDetector);
+    addAndMakeVisible(gaitEventDetectorComponent);
+    // Keep the time readout up to date with the detector display.
+    gaitEventDetectorComponent.onNewSnapshot = [this] {
+        repaint(getLocalBounds().removeFromBottom(30).removeFromRight(100));
+        sessionOverviewComponent.setPlayhead(gaitEventDetectorComponent.getSnapshot().elapsedSamples);
+    };
+
+    addAndMakeVisible(sessionOverviewComponent);
 
     addAndMakeVisible(optionsButton);
     optionsButton.setButtonText("Options");
     optionsButton.onClick = [this] { showOptions(); };
+
+    addAndMakeVisible(mappingButton);
+    mappingButton.setButtonText("Mapping");
+    mappingButton.onClick = [this] { selectMappingFile(); };
+
+    addAndMakeVisible(audioLoadComponent);
 }
 
 MainComponent::~MainComponent() {
@@ -197,74 +243,18 @@ void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate
     // but be careful - it will be called on the audio thread, not the GUI thread.
 
     // For more details, see the help for AudioProcessor::prepareToPlay()
-    auto spec = juce::dsp::ProcessSpec{sampleRate, static_cast<uint32>(samplesPerBlockExpected), NUM_OUTPUT_CHANNELS};
-    panner.setRule(juce::dsp::PannerRule::linear);
-    panner.prepare(spec);
-
-    reverb.prepare(spec);
-    reverb.setParameters(juce::Reverb::Parameters{.5f, .25f, 0.f, 1.f, 0.f});
-
-    gain.prepare(spec);
-    gain.setGainLinear(.5f);
-
-    auto params = FMSynth::Parameters{
-            FMOsc::LINEAR,
-            {
-                    FMOsc::Parameters(1.4, 500., 0.1, FMOsc::EXPONENTIAL, nullptr, {
-                            FMOsc::Parameters(1.4, 1.9)
-                    }),
-                    FMOsc::Parameters(1.35, .5)
-            },
-            OADEnv::Parameters(0.f, 0.05f, synthDecayTime)
-    };
-
-    FMOsc carrier{params.carrierMode};
-    for (auto s: params.modulatorParameters) {
-        auto m = s.generateOscillator();
-        carrier.addModulator(m);
-    }
-    carrier.setEnvelope(params.envParams);
-    synth.setCarrier(carrier);
-    synth.setModulationAmount(0.f);
-    synth.prepareToPlay(sampleRate, samplesPerBlockExpected, NUM_OUTPUT_CHANNELS);
-
-    allpass1.setGain(1.f - allpass1Gain);
-    allpass2.setGain(1.f - allpass2Gain);
+    clock.prepare(sampleRate);
+    sonificationEngine.prepareToPlay(sampleRate, samplesPerBlockExpected);
 
     transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    transportSource.setGain(.75f);
+    transportSource.setGain(SonificationEngine::AUDIO_FILE_GAIN);
     transportSource.setLooping(true);
 }
 
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo &bufferToFill) {
-    juce::dsp::AudioBlock<float> block(*bufferToFill.buffer,
-                                       (size_t) bufferToFill.startSample);
-    switch (sonificationMode) {
-        case SonificationMode::SynthConstant:
-        case SonificationMode::SynthRhythmic:
-            bufferToFill.clearActiveBufferRegion();
-            synth.renderNextBlock(*bufferToFill.buffer, 0, bufferToFill.numSamples);
-            break;
-        case SonificationMode::AudioFile:
-            if (readerSource == nullptr) {
-                bufferToFill.clearActiveBufferRegion();
-                return;
-            }
-
-            if (transportSource.isPlaying()) {
-                transportSource.getNextAudioBlock(bufferToFill);
-                allpass1.processBlock(block);
-                allpass2.processBlock(block);
-            } else {
-                bufferToFill.clearActiveBufferRegion();
-            }
-            break;
-    }
-
-    auto context = juce::dsp::ProcessContextReplacing<float>(block);
-    reverb.process(context);
-    panner.process(context);
-    gain.process(context);
+    TRACE_THREAD("Audio");
+    clock.advance(bufferToFill.numSamples);
+    sonificationEngine.getNextAudioBlock(bufferToFill);
 }
 
 void MainComponent::releaseResources() {
@@ -277,6 +267,7 @@ void MainComponent::releaseResources() {
 
 //==============================================================================
 void MainComponent::paint(juce::Graphics &g) {
+    TRACE_SCOPE("MainComponent::paint");
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
 
@@ -291,7 +282,7 @@ void MainComponent::paint(juce::Graphics &g) {
                15,
                juce::Justification::left);
     g.setColour(Colours::lightblue);
-    g.drawText("IMU:   " + juce::String(gaitEventDetector.getCurrentTime() * .001 + videoOffset),
+    g.drawText("IMU:   " + juce::String(gaitEventDetectorComponent.getSnapshot().elapsedTimeMs * .001 + videoOffset),
                getRight() - 100,
                getBottom() - 30,
                100,
@@ -309,6 +300,7 @@ void MainComponent::resized() {
     selectedCaptureFileLabel.setBounds(openCaptureBrowserButton.getRight(), bounds.getY() + padding, 200, 30);
     sonificationModeSelector.setBounds(selectedCaptureFileLabel.getRight() + 125, bounds.getY() + padding, 175, 30);
     openAudioBrowserButton.setBounds(sonificationModeSelector.getRight() + padding, bounds.getY() + padding, 150, 30);
+    synthPatchSelector.setBounds(openAudioBrowserButton.getBounds());
     selectedAudioFileLabel.setBounds(openAudioBrowserButton.getRight(), bounds.getY() + padding, 180, 30);
     //==========================================================================
     playButton.setBounds(bounds.getX() + padding, openCaptureBrowserButton.getBottom() + padding, 72, 30);
@@ -333,13 +325,24 @@ void MainComponent::resized() {
     allpass1GainSlider.setBounds(bounds.getX() + 130, playButton.getBottom() + padding, 150, 30);
     allpass2GainSlider.setBounds(allpass1GainSlider.getRight() + 120, playButton.getBottom() + padding, 150, 30);
 
+    balanceEstimatorSelector.setBounds(bounds.getRight() - padding - 90, playButton.getBottom() + padding, 90, 30);
+
     //==========================================================================
     video.setBounds(bounds.getRight() - videoWidth - padding, playButton.getBottom() + 50, videoWidth, 640);
-    gaitEventDetector.setBounds(bounds.getX() + padding,
-                                playButton.getBottom() + 50,
-                                bounds.getWidth() - videoWidth - padding * 2,
-                                video.getHeight());
+    gaitEventDetectorComponent.setBounds(bounds.getX() + padding,
+                                         playButton.getBottom() + 50,
+                                         bounds.getWidth() - videoWidth - padding * 2,
+                                         video.getHeight() - 130);
+    sessionOverviewComponent.setBounds(gaitEventDetectorComponent.getX(),
+                                       gaitEventDetectorComponent.getBottom() + padding * 2,
+                                       gaitEventDetectorComponent.getWidth(),
+                                       video.getBottom() - gaitEventDetectorComponent.getBottom() - padding * 2);
     optionsButton.setBounds(padding, getBottom() - padding * 2 - 20, 50, 20);
+    mappingButton.setBounds(optionsButton.getRight() + padding, optionsButton.getY(), 60, 20);
+    audioLoadComponent.setBounds(mappingButton.getRight() + padding,
+                                 optionsButton.getY(),
+                                 bounds.getRight() - mappingButton.getRight() - padding * 2 - 100,
+                                 optionsButton.getHeight());
 }
 
 
@@ -376,34 +379,35 @@ void MainComponent::showOptions() {
 }
 
 void MainComponent::hiResTimerCallback() {
+    TRACE_THREAD("IMU timer");
+    TRACE_SCOPE("MainComponent::hiResTimerCallback");
     if (video.isVideoOpen() && !video.isPlaying()) {
         gaitEventDetector.stop();
         transportSource.stop();
-    } else if (imuSampleTimeMs >= GaitEventDetectorComponent::IMU_SAMPLE_PERIOD_MS) {
+        return;
+    }
+
+    // Process whichever IMU samples the clock says are due.
+    auto clockTimeMs = clock.getTimeSeconds() * 1000.0;
+    for (auto i = 0; i < MAX_IMU_SAMPLES_PER_CALLBACK &&
+                     gaitEventDetector.getCurrentTime() + GaitEventDetector::IMU_SAMPLE_PERIOD_MS <= clockTimeMs; ++i) {
         // Check for gait events...
         gaitEventDetector.processNextSample();
 
+        // Anything for the message thread gets posted to it; never wait for it here. The display picks up the
+        // detector's state by itself.
         if (gaitEventDetector.isDoneProcessing()) {
-            const MessageManagerLock mmLock;
-            switchPlayState(PlayState::Stopped);
+            stopTimer();
+            juce::MessageManager::callAsync([safeThis = SafePointer<MainComponent>(this)] {
+                if (safeThis != nullptr) {
+                    safeThis->switchPlayState(PlayState::Stopped);
+                }
+            });
             return;
         }
 
-        // Try to keep the video in sync.
-        if (gaitEventDetector.getElapsedSamples() % 10 == 0) {
-            const MessageManagerLock mmLock;
-            repaint();
-            if (gaitEventDetector.getElapsedSamples() % 2500 == 0) {
-                syncVideoToIMU();
-            }
-        }
-
-        updateSonification();
-
-        imuSampleTimeMs -= GaitEventDetectorComponent::IMU_SAMPLE_PERIOD_MS;
+        sonificationEngine.update(gaitEventDetector, sonificationSettings);
     }
-
-    imuSampleTimeMs += static_cast<float>(TIMER_INCREMENT_MS * playbackSpeed);
 }
 
 void MainComponent::switchPlayState(PlayState state) {
@@ -411,23 +415,31 @@ void MainComponent::switchPlayState(PlayState state) {
         case PlayState::Playing:
             playButton.setEnabled(false);
             stopButton.setEnabled(true);
-            imuSampleTimeMs = 0.f;
+            clock.setTime(gaitEventDetector.getCurrentTime() * .001);
+            clock.setSpeed(playbackSpeedSlider.getValue());
+            clock.start();
+            // Before the IMU timer starts queueing notes of its own.
+            sonificationEngine.start(sonificationSettings);
             startTimer(TIMER_INCREMENT_MS);
             if (video.isVideoOpen()) {
                 video.setAudioVolume(0.25f);
                 video.play();
+                videoClockFollower.setOffset(videoOffset + VIDEO_NUDGE);
+                videoClockFollower.start();
             }
 
-            if (sonificationMode == AudioFile) {
+            if (sonificationEngine.getMode() == SonificationMode::AudioFile) {
                 transportSource.start();
-            } else if (sonificationMode == SynthConstant) {
-                synth.startNote(carrierFrequencyRange.first, .5);
             }
             break;
         case PlayState::Stopped:
             playButton.setEnabled(true);
             stopButton.setEnabled(false);
+            // Waits for any callback in progress, so the IMU timer has stopped queueing notes by the time the engine
+            // is stopped below.
             stopTimer();
+            clock.stop();
+            videoClockFollower.stop();
             gaitEventDetector.stop(true);
             video.stop();
             videoOffset = 0.0;
@@ -435,76 +447,12 @@ void MainComponent::switchPlayState(PlayState state) {
                 videoOffset = VIDEO_OFFSETS.getWithDefault(captureFile.getFileNameWithoutExtension(), 30.0);
             }
             video.setPlayPosition(videoOffset);
-            if (sonificationMode == AudioFile) {
+            if (sonificationEngine.getMode() == SonificationMode::AudioFile) {
                 transportSource.stop();
-            } else {
-                synth.stopPlaying();
-                synth.setModulationAmount(0.f);
-            }
-            break;
-    }
-}
-
-void MainComponent::syncVideoToIMU() {
-    auto imuTime = gaitEventDetector.getCurrentTime() * .001;
-    video.setPlayPosition(videoOffset + VIDEO_NUDGE + imuTime);
-}
-
-void MainComponent::updateSonification() {
-    // Raw GCT balance, 0 (L) to 1 (R)
-    auto balance = gaitEventDetector.getGtcBalance();
-    // Asymmetry -.5 - +.5
-    auto asymmetry = balance - .5f;
-    // Absolute (polarisation-independent) asymmetry
-    auto absAsymmetry = fabsf(asymmetry);
-
-    switch (sonificationMode) {
-        case SonificationMode::SynthConstant:
-        case SonificationMode::SynthRhythmic: {
-            auto freqRange = carrierFrequencyRange.second - carrierFrequencyRange.first;
-            // Imagine cadence is limited to 100-300 bpm, so a range of 200.
-            auto freq = carrierFrequencyRange.first +
-                        freqRange * (Utils::clamp(gaitEventDetector.getCadence(), 100.f, 300.f) - 100.f) * .005f;
-//            auto freq = carrierFrequencyRange.first * powf(2.f, gaitEventDetector.getCadence() * .01f);
-            auto amp = .5f;
-
-//            auto modAmount = fmModMultiplier * Utils::clamp(absAsymmetry + .5f - asymmetryThresholdLow, 0.f, 1.f);
-            auto modAmount = Utils::clamp(absAsymmetry + .5f - asymmetryThresholdLow, 0.f, 1.f);
-
-
-            if (sonificationMode == SynthRhythmic) {
-                synth.setModulationAmount(modAmount > 0.f ? 2.f + fmModMultiplier * modAmount : 0);
-                // Check for new note
-                if (gaitEventDetector.hasEventNow(GaitEventDetectorComponent::GaitEventType::ToeOff)) {
-                    synth.startNote(freq, amp);
-                }
-                synth.setEnvelope({0.f, .05f, synthDecayTime});
-            } else {
-                synth.setModulationAmount(fmModMultiplier * .5f * modAmount);
-                synth.setCarrierFrequency(freq);
             }
-            break;
-        }
-        case SonificationMode::AudioFile:
-            auto filterOrder = static_cast<unsigned int>(floorf(5000.f * Utils::clamp(absAsymmetry + .5f -
-                                                                                      asymmetryThresholdLow, 0.f,
-                                                                                      1.f)));
-            allpass1.setOrder(filterOrder == 0 ? 0 : filterOrder);
-            allpass2.setOrder(filterOrder == 0 ? 0 : 1 + ceilf(filterOrder * 1.1));
+            sonificationEngine.stop();
             break;
     }
-
-    auto pan = asymmetry * 30.f;
-    panner.setPan(Utils::clamp(pan, -1.f, 1.f));
-
-    auto reverbParams = reverb.getParameters();
-    auto reverbAmount = Utils::clamp(
-            reverbAmountMultiplier * Utils::clamp(absAsymmetry + .5f - asymmetryThresholdHigh, 0.f, 1.f),
-            0.f, 1.f
-    );
-    reverbParams.wetLevel = reverbAmount;
-    reverbParams.dryLevel = 1.f - reverbAmount;
-    reverb.setParameters(reverbParams);
 }
 
 void MainComponent::play() {
@@ -535,6 +483,7 @@ void MainComponent::selectCaptureFile() {
                                                      NotificationType::dontSendNotification);
 
                     captureFile = csvFile;
+                    sessionOverviewComponent.loadCapture(captureFile);
 
                     playbackSpeedSlider.setEnabled(true);
                     switchPlayState(PlayState::Stopped);
@@ -560,10 +509,33 @@ void MainComponent::selectCaptureFile() {
 }
 
 void MainComponent::changePlaybackSpeed() {
-    auto speed = playbackSpeedSlider.getValue();
-    video.setPlaySpeed(speed);
-    playbackSpeed = static_cast<float>(speed);
-    syncVideoToIMU();
+    // The video follows by adjusting its rate, with no need to seek it; have it change rate now, not on its next tick.
+    clock.setSpeed(playbackSpeedSlider.getValue());
+    if (video.isVideoOpen() && video.isPlaying()) {
+        videoClockFollower.update();
+    }
+}
+
+void MainComponent::selectMappingFile() {
+    fileChooser = std::make_unique<FileChooser>("Select a mapping design",
+                                                File::getCurrentWorkingDirectory(),
+                                                "*.json");
+    fileChooser->launchAsync(
+            FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles,
+            [this](const FileChooser &chooser) {
+                auto file = chooser.getResult();
+                if (file == File{}) {
+                    return;
+                }
+
+                auto result = sonificationEngine.loadMappingDesign(file);
+                if (result.failed()) {
+                    AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon,
+                                                     "Failed to load mapping design",
+                                                     result.getErrorMessage());
+                }
+            }
+    );
 }
 
 void MainComponent::selectAudioFile() {
@@ -579,7 +551,9 @@ void MainComponent::selectAudioFile() {
                     auto *reader = formatManager.createReaderFor(file);
 
                     if (reader != nullptr) {
-                        auto newSource = std::make_unique<juce::AudioFormatReaderSource>(reader, true);
+                        auto newSource = std::make_unique<PrefetchingFileSource>(reader, readAheadThread,
+                                                                                 &sonificationEngine.getLoadMonitor());
+                        newSource->setLooping(true);
                         transportSource.setSource(newSource.get(), 0, nullptr, reader->sampleRate);
                         switchPlayState(PlayState::Stopped);
                         readerSource = std::move(newSource);
@@ -595,25 +569,27 @@ void MainComponent::selectAudioFile() {
 }
 
 void MainComponent::setSonificationMode() {
-    sonificationMode = static_cast<SonificationMode>(sonificationModeSelector.getSelectedId());
+    auto sonificationMode = static_cast<SonificationMode>(sonificationModeSelector.getSelectedId());
+    sonificationEngine.setMode(sonificationMode);
 
     switch (sonificationMode) {
-        case SynthRhythmic:
-        case SynthConstant:
+        case SonificationMode::SynthRhythmic:
+        case SonificationMode::SynthConstant:
             openAudioBrowserButton.setVisible(false);
             openAudioBrowserButton.setEnabled(false);
             selectedAudioFileLabel.setVisible(false);
+            synthPatchSelector.setVisible(true);
             carrierFreqSlider.setVisible(true);
             modulationAmountSlider.setVisible(true);
-            decayTimeSlider.setVisible(sonificationMode == SynthRhythmic);
-            synth.enableEnvelope(sonificationMode == SynthRhythmic);
+            decayTimeSlider.setVisible(sonificationMode == SonificationMode::SynthRhythmic);
             allpass1GainSlider.setVisible(false);
             allpass2GainSlider.setVisible(false);
             break;
-        case AudioFile:
+        case SonificationMode::AudioFile:
             openAudioBrowserButton.setVisible(true);
             openAudioBrowserButton.setEnabled(true);
             selectedAudioFileLabel.setVisible(true);
+            synthPatchSelector.setVisible(false);
             carrierFreqSlider.setVisible(false);
             modulationAmountSlider.setVisible(false);
             decayTimeSlider.setVisible(false);
@@ -622,3 +598,20 @@ void MainComponent::setSonificationMode() {
             break;
     }
 }
+
+void MainComponent::setBalanceEstimator() {
+    auto useMedian = balanceEstimatorSelector.getSelectedId() == 2;
+
+    gaitEventDetector.setBalanceEstimator(useMedian ?
+                                          GaitEventDetector::BalanceEstimator::SlidingMedian :
+                                          GaitEventDetector::BalanceEstimator::Mean);
+
+    // The median isn't limited by the length of the ground contact buffer, so can look back much further.
+    auto maxLookback = useMedian ?
+                       GaitEventDetector::MAX_MEDIAN_STRIDE_LOOKBACK :
+                       GaitEventDetector::MAX_MEAN_STRIDE_LOOKBACK;
+    strideLookbackSlider.setNormalisableRange({1, static_cast<double>(maxLookback), 1});
+    strideLookbackSlider.setTextBoxIsEditable(useMedian);
+    // Narrowing the range clamps the slider without notifying; keep the detector in step with it.
+    gaitEventDetector.setStrideLookback(static_cast<int>(strideLookbackSlider.getValue()));
+}
@@ -3,8 +3,12 @@
 #include <JuceHeader.h>
 #include <juce_video/playback/juce_VideoComponent.h>
 #include "GaitEventDetectorComponent.h"
-#include "Synthesis/FMSynth.h"
-#include "Processing/AllpassFilter.h"
+#include "SessionOverviewComponent.h"
+#include "SonificationEngine.h"
+#include "AudioLoadComponent.h"
+#include "ClockFollower.h"
+#include "MasterClock.h"
+#include "Processing/PrefetchingFileSource.h"
 
 //==============================================================================
 /*
@@ -14,18 +18,15 @@
 class MainComponent : public juce::AudioAppComponent,
                       juce::HighResolutionTimer {
 public:
-    static constexpr int NUM_OUTPUT_CHANNELS{2};
+    static constexpr int NUM_OUTPUT_CHANNELS{SonificationEngine::NUM_OUTPUT_CHANNELS};
 
     enum class PlayState {
         Playing,
         Stopped
     };
 
-    enum SonificationMode {
-        SynthRhythmic = 1,
-        SynthConstant,
-        AudioFile
-    };
+    using SonificationMode = SonificationEngine::SonificationMode;
+    using SynthPatch = SonificationEngine::SynthPatch;
 
     //==============================================================================
     MainComponent();
@@ -47,6 +48,8 @@ public:
 private:
     static constexpr unsigned int TIMER_INCREMENT_MS{1};
     static constexpr float VIDEO_NUDGE{.2F};
+    // The most IMU samples processed in one timer callback, so catching up after a stall doesn't hog the thread.
+    static constexpr int MAX_IMU_SAMPLES_PER_CALLBACK{8};
     const juce::NamedValueSet VIDEO_OFFSETS{
             {"Normal_7_5",     31.625},
             {"Normal_10",      32.625},
@@ -68,12 +71,8 @@ private:
 
     void switchPlayState(PlayState state);
 
-    void updateSonification();
-
     void showOptions();
 
-    void syncVideoToIMU();
-
     void hiResTimerCallback() override;
 
     std::unique_ptr<juce::FileChooser> fileChooser;
@@ -82,30 +81,58 @@ private:
     juce::File captureFile;
     juce::Label selectedCaptureFileLabel;
 
+    /**
+     * Lets a ClockFollower drive the video.
+     */
+    class VideoFollower : public ClockFollower::Follower {
+    public:
+        explicit VideoFollower(juce::VideoComponent &videoToDrive) : video(videoToDrive) {}
+
+        double getPosition() override { return video.getPlayPosition(); }
+
+        void setPosition(double seconds) override { video.setPlayPosition(seconds); }
+
+        void setRate(double rate) override { video.setPlaySpeed(rate); }
+
+    private:
+        juce::VideoComponent &video;
+    };
+
     juce::VideoComponent video{false};
     float videoOffset{0.f};
 
+    // Media time, driven by the audio device; IMU processing and the video follow it.
+    MasterClock clock;
+    VideoFollower videoFollower{video};
+    ClockFollower videoClockFollower{clock, videoFollower};
+
     juce::TextButton playButton;
     juce::TextButton stopButton;
     juce::Label playbackSpeedLabel;
     juce::Slider playbackSpeedSlider;
-    float imuSampleTimeMs{0.f};
-    float playbackSpeed{1.f};
     juce::Label strideLookbackLabel;
     juce::Slider strideLookbackSlider;
     juce::Label asymmetryThresholdsLabel;
     juce::Slider asymmetryThresholdsSlider;
+    juce::Label balanceEstimatorLabel;
+    juce::ComboBox balanceEstimatorSelector;
 
     juce::TextButton optionsButton;
     SafePointer <DialogWindow> optionsWindow;
+    juce::TextButton mappingButton;
 
-    GaitEventDetectorComponent gaitEventDetector;
+    GaitEventDetector gaitEventDetector;
+    GaitEventDetectorComponent gaitEventDetectorComponent;
+    SessionOverviewComponent sessionOverviewComponent;
 
-    SonificationMode sonificationMode{SonificationMode::SynthRhythmic};
+    SonificationEngine sonificationEngine;
+    SonificationEngine::Settings sonificationSettings;
+    AudioLoadComponent audioLoadComponent{sonificationEngine.getLoadMonitor()};
     juce::Label sonificationModeLabel;
     juce::ComboBox sonificationModeSelector;
 
-    FMSynth synth;
+    SynthPatch synthPatch{SynthPatch::PatchDefault};
+    juce::ComboBox synthPatchSelector;
     juce::Label carrierFreqLabel;
     juce::Slider carrierFreqSlider;
     juce::Label modulationAmountLabel;
@@ -114,34 +141,25 @@ private:
     juce::Slider decayTimeSlider;
 
     juce::AudioFormatManager formatManager;
-    std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+    // Decodes long audio files ahead of playback, off the audio thread.
+    juce::TimeSliceThread readAheadThread{"Audio file read-ahead"};
+    std::unique_ptr<PrefetchingFileSource> readerSource;
     juce::AudioTransportSource transportSource;
     juce::TextButton openAudioBrowserButton;
     juce::Label selectedAudioFileLabel;
 
-    AllpassFilter allpass1{2};
-    AllpassFilter allpass2{2};
     juce::Label allpass1GainLabel;
     juce::Slider allpass1GainSlider;
     juce::Label allpass2GainLabel;
     juce::Slider allpass2GainSlider;
 
-    juce::dsp::Gain<float> gain;
-    juce::dsp::Panner<float> panner;
-    juce::dsp::Reverb reverb;
-
-    float asymmetryThresholdLow{.515f},
-            asymmetryThresholdHigh{.53f},
-            fmModMultiplier{70.f},
-            synthDecayTime{.2f},
-            reverbAmountMultiplier{100.f},
-            allpass1Gain{.23f},
-            allpass2Gain{.71f};
-    std::pair<float, float> carrierFrequencyRange{300.f, 600.f};
-
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
 
     void selectAudioFile();
 
+    void selectMappingFile();
+
     void setSonificationMode();
+
+    void setBalanceEstimator();
 };
@@ -0,0 +1,138 @@
+#include "MasterClock.h"
+
+MasterClock::MasterClock() :
+        ticksPerSecond(static_cast<double>(juce::Time::getHighResolutionTicksPerSecond())) {
+    const juce::SpinLock::ScopedLockType lock(writeLock);
+    writeAnchor({0.0, juce::Time::getHighResolutionTicks(), 1.0, false, 0});
+}
+
+void MasterClock::prepare(double newSampleRate) {
+    sampleRate = newSampleRate;
+    deviceSamples = 0;
+    lastBlockSize = 0;
+}
+
+void MasterClock::advance(int numSamples) noexcept {
+    deviceSamples.fetch_add(numSamples, std::memory_order_relaxed);
+
+    auto previousBlockSize = lastBlockSize;
+    lastBlockSize = numSamples;
+
+    const juce::SpinLock::ScopedTryLockType lock(writeLock);
+    if (!lock.isLocked()) {
+        // A control call is re-anchoring; it'll do for this block.
+        return;
+    }
+
+    auto anchor = readAnchor();
+    auto rate = sampleRate.load(std::memory_order_relaxed);
+    if (!anchor.running || rate <= 0.0) {
+        lastGeneration = anchor.generation;
+        return;
+    }
+
+    auto now = getTicks();
+    auto previousBlockTicks = static_cast<double>(previousBlockSize) / rate * ticksPerSecond;
+    auto isContinuous = static_cast<double>(now - anchor.ticks) < MAX_CALLBACK_GAP_BLOCKS * previousBlockTicks;
+    if (anchor.generation == lastGeneration && isContinuous) {
+        // The last anchor was the start of the previous block; this block starts where that one ends.
+        anchor.seconds += static_cast<double>(previousBlockSize) / rate * anchor.speed;
+    } else {
+        anchor.seconds = extrapolate(anchor, now);
+        lastGeneration = anchor.generation;
+    }
+    anchor.ticks = now;
+    writeAnchor(anchor);
+}
+
+void MasterClock::start() {
+    change([](Anchor &anchor) { anchor.running = true; });
+}
+
+void MasterClock::stop() {
+    change([](Anchor &anchor) { anchor.running = false; });
+}
+
+bool MasterClock::isRunning() const {
+    return readAnchor().running;
+}
+
+void MasterClock::setTime(double seconds) {
+    change([seconds](Anchor &anchor) { anchor.seconds = seconds; });
+}
+
+void MasterClock::setSpeed(double newSpeed) {
+    jassert(newSpeed >= 0.0);
+    change([newSpeed](Anchor &anchor) { anchor.speed = newSpeed; });
+}
+
+double MasterClock::getSpeed() const {
+    return readAnchor().speed;
+}
+
+double MasterClock::getTimeSeconds() const {
+    const juce::SpinLock::ScopedLockType lock(readLock);
+    auto anchor = readAnchor();
+    auto seconds = extrapolate(anchor, getTicks());
+    if (anchor.generation == lastReadGeneration) {
+        seconds = std::max(seconds, lastReadSeconds);
+    }
+    lastReadSeconds = seconds;
+    lastReadGeneration = anchor.generation;
+    return seconds;
+}
+
+juce::int64 MasterClock::getDeviceSamples() const {
+    return deviceSamples.load(std::memory_order_relaxed);
+}
+
+juce::int64 MasterClock::getTicks() const noexcept {
+    return juce::Time::getHighResolutionTicks();
+}
+
+MasterClock::Anchor MasterClock::readAnchor() const noexcept {
+    while (true) {
+        auto before = sequence.load(std::memory_order_acquire);
+        if ((before & 1u) == 0) {
+            Anchor anchor{anchorSeconds.load(std::memory_order_relaxed),
+                          anchorTicks.load(std::memory_order_relaxed),
+                          anchorSpeed.load(std::memory_order_relaxed),
+                          anchorRunning.load(std::memory_order_relaxed),
+                          anchorGeneration.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) {
+                return anchor;
+            }
+        }
+    }
+}
+
+void MasterClock::writeAnchor(const Anchor &anchor) noexcept {
+    sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    anchorSeconds.store(anchor.seconds, std::memory_order_relaxed);
+    anchorTicks.store(anchor.ticks, std::memory_order_relaxed);
+    anchorSpeed.store(anchor.speed, std::memory_order_relaxed);
+    anchorRunning.store(anchor.running, std::memory_order_relaxed);
+    anchorGeneration.store(anchor.generation, std::memory_order_relaxed);
+    sequence.fetch_add(1, std::memory_order_release);
+}
+
+double MasterClock::extrapolate(const Anchor &anchor, juce::int64 ticks) const noexcept {
+    if (!anchor.running) {
+        return anchor.seconds;
+    }
+    return anchor.seconds + static_cast<double>(ticks - anchor.ticks) / ticksPerSecond * anchor.speed;
+}
+
+template<typename Change>
+void MasterClock::change(Change &&applyChange) {
+    const juce::SpinLock::ScopedLockType lock(writeLock);
+    auto anchor = readAnchor();
+    auto now = getTicks();
+    anchor.seconds = extrapolate(anchor, now);
+    anchor.ticks = now;
+    applyChange(anchor);
+    ++anchor.generation;
+    writeAnchor(anchor);
+}
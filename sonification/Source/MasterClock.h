@@ -0,0 +1,126 @@
+#ifndef GAIT_SONIFICATION_MASTERCLOCK_H
+#define GAIT_SONIFICATION_MASTERCLOCK_H
+
+#include <JuceHeader.h>
+#include <atomic>
+
+/**
+ * The session's media time, which IMU processing, audio and video all follow.
+ *
+ * Driven by the audio device: each callback advances the clock by its block of samples, scaled by the playback speed,
+ * so media time runs at the device's rate rather than a timer's. Between callbacks, and if no device is running, it is
+ * extrapolated from the high-resolution clock.
+ *
+ * advance() is called on the audio thread, never blocks, and skips re-anchoring if a control call happens to be
+ * updating the clock at the same time. Control calls may come from any thread. Reads may too; they never wait on the
+ * audio thread, only on each other, so that the time they return doesn't go backwards.
+ */
+class MasterClock {
+public:
+    MasterClock();
+
+    virtual ~MasterClock() = default;
+
+    /**
+     * Set the device sample rate. Call before the audio device starts calling advance().
+     */
+    void prepare(double sampleRate);
+
+    /**
+     * Call at the start of each audio callback.
+     */
+    void advance(int numSamples) noexcept;
+
+    void start();
+
+    void stop();
+
+    bool isRunning() const;
+
+    /**
+     * Jump to a media time, in seconds.
+     */
+    void setTime(double seconds);
+
+    /**
+     * Set the playback speed, 1 for real time. Media time stays continuous.
+     */
+    void setSpeed(double newSpeed);
+
+    double getSpeed() const;
+
+    /**
+     * @return Media time, in seconds. Never less than the last time returned, unless a control call has changed the
+     * clock since.
+     */
+    double getTimeSeconds() const;
+
+    /**
+     * @return The number of samples the audio device has rendered since prepare().
+     */
+    juce::int64 getDeviceSamples() const;
+
+protected:
+    /**
+     * @return The time media time is extrapolated from, in high-resolution ticks. Overridable for testing.
+     */
+    virtual juce::int64 getTicks() const noexcept;
+
+private:
+    // Callbacks further apart than this many blocks mean the device stalled or restarted, so the clock carries on
+    // from its extrapolation rather than the samples rendered.
+    static constexpr double MAX_CALLBACK_GAP_BLOCKS{4.0};
+
+    /**
+     * Media time at a moment, and how it runs on from there.
+     */
+    struct Anchor {
+        double seconds;
+        juce::int64 ticks;
+        double speed;
+        bool running;
+        // Bumped by control calls, so advance() can tell its last anchor has been replaced.
+        juce::uint32 generation;
+    };
+
+    Anchor readAnchor() const noexcept;
+
+    /**
+     * Publish a new anchor. Call with writeLock held.
+     */
+    void writeAnchor(const Anchor &anchor) noexcept;
+
+    double extrapolate(const Anchor &anchor, juce::int64 ticks) const noexcept;
+
+    /**
+     * Apply a control change to the anchor, re-anchored at the current time.
+     */
+    template<typename Change>
+    void change(Change &&applyChange);
+
+    const double ticksPerSecond;
+    std::atomic<double> sampleRate{0.0};
+    std::atomic<juce::int64> deviceSamples{0};
+
+    // Serialises writers; the audio thread only ever tries it.
+    juce::SpinLock writeLock;
+    // Odd while an anchor is being written.
+    std::atomic<juce::uint32> sequence{0};
+    std::atomic<double> anchorSeconds{0.0}, anchorSpeed{1.0};
+    std::atomic<juce::int64> anchorTicks{0};
+    std::atomic<bool> anchorRunning{false};
+    std::atomic<juce::uint32> anchorGeneration{0};
+
+    // The last time read, and the generation of the anchor it was read from. Re-anchoring on the samples rendered
+    // can put the clock a little behind where it had been extrapolated to; reads are held here until it catches up.
+    mutable juce::SpinLock readLock;
+    mutable double lastReadSeconds{0.0};
+    mutable juce::uint32 lastReadGeneration{0};
+
+    // Owned by the audio thread.
+    juce::uint32 lastGeneration{0};
+    int lastBlockSize{0};
+};
+
+
+#endif //GAIT_SONIFICATION_MASTERCLOCK_H
@@ -0,0 +1,59 @@
+#include "MinMaxPyramid.h"
+
+void MinMaxPyramid::build(const std::vector<float> &samples) {
+    levels.clear();
+
+    if (samples.empty()) {
+        return;
+    }
+
+    std::vector<juce::Range<float>> level;
+    level.reserve(samples.size());
+    for (auto sample: samples) {
+        // Keep NaNs out of the ranges.
+        sample = std::isnan(sample) ? 0.f : sample;
+        level.emplace_back(sample, sample);
+    }
+    levels.push_back(std::move(level));
+
+    while (levels.back().size() > 1) {
+        auto &finer = levels.back();
+        std::vector<juce::Range<float>> coarser((finer.size() + 1) / 2);
+        for (size_t n = 0; n < coarser.size(); ++n) {
+            coarser[n] = 2 * n + 1 < finer.size() ? finer[2 * n].getUnionWith(finer[2 * n + 1]) : finer[2 * n];
+        }
+        levels.push_back(std::move(coarser));
+    }
+}
+
+juce::int64 MinMaxPyramid::getNumSamples() const {
+    return levels.empty() ? 0 : static_cast<juce::int64>(levels.front().size());
+}
+
+juce::Range<float> MinMaxPyramid::getRange(juce::int64 start, juce::int64 end) const {
+    if (getNumSamples() == 0) {
+        return {};
+    }
+
+    start = juce::jlimit<juce::int64>(0, getNumSamples() - 1, start);
+    end = juce::jlimit<juce::int64>(start + 1, getNumSamples(), end);
+
+    // Read blocks no bigger than half the span, so at most three or four of them.
+    auto level = 0;
+    while (level + 1 < static_cast<int>(levels.size()) && (juce::int64{2} << level) <= (end - start) / 2) {
+        ++level;
+    }
+
+    auto &blocks = levels[static_cast<size_t>(level)];
+    auto first = static_cast<size_t>(start >> level);
+    auto last = static_cast<size_t>((end - 1) >> level);
+    auto range = blocks[first];
+    for (auto n = first + 1; n <= last; ++n) {
+        range = range.getUnionWith(blocks[n]);
+    }
+    return range;
+}
+
+juce::Range<float> MinMaxPyramid::getOverallRange() const {
+    return levels.empty() ? juce::Range<float>{} : levels.back().front();
+}
@@ -0,0 +1,32 @@
+#ifndef GAIT_SONIFICATION_MINMAXPYRAMID_H
+#define GAIT_SONIFICATION_MINMAXPYRAMID_H
+
+#include <JuceHeader.h>
+
+/**
+ * Multi-resolution min/max summary of a signal.
+ *
+ * Level k holds the range of each consecutive block of 2^k samples, level 0 being the samples themselves. The range of
+ * any span of samples can then be read from the coarsest level at which the span covers at least a couple of blocks,
+ * so plotting any span at a fixed number of columns costs the same however many samples the span holds.
+ */
+class MinMaxPyramid {
+public:
+    void build(const std::vector<float> &samples);
+
+    juce::int64 getNumSamples() const;
+
+    /**
+     * Get the range of the samples in [start, end). May include a few samples either side of the span, up to the size
+     * of the blocks read.
+     */
+    juce::Range<float> getRange(juce::int64 start, juce::int64 end) const;
+
+    juce::Range<float> getOverallRange() const;
+
+private:
+    std::vector<std::vector<juce::Range<float>>> levels;
+};
+
+
+#endif //GAIT_SONIFICATION_MINMAXPYRAMID_H
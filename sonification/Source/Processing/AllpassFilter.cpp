@@ -9,73 +9,119 @@
 */
 
 #include "AllpassFilter.h"
-#include "../Utils.h"
 
-AllpassFilter::AllpassFilter(unsigned int numChannelsToAllocate) :
+AllpassFilter::AllpassFilter(unsigned int numChannelsToAllocate, unsigned int maxOrderToAllocate) :
         numChannels(numChannelsToAllocate),
-        buffer(static_cast<int>(numChannelsToAllocate * 2), 0),
-        writeIndices(numChannelsToAllocate, 0) {
+        maxOrder(maxOrderToAllocate),
+        // Room for the longest delay plus the sample being written.
+        delayLength(static_cast<unsigned int>(juce::nextPowerOfTwo(static_cast<int>(maxOrderToAllocate) + 1))),
+        delayMask(delayLength - 1),
+        feedforward(numChannelsToAllocate * delayLength, 0.f),
+        feedback(numChannelsToAllocate * delayLength, 0.f) {
 }
 
 void AllpassFilter::setGain(float newGain) {
-    this->gain = newGain;
+    this->targetGain = newGain;
 }
 
-void AllpassFilter::setOrder(uint newOrder) {
-    if (newOrder != this->order) {
+void AllpassFilter::setOrder(unsigned int newOrder) {
+    this->targetOrder = std::min(newOrder, this->maxOrder);
+}
+
+unsigned int AllpassFilter::getMaxOrder() const {
+    return this->maxOrder;
+}
+
+void AllpassFilter::reset() {
+    std::fill(this->feedforward.begin(), this->feedforward.end(), 0.f);
+    std::fill(this->feedback.begin(), this->feedback.end(), 0.f);
+    this->writeIndex = 0;
+    // With no history there's nothing to crossfade from, so go straight to the latest gain and order.
+    this->gain = this->targetGain.load();
+    this->order = this->targetOrder.load();
+    this->previousOrder = this->order;
+    this->transitionPosition = ORDER_FADE_SAMPLES;
+}
+
+void AllpassFilter::beginBlock() {
+    this->gain = this->targetGain.load();
+
+    // Start a transition to the new order once any transition in progress has finished.
+    auto newOrder = this->targetOrder.load();
+    if (newOrder != this->order && this->transitionPosition >= ORDER_FADE_SAMPLES) {
+        this->previousOrder = this->order;
         this->order = newOrder;
-        if (newOrder > maxOrder) {
-            this->buffer.setSize(static_cast<int>(numChannels * 2), static_cast<int>(newOrder), true, true, true);
-            maxOrder = newOrder;
-            // maybe don't need this anymore...
-            for (unsigned int channel = 0; channel < numChannels; ++channel) {
-                this->writeIndices[channel] %= this->order;
-            }
-        }
+        this->transitionPosition = 0;
     }
+}
 
-//    if (newOrder != this->order) {
-//        this->order = newOrder;
-//        if (newOrder > 0) {
-//            this->buffer.setSize(static_cast<int>(numChannels * 2), static_cast<int>(newOrder), true, true, true);
-//            for (unsigned int channel = 0; channel < numChannels; ++channel) {
-//                this->writeIndices[channel] %= this->order;
-//            }
-//        }
-//    }
+void AllpassFilter::endBlock(int numSamples) {
+    this->writeIndex = (this->writeIndex + static_cast<unsigned int>(numSamples)) & this->delayMask;
+    this->transitionPosition = std::min(this->transitionPosition + numSamples, ORDER_FADE_SAMPLES);
 }
 
-float AllpassFilter::processSample(int channel, float inputSample) {
-    float outSample;
-
-    if (this->order == 0) {
-        outSample = inputSample;
-        this->writeIndices[channel] = 0;
-    } else {
-        auto readIndex = static_cast<uint>(Utils::modulo(this->writeIndices[channel] - this->order, this->order));
-
-        // y[n] = gx[n] + x[n-N] - gy[n-N]
-        outSample = this->gain * inputSample +
-                    this->buffer.getSample(2 * channel, static_cast<int>(readIndex)) -
-                    this->gain * this->buffer.getSample(2 * channel + 1, static_cast<int>(readIndex));
-
-        this->buffer.setSample(2 * channel, static_cast<int>(this->writeIndices[channel]), inputSample);
-        this->buffer.setSample(2 * channel + 1, static_cast<int>(this->writeIndices[channel]), outSample);
-        ++this->writeIndices[channel];
-        // This really oughtn't happen due to the condition above. Race condition, maybe.
-        if (this->order > 0) {
-            this->writeIndices[channel] %= this->order;
-        }
+float AllpassFilter::getTransitionMix(int n) const {
+    return std::min(1.f, static_cast<float>(this->transitionPosition + n + 1) / ORDER_FADE_SAMPLES);
+}
+
+float AllpassFilter::computeOutput(const float *x, const float *y, unsigned int index, unsigned int delay,
+                                   float inputSample) const {
+    if (delay == 0) {
+        return inputSample;
+    }
+
+    auto readIndex = (index - delay) & this->delayMask;
+    // y[n] = gx[n] + x[n-N] - gy[n-N]
+    return this->gain * inputSample + x[readIndex] - this->gain * y[readIndex];
+}
+
+float AllpassFilter::processSample(size_t channel, int n, float inputSample, float mix) {
+    auto x = &this->feedforward[channel * this->delayLength];
+    auto y = &this->feedback[channel * this->delayLength];
+    auto index = (this->writeIndex + static_cast<unsigned int>(n)) & this->delayMask;
+
+    auto outSample = computeOutput(x, y, index, this->order, inputSample);
+    if (mix < 1.f) {
+        auto previousOutSample = computeOutput(x, y, index, this->previousOrder, inputSample);
+        outSample = previousOutSample + mix * (outSample - previousOutSample);
     }
 
+    x[index] = inputSample;
+    y[index] = outSample;
     return outSample;
 }
 
 void AllpassFilter::processBlock(juce::dsp::AudioBlock<float> &block) {
-    for (unsigned long channel = 0; channel < block.getNumChannels(); ++channel) {
-        for (unsigned long sample = 0; sample < block.getNumSamples(); ++sample) {
-            auto filteredSample = processSample(channel, block.getSample(channel, sample));
-            block.addSample(channel, sample, filteredSample);
+    beginBlock();
+
+    auto numSamples = static_cast<int>(block.getNumSamples());
+    auto channelsToProcess = std::min(static_cast<size_t>(this->numChannels), block.getNumChannels());
+    for (size_t channel = 0; channel < channelsToProcess; ++channel) {
+        auto samples = block.getChannelPointer(channel);
+        for (auto n = 0; n < numSamples; ++n) {
+            samples[n] += processSample(channel, n, samples[n], getTransitionMix(n));
         }
     }
-}
\ No newline at end of file
+
+    endBlock(numSamples);
+}
+
+void AllpassFilter::processCascade(AllpassFilter &first, AllpassFilter &second, juce::dsp::AudioBlock<float> &block) {
+    first.beginBlock();
+    second.beginBlock();
+
+    auto numSamples = static_cast<int>(block.getNumSamples());
+    auto channelsToProcess = std::min({static_cast<size_t>(first.numChannels),
+                                       static_cast<size_t>(second.numChannels),
+                                       block.getNumChannels()});
+    for (size_t channel = 0; channel < channelsToProcess; ++channel) {
+        auto samples = block.getChannelPointer(channel);
+        for (auto n = 0; n < numSamples; ++n) {
+            auto intermediate = samples[n] + first.processSample(channel, n, samples[n], first.getTransitionMix(n));
+            samples[n] = intermediate + second.processSample(channel, n, intermediate, second.getTransitionMix(n));
+        }
+    }
+
+    first.endBlock(numSamples);
+    second.endBlock(numSamples);
+}
@@ -12,24 +12,83 @@
 
 #include <JuceHeader.h>
 
+/**
+ * Feedforward/feedback comb allpass, y[n] = gx[n] + x[n-N] - gy[n-N], mixed with its input.
+ *
+ * Delay lines are allocated up front for the maximum order, with power-of-two lengths so they wrap with a mask. Gain
+ * and order may be set from any thread; the audio thread picks them up at the start of a block and crossfades from the
+ * old order to the new over ORDER_FADE_SAMPLES.
+ */
 class AllpassFilter {
 public:
-    explicit AllpassFilter(unsigned int numChannelsToAllocate);
+    static constexpr unsigned int DEFAULT_MAX_ORDER{6000};
+    static constexpr int ORDER_FADE_SAMPLES{256};
+
+    explicit AllpassFilter(unsigned int numChannelsToAllocate, unsigned int maxOrderToAllocate = DEFAULT_MAX_ORDER);
 
     void setGain(float newGain);
 
-    void setOrder(uint newOrder);
+    /**
+     * @param newOrder Delay length, in samples; clamped to the maximum order. 0 passes the input through unfiltered.
+     */
+    void setOrder(unsigned int newOrder);
+
+    unsigned int getMaxOrder() const;
 
+    /**
+     * Add the filtered signal to the block.
+     */
     void processBlock(juce::dsp::AudioBlock<float> &block);
 
-    float processSample(int channel, float inputSample);
+    /**
+     * Equivalent to first.processBlock(block) then second.processBlock(block), in a single pass.
+     */
+    static void processCascade(AllpassFilter &first, AllpassFilter &second, juce::dsp::AudioBlock<float> &block);
+
+    /**
+     * Clear the histories, and take up the gain and order last set without crossfading. Not thread-safe.
+     */
+    void reset();
 
 private:
+    /**
+     * Pick up gain and order changes for the coming block.
+     */
+    void beginBlock();
+
+    /**
+     * Advance the write position and any order transition past a processed block.
+     */
+    void endBlock(int numSamples);
+
+    /**
+     * @return Progress through the current order transition, 0-1, after n samples of the block.
+     */
+    float getTransitionMix(int n) const;
+
+    /**
+     * Filter a sample n samples into the block. Does not add the input.
+     */
+    float processSample(size_t channel, int n, float inputSample, float mix);
+
+    float computeOutput(const float *x, const float *y, unsigned int writeIndex, unsigned int delay,
+                        float inputSample) const;
+
     unsigned int numChannels;
+    unsigned int maxOrder;
+    unsigned int delayLength;
+    unsigned int delayMask;
+
+    std::atomic<float> targetGain{0.f};
+    std::atomic<unsigned int> targetOrder{0};
+
+    // State owned by the audio thread.
     float gain{0.f};
     unsigned int order{0};
-    unsigned int maxOrder{0};
-    // Use even numbered channels for feedforward buffers, odd numbered for feedback.
-    juce::AudioBuffer<float> buffer;
-    std::vector<unsigned int> writeIndices;
-};
\ No newline at end of file
+    unsigned int previousOrder{0};
+    int transitionPosition{ORDER_FADE_SAMPLES};
+    unsigned int writeIndex{0};
+
+    // Input and output histories, one delay line per channel.
+    std::vector<float> feedforward, feedback;
+};
@@ -0,0 +1,164 @@
+/*
+  ==============================================================================
+
+    AudioLoadMonitor.cpp
+
+  ==============================================================================
+*/
+
+#include "AudioLoadMonitor.h"
+
+AudioLoadMonitor::AudioLoadMonitor() :
+        ticksPerSecond(static_cast<double>(juce::Time::getHighResolutionTicksPerSecond())) {
+}
+
+void AudioLoadMonitor::prepare(double newSampleRate) {
+    sampleRate = newSampleRate;
+    clear();
+}
+
+void AudioLoadMonitor::beginBlock(int numSamples) noexcept {
+    if (resetRequested.exchange(false, std::memory_order_relaxed)) {
+        clear();
+    }
+
+    blockStartTicks = juce::Time::getHighResolutionTicks();
+    blockDurationTicks = sampleRate > 0.0
+                         ? static_cast<juce::int64>(ticksPerSecond * numSamples / sampleRate)
+                         : 0;
+
+    if (lastBlockStartTicks > 0 &&
+        static_cast<double>(blockStartTicks - lastBlockStartTicks) >
+        LATE_BLOCK_THRESHOLD * static_cast<double>(lastBlockDurationTicks)) {
+        numLateBlocks.fetch_add(1, std::memory_order_relaxed);
+    }
+    lastBlockStartTicks = blockStartTicks;
+    lastBlockDurationTicks = blockDurationTicks;
+}
+
+void AudioLoadMonitor::endBlock() noexcept {
+    if (blockDurationTicks <= 0) {
+        return;
+    }
+
+    auto processingTicks = juce::Time::getHighResolutionTicks() - blockStartTicks;
+    auto load = static_cast<float>(static_cast<double>(processingTicks) / static_cast<double>(blockDurationTicks));
+
+    numBlocks.fetch_add(1, std::memory_order_relaxed);
+    if (load > 1.f) {
+        numOverruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    totalProcessingTicks.fetch_add(processingTicks, std::memory_order_relaxed);
+    totalDurationTicks.fetch_add(blockDurationTicks, std::memory_order_relaxed);
+    // Only the audio thread writes the peak, so there's no need to compare-and-swap.
+    if (load > peakLoad.load(std::memory_order_relaxed)) {
+        peakLoad.store(load, std::memory_order_relaxed);
+    }
+
+    auto bin = std::min(static_cast<int>(load / HISTOGRAM_BIN_WIDTH), NUM_HISTOGRAM_BINS - 1);
+    histogram[static_cast<size_t>(bin)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void AudioLoadMonitor::addFileUnderrun() noexcept {
+    numFileUnderruns.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AudioLoadMonitor::reset() {
+    resetRequested = true;
+}
+
+AudioLoadMonitor::Statistics AudioLoadMonitor::getStatistics() const {
+    Statistics stats;
+    stats.numBlocks = numBlocks.load(std::memory_order_relaxed);
+    stats.numOverruns = numOverruns.load(std::memory_order_relaxed);
+    stats.numLateBlocks = numLateBlocks.load(std::memory_order_relaxed);
+    stats.numFileUnderruns = numFileUnderruns.load(std::memory_order_relaxed);
+    stats.peakLoad = peakLoad.load(std::memory_order_relaxed);
+
+    auto duration = totalDurationTicks.load(std::memory_order_relaxed);
+    if (duration > 0) {
+        stats.meanLoad = static_cast<double>(totalProcessingTicks.load(std::memory_order_relaxed)) /
+                         static_cast<double>(duration);
+    }
+
+    for (size_t i = 0; i < histogram.size(); ++i) {
+        stats.histogram[i] = histogram[i].load(std::memory_order_relaxed);
+    }
+
+    if (stats.numBlocks > 0) {
+        for (size_t i = 0; i < stageTicks.size(); ++i) {
+            stats.meanStageMicroseconds[i] = 1e6 * static_cast<double>(stageTicks[i].load(std::memory_order_relaxed)) /
+                                             ticksPerSecond / static_cast<double>(stats.numBlocks);
+        }
+    }
+
+    return stats;
+}
+
+bool AudioLoadMonitor::writeToFile(const juce::File &file) const {
+    auto stats = getStatistics();
+
+    juce::String text;
+    text << "Sample rate: " << sampleRate << " Hz\n"
+         << "Callbacks: " << juce::String(stats.numBlocks) << "\n"
+         << "Overruns: " << juce::String(stats.numOverruns) << "\n"
+         << "Late callbacks: " << juce::String(stats.numLateBlocks) << "\n"
+         << "Audio file underruns: " << juce::String(stats.numFileUnderruns) << "\n"
+         << "Mean load: " << juce::String(100.0 * stats.meanLoad, 2) << "%\n"
+         << "Peak load: " << juce::String(100.f * stats.peakLoad, 2) << "%\n"
+         << "\nStage, mean us per callback\n";
+    for (auto stage = 0; stage < NUM_STAGES; ++stage) {
+        text << getStageName(static_cast<Stage>(stage)) << ", "
+             << juce::String(stats.meanStageMicroseconds[static_cast<size_t>(stage)], 3) << "\n";
+    }
+    text << "\nLoad from %, callbacks\n";
+    for (auto bin = 0; bin < NUM_HISTOGRAM_BINS; ++bin) {
+        text << juce::roundToInt(100.f * HISTOGRAM_BIN_WIDTH * static_cast<float>(bin)) << ", "
+             << juce::String(stats.histogram[static_cast<size_t>(bin)]) << "\n";
+    }
+
+    return file.replaceWithText(text);
+}
+
+const char *AudioLoadMonitor::getStageName(Stage stage) {
+    switch (stage) {
+        case Synth:
+            return "Synth";
+        case SynthOversampled:
+            return "Synth, oversampled";
+        case AudioFile:
+            return "Audio file";
+        case AllpassCascade:
+            return "Allpass cascade";
+        case Reverb:
+            return "Reverb";
+        case Pan:
+            return "Pan";
+        case Gain:
+            return "Gain";
+        case NUM_STAGES:
+        default:
+            return "";
+    }
+}
+
+void AudioLoadMonitor::addStageTime(Stage stage, juce::int64 ticks) noexcept {
+    stageTicks[static_cast<size_t>(stage)].fetch_add(ticks, std::memory_order_relaxed);
+}
+
+void AudioLoadMonitor::clear() noexcept {
+    numBlocks = 0;
+    numOverruns = 0;
+    numLateBlocks = 0;
+    numFileUnderruns = 0;
+    totalProcessingTicks = 0;
+    totalDurationTicks = 0;
+    peakLoad = 0.f;
+    for (auto &count: histogram) {
+        count = 0;
+    }
+    for (auto &ticks: stageTicks) {
+        ticks = 0;
+    }
+    lastBlockStartTicks = 0;
+}
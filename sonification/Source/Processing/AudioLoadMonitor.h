@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    AudioLoadMonitor.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include "../Trace.h"
+
+/**
+ * Measures how much of each audio callback's deadline is spent processing, and where.
+ *
+ * The audio thread brackets each callback with beginBlock()/endBlock(), and each stage of the chain with a
+ * ScopedStage. Everything it records goes into relaxed atomics, so it never locks or allocates; any thread can read
+ * the statistics while it runs.
+ */
+class AudioLoadMonitor {
+public:
+    enum Stage {
+        Synth,
+        // The synth while oversampling, so its cost can be told apart.
+        SynthOversampled,
+        AudioFile,
+        AllpassCascade,
+        Reverb,
+        Pan,
+        Gain,
+        NUM_STAGES
+    };
+
+    // Callback load histogram: bins of 5% up to 200%, then a bin for everything above.
+    static constexpr int NUM_HISTOGRAM_BINS{41};
+    static constexpr float HISTOGRAM_BIN_WIDTH{.05f};
+    // A callback that starts this many block durations after the last one is late.
+    static constexpr double LATE_BLOCK_THRESHOLD{1.5};
+
+    struct Statistics {
+        juce::uint64 numBlocks{0};
+        // Callbacks that took longer than their block's duration to process.
+        juce::uint64 numOverruns{0};
+        // Callbacks that started late; the device may have dropped audio before them.
+        juce::uint64 numLateBlocks{0};
+        // Blocks the audio file couldn't fill because its read-ahead buffer ran dry.
+        juce::uint64 numFileUnderruns{0};
+        // Processing time relative to block duration, 1 at the deadline.
+        double meanLoad{0.0};
+        float peakLoad{0.f};
+        std::array<juce::uint64, NUM_HISTOGRAM_BINS> histogram{};
+        // Mean time spent in each stage per callback, in microseconds.
+        std::array<double, NUM_STAGES> meanStageMicroseconds{};
+    };
+
+    /**
+     * Times a stage of the current block, from construction to destruction. Also traced, if tracing is on.
+     */
+    class ScopedStage {
+    public:
+        ScopedStage(AudioLoadMonitor &monitorToUse, Stage stageToTime) noexcept
+                : monitor(monitorToUse), stage(stageToTime), startTicks(juce::Time::getHighResolutionTicks())
+#if GAIT_SONIFICATION_TRACING
+                , traceScope(getStageName(stageToTime))
+#endif
+        {
+        }
+
+        ~ScopedStage() noexcept {
+            monitor.addStageTime(stage, juce::Time::getHighResolutionTicks() - startTicks);
+        }
+
+    private:
+        AudioLoadMonitor &monitor;
+        Stage stage;
+        juce::int64 startTicks;
+#if GAIT_SONIFICATION_TRACING
+        const Trace::Scope traceScope;
+#endif
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedStage)
+    };
+
+    AudioLoadMonitor();
+
+    /**
+     * Set the sample rate callbacks are timed against. Call while the audio thread isn't running.
+     */
+    void prepare(double sampleRate);
+
+    void beginBlock(int numSamples) noexcept;
+
+    void endBlock() noexcept;
+
+    /**
+     * Count a block the audio file source couldn't fill in time. Call from the audio thread.
+     */
+    void addFileUnderrun() noexcept;
+
+    /**
+     * Clear the statistics. May be called from any thread; takes effect at the beginning of the next block.
+     */
+    void reset();
+
+    Statistics getStatistics() const;
+
+    /**
+     * Write the statistics, including the full histogram, to a text file.
+     */
+    bool writeToFile(const juce::File &file) const;
+
+    static const char *getStageName(Stage stage);
+
+private:
+    void addStageTime(Stage stage, juce::int64 ticks) noexcept;
+
+    void clear() noexcept;
+
+    double sampleRate{0.0};
+    double ticksPerSecond;
+
+    // Owned by the audio thread.
+    juce::int64 blockStartTicks{0};
+    juce::int64 blockDurationTicks{0};
+    juce::int64 lastBlockStartTicks{0};
+    juce::int64 lastBlockDurationTicks{0};
+
+    std::atomic<bool> resetRequested{false};
+
+    std::atomic<juce::uint64> numBlocks{0}, numOverruns{0}, numLateBlocks{0}, numFileUnderruns{0};
+    std::atomic<juce::int64> totalProcessingTicks{0}, totalDurationTicks{0};
+    std::atomic<float> peakLoad{0.f};
+    std::array<std::atomic<juce::uint64>, NUM_HISTOGRAM_BINS> histogram{};
+    std::array<std::atomic<juce::int64>, NUM_STAGES> stageTicks{};
+};
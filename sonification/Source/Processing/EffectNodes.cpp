@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+
+    EffectNodes.cpp
+
+  ==============================================================================
+*/
+
+#include "EffectNodes.h"
+
+ReverbNode::ReverbNode(ParameterStore &parameterStore, int wetLevelParameterToUse) :
+        parameters(parameterStore),
+        wetLevelParameter(wetLevelParameterToUse) {
+}
+
+void ReverbNode::prepare(const juce::dsp::ProcessSpec &spec) {
+    reverb.prepare(spec);
+    reverb.setParameters(juce::Reverb::Parameters{.5f, .25f, 0.f, LEVEL_SCALE, 0.f});
+    wetSmoothingSamples = static_cast<int>(std::ceil(spec.sampleRate * WET_SMOOTHING_SECONDS));
+    fadeOutRemaining = 0;
+    appliedWetLevel = 0.f;
+    isRunning = false;
+    hasTail = false;
+}
+
+bool ReverbNode::isActive(bool inputIsSilent) const {
+    if (wetLevelIsZero() && fadeOutRemaining == 0) {
+        return false;
+    }
+    return !inputIsSilent || hasTail;
+}
+
+void ReverbNode::process(juce::dsp::AudioBlock<float> &block) {
+    auto numSamples = static_cast<int>(block.getNumSamples());
+    auto inputIsSilent = EffectsChain::isSilent(block);
+
+    if (!isRunning) {
+        // Don't let whatever was left ringing when it was bypassed back in.
+        reverb.reset();
+        isRunning = true;
+    }
+
+    // Per-block updates are enough, as juce::Reverb smooths wet/dry changes itself.
+    auto wetLevel = parameters.skip(wetLevelParameter, numSamples);
+    if (wetLevel != appliedWetLevel) {
+        if (wetLevel == 0.f) {
+            fadeOutRemaining = wetSmoothingSamples;
+        }
+        auto reverbParams = reverb.getParameters();
+        reverbParams.wetLevel = wetLevel * LEVEL_SCALE;
+        reverbParams.dryLevel = (1.f - wetLevel) * LEVEL_SCALE;
+        reverb.setParameters(reverbParams);
+        appliedWetLevel = wetLevel;
+    } else if (wetLevel == 0.f) {
+        fadeOutRemaining = std::max(0, fadeOutRemaining - numSamples);
+    }
+
+    auto context = juce::dsp::ProcessContextReplacing<float>(block);
+    reverb.process(context);
+
+    // Fed silence, the output is all tail.
+    hasTail = !inputIsSilent || !EffectsChain::isSilent(block);
+}
+
+void ReverbNode::skip(int numSamples) {
+    parameters.skip(wetLevelParameter, numSamples);
+    isRunning = false;
+    hasTail = false;
+
+    // Restart from a wet level of zero, so turning back on fades in.
+    if (wetLevelIsZero() && appliedWetLevel != 0.f) {
+        auto reverbParams = reverb.getParameters();
+        reverbParams.wetLevel = 0.f;
+        reverbParams.dryLevel = LEVEL_SCALE;
+        reverb.setParameters(reverbParams);
+        appliedWetLevel = 0.f;
+    }
+    fadeOutRemaining = 0;
+}
+
+bool ReverbNode::wetLevelIsZero() const {
+    return parameters.getCurrent(wetLevelParameter) == 0.f && parameters.getTarget(wetLevelParameter) == 0.f;
+}
+
+//==============================================================================
+PanNode::PanNode(ParameterStore &parameterStore, int panParameterToUse) :
+        parameters(parameterStore),
+        panParameter(panParameterToUse) {
+}
+
+void PanNode::prepare(const juce::dsp::ProcessSpec &spec) {
+    panRamp.assign(static_cast<size_t>(spec.maximumBlockSize), 0.f);
+}
+
+bool PanNode::isActive(bool inputIsSilent) const {
+    return !inputIsSilent &&
+           (parameters.getCurrent(panParameter) != 0.f || parameters.getTarget(panParameter) != 0.f);
+}
+
+void PanNode::process(juce::dsp::AudioBlock<float> &block) {
+    auto numSamples = static_cast<int>(block.getNumSamples());
+    if (block.getNumChannels() < 2 || panRamp.empty()) {
+        skip(numSamples);
+        return;
+    }
+
+    auto left = block.getChannelPointer(0), right = block.getChannelPointer(1);
+    auto rampLength = static_cast<int>(panRamp.size());
+    for (auto start = 0; start < numSamples; start += rampLength) {
+        auto length = std::min(rampLength, numSamples - start);
+        parameters.fillRamp(panParameter, panRamp.data(), length);
+        for (auto n = 0; n < length; ++n) {
+            left[start + n] *= 1.f - panRamp[static_cast<size_t>(n)];
+            right[start + n] *= 1.f + panRamp[static_cast<size_t>(n)];
+        }
+    }
+}
+
+void PanNode::skip(int numSamples) {
+    parameters.skip(panParameter, numSamples);
+}
+
+//==============================================================================
+GainNode::GainNode(float gainToUse) : gainLinear(gainToUse) {
+}
+
+void GainNode::prepare(const juce::dsp::ProcessSpec &spec) {
+    gain.prepare(spec);
+    gain.setGainLinear(gainLinear);
+}
+
+bool GainNode::isActive(bool inputIsSilent) const {
+    return !inputIsSilent && gainLinear != 1.f;
+}
+
+void GainNode::process(juce::dsp::AudioBlock<float> &block) {
+    auto context = juce::dsp::ProcessContextReplacing<float>(block);
+    gain.process(context);
+}
@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    EffectNodes.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "EffectsChain.h"
+#include "ParameterStore.h"
+
+/**
+ * Reverb with its wet level following a parameter; dry is 1 - wet.
+ *
+ * juce::Reverb applies twice the dry level it's given, so both levels are scaled by LEVEL_SCALE to give the dry path
+ * unity gain, the same as while bypassed; follow the node with 1 / LEVEL_SCALE of gain for juce::Reverb's own levels.
+ * Bypassed while the wet level is zero. On being turned back on the reverb starts out empty, from a wet level of zero,
+ * so the wet level's ramp crossfades it in. Keeps running on silent input until its tail has died away.
+ */
+class ReverbNode : public EffectsChain::Node {
+public:
+    // Halves juce::Reverb's dry gain of 2, and its wet gain of 3.
+    static constexpr float LEVEL_SCALE{.5f};
+
+    ReverbNode(ParameterStore &parameterStore, int wetLevelParameter);
+
+    void prepare(const juce::dsp::ProcessSpec &spec) override;
+
+    bool isActive(bool inputIsSilent) const override;
+
+    void process(juce::dsp::AudioBlock<float> &block) override;
+
+    void skip(int numSamples) override;
+
+private:
+    // juce::Reverb smooths wet level changes over this long; keep running until a change to zero has taken effect.
+    static constexpr double WET_SMOOTHING_SECONDS{.01};
+
+    bool wetLevelIsZero() const;
+
+    juce::dsp::Reverb reverb;
+    ParameterStore &parameters;
+    int wetLevelParameter;
+
+    int wetSmoothingSamples{0};
+    // Samples left until the reverb's own wet level has settled at zero.
+    int fadeOutRemaining{0};
+    float appliedWetLevel{0.f};
+    bool isRunning{false};
+    // Whether the reverb might still be ringing.
+    bool hasTail{false};
+};
+
+/**
+ * Linear pan law, following a parameter sample by sample; unity gain at the centre, 2 at the extremes, as
+ * juce::dsp::PannerRule::linear. Bypassed while centred.
+ */
+class PanNode : public EffectsChain::Node {
+public:
+    PanNode(ParameterStore &parameterStore, int panParameter);
+
+    void prepare(const juce::dsp::ProcessSpec &spec) override;
+
+    bool isActive(bool inputIsSilent) const override;
+
+    void process(juce::dsp::AudioBlock<float> &block) override;
+
+    void skip(int numSamples) override;
+
+private:
+    ParameterStore &parameters;
+    int panParameter;
+    std::vector<float> panRamp;
+};
+
+/**
+ * Fixed gain; bypassed on silence, and at unity.
+ */
+class GainNode : public EffectsChain::Node {
+public:
+    explicit GainNode(float gainLinear);
+
+    void prepare(const juce::dsp::ProcessSpec &spec) override;
+
+    bool isActive(bool inputIsSilent) const override;
+
+    void process(juce::dsp::AudioBlock<float> &block) override;
+
+private:
+    juce::dsp::Gain<float> gain;
+    float gainLinear;
+};
@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    EffectsChain.cpp
+
+  ==============================================================================
+*/
+
+#include "EffectsChain.h"
+
+void EffectsChain::add(Node &node, AudioLoadMonitor::Stage stage) {
+    nodes.push_back({&node, stage});
+}
+
+void EffectsChain::prepare(const juce::dsp::ProcessSpec &spec) {
+    for (auto &entry: nodes) {
+        entry.node->prepare(spec);
+    }
+}
+
+bool EffectsChain::process(juce::dsp::AudioBlock<float> &block, AudioLoadMonitor &monitor) {
+    auto numSamples = static_cast<int>(block.getNumSamples());
+    auto silent = isSilent(block);
+
+    for (auto &entry: nodes) {
+        if (entry.node->isActive(silent)) {
+            AudioLoadMonitor::ScopedStage stage{monitor, entry.stage};
+            entry.node->process(block);
+            // A node may have made something of nothing, e.g. a reverb tail.
+            silent = silent && isSilent(block);
+        } else {
+            entry.node->skip(numSamples);
+        }
+    }
+
+    if (silent) {
+        block.clear();
+    }
+    return !silent;
+}
+
+bool EffectsChain::isSilent(const juce::dsp::AudioBlock<float> &block) {
+    auto numSamples = block.getNumSamples();
+    // Sound is usually found on the first sample, so look sample by sample rather than scanning the whole block.
+    for (size_t channel = 0; channel < block.getNumChannels(); ++channel) {
+        auto samples = block.getChannelPointer(channel);
+        for (size_t n = 0; n < numSamples; ++n) {
+            if (std::abs(samples[n]) > SILENCE_THRESHOLD) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
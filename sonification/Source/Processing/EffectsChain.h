@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    EffectsChain.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "AudioLoadMonitor.h"
+
+/**
+ * Effects run in series over a block, each of which is skipped when it has nothing to do.
+ *
+ * Before each node the chain tells it whether the block is silent, and the node reports whether it would change it: a
+ * reverb with no wet level, or a gain on silence, would not. A silent block that no node has anything left to add to
+ * is cleared without being processed at all.
+ */
+class EffectsChain {
+public:
+    // Blocks with no sample larger than this are treated as silence; about -100 dBFS.
+    static constexpr float SILENCE_THRESHOLD{1.0e-5f};
+
+    class Node {
+    public:
+        virtual ~Node() = default;
+
+        virtual void prepare(const juce::dsp::ProcessSpec &spec) = 0;
+
+        /**
+         * @param inputIsSilent Whether the block about to be processed is silent.
+         * @return false if processing the block would leave it unchanged.
+         */
+        virtual bool isActive(bool inputIsSilent) const = 0;
+
+        virtual void process(juce::dsp::AudioBlock<float> &block) = 0;
+
+        /**
+         * Called in place of process() for blocks the node isn't active for, e.g. to keep parameter ramps moving.
+         */
+        virtual void skip(int numSamples) { juce::ignoreUnused(numSamples); }
+    };
+
+    /**
+     * Append a node, timed as the given stage. The chain doesn't take ownership. Call before prepare().
+     */
+    void add(Node &node, AudioLoadMonitor::Stage stage);
+
+    void prepare(const juce::dsp::ProcessSpec &spec);
+
+    /**
+     * Run a block through every active node in turn.
+     * @return false if the block is silent, in which case it has been cleared.
+     */
+    bool process(juce::dsp::AudioBlock<float> &block, AudioLoadMonitor &monitor);
+
+    static bool isSilent(const juce::dsp::AudioBlock<float> &block);
+
+private:
+    struct Entry {
+        Node *node;
+        AudioLoadMonitor::Stage stage;
+    };
+
+    std::vector<Entry> nodes;
+};
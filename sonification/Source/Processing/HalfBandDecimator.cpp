@@ -0,0 +1,37 @@
+/*
+  ==============================================================================
+
+    HalfBandDecimator.cpp
+
+  ==============================================================================
+*/
+
+#include "HalfBandDecimator.h"
+
+void HalfBandDecimator::reset() {
+    previousInput.fill(0.f);
+    previousOutput.fill(0.f);
+}
+
+void HalfBandDecimator::process(const float *input, float *output, int numOutputSamples) noexcept {
+    for (auto n = 0; n < numOutputSamples; ++n) {
+        // Each path takes alternate input samples. Read both before writing, so output can overwrite input.
+        auto path0 = input[2 * n + 1];
+        auto path1 = input[2 * n];
+
+        for (size_t i = 0; i < NUM_COEFFICIENTS; i += 2) {
+            auto y = COEFFICIENTS[i] * (path0 - previousOutput[i]) + previousInput[i];
+            previousInput[i] = path0;
+            previousOutput[i] = y;
+            path0 = y;
+        }
+        for (size_t i = 1; i < NUM_COEFFICIENTS; i += 2) {
+            auto y = COEFFICIENTS[i] * (path1 - previousOutput[i]) + previousInput[i];
+            previousInput[i] = path1;
+            previousOutput[i] = y;
+            path1 = y;
+        }
+
+        output[n] = .5f * (path0 + path1);
+    }
+}
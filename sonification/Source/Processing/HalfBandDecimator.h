@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    HalfBandDecimator.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+/**
+ * Halves the sample rate of a signal, with a polyphase IIR half-band lowpass.
+ *
+ * The filter is a pair of chains of first-order allpass sections, each running at the lower rate on alternate input
+ * samples, whose outputs are averaged. With a transition band of 0.05 of the input rate this passes everything below
+ * 0.45 of the output rate flat and attenuates everything above 0.55 by more than 100 dB, for eight multiplies per
+ * output sample. The phase response isn't linear, which doesn't matter for a synth.
+ */
+class HalfBandDecimator {
+public:
+    static constexpr int NUM_COEFFICIENTS{8};
+
+    void reset();
+
+    /**
+     * Decimate 2 * numOutputSamples samples of input to output. Output may be the same buffer as input.
+     */
+    void process(const float *input, float *output, int numOutputSamples) noexcept;
+
+private:
+    // Allpass coefficients, alternating between the two chains; designed as by Laurent de Soras' HIIR library.
+    static constexpr std::array<float, NUM_COEFFICIENTS> COEFFICIENTS{
+            .035832788431f, .134090141943f, .272040143396f, .424324871272f,
+            .572057197236f, .706292142139f, .827124761997f, .941503094174f
+    };
+
+    // The last input and output of each allpass section.
+    std::array<float, NUM_COEFFICIENTS> previousInput{}, previousOutput{};
+};
@@ -0,0 +1,162 @@
+/*
+  ==============================================================================
+
+    ParameterStore.cpp
+
+  ==============================================================================
+*/
+
+#include "ParameterStore.h"
+#include "../Synthesis/FastMath.h"
+
+int ParameterStore::add(float initialValue, double rampTimeMs, Ramp ramp) {
+    jassert(numParameters < MAX_PARAMETERS);
+
+    auto &p = parameters[static_cast<size_t>(numParameters)];
+    p.target = initialValue;
+    p.ramp = ramp;
+    p.rampTimeMs = rampTimeMs;
+    p.current = p.rampTarget = initialValue;
+
+    return numParameters++;
+}
+
+void ParameterStore::prepareToPlay(double sampleRate) {
+    for (auto i = 0; i < numParameters; ++i) {
+        auto &p = parameters[static_cast<size_t>(i)];
+        auto rampSamples = p.rampTimeMs * .001 * sampleRate;
+        p.rampLength = std::max(0, juce::roundToInt(rampSamples));
+        p.remaining = 0;
+        // Distance to the target falls by a factor of e every rampSamples.
+        p.log2Decay = rampSamples > 0.0 ? static_cast<float>(-1.0 / (rampSamples * std::log(2.0))) : -126.f;
+        p.current = p.rampTarget = p.target.load();
+    }
+}
+
+void ParameterStore::set(int id, float newTarget) {
+    getParameter(id).target = newTarget;
+}
+
+float ParameterStore::getTarget(int id) const {
+    jassert(id >= 0 && id < numParameters);
+    return parameters[static_cast<size_t>(id)].target.load();
+}
+
+void ParameterStore::snapTo(int id, float value) {
+    auto &p = getParameter(id);
+    p.current = p.rampTarget = value;
+    p.remaining = 0;
+}
+
+float ParameterStore::getCurrent(int id) const {
+    jassert(id >= 0 && id < numParameters);
+    return parameters[static_cast<size_t>(id)].current;
+}
+
+float ParameterStore::getNext(int id) {
+    return skip(id, 1);
+}
+
+float ParameterStore::skip(int id, int numSamples) {
+    auto &p = getParameter(id);
+    updateTarget(p);
+
+    if (p.current == p.rampTarget || numSamples <= 0) {
+        return p.current;
+    }
+
+    switch (p.ramp) {
+        case Ramp::Linear:
+            if (numSamples >= p.remaining) {
+                p.current = p.rampTarget;
+                p.remaining = 0;
+            } else {
+                p.current += p.step * static_cast<float>(numSamples);
+                p.remaining -= numSamples;
+            }
+            break;
+        case Ramp::Exponential:
+            p.current = p.rampTarget + (p.current - p.rampTarget) *
+                                       FastMath::exp2(p.log2Decay * static_cast<float>(numSamples));
+            snapIfSettled(p);
+            break;
+    }
+
+    return p.current;
+}
+
+void ParameterStore::fillRamp(int id, float *output, int numSamples) {
+    auto &p = getParameter(id);
+    updateTarget(p);
+
+    if (numSamples <= 0) {
+        return;
+    }
+
+    if (p.current == p.rampTarget) {
+        std::fill_n(output, numSamples, p.current);
+        return;
+    }
+
+    switch (p.ramp) {
+        case Ramp::Linear: {
+            auto rampSamples = std::min(numSamples, p.remaining);
+            auto start = p.current, step = p.step;
+            for (auto n = 0; n < rampSamples; ++n) {
+                output[n] = start + step * static_cast<float>(n + 1);
+            }
+            std::fill(output + rampSamples, output + numSamples, p.rampTarget);
+
+            p.remaining -= rampSamples;
+            p.current = p.remaining == 0 ? p.rampTarget : output[rampSamples - 1];
+            break;
+        }
+        case Ramp::Exponential: {
+            // output[n] = target + (current - target) * decay^(n + 1), with the powers computed a block at a time.
+            auto log2Decay = p.log2Decay;
+            for (auto n = 0; n < numSamples; ++n) {
+                output[n] = log2Decay * static_cast<float>(n + 1);
+            }
+            FastMath::exp2(output, output, numSamples);
+
+            auto target = p.rampTarget, distance = p.current - p.rampTarget;
+            for (auto n = 0; n < numSamples; ++n) {
+                output[n] = target + distance * output[n];
+            }
+
+            p.current = output[numSamples - 1];
+            snapIfSettled(p);
+            break;
+        }
+    }
+}
+
+void ParameterStore::updateTarget(Parameter &p) {
+    auto newTarget = p.target.load();
+    if (newTarget == p.rampTarget) {
+        return;
+    }
+
+    p.rampTarget = newTarget;
+    if (p.ramp == Ramp::Linear) {
+        if (p.rampLength > 0) {
+            p.remaining = p.rampLength;
+            p.step = (newTarget - p.current) / static_cast<float>(p.rampLength);
+        } else {
+            p.current = newTarget;
+            p.remaining = 0;
+        }
+    }
+}
+
+void ParameterStore::snapIfSettled(Parameter &p) {
+    static constexpr float THRESHOLD{1e-5f};
+    if (std::abs(p.current - p.rampTarget) <= THRESHOLD * std::max(1.f, std::abs(p.rampTarget))) {
+        p.current = p.rampTarget;
+    }
+}
+
+ParameterStore::Parameter &ParameterStore::getParameter(int id) {
+    jassert(id >= 0 && id < numParameters);
+    return parameters[static_cast<size_t>(id)];
+}
@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    ParameterStore.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+/**
+ * Audio parameters set from a control thread and smoothed on the audio thread.
+ *
+ * The control thread only ever writes a parameter's target, atomically. The audio thread picks up new targets as it
+ * reads values, and ramps towards them over a time given in milliseconds, so smoothing doesn't depend on how often
+ * either thread runs. Linear ramps reach the target in the ramp time; exponential ramps approach it with the ramp time
+ * as their time constant.
+ */
+class ParameterStore {
+public:
+    enum class Ramp {
+        Linear,
+        Exponential
+    };
+
+    static constexpr int MAX_PARAMETERS{16};
+
+    /**
+     * Add a parameter. Call before prepareToPlay(), from the message thread.
+     * @return The parameter's id.
+     */
+    int add(float initialValue, double rampTimeMs, Ramp ramp = Ramp::Linear);
+
+    /**
+     * Set up ramps for a sample rate, jumping every parameter to its target.
+     */
+    void prepareToPlay(double sampleRate);
+
+    /**
+     * Set the value a parameter should ramp to. May be called from any thread.
+     */
+    void set(int id, float newTarget);
+
+    float getTarget(int id) const;
+
+    //==============================================================================
+    // The following must only be called from the audio thread.
+
+    /**
+     * Jump to a value, abandoning any ramp in progress. The parameter then ramps to its target, if it differs.
+     */
+    void snapTo(int id, float value);
+
+    /**
+     * @return The value most recently read, without advancing.
+     */
+    float getCurrent(int id) const;
+
+    /**
+     * @return The next value, one sample on.
+     */
+    float getNext(int id);
+
+    /**
+     * Advance a block without reading every sample.
+     * @return The value at the end of the block.
+     */
+    float skip(int id, int numSamples);
+
+    /**
+     * Write the next numSamples values to output.
+     */
+    void fillRamp(int id, float *output, int numSamples);
+
+private:
+    struct Parameter {
+        std::atomic<float> target{0.f};
+        Ramp ramp{Ramp::Linear};
+        double rampTimeMs{0.0};
+
+        // Owned by the audio thread.
+        float current{0.f};
+        // The target the current ramp is heading for.
+        float rampTarget{0.f};
+        // Linear: samples in a full ramp, samples left in this one, and the per-sample step.
+        int rampLength{0};
+        int remaining{0};
+        float step{0.f};
+        // Exponential: log2 of the per-sample decay of the distance to the target.
+        float log2Decay{0.f};
+    };
+
+    /**
+     * Start a new ramp if the target has changed.
+     */
+    void updateTarget(Parameter &p);
+
+    /**
+     * Jump an exponential ramp to its target once it's close enough.
+     */
+    static void snapIfSettled(Parameter &p);
+
+    Parameter &getParameter(int id);
+
+    std::array<Parameter, MAX_PARAMETERS> parameters;
+    int numParameters{0};
+};
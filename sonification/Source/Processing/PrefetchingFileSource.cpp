@@ -0,0 +1,235 @@
+/*
+  ==============================================================================
+
+    PrefetchingFileSource.cpp
+
+  ==============================================================================
+*/
+
+#include "PrefetchingFileSource.h"
+
+PrefetchingFileSource::PrefetchingFileSource(juce::AudioFormatReader *readerToUse,
+                                             juce::TimeSliceThread &threadToUse,
+                                             AudioLoadMonitor *monitorToUse) :
+        reader(readerToUse),
+        thread(threadToUse),
+        monitor(monitorToUse),
+        totalLength(reader->lengthInSamples) {
+    // AudioFormatReader::read() fills at most two channels.
+    auto numChannels = juce::jlimit(1, 2, static_cast<int>(reader->numChannels));
+
+    if (static_cast<double>(totalLength) <= PRELOAD_MAX_SECONDS * reader->sampleRate) {
+        preloaded.setSize(numChannels, static_cast<int>(totalLength));
+        if (!reader->read(&preloaded, 0, static_cast<int>(totalLength), 0, true, true)) {
+            preloaded.clear();
+        }
+        return;
+    }
+
+    auto ringLength = static_cast<int>(READ_AHEAD_SECONDS * reader->sampleRate);
+    ring.setSize(numChannels, ringLength);
+    fifo.setTotalSize(ringLength);
+    thread.addTimeSliceClient(this);
+}
+
+PrefetchingFileSource::~PrefetchingFileSource() {
+    if (!isPreloaded()) {
+        thread.removeTimeSliceClient(this);
+    }
+}
+
+bool PrefetchingFileSource::isPreloaded() const {
+    return preloaded.getNumSamples() > 0;
+}
+
+juce::uint64 PrefetchingFileSource::getNumUnderruns() const {
+    return numUnderruns.load(std::memory_order_relaxed);
+}
+
+void PrefetchingFileSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    // Nothing depends on the device; the read-ahead buffer is sized in file samples.
+    juce::ignoreUnused(samplesPerBlockExpected, sampleRate);
+}
+
+void PrefetchingFileSource::releaseResources() {
+}
+
+void PrefetchingFileSource::getNextAudioBlock(const juce::AudioSourceChannelInfo &bufferToFill) {
+    if (totalLength <= 0) {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    if (isPreloaded()) {
+        getNextPreloadedBlock(bufferToFill);
+    } else {
+        getNextStreamedBlock(bufferToFill);
+    }
+}
+
+void PrefetchingFileSource::setNextReadPosition(juce::int64 newPosition) {
+    nextReadPosition = newPosition;
+    if (!isPreloaded()) {
+        requestedPosition = newPosition;
+        requestedSeek.fetch_add(1, std::memory_order_release);
+        thread.moveToFrontOfQueue(this);
+    }
+}
+
+juce::int64 PrefetchingFileSource::getNextReadPosition() const {
+    return nextReadPosition.load(std::memory_order_relaxed);
+}
+
+juce::int64 PrefetchingFileSource::getTotalLength() const {
+    return totalLength;
+}
+
+bool PrefetchingFileSource::isLooping() const {
+    return looping;
+}
+
+void PrefetchingFileSource::setLooping(bool shouldLoop) {
+    looping = shouldLoop;
+}
+
+int PrefetchingFileSource::useTimeSlice() {
+    auto seek = requestedSeek.load(std::memory_order_acquire);
+    if (seek != producerSeek) {
+        producerSeek = seek;
+        filePosition = juce::jlimit(static_cast<juce::int64>(0), totalLength, requestedPosition.load());
+        samplesBeforeSeek = samplesWritten;
+        acknowledgedPosition = filePosition;
+        acknowledgedSeek.store(seek, std::memory_order_release);
+    }
+
+    auto numToWrite = std::min(fifo.getFreeSpace(), READ_CHUNK_SAMPLES);
+    if (!looping) {
+        numToWrite = static_cast<int>(std::min(static_cast<juce::int64>(numToWrite), totalLength - filePosition));
+    }
+    if (numToWrite <= 0) {
+        // Full, or finished; check back for seeks.
+        return 20;
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numToWrite, start1, size1, start2, size2);
+    readIntoRing(start1, size1);
+    readIntoRing(start2, size2);
+    fifo.finishedWrite(size1 + size2);
+    samplesWritten += size1 + size2;
+
+    // Keep going while there's a chunk's worth of room, then let the audio thread drain some.
+    return fifo.getFreeSpace() >= READ_CHUNK_SAMPLES ? 0 : 5;
+}
+
+void PrefetchingFileSource::readIntoRing(int ringStart, int numSamples) {
+    while (numSamples > 0) {
+        if (filePosition >= totalLength) {
+            filePosition = 0;
+        }
+        auto numToRead = static_cast<int>(std::min(static_cast<juce::int64>(numSamples), totalLength - filePosition));
+        reader->read(&ring, ringStart, numToRead, filePosition, true, true);
+        ringStart += numToRead;
+        numSamples -= numToRead;
+        filePosition += numToRead;
+    }
+}
+
+void PrefetchingFileSource::getNextPreloadedBlock(const juce::AudioSourceChannelInfo &bufferToFill) {
+    auto startPosition = nextReadPosition.load(std::memory_order_relaxed);
+    auto position = startPosition;
+    auto numCopied = 0;
+    while (numCopied < bufferToFill.numSamples) {
+        if (position >= totalLength) {
+            if (!looping) {
+                break;
+            }
+            position = 0;
+        }
+        auto numToCopy = static_cast<int>(std::min(static_cast<juce::int64>(bufferToFill.numSamples - numCopied),
+                                                   totalLength - position));
+        copyToOutput(preloaded, static_cast<int>(position), bufferToFill, numCopied, numToCopy);
+        numCopied += numToCopy;
+        position += numToCopy;
+    }
+
+    if (numCopied < bufferToFill.numSamples) {
+        bufferToFill.buffer->clear(bufferToFill.startSample + numCopied, bufferToFill.numSamples - numCopied);
+    }
+
+    // Unless there's been a seek meanwhile.
+    nextReadPosition.compare_exchange_strong(startPosition, position, std::memory_order_relaxed);
+}
+
+void PrefetchingFileSource::getNextStreamedBlock(const juce::AudioSourceChannelInfo &bufferToFill) {
+    auto seek = acknowledgedSeek.load(std::memory_order_acquire);
+    if (seek != consumerSeek) {
+        // Drop what was decoded from before the seek.
+        auto numStale = static_cast<int>(std::max(static_cast<juce::int64>(0), samplesBeforeSeek - samplesRead));
+        fifo.finishedRead(numStale);
+        samplesRead += numStale;
+        nextReadPosition = acknowledgedPosition.load();
+        consumerSeek = seek;
+        refillingAfterSeek = true;
+    }
+
+    if (requestedSeek.load(std::memory_order_acquire) != consumerSeek) {
+        // Still seeking; no sense playing from the old position.
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    auto position = nextReadPosition.load(std::memory_order_relaxed);
+    auto numWanted = bufferToFill.numSamples;
+    if (!looping) {
+        numWanted = static_cast<int>(juce::jlimit(static_cast<juce::int64>(0), static_cast<juce::int64>(numWanted),
+                                                  totalLength - position));
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numWanted, start1, size1, start2, size2);
+    copyToOutput(ring, start1, bufferToFill, 0, size1);
+    copyToOutput(ring, start2, bufferToFill, size1, size2);
+    auto numRead = size1 + size2;
+    fifo.finishedRead(numRead);
+    samplesRead += numRead;
+
+    // Running dry while the ring refills after a seek is expected.
+    refillingAfterSeek = refillingAfterSeek && numRead == 0;
+    if (numRead < numWanted && !refillingAfterSeek) {
+        reportUnderrun();
+    }
+    if (numRead < bufferToFill.numSamples) {
+        bufferToFill.buffer->clear(bufferToFill.startSample + numRead, bufferToFill.numSamples - numRead);
+    }
+
+    position += numRead;
+    if (looping) {
+        position %= totalLength;
+    }
+    nextReadPosition.store(position, std::memory_order_relaxed);
+}
+
+void PrefetchingFileSource::copyToOutput(const juce::AudioBuffer<float> &source, int sourceStart,
+                                         const juce::AudioSourceChannelInfo &bufferToFill, int outputOffset,
+                                         int numSamples) {
+    if (numSamples <= 0) {
+        return;
+    }
+
+    for (auto channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel) {
+        bufferToFill.buffer->copyFrom(channel,
+                                      bufferToFill.startSample + outputOffset,
+                                      source,
+                                      std::min(channel, source.getNumChannels() - 1),
+                                      sourceStart,
+                                      numSamples);
+    }
+}
+
+void PrefetchingFileSource::reportUnderrun() noexcept {
+    numUnderruns.fetch_add(1, std::memory_order_relaxed);
+    if (monitor != nullptr) {
+        monitor->addFileUnderrun();
+    }
+}
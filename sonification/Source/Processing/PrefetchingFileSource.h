@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    PrefetchingFileSource.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include "AudioLoadMonitor.h"
+
+/**
+ * Plays an audio file without touching the disk on the audio thread.
+ *
+ * Short files are decoded into memory up front. Longer ones are decoded ahead of the play position into a ring buffer
+ * on a background TimeSliceThread, and the audio thread only ever copies out of the ring. If the ring runs dry the
+ * rest of the block is silent and an underrun is counted, rather than the audio thread waiting on the decoder.
+ *
+ * Looping is gapless either way: the end of the file is followed directly by its start, in the same block if need be.
+ */
+class PrefetchingFileSource : public juce::PositionableAudioSource,
+                              private juce::TimeSliceClient {
+public:
+    // Files up to this long are decoded into memory.
+    static constexpr double PRELOAD_MAX_SECONDS{30.0};
+    // How far ahead of the play position longer files are decoded.
+    static constexpr double READ_AHEAD_SECONDS{4.0};
+    // The most decoded in one time slice, so seeks are taken up promptly.
+    static constexpr int READ_CHUNK_SAMPLES{8192};
+
+    /**
+     * @param readerToUse The file to play; the source takes ownership.
+     * @param threadToUse Decodes long files; must be running for as long as the source exists.
+     * @param monitorToUse Where to report underruns, if anywhere.
+     */
+    PrefetchingFileSource(juce::AudioFormatReader *readerToUse,
+                          juce::TimeSliceThread &threadToUse,
+                          AudioLoadMonitor *monitorToUse = nullptr);
+
+    ~PrefetchingFileSource() override;
+
+    /**
+     * @return Whether the whole file is in memory.
+     */
+    bool isPreloaded() const;
+
+    /**
+     * @return The number of blocks not filled because the read-ahead buffer ran dry.
+     */
+    juce::uint64 getNumUnderruns() const;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+
+    void releaseResources() override;
+
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo &bufferToFill) override;
+
+    /**
+     * May be called from any thread. When streaming, the block after a seek may be silent while the read-ahead
+     * thread catches up.
+     */
+    void setNextReadPosition(juce::int64 newPosition) override;
+
+    juce::int64 getNextReadPosition() const override;
+
+    juce::int64 getTotalLength() const override;
+
+    bool isLooping() const override;
+
+    void setLooping(bool shouldLoop) override;
+
+private:
+    /**
+     * Take up any seek, then decode into the ring. Runs on the read-ahead thread.
+     * @return Milliseconds until the next slice.
+     */
+    int useTimeSlice() override;
+
+    /**
+     * Decode from the file position into the ring, wrapping at the end of the file. Runs on the read-ahead thread.
+     */
+    void readIntoRing(int ringStart, int numSamples);
+
+    void getNextPreloadedBlock(const juce::AudioSourceChannelInfo &bufferToFill);
+
+    void getNextStreamedBlock(const juce::AudioSourceChannelInfo &bufferToFill);
+
+    /**
+     * Copy file samples to an output block, repeating the last file channel if the output has more channels.
+     */
+    static void copyToOutput(const juce::AudioBuffer<float> &source, int sourceStart,
+                             const juce::AudioSourceChannelInfo &bufferToFill, int outputOffset, int numSamples);
+
+    void reportUnderrun() noexcept;
+
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    juce::TimeSliceThread &thread;
+    AudioLoadMonitor *monitor;
+    const juce::int64 totalLength;
+    std::atomic<bool> looping{false};
+    std::atomic<juce::int64> nextReadPosition{0};
+    std::atomic<juce::uint64> numUnderruns{0};
+
+    // The whole file, if preloaded.
+    juce::AudioBuffer<float> preloaded;
+
+    // Decoded audio, written by the read-ahead thread and read by the audio thread.
+    juce::AudioBuffer<float> ring;
+    juce::AbstractFifo fifo{1};
+
+    // Seeks are counted: a seek is requested by setNextReadPosition(), acknowledged by the read-ahead thread once it
+    // is decoding from the new position, then applied by the audio thread, which drops whatever was decoded before.
+    std::atomic<juce::uint32> requestedSeek{0}, acknowledgedSeek{0};
+    std::atomic<juce::int64> requestedPosition{0}, acknowledgedPosition{0};
+    // The number of samples written to the ring before the acknowledged seek.
+    std::atomic<juce::int64> samplesBeforeSeek{0};
+
+    // Owned by the read-ahead thread.
+    juce::uint32 producerSeek{0};
+    juce::int64 filePosition{0};
+    juce::int64 samplesWritten{0};
+
+    // Owned by the audio thread.
+    juce::uint32 consumerSeek{0};
+    juce::int64 samplesRead{0};
+    bool refillingAfterSeek{false};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PrefetchingFileSource)
+};
@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Command-line tool that renders the sonification of captures to WAV files,
+    without an audio device:
+
+        GaitSonificationRender [options] capture.csv...
+
+        --mode=rhythmic|constant|audio  Sonification mode (default rhythmic)
+        --patch=default|bell|reed|vibrato  Synth patch (default default)
+        --audio=<file>                  Audio file to filter, for --mode=audio
+        --mapping=<file>                JSON mapping design (default: the
+                                        built-in mapping)
+        --capture-timestamps            Time samples by the capture's own
+                                        sample numbers, not the sample count
+        --output=<directory>            Where to write <capture>.wav (default
+                                        alongside each capture)
+        --rate=<Hz>                     Sample rate (default 48000)
+        --jobs=<n>                      Captures rendered at once (default:
+                                        number of CPUs)
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "OfflineRenderer.h"
+
+namespace {
+    void printUsage() {
+        std::cerr << "Usage: GaitSonificationRender [--mode=rhythmic|constant|audio]"
+                     " [--patch=default|bell|reed|vibrato] [--audio=<file>] [--mapping=<file>]"
+                     " [--capture-timestamps] [--output=<directory>] [--rate=<Hz>] [--jobs=<n>]"
+                     " capture.csv..." << std::endl;
+    }
+
+    bool parseOptions(const juce::ArgumentList &args, OfflineRenderer::Options &options) {
+        if (args.containsOption("--mode")) {
+            auto mode = args.getValueForOption("--mode");
+            if (mode == "rhythmic") {
+                options.mode = SonificationEngine::SynthRhythmic;
+            } else if (mode == "constant") {
+                options.mode = SonificationEngine::SynthConstant;
+            } else if (mode == "audio") {
+                options.mode = SonificationEngine::AudioFile;
+            } else {
+                std::cerr << "Unknown mode: " << mode << std::endl;
+                return false;
+            }
+        }
+
+        if (args.containsOption("--patch")) {
+            auto result = SonificationEngine::parsePatchName(args.getValueForOption("--patch"), options.patch);
+            if (result.failed()) {
+                std::cerr << result.getErrorMessage() << std::endl;
+                return false;
+            }
+        }
+
+        if (options.mode == SonificationEngine::AudioFile) {
+            if (!args.containsOption("--audio")) {
+                std::cerr << "--mode=audio needs an --audio file" << std::endl;
+                return false;
+            }
+            options.audioFile = args.getFileForOption("--audio");
+        }
+
+        if (args.containsOption("--mapping")) {
+            auto mappingFile = args.getFileForOption("--mapping");
+            auto result = SonificationMapping::parseDesign(mappingFile.loadFileAsString(),
+                                                           SonificationEngine::getModeNames(), options.mapping);
+            if (result.failed()) {
+                std::cerr << "Failed to load mapping " << mappingFile.getFullPathName() << ": "
+                          << result.getErrorMessage() << std::endl;
+                return false;
+            }
+        }
+
+        if (args.containsOption("--capture-timestamps")) {
+            options.timestampSource = GaitEventDetector::TimestampSource::Capture;
+        }
+
+        if (args.containsOption("--rate")) {
+            auto result = SonificationEngine::parseSampleRate(args.getValueForOption("--rate"), options.sampleRate);
+            if (result.failed()) {
+                std::cerr << result.getErrorMessage() << std::endl;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    struct RenderJob {
+        juce::File captureFile, outputFile;
+        juce::Result result{juce::Result::ok()};
+        double renderedSeconds{0.0}, elapsedSeconds{0.0};
+    };
+}
+
+int main(int argc, char *argv[]) {
+    juce::ArgumentList args{argc, argv};
+
+    OfflineRenderer::Options options;
+    if (!parseOptions(args, options)) {
+        printUsage();
+        return 1;
+    }
+
+    auto outputDirectory = args.containsOption("--output") ? args.getFileForOption("--output") : juce::File{};
+    if (outputDirectory != juce::File{} && !outputDirectory.createDirectory()) {
+        std::cerr << "Failed to create " << outputDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    std::vector<RenderJob> jobs;
+    for (auto &arg: args.arguments) {
+        if (arg.isOption()) {
+            continue;
+        }
+        auto captureFile = arg.resolveAsFile();
+        auto directory = outputDirectory != juce::File{} ? outputDirectory : captureFile.getParentDirectory();
+        jobs.push_back({captureFile, directory.getChildFile(captureFile.getFileNameWithoutExtension() + ".wav")});
+    }
+    if (jobs.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    auto numThreads = args.containsOption("--jobs") ? args.getValueForOption("--jobs").getIntValue()
+                                                    : juce::SystemStats::getNumCpus();
+    juce::ThreadPool pool{juce::jlimit(1, static_cast<int>(jobs.size()), numThreads)};
+
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+    for (auto &job: jobs) {
+        pool.addJob([&job, &options] {
+            auto jobStartTime = juce::Time::getMillisecondCounterHiRes();
+            OfflineRenderer renderer{options};
+            job.result = renderer.render(job.captureFile, job.outputFile);
+            job.renderedSeconds = renderer.getRenderedSeconds();
+            job.elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - jobStartTime) * .001;
+        });
+    }
+    while (pool.getNumJobs() > 0) {
+        juce::Thread::sleep(10);
+    }
+    auto elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * .001;
+
+    auto numFailed{0};
+    auto totalRenderedSeconds{0.0};
+    for (auto &job: jobs) {
+        if (job.result.failed()) {
+            std::cerr << job.result.getErrorMessage() << std::endl;
+            ++numFailed;
+            continue;
+        }
+        totalRenderedSeconds += job.renderedSeconds;
+        std::cout << job.outputFile.getFullPathName() << ": " << juce::String(job.renderedSeconds, 1) << " s in "
+                  << juce::String(job.elapsedSeconds, 2) << " s" << std::endl;
+    }
+    std::cout << "Rendered " << juce::String(totalRenderedSeconds, 1) << " s of audio in "
+              << juce::String(elapsedSeconds, 2) << " s ("
+              << juce::String(totalRenderedSeconds / std::max(elapsedSeconds, 1e-3), 0) << "x real time)"
+              << std::endl;
+
+    return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+
+#include <utility>
+
+namespace {
+    /**
+     * Plays an audio file on a loop at the render's sample rate, at the same level as the app's transport source.
+     */
+    class LoopingFileSource : public juce::AudioSource {
+    public:
+        explicit LoopingFileSource(juce::AudioFormatReader *reader) :
+                fileSampleRate(reader->sampleRate),
+                readerSource(reader, true),
+                resampler(&readerSource, false, SonificationEngine::NUM_OUTPUT_CHANNELS) {
+            readerSource.setLooping(true);
+        }
+
+        void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override {
+            resampler.setResamplingRatio(fileSampleRate / sampleRate);
+            resampler.prepareToPlay(samplesPerBlockExpected, sampleRate);
+        }
+
+        void releaseResources() override {
+            resampler.releaseResources();
+        }
+
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo &bufferToFill) override {
+            resampler.getNextAudioBlock(bufferToFill);
+            bufferToFill.buffer->applyGain(bufferToFill.startSample, bufferToFill.numSamples,
+                                           SonificationEngine::AUDIO_FILE_GAIN);
+        }
+
+    private:
+        double fileSampleRate;
+        juce::AudioFormatReaderSource readerSource;
+        juce::ResamplingAudioSource resampler;
+    };
+}
+
+OfflineRenderer::OfflineRenderer(Options optionsToUse) : options(std::move(optionsToUse)) {
+}
+
+juce::Result OfflineRenderer::render(const juce::File &captureFile, const juce::File &outputFile) {
+    numSamplesRendered = 0;
+
+    auto capture = captureFile;
+    GaitEventDetector detector{capture};
+    detector.setTimestampSource(options.timestampSource);
+    if (!detector.prepareToProcess()) {
+        return juce::Result::fail("Failed to load capture data from " + captureFile.getFullPathName());
+    }
+
+    std::unique_ptr<LoopingFileSource> fileSource;
+    if (options.mode == SonificationEngine::AudioFile) {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+        auto *reader = formatManager.createReaderFor(options.audioFile);
+        if (reader == nullptr) {
+            return juce::Result::fail("Failed to load audio file " + options.audioFile.getFullPathName());
+        }
+        fileSource = std::make_unique<LoopingFileSource>(reader);
+        fileSource->prepareToPlay(options.blockSize, options.sampleRate);
+    }
+
+    outputFile.deleteFile();
+    auto stream = std::make_unique<juce::FileOutputStream>(outputFile);
+    if (!stream->openedOk()) {
+        return juce::Result::fail("Failed to open " + outputFile.getFullPathName() + " for writing");
+    }
+    juce::WavAudioFormat wavFormat;
+    writer.reset(wavFormat.createWriterFor(stream.get(), options.sampleRate, SonificationEngine::NUM_OUTPUT_CHANNELS,
+                                           options.bitsPerSample, {}, 0));
+    if (writer == nullptr) {
+        return juce::Result::fail("Failed to create a WAV writer for " + outputFile.getFullPathName());
+    }
+    // The writer owns the stream now.
+    stream.release();
+
+    engine.setMode(options.mode);
+    engine.setSynthPatch(options.patch, options.settings.synthDecayTime);
+    engine.setMappingDesign(options.mapping);
+    engine.setAudioFileSource(fileSource.get());
+    engine.prepareToPlay(options.sampleRate, options.blockSize);
+    buffer.setSize(SonificationEngine::NUM_OUTPUT_CHANNELS, options.blockSize);
+
+    engine.start(options.settings);
+
+    while (true) {
+        detector.processNextSample();
+        if (detector.isDoneProcessing()) {
+            break;
+        }
+
+        engine.update(detector, options.settings);
+        // Round each IMU sample's time, rather than each interval, so rounding errors don't accumulate.
+        renderUntil(static_cast<juce::int64>(std::llround(detector.getCurrentTime() * .001 * options.sampleRate)));
+    }
+
+    engine.stop();
+    renderUntil(numSamplesRendered + static_cast<juce::int64>(options.tailSeconds * options.sampleRate));
+
+    writer.reset();
+    engine.setAudioFileSource(nullptr);
+
+    return juce::Result::ok();
+}
+
+double OfflineRenderer::getRenderedSeconds() const {
+    return static_cast<double>(numSamplesRendered) / options.sampleRate;
+}
+
+void OfflineRenderer::renderUntil(juce::int64 endSample) {
+    while (numSamplesRendered < endSample) {
+        auto numSamples = static_cast<int>(std::min(static_cast<juce::int64>(options.blockSize),
+                                                     endSample - numSamplesRendered));
+        juce::AudioSourceChannelInfo bufferToFill{&buffer, 0, numSamples};
+        engine.getNextAudioBlock(bufferToFill);
+        writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+        numSamplesRendered += numSamples;
+    }
+}
@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../SonificationEngine.h"
+
+/**
+ * Renders the sonification of a capture to a WAV file, as fast as it can be computed.
+ *
+ * The detector and the audio chain are driven just as they are in the app, but from a sample clock rather than a timer
+ * and an audio device: after each IMU sample the engine is updated, then audio is rendered up to that sample's time.
+ * The output is the same on every run. Renderers share no state, so several can run at once on different threads.
+ */
+class OfflineRenderer {
+public:
+    struct Options {
+        SonificationEngine::SonificationMode mode{SonificationEngine::SynthRhythmic};
+        SonificationEngine::SynthPatch patch{SonificationEngine::PatchDefault};
+        SonificationEngine::Settings settings;
+        SonificationMapping::Design mapping{SonificationEngine::createDefaultMappingDesign()};
+        GaitEventDetector::TimestampSource timestampSource{GaitEventDetector::TimestampSource::SampleClock};
+        // The audio filtered in AudioFile mode.
+        juce::File audioFile;
+        double sampleRate{48000.0};
+        int blockSize{512};
+        int bitsPerSample{24};
+        // Audio rendered after the last IMU sample, to let notes and reverb ring out.
+        double tailSeconds{2.0};
+    };
+
+    explicit OfflineRenderer(Options optionsToUse);
+
+    /**
+     * Render a capture to a WAV file, overwriting it if it exists.
+     */
+    juce::Result render(const juce::File &captureFile, const juce::File &outputFile);
+
+    /**
+     * @return The length of the audio most recently rendered.
+     */
+    double getRenderedSeconds() const;
+
+private:
+    /**
+     * Render and write audio up to a given sample.
+     */
+    void renderUntil(juce::int64 endSample);
+
+    Options options;
+
+    SonificationEngine engine;
+    juce::AudioBuffer<float> buffer;
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    juce::int64 numSamplesRendered{0};
+};
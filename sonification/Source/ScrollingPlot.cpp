@@ -0,0 +1,160 @@
+#include "ScrollingPlot.h"
+
+bool ScrollingPlot::setSize(int newWidth, int newHeight, float newScale) {
+    if (newWidth == width && newHeight == height && newScale == scale && image.isValid()) {
+        return false;
+    }
+
+    width = std::max(1, newWidth);
+    height = std::max(1, newHeight);
+    scale = newScale;
+    clear();
+    return true;
+}
+
+bool ScrollingPlot::setLookback(int numSamples) {
+    numSamples = std::max(2, numSamples);
+    if (numSamples == lookback) {
+        return false;
+    }
+
+    lookback = numSamples;
+    clear();
+    return true;
+}
+
+int ScrollingPlot::getLookback() const {
+    return lookback;
+}
+
+void ScrollingPlot::clear() {
+    // No image until the plot has been given a size.
+    image = height > 0 ? juce::Image{juce::Image::ARGB,
+                                     juce::roundToInt(static_cast<float>(getRingWidth()) * scale),
+                                     juce::roundToInt(static_cast<float>(height) * scale),
+                                     true} : juce::Image{};
+    lastSampleIndex = -1;
+    lastFlushedIndex = -1;
+    pendingSamples.clear();
+    pendingSamples.reserve(static_cast<size_t>(lookback));
+}
+
+juce::int64 ScrollingPlot::getLastSampleIndex() const {
+    return lastSampleIndex;
+}
+
+void ScrollingPlot::appendSample(juce::int64 sampleIndex, float y, juce::Colour colour) {
+    jassert(sampleIndex > lastSampleIndex);
+
+    // Prevent NaN values throwing an exception.
+    if (std::isnan(y)) {
+        y = 0.f;
+    }
+
+    traceColour = colour;
+    pendingSamples.push_back({sampleIndex, y});
+    lastSampleIndex = sampleIndex;
+    lastSampleY = y;
+}
+
+void ScrollingPlot::markSample(juce::int64 sampleIndex, const MarkFunction &markFunction) {
+    flushSamples();
+
+    // Only mark samples that are still in the visible window.
+    if (!image.isValid() || sampleIndex <= lastSampleIndex - lookback) {
+        return;
+    }
+
+    juce::Graphics g{image};
+    g.addTransform(juce::AffineTransform::scale(scale));
+    auto x = getRingPosition(sampleIndex);
+    auto ringWidth = static_cast<float>(getRingWidth());
+    markFunction(g, x);
+    markFunction(g, x - ringWidth);
+    markFunction(g, x + ringWidth);
+}
+
+float ScrollingPlot::getSampleSpacing() const {
+    return static_cast<float>(width) / static_cast<float>(lookback - 1);
+}
+
+void ScrollingPlot::draw(juce::Graphics &g, juce::Rectangle<int> area) {
+    flushSamples();
+
+    if (!image.isValid() || lastSampleIndex < 0) {
+        return;
+    }
+
+    juce::Graphics::ScopedSaveState state{g};
+    g.reduceClipRegion(area);
+
+    // Put the newest sample at the right-hand edge, with the part of the ring to its right wrapped around to the left.
+    auto offset = static_cast<float>(area.getRight()) - getRingPosition(lastSampleIndex);
+    auto ringWidth = static_cast<float>(getRingWidth());
+    auto toLogical = juce::AffineTransform::scale(1.f / scale);
+    g.drawImageTransformed(image, toLogical.translated(offset, static_cast<float>(area.getY())));
+    g.drawImageTransformed(image, toLogical.translated(offset - ringWidth, static_cast<float>(area.getY())));
+}
+
+float ScrollingPlot::getRingPosition(juce::int64 sampleIndex) const {
+    return static_cast<float>(std::fmod(static_cast<double>(sampleIndex) * getSampleSpacing(), getRingWidth()));
+}
+
+int ScrollingPlot::getRingWidth() const {
+    return width + MARGIN;
+}
+
+void ScrollingPlot::flushSamples() {
+    if (!image.isValid()) {
+        pendingSamples.clear();
+        return;
+    }
+
+    if (pendingSamples.empty()) {
+        return;
+    }
+
+    auto ringWidth = static_cast<float>(getRingWidth());
+    auto spacing = getSampleSpacing();
+
+    // Work in unwrapped coordinates relative to the first new sample, then draw at each position the strip occupies.
+    auto first = pendingSamples.front();
+    auto x0 = getRingPosition(first.index);
+    auto hasPrevious = lastFlushedIndex >= 0 && first.index - lastFlushedIndex < lookback;
+    auto startX = hasPrevious ? x0 - static_cast<float>(first.index - lastFlushedIndex) * spacing : x0;
+
+    juce::Path trace;
+    trace.startNewSubPath(startX, hasPrevious ? lastFlushedY : first.y);
+    for (auto &sample: pendingSamples) {
+        trace.lineTo(x0 + static_cast<float>(sample.index - first.index) * spacing, sample.y);
+    }
+    auto endX = x0 + static_cast<float>(pendingSamples.back().index - first.index) * spacing;
+
+    // If more than a whole ring's worth arrived at once, everything is new.
+    auto stripWidth = std::min(endX - startX, ringWidth);
+
+    {
+        juce::Graphics g{image};
+        g.addTransform(juce::AffineTransform::scale(scale));
+
+        for (auto shift: {0.f, ringWidth, -ringWidth}) {
+            // Erase what was there a ring ago. Leave the previous sample's column alone so the join stays intact.
+            auto left = juce::roundToInt((endX - stripWidth + shift) * scale) + 1;
+            auto right = juce::roundToInt((endX + shift) * scale) + 1;
+            auto clearArea = juce::Rectangle<int>{left, 0, right - left, image.getHeight()}
+                    .getIntersection(image.getBounds());
+            if (!clearArea.isEmpty()) {
+                image.clear(clearArea);
+            }
+        }
+
+        g.setColour(traceColour);
+        for (auto shift: {0.f, ringWidth, -ringWidth}) {
+            g.strokePath(trace, juce::PathStrokeType(2.f), juce::AffineTransform::translation(shift, 0.f));
+        }
+    }
+
+    lastFlushedIndex = pendingSamples.back().index;
+    lastFlushedY = pendingSamples.back().y;
+    pendingSamples.clear();
+}
@@ -0,0 +1,95 @@
+#ifndef GAIT_SONIFICATION_SCROLLINGPLOT_H
+#define GAIT_SONIFICATION_SCROLLINGPLOT_H
+
+#include <JuceHeader.h>
+
+/**
+ * A scrolling plot of the last lookback samples of a signal, drawn incrementally.
+ *
+ * The plot is held in an image used as a ring: sample n lives at x = n * spacing (mod the image width), so appending a
+ * sample only clears and draws the strip between it and the previous sample, and anything else marked at a sample
+ * index (events, shaded regions) is drawn once, when it happens. Drawing the plot blits the ring in two pieces so the
+ * newest sample is at the right-hand edge. Per-frame cost depends on the number of new samples, not the lookback.
+ */
+class ScrollingPlot {
+public:
+    /**
+     * Called to draw something at a given sample position. May be called more than once per mark, at positions a
+     * whole ring width apart, so that anything straddling the ring's seam is drawn on both sides of it.
+     */
+    using MarkFunction = std::function<void(juce::Graphics &, float x)>;
+
+    /**
+     * Set the size of the plot, in logical pixels, and the physical pixel scale to render at.
+     * @return true if the plot had to be cleared, in which case its content should be redrawn.
+     */
+    bool setSize(int newWidth, int newHeight, float newScale);
+
+    /**
+     * Set the number of samples spanned by the plot's width.
+     * @return true if the plot had to be cleared, in which case its content should be redrawn.
+     */
+    bool setLookback(int numSamples);
+
+    int getLookback() const;
+
+    void clear();
+
+    /**
+     * @return The index of the last sample appended, or -1 if none have been appended since the plot was cleared.
+     */
+    juce::int64 getLastSampleIndex() const;
+
+    /**
+     * Append the sample at sampleIndex, which should be later than the last sample appended.
+     * @param y Vertical position of the sample, in logical pixels.
+     */
+    void appendSample(juce::int64 sampleIndex, float y, juce::Colour colour);
+
+    /**
+     * Draw something at the position of a sample already appended to the plot.
+     */
+    void markSample(juce::int64 sampleIndex, const MarkFunction &markFunction);
+
+    /**
+     * @return The horizontal distance between consecutive samples, in logical pixels.
+     */
+    float getSampleSpacing() const;
+
+    /**
+     * Draw the plot with the newest sample at the right-hand edge of area.
+     */
+    void draw(juce::Graphics &g, juce::Rectangle<int> area);
+
+private:
+    // Extra ring width to the left of the visible window, where marks that extend to the left of the oldest visible
+    // sample can land without wrapping into the newest samples.
+    static constexpr int MARGIN{64};
+
+    float getRingPosition(juce::int64 sampleIndex) const;
+
+    int getRingWidth() const;
+
+    void flushSamples();
+
+    juce::Image image;
+    int width{0}, height{0};
+    float scale{1.f};
+    int lookback{150};
+
+    juce::int64 lastSampleIndex{-1};
+    float lastSampleY{0.f};
+
+    // Samples appended since the ring was last drawn to, stroked in one go to keep joins tidy.
+    struct PendingSample {
+        juce::int64 index;
+        float y;
+    };
+    std::vector<PendingSample> pendingSamples;
+    juce::int64 lastFlushedIndex{-1};
+    float lastFlushedY{0.f};
+    juce::Colour traceColour{juce::Colours::lightgrey};
+};
+
+
+#endif //GAIT_SONIFICATION_SCROLLINGPLOT_H
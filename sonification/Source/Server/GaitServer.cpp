@@ -0,0 +1,668 @@
+/*
+  ==============================================================================
+
+    GaitServer.cpp
+
+  ==============================================================================
+*/
+
+#include "GaitServer.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+#if JUCE_LINUX
+    constexpr int SEND_FLAGS{MSG_NOSIGNAL};
+#else
+    constexpr int SEND_FLAGS{0};
+#endif
+
+    juce::String getErrorText() {
+        return std::strerror(errno);
+    }
+
+    bool setNonBlocking(int fd) {
+        auto flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    void appendLittleEndian(std::string &out, juce::uint64 value, int numBytes) {
+        for (auto b = 0; b < numBytes; ++b) {
+            out.push_back(static_cast<char>((value >> (8 * b)) & 0xff));
+        }
+    }
+
+    void appendFloat(std::string &out, float value) {
+        juce::uint32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        appendLittleEndian(out, bits, 4);
+    }
+
+    float readFloat(const char *data) {
+        auto bits = juce::ByteOrder::littleEndianInt(data);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    template<typename... Args>
+    void appendFormatted(std::string &out, const char *format, Args... args) {
+        char line[256];
+        auto length = std::snprintf(line, sizeof(line), format, args...);
+        out.append(line, static_cast<size_t>(juce::jlimit(0, static_cast<int>(sizeof(line)) - 1, length)));
+    }
+
+    const char *getFootName(GaitEventDetector::Foot foot) {
+        switch (foot) {
+            case GaitEventDetector::Foot::Left:
+                return "left";
+            case GaitEventDetector::Foot::Right:
+                return "right";
+            case GaitEventDetector::Foot::Unknown:
+                break;
+        }
+        return "unknown";
+    }
+
+    std::string formatError(const juce::String &message) {
+        std::string out;
+        appendFormatted(out, "{\"type\":\"error\",\"message\":%s}\n", juce::JSON::toString(message).toRawUTF8());
+        return out;
+    }
+
+    std::string formatStats(const GaitServer::ConnectionStats &stats) {
+        std::string out;
+        appendFormatted(out, "{\"type\":\"stats\",\"framesReceived\":%lld,\"framesProcessed\":%lld,"
+                             "\"eventsSent\":%lld,\"bytesReceived\":%lld,\"bytesSent\":%lld,\"readPauses\":%lld,"
+                             "\"maxPendingFrames\":%zu,\"processingMs\":%.3f,\"connectedMs\":%.1f}\n",
+                        static_cast<long long>(stats.framesReceived), static_cast<long long>(stats.framesProcessed),
+                        static_cast<long long>(stats.eventsSent), static_cast<long long>(stats.bytesReceived),
+                        static_cast<long long>(stats.bytesSent), static_cast<long long>(stats.readPauses),
+                        stats.maxPendingFrames, stats.processingMs, stats.connectedMs);
+        return out;
+    }
+}
+
+void GaitServer::appendStreamHeader(std::string &out, float samplePeriodMs) {
+    out.append(STREAM_MAGIC);
+    appendFloat(out, samplePeriodMs);
+}
+
+void GaitServer::appendFrame(std::string &out, juce::int64 sampleIndex, const std::array<float, 6> &values) {
+    appendLittleEndian(out, static_cast<juce::uint64>(sampleIndex), 8);
+    for (auto value: values) {
+        appendFloat(out, value);
+    }
+}
+
+GaitServer::GaitServer(const Options &optionsToUse) :
+        juce::Thread("Gait server"),
+        options(optionsToUse),
+        workers(juce::jmax(1, optionsToUse.numWorkers)) {
+}
+
+GaitServer::~GaitServer() {
+    stop();
+}
+
+juce::Result GaitServer::start() {
+    if (!poller.isValid()) {
+        return juce::Result::fail("Failed to create poller: " + getErrorText());
+    }
+
+    if (pipe(wakeFds) != 0 || !setNonBlocking(wakeFds[0]) || !setNonBlocking(wakeFds[1]) ||
+        !poller.add(wakeFds[0], true, false)) {
+        return juce::Result::fail("Failed to create wake pipe: " + getErrorText());
+    }
+
+    if (options.socketPath.isNotEmpty()) {
+        auto result = listenOnSocket(options.socketPath);
+        if (result.failed()) {
+            return result;
+        }
+    }
+    if (options.port > 0) {
+        auto result = listenOnPort(options.port);
+        if (result.failed()) {
+            return result;
+        }
+    }
+    if (unixListenFd < 0 && tcpListenFd < 0) {
+        return juce::Result::fail("Nothing to listen on");
+    }
+
+    startThread();
+    return juce::Result::ok();
+}
+
+void GaitServer::stop() {
+    if (wakeFds[0] < 0) {
+        return;
+    }
+
+    signalThreadShouldExit();
+    wake();
+    stopThread(5000);
+    workers.removeAllJobs(true, 5000);
+
+    while (!connections.empty()) {
+        closeConnection(connections.begin()->second, "Server stopped");
+    }
+
+    for (auto *fd: {&unixListenFd, &tcpListenFd, &wakeFds[0], &wakeFds[1]}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    if (boundSocketPath.isNotEmpty()) {
+        unlink(boundSocketPath.toRawUTF8());
+        boundSocketPath = {};
+    }
+}
+
+GaitServer::Stats GaitServer::getStats() const {
+    return {connectionsOpen.load(), connectionsAccepted.load(), framesReceived.load(), framesProcessed.load(),
+            eventsSent.load(), bytesReceived.load(), bytesSent.load(), readPauses.load(), protocolErrors.load()};
+}
+
+juce::String GaitServer::getError() const {
+    std::lock_guard<std::mutex> lock{errorMutex};
+    return serverError;
+}
+
+juce::Result GaitServer::listenOnSocket(const juce::String &path) {
+    sockaddr_un address{};
+    if (path.getNumBytesAsUTF8() >= sizeof(address.sun_path)) {
+        return juce::Result::fail("Socket path too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.toRawUTF8());
+
+    auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return juce::Result::fail("Failed to create socket: " + getErrorText());
+    }
+
+    // A socket left behind by a server that didn't stop cleanly.
+    unlink(address.sun_path);
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0 ||
+        !setNonBlocking(fd) || !poller.add(fd, true, false)) {
+        auto error = getErrorText();
+        close(fd);
+        return juce::Result::fail("Failed to listen on " + path + ": " + error);
+    }
+
+    unixListenFd = fd;
+    boundSocketPath = path;
+    return juce::Result::ok();
+}
+
+juce::Result GaitServer::listenOnPort(int port) {
+    auto fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return juce::Result::fail("Failed to create socket: " + getErrorText());
+    }
+
+    auto reuse{1};
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0 ||
+        !setNonBlocking(fd) || !poller.add(fd, true, false)) {
+        auto error = getErrorText();
+        close(fd);
+        return juce::Result::fail("Failed to listen on port " + juce::String(port) + ": " + error);
+    }
+
+    tcpListenFd = fd;
+    return juce::Result::ok();
+}
+
+void GaitServer::run() {
+    std::vector<Poller::Event> events;
+    std::vector<std::shared_ptr<Connection>> dirty;
+
+    while (!threadShouldExit()) {
+        if (!poller.wait(500, events)) {
+            fail("Failed to wait for connections: " + getErrorText());
+            break;
+        }
+
+        for (auto &event: events) {
+            if (event.fd == wakeFds[0]) {
+                char drain[64];
+                while (read(wakeFds[0], drain, sizeof(drain)) > 0) {}
+                continue;
+            }
+            if (event.fd == unixListenFd) {
+                acceptConnections(unixListenFd, "unix");
+                continue;
+            }
+            if (event.fd == tcpListenFd) {
+                acceptConnections(tcpListenFd, "tcp");
+                continue;
+            }
+
+            // It may have been closed by an earlier event.
+            auto it = connections.find(event.fd);
+            if (it == connections.end()) {
+                continue;
+            }
+            auto connection = it->second;
+
+            if (event.readable) {
+                readFrom(connection);
+            }
+            if (event.writable && !connection->closed) {
+                writeTo(connection);
+            }
+            // Nobody is left to reply to.
+            if (event.hangUp && !connection->closed) {
+                closeConnection(connection, "Hung up");
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{dirtyMutex};
+            dirty.swap(dirtyConnections);
+        }
+        for (auto &connection: dirty) {
+            if (!connection->closed) {
+                writeTo(connection);
+            }
+        }
+        dirty.clear();
+    }
+}
+
+void GaitServer::acceptConnections(int listenFd, const juce::String &kind) {
+    while (true) {
+        auto fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Including EAGAIN: none left to accept.
+            return;
+        }
+
+        auto noDelay{1};
+        if (listenFd == tcpListenFd) {
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        }
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noDelay, sizeof(noDelay));
+#endif
+        if (!setNonBlocking(fd) || !poller.add(fd, true, false)) {
+            close(fd);
+            continue;
+        }
+
+        auto connection = std::make_shared<Connection>();
+        connection->fd = fd;
+        connection->connectedAtMs = juce::Time::getMillisecondCounterHiRes();
+        connection->stats.name = kind + " #" + juce::String(++connectionsAccepted);
+        connection->detector.setTimestampSource(GaitEventDetector::TimestampSource::Capture);
+        connection->detector.prepareToProcessSamples();
+        connections[fd] = connection;
+        ++connectionsOpen;
+    }
+}
+
+void GaitServer::readFrom(const std::shared_ptr<Connection> &connection) {
+    auto &input = connection->input;
+    auto previousSize = input.size();
+    input.resize(previousSize + READ_CHUNK_BYTES);
+    auto numRead = recv(connection->fd, input.data() + previousSize, READ_CHUNK_BYTES, 0);
+    input.resize(previousSize + static_cast<size_t>(juce::jmax<ssize_t>(numRead, 0)));
+
+    if (numRead < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            closeConnection(connection, getErrorText());
+        }
+        return;
+    }
+
+    if (numRead == 0) {
+        connection->inputClosed = true;
+        input.clear();
+    } else {
+        bytesReceived += numRead;
+        {
+            std::lock_guard<std::mutex> lock{connection->mutex};
+            connection->stats.bytesReceived += numRead;
+        }
+        parseInput(*connection);
+        scheduleProcessing(connection);
+    }
+
+    updateConnection(connection);
+}
+
+void GaitServer::parseInput(Connection &connection) {
+    auto &input = connection.input;
+    size_t offset{0};
+
+    if (!connection.headerReceived) {
+        if (input.size() < STREAM_HEADER_BYTES) {
+            return;
+        }
+        if (std::memcmp(input.data(), STREAM_MAGIC, std::strlen(STREAM_MAGIC)) != 0) {
+            failConnection(connection, "Expected a GAITIMU1 stream");
+            return;
+        }
+        auto samplePeriodMs = readFloat(input.data() + std::strlen(STREAM_MAGIC));
+        if (!(std::abs(samplePeriodMs - GaitEventDetector::IMU_SAMPLE_PERIOD_MS) <=
+              MAX_PERIOD_ERROR * GaitEventDetector::IMU_SAMPLE_PERIOD_MS)) {
+            failConnection(connection, "The sample period must be " +
+                                       juce::String(GaitEventDetector::IMU_SAMPLE_PERIOD_MS) + " ms");
+            return;
+        }
+
+        connection.headerReceived = true;
+        offset = STREAM_HEADER_BYTES;
+        std::lock_guard<std::mutex> lock{connection.mutex};
+        connection.samplePeriodMs = samplePeriodMs;
+    }
+
+    auto numFrames = (input.size() - offset) / FRAME_BYTES;
+    auto isOutOfOrder{false};
+    {
+        std::lock_guard<std::mutex> lock{connection.mutex};
+        for (size_t f = 0; f < numFrames; ++f) {
+            auto *frame = input.data() + offset + f * FRAME_BYTES;
+            auto sampleIndex = static_cast<juce::int64>(juce::ByteOrder::littleEndianInt64(frame));
+            if (sampleIndex <= connection.lastSampleIndex) {
+                isOutOfOrder = true;
+                break;
+            }
+            connection.lastSampleIndex = sampleIndex;
+            // accelX, accelY, accelZ, gyroX, gyroY, gyroZ after the index.
+            connection.pendingFrames.push_back({sampleIndex, readFloat(frame + 12), readFloat(frame + 24)});
+            ++connection.stats.framesReceived;
+            ++framesReceived;
+        }
+        connection.stats.maxPendingFrames = std::max(connection.stats.maxPendingFrames,
+                                                     connection.pendingFrames.size());
+    }
+
+    if (isOutOfOrder) {
+        failConnection(connection, "Sample indices must increase");
+        return;
+    }
+
+    input.erase(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(offset + numFrames * FRAME_BYTES));
+}
+
+void GaitServer::failConnection(Connection &connection, const juce::String &message) {
+    auto reply = formatError(message);
+    {
+        std::lock_guard<std::mutex> lock{connection.mutex};
+        connection.output += reply;
+        connection.stats.error = message;
+    }
+    ++protocolErrors;
+
+    // Frames already received are still processed.
+    connection.inputClosed = true;
+    connection.input.clear();
+}
+
+void GaitServer::writeTo(const std::shared_ptr<Connection> &connection) {
+    juce::String error;
+    {
+        std::lock_guard<std::mutex> lock{connection->mutex};
+        auto &output = connection->output;
+        while (connection->outputSent < output.size()) {
+            auto numSent = send(connection->fd, output.data() + connection->outputSent,
+                                output.size() - connection->outputSent, SEND_FLAGS);
+            if (numSent > 0) {
+                connection->outputSent += static_cast<size_t>(numSent);
+                connection->stats.bytesSent += numSent;
+                bytesSent += numSent;
+            } else if (numSent < 0 && errno == EINTR) {
+                continue;
+            } else {
+                if (numSent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    error = getErrorText();
+                }
+                break;
+            }
+        }
+
+        // Drop what's been sent, once it's worth moving what hasn't.
+        if (connection->outputSent == output.size()) {
+            output.clear();
+            connection->outputSent = 0;
+        } else if (connection->outputSent > output.size() / 2) {
+            output.erase(0, connection->outputSent);
+            connection->outputSent = 0;
+        }
+    }
+
+    if (error.isNotEmpty()) {
+        closeConnection(connection, error);
+        return;
+    }
+    updateConnection(connection);
+}
+
+void GaitServer::updateConnection(const std::shared_ptr<Connection> &connection) {
+    if (connection->closed) {
+        return;
+    }
+
+    size_t numPendingFrames, numPendingOutputBytes;
+    {
+        std::lock_guard<std::mutex> lock{connection->mutex};
+        numPendingFrames = connection->pendingFrames.size();
+
+        // Done with the client's data; the stats are the last reply.
+        if (connection->inputClosed && !connection->processing && numPendingFrames == 0 &&
+            !connection->statsSent) {
+            connection->stats.connectedMs = juce::Time::getMillisecondCounterHiRes() - connection->connectedAtMs;
+            connection->output += formatStats(connection->stats);
+            connection->statsSent = true;
+        }
+
+        numPendingOutputBytes = connection->output.size() - connection->outputSent;
+
+        if (!connection->readPaused && (numPendingFrames > options.maxPendingFrames ||
+                                        numPendingOutputBytes > options.maxPendingOutputBytes)) {
+            connection->readPaused = true;
+            ++connection->stats.readPauses;
+            ++readPauses;
+        } else if (connection->readPaused && numPendingFrames <= options.maxPendingFrames / 2 &&
+                   numPendingOutputBytes <= options.maxPendingOutputBytes / 2) {
+            connection->readPaused = false;
+        }
+    }
+
+    if (connection->statsSent && numPendingOutputBytes == 0) {
+        closeConnection(connection);
+        return;
+    }
+
+    auto waitToRead = !connection->inputClosed && !connection->readPaused;
+    auto waitToWrite = numPendingOutputBytes > 0;
+    if (waitToRead != connection->waitingToRead || waitToWrite != connection->waitingToWrite) {
+        poller.modify(connection->fd, waitToRead, waitToWrite);
+        connection->waitingToRead = waitToRead;
+        connection->waitingToWrite = waitToWrite;
+    }
+}
+
+void GaitServer::closeConnection(const std::shared_ptr<Connection> &connection, const juce::String &error) {
+    if (connection->closed) {
+        return;
+    }
+
+    connection->closed = true;
+    poller.remove(connection->fd);
+    close(connection->fd);
+    connections.erase(connection->fd);
+    --connectionsOpen;
+
+    ConnectionStats stats;
+    {
+        std::lock_guard<std::mutex> lock{connection->mutex};
+        if (connection->stats.error.isEmpty()) {
+            connection->stats.error = error;
+        }
+        connection->stats.connectedMs = juce::Time::getMillisecondCounterHiRes() - connection->connectedAtMs;
+        stats = connection->stats;
+    }
+
+    if (onConnectionClosed != nullptr) {
+        onConnectionClosed(stats);
+    }
+}
+
+void GaitServer::scheduleProcessing(const std::shared_ptr<Connection> &connection) {
+    {
+        std::lock_guard<std::mutex> lock{connection->mutex};
+        if (connection->processing || connection->pendingFrames.empty()) {
+            return;
+        }
+        connection->processing = true;
+    }
+    workers.addJob([this, connection] { process(connection); });
+}
+
+void GaitServer::process(const std::shared_ptr<Connection> &connection) {
+    if (threadShouldExit()) {
+        return;
+    }
+
+    auto &batch = connection->batch;
+    {
+        std::lock_guard<std::mutex> lock{connection->mutex};
+        auto &pending = connection->pendingFrames;
+        batch.clear();
+        if (pending.size() <= MAX_BATCH_FRAMES) {
+            batch.swap(pending);
+        } else {
+            auto end = pending.begin() + static_cast<std::ptrdiff_t>(MAX_BATCH_FRAMES);
+            batch.assign(pending.begin(), end);
+            pending.erase(pending.begin(), end);
+        }
+    }
+
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    std::string replies;
+    auto numEvents{0};
+    for (auto &frame: batch) {
+        numEvents += detect(*connection, frame, replies);
+    }
+    auto processingMs = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) *
+                        1000.0;
+
+    bool hasMoreFrames;
+    {
+        std::lock_guard<std::mutex> lock{connection->mutex};
+        connection->output += replies;
+        connection->stats.framesProcessed += static_cast<juce::int64>(batch.size());
+        connection->stats.eventsSent += numEvents;
+        connection->stats.processingMs += processingMs;
+        hasMoreFrames = !connection->pendingFrames.empty();
+        connection->processing = hasMoreFrames;
+    }
+    framesProcessed += static_cast<juce::int64>(batch.size());
+    eventsSent += numEvents;
+
+    // To the back of the queue, so that other connections get a turn.
+    if (hasMoreFrames) {
+        workers.addJob([this, connection] { process(connection); });
+    }
+
+    // Even with nothing to send, the server's thread may be waiting on this batch to resume reading or to close.
+    {
+        std::lock_guard<std::mutex> lock{dirtyMutex};
+        dirtyConnections.push_back(connection);
+    }
+    wake();
+}
+
+int GaitServer::detect(Connection &connection, const Frame &frame, std::string &replies) {
+    auto &detector = connection.detector;
+    if (detector.getElapsedSamples() == 0) {
+        connection.timeOffsetMs = static_cast<double>(frame.sampleIndex) * connection.samplePeriodMs -
+                                  GaitEventDetector::IMU_SAMPLE_PERIOD_MS;
+    }
+
+    detector.processSample(frame.accelY, frame.gyroY,
+                           static_cast<double>(frame.sampleIndex) * connection.samplePeriodMs);
+
+    auto numEvents{0};
+    for (auto type: {GaitEventDetector::GaitEventType::ToeOff, GaitEventDetector::GaitEventType::InitialContact}) {
+        auto event = detector.getLastEvent(type);
+        auto &lastSample = type == GaitEventDetector::GaitEventType::ToeOff ? connection.lastToeOffSample
+                                                                          : connection.lastInitialContactSample;
+        if (event.type != type || event.sampleIndex == lastSample) {
+            continue;
+        }
+        lastSample = event.sampleIndex;
+
+        // Back on the client's clock.
+        auto timeMs = event.timeStampMs + connection.timeOffsetMs;
+        auto sampleIndex = std::llround(timeMs / connection.samplePeriodMs);
+        appendFormatted(replies, "{\"type\":\"%s\",\"foot\":\"%s\",\"sample\":%lld,\"timeMs\":%.3f}\n",
+                        type == GaitEventDetector::GaitEventType::ToeOff ? "toe-off" : "initial-contact",
+                        getFootName(event.foot), static_cast<long long>(sampleIndex), timeMs);
+        ++numEvents;
+    }
+
+    if (++connection.samplesSinceMetrics >= METRICS_INTERVAL_SAMPLES) {
+        connection.samplesSinceMetrics = 0;
+        auto info = detector.getGroundContactInfo();
+        appendFormatted(replies, "{\"type\":\"metrics\",\"sample\":%lld,\"cadence\":%.1f,\"balance\":%.3f,"
+                                 "\"leftGctMs\":%.1f,\"rightGctMs\":%.1f}\n",
+                        static_cast<long long>(frame.sampleIndex), static_cast<double>(detector.getCadence()),
+                        static_cast<double>(detector.getGtcBalance()), static_cast<double>(info.leftAvgMs),
+                        static_cast<double>(info.rightAvgMs));
+    }
+
+    return numEvents;
+}
+
+void GaitServer::fail(const juce::String &message) {
+    {
+        std::lock_guard<std::mutex> lock{errorMutex};
+        serverError = message;
+    }
+
+    // Without the poller nothing more can be read or sent, other than what the socket takes now.
+    auto reply = formatError(message);
+    while (!connections.empty()) {
+        auto connection = connections.begin()->second;
+        {
+            std::lock_guard<std::mutex> lock{connection->mutex};
+            connection->output.erase(0, connection->outputSent);
+            connection->outputSent = 0;
+            connection->output += reply;
+            auto numSent = send(connection->fd, connection->output.data(), connection->output.size(), SEND_FLAGS);
+            if (numSent > 0) {
+                connection->stats.bytesSent += numSent;
+                bytesSent += numSent;
+            }
+        }
+        closeConnection(connection, message);
+    }
+}
+
+void GaitServer::wake() {
+    // If the pipe is full, the server's thread is already due to wake.
+    char byte{1};
+    auto numWritten = write(wakeFds[1], &byte, 1);
+    juce::ignoreUnused(numWritten);
+}
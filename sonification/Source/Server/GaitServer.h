@@ -0,0 +1,243 @@
+/*
+  ==============================================================================
+
+    GaitServer.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <limits>
+#include "../GaitEventDetector.h"
+#include "Poller.h"
+
+/**
+ * Runs gait event detection for many runners at once, each streaming IMU data over its own connection to a Unix
+ * domain socket or a localhost TCP port.
+ *
+ * A client sends the binary stream GaitSonificationWorkload writes: "GAITIMU1", the sample period in ms as a float,
+ * then a 32-byte frame per sample, its index as an int64 then accelX, accelY, accelZ, gyroX, gyroY and gyroZ as
+ * floats, all little-endian. Indices must increase; gaps are dropouts. The server replies on the same connection with
+ * one JSON object per line:
+ *
+ *     {"type":"toe-off","foot":"left","sample":1234,"timeMs":8329.500}
+ *     {"type":"metrics","sample":1332,"cadence":171.2,"balance":0.502,"leftGctMs":248.1,"rightGctMs":251.3}
+ *     {"type":"error","message":"..."}
+ *
+ * with initial contacts as "initial-contact", and metrics about once a second of data. When the client shuts down its
+ * side of the connection, the server finishes with its data, replies with the connection's statistics as
+ * {"type":"stats",...} and closes.
+ *
+ * One thread waits on all the sockets, reading frames and writing replies; a pool of workers runs the detectors, one
+ * connection at a time per worker and a batch of frames at a time per connection. A connection stops being read while
+ * it has too many frames waiting to be processed, or too many bytes of replies waiting to be sent, and resumes once
+ * it has caught up.
+ */
+class GaitServer : private juce::Thread {
+public:
+    static constexpr const char *STREAM_MAGIC{"GAITIMU1"};
+    // The magic and the sample period.
+    static constexpr size_t STREAM_HEADER_BYTES{12};
+    static constexpr size_t FRAME_BYTES{32};
+
+    /**
+     * Append the start of a stream, with the period of its samples, as a client sends it.
+     */
+    static void appendStreamHeader(std::string &out, float samplePeriodMs);
+
+    /**
+     * Append a sample's frame, as a client sends it.
+     * @param values accelX, accelY, accelZ, gyroX, gyroY and gyroZ.
+     */
+    static void appendFrame(std::string &out, juce::int64 sampleIndex, const std::array<float, 6> &values);
+
+    struct Options {
+        // Unix domain socket to listen on; empty for none.
+        juce::String socketPath;
+        // Localhost TCP port to listen on; 0 for none.
+        int port{0};
+        int numWorkers{juce::SystemStats::getNumCpus()};
+        // Frames received but not yet processed, beyond which a connection stops being read.
+        size_t maxPendingFrames{8192};
+        // Replies not yet sent, beyond which a connection stops being read.
+        size_t maxPendingOutputBytes{1 << 20};
+    };
+
+    struct ConnectionStats {
+        juce::String name;
+        juce::int64 framesReceived{0};
+        juce::int64 framesProcessed{0};
+        juce::int64 eventsSent{0};
+        juce::int64 bytesReceived{0};
+        juce::int64 bytesSent{0};
+        // Times reading was paused for backpressure.
+        juce::int64 readPauses{0};
+        size_t maxPendingFrames{0};
+        // Time spent in the detector.
+        double processingMs{0.0};
+        double connectedMs{0.0};
+        juce::String error;
+    };
+
+    struct Stats {
+        juce::int64 connectionsOpen{0};
+        juce::int64 connectionsAccepted{0};
+        juce::int64 framesReceived{0};
+        juce::int64 framesProcessed{0};
+        juce::int64 eventsSent{0};
+        juce::int64 bytesReceived{0};
+        juce::int64 bytesSent{0};
+        juce::int64 readPauses{0};
+        juce::int64 protocolErrors{0};
+    };
+
+    explicit GaitServer(const Options &optionsToUse);
+
+    ~GaitServer() override;
+
+    /**
+     * Start listening, and serving connections.
+     */
+    juce::Result start();
+
+    /**
+     * Close every connection, and stop listening.
+     */
+    void stop();
+
+    /**
+     * May be called from any thread.
+     */
+    Stats getStats() const;
+
+    /**
+     * May be called from any thread.
+     * @return Why the server stopped serving of its own accord, having closed every connection; empty while it can
+     * still serve.
+     */
+    juce::String getError() const;
+
+    /**
+     * Called on the server's thread as each connection closes.
+     */
+    std::function<void(const ConnectionStats &)> onConnectionClosed;
+
+private:
+    struct Frame {
+        juce::int64 sampleIndex;
+        float accelY, gyroY;
+    };
+
+    struct Connection {
+        int fd;
+        // Read by the server's thread only.
+        std::vector<char> input;
+        bool headerReceived{false};
+        // Below any index, so a stream may start at 0.
+        juce::int64 lastSampleIndex{std::numeric_limits<juce::int64>::min()};
+        bool readPaused{false}, waitingToRead{true}, waitingToWrite{false};
+        bool inputClosed{false}, statsSent{false}, closed{false};
+        double connectedAtMs;
+
+        // Shared with the workers.
+        std::mutex mutex;
+        std::vector<Frame> pendingFrames;
+        std::string output;
+        size_t outputSent{0};
+        bool processing{false};
+        ConnectionStats stats;
+
+        // Used by one worker at a time.
+        GaitEventDetector detector;
+        std::vector<Frame> batch;
+        double samplePeriodMs{GaitEventDetector::IMU_SAMPLE_PERIOD_MS};
+        // The time of the sample before the first, on the client's clock.
+        double timeOffsetMs{0.0};
+        juce::int64 lastToeOffSample{0}, lastInitialContactSample{0};
+        juce::int64 samplesSinceMetrics{0};
+    };
+
+    // Frames processed by a worker before it moves on to another connection.
+    static constexpr size_t MAX_BATCH_FRAMES{1024};
+    // Metrics are sent once per this many samples, about a second.
+    static constexpr juce::int64 METRICS_INTERVAL_SAMPLES{148};
+    static constexpr size_t READ_CHUNK_BYTES{1 << 16};
+    // How far the sample period a client sends may be from the one the detector is tuned for.
+    static constexpr float MAX_PERIOD_ERROR{.01f};
+
+    void run() override;
+
+    juce::Result listenOnSocket(const juce::String &path);
+
+    juce::Result listenOnPort(int port);
+
+    void acceptConnections(int listenFd, const juce::String &kind);
+
+    void readFrom(const std::shared_ptr<Connection> &connection);
+
+    /**
+     * Turn complete frames in the connection's input into pending frames.
+     */
+    void parseInput(Connection &connection);
+
+    /**
+     * Reply with an error and stop reading from the connection; it closes once the reply has been sent.
+     */
+    void failConnection(Connection &connection, const juce::String &message);
+
+    void writeTo(const std::shared_ptr<Connection> &connection);
+
+    /**
+     * Update what the connection is waited for, pausing or resuming reads, and close it if it's done.
+     */
+    void updateConnection(const std::shared_ptr<Connection> &connection);
+
+    void closeConnection(const std::shared_ptr<Connection> &connection, const juce::String &error = {});
+
+    void scheduleProcessing(const std::shared_ptr<Connection> &connection);
+
+    /**
+     * Run on a worker: process a batch of the connection's frames, then let the server's thread know there are
+     * replies to send.
+     */
+    void process(const std::shared_ptr<Connection> &connection);
+
+    /**
+     * Process a frame, appending any events and metrics to replies.
+     * @return The number of events found.
+     */
+    int detect(Connection &connection, const Frame &frame, std::string &replies);
+
+    void wake();
+
+    /**
+     * Record why the server can't carry on, and close every connection, replying with the error where there's room.
+     */
+    void fail(const juce::String &message);
+
+    Options options;
+    Poller poller;
+    int unixListenFd{-1}, tcpListenFd{-1};
+    juce::String boundSocketPath;
+    // Written by workers to wake the server's thread.
+    int wakeFds[2]{-1, -1};
+
+    std::map<int, std::shared_ptr<Connection>> connections;
+    juce::ThreadPool workers;
+
+    // Connections with replies for the server's thread to send.
+    std::mutex dirtyMutex;
+    std::vector<std::shared_ptr<Connection>> dirtyConnections;
+
+    std::atomic<juce::int64> connectionsOpen{0}, connectionsAccepted{0};
+    std::atomic<juce::int64> framesReceived{0}, framesProcessed{0}, eventsSent{0};
+    std::atomic<juce::int64> bytesReceived{0}, bytesSent{0}, readPauses{0}, protocolErrors{0};
+
+    mutable std::mutex errorMutex;
+    juce::String serverError;
+
+    JUCE_DECLARE_NON_COPYABLE(GaitServer)
+};
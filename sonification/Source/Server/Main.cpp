@@ -0,0 +1,289 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Headless gait analysis server: detects gait events for many runners at
+    once, each streaming IMU data over its own connection, and replies with
+    the events and rolling metrics (see GaitServer.h for the protocol):
+
+        GaitSonificationServer [options]
+
+        --socket=<path>                 Unix domain socket to listen on
+        --port=<n>                      Localhost TCP port to listen on
+        --workers=<n>                   Detection threads (default: number
+                                        of CPUs)
+        --max-pending=<frames>          Frames waiting to be processed, per
+                                        connection, before it stops being
+                                        read (default 8192)
+        --stats=<s>                     Print the server's statistics this
+                                        often; 0 for never (default 10)
+        --stress=<clients>              Instead of serving until interrupted,
+                                        run this many local clients against
+                                        the server, report, and exit
+        --minutes=<m>                   Data each stress client sends
+                                        (default 1)
+        --realtime                      Stress clients send at the IMU rate,
+                                        not as fast as they can
+        --seed=<n>                      Seed for the stress clients' data
+                                        (default 1)
+
+    At least one of --socket and --port is needed. Statistics for each
+    connection are printed as it closes. Exits with 1 if the server stops
+    serving of its own accord.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <csignal>
+#include <iostream>
+#include "GaitServer.h"
+#include "StressClient.h"
+
+namespace {
+    struct Settings {
+        GaitServer::Options server;
+        double statsIntervalSeconds{10.0};
+        int numStressClients{0};
+        double minutes{1.0};
+        bool realtime{false};
+        juce::int64 seed{1};
+    };
+
+    std::atomic<bool> shouldExit{false};
+
+    std::mutex printMutex;
+
+    void print(const juce::String &line) {
+        std::lock_guard<std::mutex> lock{printMutex};
+        std::cout << line << std::endl;
+    }
+
+    void printUsage() {
+        std::cerr << "Usage: GaitSonificationServer [--socket=<path>] [--port=<n>] [--workers=<n>]"
+                     " [--max-pending=<frames>] [--stats=<s>] [--stress=<clients>] [--minutes=<m>] [--realtime]"
+                     " [--seed=<n>]" << std::endl;
+    }
+
+    bool parseOptions(const juce::ArgumentList &args, Settings &settings) {
+        if (args.containsOption("--socket")) {
+            settings.server.socketPath = args.getValueForOption("--socket");
+        }
+        if (args.containsOption("--port")) {
+            settings.server.port = args.getValueForOption("--port").getIntValue();
+            if (settings.server.port < 1 || settings.server.port > 65535) {
+                std::cerr << "--port must be between 1 and 65535" << std::endl;
+                return false;
+            }
+        }
+        if (settings.server.socketPath.isEmpty() && settings.server.port == 0) {
+            std::cerr << "Nothing to listen on; give --socket or --port" << std::endl;
+            return false;
+        }
+
+        if (args.containsOption("--workers")) {
+            settings.server.numWorkers = args.getValueForOption("--workers").getIntValue();
+            if (settings.server.numWorkers < 1) {
+                std::cerr << "--workers must be at least 1" << std::endl;
+                return false;
+            }
+        }
+        if (args.containsOption("--max-pending")) {
+            auto maxPendingFrames = args.getValueForOption("--max-pending").getIntValue();
+            if (maxPendingFrames < 1) {
+                std::cerr << "--max-pending must be at least 1" << std::endl;
+                return false;
+            }
+            settings.server.maxPendingFrames = static_cast<size_t>(maxPendingFrames);
+        }
+        if (args.containsOption("--stats")) {
+            settings.statsIntervalSeconds = juce::jmax(0.0, args.getValueForOption("--stats").getDoubleValue());
+        }
+
+        if (args.containsOption("--stress")) {
+            settings.numStressClients = args.getValueForOption("--stress").getIntValue();
+            if (settings.numStressClients < 1) {
+                std::cerr << "--stress must be at least 1" << std::endl;
+                return false;
+            }
+        }
+        if (args.containsOption("--minutes")) {
+            settings.minutes = args.getValueForOption("--minutes").getDoubleValue();
+            if (settings.minutes <= 0.0) {
+                std::cerr << "--minutes must be positive" << std::endl;
+                return false;
+            }
+        }
+        settings.realtime = args.containsOption("--realtime");
+        if (args.containsOption("--seed")) {
+            settings.seed = args.getValueForOption("--seed").getLargeIntValue();
+        }
+
+        return true;
+    }
+
+    juce::String formatConnectionStats(const GaitServer::ConnectionStats &stats) {
+        auto line = stats.name + ": " + juce::String(stats.framesProcessed) + "/" + juce::String(stats.framesReceived) +
+                    " frames processed, " + juce::String(stats.eventsSent) + " events, " +
+                    juce::String(stats.bytesReceived) + " bytes in, " + juce::String(stats.bytesSent) +
+                    " bytes out, " + juce::String(stats.readPauses) + " read pauses, max " +
+                    juce::String(static_cast<juce::int64>(stats.maxPendingFrames)) + " frames pending, " +
+                    juce::String(stats.processingMs, 1) + " ms processing in " +
+                    juce::String(stats.connectedMs * .001, 2) + " s";
+        if (stats.error.isNotEmpty()) {
+            line << " (" << stats.error << ")";
+        }
+        return line;
+    }
+
+    /**
+     * Prints the server's statistics, with rates since the last time.
+     */
+    class StatsPrinter {
+    public:
+        explicit StatsPrinter(const GaitServer &serverToUse) : server(serverToUse) {
+        }
+
+        void print() {
+            auto stats = server.getStats();
+            auto nowMs = juce::Time::getMillisecondCounterHiRes();
+            auto seconds = juce::jmax(1e-3, (nowMs - lastMs) * .001);
+            ::print(juce::String(stats.connectionsOpen) + " connections open (" +
+                    juce::String(stats.connectionsAccepted) + " accepted), " +
+                    juce::String(static_cast<double>(stats.framesProcessed - last.framesProcessed) / seconds, 0) +
+                    " frames/s, " +
+                    juce::String(static_cast<double>(stats.eventsSent - last.eventsSent) / seconds, 1) +
+                    " events/s, " + juce::String(stats.framesReceived - stats.framesProcessed) + " frames queued, " +
+                    juce::String(stats.readPauses) + " read pauses, " + juce::String(stats.protocolErrors) +
+                    " protocol errors");
+            last = stats;
+            lastMs = nowMs;
+        }
+
+    private:
+        const GaitServer &server;
+        GaitServer::Stats last;
+        double lastMs{juce::Time::getMillisecondCounterHiRes()};
+    };
+
+    int runStressTest(const Settings &settings, GaitServer &server, StatsPrinter &statsPrinter) {
+        std::vector<StressClient::Result> results(static_cast<size_t>(settings.numStressClients));
+        juce::ThreadPool pool{settings.numStressClients};
+
+        auto startMs = juce::Time::getMillisecondCounterHiRes();
+        for (auto c = 0; c < settings.numStressClients; ++c) {
+            StressClient::Options options;
+            options.socketPath = settings.server.socketPath;
+            options.port = settings.server.port;
+            options.generator.seed = settings.seed;
+            options.runnerIndex = c;
+            options.minutes = settings.minutes;
+            options.realtime = settings.realtime;
+            pool.addJob([options, &result = results[static_cast<size_t>(c)]] {
+                StressClient client{options};
+                result = client.run();
+            });
+        }
+
+        auto nextStatsMs = startMs + settings.statsIntervalSeconds * 1000.0;
+        while (pool.getNumJobs() > 0) {
+            juce::Thread::sleep(50);
+            if (settings.statsIntervalSeconds > 0.0 && juce::Time::getMillisecondCounterHiRes() >= nextStatsMs) {
+                statsPrinter.print();
+                nextStatsMs += settings.statsIntervalSeconds * 1000.0;
+            }
+        }
+        auto elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startMs) * .001;
+
+        auto numFailed{0};
+        juce::int64 totalFrames{0};
+        juce::int64 expected{0}, detected{0}, matched{0};
+        for (size_t c = 0; c < results.size(); ++c) {
+            auto &result = results[c];
+            if (result.error.isNotEmpty()) {
+                std::cerr << "Client " << c + 1 << ": " << result.error << std::endl;
+                ++numFailed;
+            }
+            totalFrames += result.framesSent;
+            expected += result.toeOffsExpected;
+            detected += result.toeOffsDetected;
+            matched += result.toeOffsMatched;
+        }
+
+        auto stats = server.getStats();
+        print(juce::String(settings.numStressClients - numFailed) + "/" + juce::String(settings.numStressClients) +
+              " clients succeeded; " + juce::String(totalFrames) + " frames in " + juce::String(elapsedSeconds, 2) +
+              " s (" + juce::String(static_cast<double>(totalFrames) / elapsedSeconds, 0) + " frames/s); toe-offs " +
+              juce::String(matched) + " matched of " + juce::String(expected) + " expected, " +
+              juce::String(detected) + " detected; " + juce::String(stats.readPauses) + " read pauses");
+
+        auto error = server.getError();
+        if (error.isNotEmpty()) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        return numFailed == 0 ? 0 : 1;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    juce::ArgumentList args{argc, argv};
+
+    Settings settings;
+    if (!parseOptions(args, settings)) {
+        printUsage();
+        return 1;
+    }
+
+    // Failed writes to closed connections are handled where they happen.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    GaitServer server{settings.server};
+    server.onConnectionClosed = [&settings](const GaitServer::ConnectionStats &stats) {
+        // With many stress clients, only the ones that went wrong.
+        if (settings.numStressClients == 0 || stats.error.isNotEmpty()) {
+            print(formatConnectionStats(stats));
+        }
+    };
+
+    auto result = server.start();
+    if (result.failed()) {
+        std::cerr << result.getErrorMessage() << std::endl;
+        return 1;
+    }
+
+    StatsPrinter statsPrinter{server};
+    if (settings.numStressClients > 0) {
+        auto exitCode = runStressTest(settings, server, statsPrinter);
+        server.stop();
+        return exitCode;
+    }
+
+    std::signal(SIGINT, [](int) { shouldExit = true; });
+    std::signal(SIGTERM, [](int) { shouldExit = true; });
+
+    print("Listening" + (settings.server.socketPath.isNotEmpty() ? " on " + settings.server.socketPath : "") +
+          (settings.server.port > 0 ? " on 127.0.0.1:" + juce::String(settings.server.port) : "") +
+          " with " + juce::String(settings.server.numWorkers) + " workers");
+
+    auto nextStatsMs = juce::Time::getMillisecondCounterHiRes() + settings.statsIntervalSeconds * 1000.0;
+    // Until interrupted, or the server can't carry on.
+    while (!shouldExit && server.getError().isEmpty()) {
+        juce::Thread::sleep(100);
+        if (settings.statsIntervalSeconds > 0.0 && juce::Time::getMillisecondCounterHiRes() >= nextStatsMs) {
+            statsPrinter.print();
+            nextStatsMs += settings.statsIntervalSeconds * 1000.0;
+        }
+    }
+
+    server.stop();
+    statsPrinter.print();
+
+    auto error = server.getError();
+    if (error.isNotEmpty()) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    Poller.cpp
+
+  ==============================================================================
+*/
+
+#include "Poller.h"
+#include <cerrno>
+#include <unistd.h>
+
+#if JUCE_LINUX
+#include <sys/epoll.h>
+#else
+#include <sys/event.h>
+#endif
+
+#if JUCE_LINUX
+
+Poller::Poller() : pollFd(epoll_create1(EPOLL_CLOEXEC)) {
+}
+
+bool Poller::add(int fd, bool read, bool write) {
+    epoll_event event{};
+    event.events = (read ? EPOLLIN : 0u) | (write ? EPOLLOUT : 0u);
+    event.data.fd = fd;
+    return epoll_ctl(pollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+bool Poller::modify(int fd, bool read, bool write) {
+    epoll_event event{};
+    event.events = (read ? EPOLLIN : 0u) | (write ? EPOLLOUT : 0u);
+    event.data.fd = fd;
+    return epoll_ctl(pollFd, EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
+void Poller::remove(int fd) {
+    epoll_ctl(pollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+bool Poller::wait(int timeoutMs, std::vector<Event> &events) {
+    events.clear();
+
+    epoll_event ready[MAX_EVENTS];
+    auto numReady = epoll_wait(pollFd, ready, MAX_EVENTS, timeoutMs);
+    if (numReady < 0) {
+        return errno == EINTR;
+    }
+
+    for (auto i = 0; i < numReady; ++i) {
+        auto flags = ready[i].events;
+        events.push_back({ready[i].data.fd,
+                          (flags & EPOLLIN) != 0,
+                          (flags & EPOLLOUT) != 0,
+                          (flags & (EPOLLHUP | EPOLLERR)) != 0});
+    }
+    return true;
+}
+
+#else
+
+Poller::Poller() : pollFd(kqueue()) {
+}
+
+bool Poller::add(int fd, bool read, bool write) {
+    return modify(fd, read, write);
+}
+
+bool Poller::modify(int fd, bool read, bool write) {
+    struct kevent changes[2];
+    EV_SET(&changes[0], fd, EVFILT_READ, EV_ADD | (read ? EV_ENABLE : EV_DISABLE), 0, 0, nullptr);
+    EV_SET(&changes[1], fd, EVFILT_WRITE, EV_ADD | (write ? EV_ENABLE : EV_DISABLE), 0, 0, nullptr);
+    return kevent(pollFd, changes, 2, nullptr, 0, nullptr) == 0;
+}
+
+void Poller::remove(int fd) {
+    struct kevent changes[2];
+    EV_SET(&changes[0], fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+    EV_SET(&changes[1], fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+    kevent(pollFd, changes, 2, nullptr, 0, nullptr);
+}
+
+bool Poller::wait(int timeoutMs, std::vector<Event> &events) {
+    events.clear();
+
+    timespec timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+    struct kevent ready[MAX_EVENTS];
+    auto numReady = kevent(pollFd, nullptr, 0, ready, MAX_EVENTS, timeoutMs < 0 ? nullptr : &timeout);
+    if (numReady < 0) {
+        return errno == EINTR;
+    }
+
+    // Reads and writes are reported separately; a descriptor may appear twice. The end of the peer's data is left to
+    // reading to find, since the peer may still be reading.
+    for (auto i = 0; i < numReady; ++i) {
+        auto fd = static_cast<int>(ready[i].ident);
+        auto isWrite = ready[i].filter == EVFILT_WRITE;
+        events.push_back({fd,
+                          !isWrite,
+                          isWrite,
+                          (ready[i].flags & EV_ERROR) != 0 || (isWrite && (ready[i].flags & EV_EOF) != 0)});
+    }
+    return true;
+}
+
+#endif
+
+Poller::~Poller() {
+    if (pollFd >= 0) {
+        close(pollFd);
+    }
+}
+
+bool Poller::isValid() const {
+    return pollFd >= 0;
+}
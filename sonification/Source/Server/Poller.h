@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    Poller.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Waits for any of a set of file descriptors to become readable or writable: epoll on Linux, kqueue on macOS and the
+ * BSDs. Readiness is level-triggered. Not thread-safe; one thread adds, modifies, removes and waits.
+ */
+class Poller {
+public:
+    struct Event {
+        int fd;
+        bool readable;
+        bool writable;
+        // The peer hung up or the descriptor is in error; reading or writing will say which.
+        bool hangUp;
+    };
+
+    Poller();
+
+    ~Poller();
+
+    bool isValid() const;
+
+    bool add(int fd, bool read, bool write);
+
+    /**
+     * Change what fd is waited for.
+     */
+    bool modify(int fd, bool read, bool write);
+
+    void remove(int fd);
+
+    /**
+     * Wait for events, replacing the contents of events with them.
+     * @param timeoutMs -1 to wait indefinitely.
+     * @return false on error, other than being interrupted by a signal.
+     */
+    bool wait(int timeoutMs, std::vector<Event> &events);
+
+private:
+    static constexpr int MAX_EVENTS{256};
+
+    int pollFd{-1};
+
+    JUCE_DECLARE_NON_COPYABLE(Poller)
+};
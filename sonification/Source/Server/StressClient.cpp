@@ -0,0 +1,208 @@
+/*
+  ==============================================================================
+
+    StressClient.cpp
+
+  ==============================================================================
+*/
+
+#include "StressClient.h"
+#include "GaitServer.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+StressClient::StressClient(const Options &optionsToUse) :
+        options(optionsToUse),
+        generator(ImuGenerator::forRunner(optionsToUse.generator, optionsToUse.runnerIndex)),
+        endSample(static_cast<juce::int64>(optionsToUse.minutes * 60000.0 / GaitEventDetector::IMU_SAMPLE_PERIOD_MS)),
+        nextSample(generator.getNextSample()) {
+}
+
+StressClient::Result StressClient::run() {
+    result = {};
+    auto startMs = juce::Time::getMillisecondCounterHiRes();
+
+    auto fd = connectToServer();
+    if (fd < 0) {
+        return result;
+    }
+
+    GaitServer::appendStreamHeader(unsent, GaitEventDetector::IMU_SAMPLE_PERIOD_MS);
+
+    auto isShutDown{false};
+    char buffer[1 << 14];
+    while (true) {
+        auto elapsedMs = juce::Time::getMillisecondCounterHiRes() - startMs;
+        if (!isGenerated && unsent.size() - unsentOffset < MAX_UNSENT_BYTES) {
+            generateFrames(elapsedMs);
+        }
+        auto hasUnsent = unsentOffset < unsent.size();
+        if (isGenerated && !hasUnsent && !isShutDown) {
+            // Tell the server there's no more to come; it replies with its stats and closes.
+            shutdown(fd, SHUT_WR);
+            isShutDown = true;
+        }
+
+        auto timeoutMs = TIMEOUT_MS;
+        if (!isGenerated && options.realtime) {
+            timeoutMs = juce::jlimit(1, TIMEOUT_MS, static_cast<int>(nextSample.timeMs - elapsedMs) + 1);
+        } else if (!isGenerated && !hasUnsent) {
+            timeoutMs = 0;
+        }
+
+        pollfd pollFd{fd, static_cast<short>(POLLIN | (hasUnsent ? POLLOUT : 0)), 0};
+        auto numReady = poll(&pollFd, 1, timeoutMs);
+        if (numReady < 0 && errno != EINTR) {
+            result.error = std::strerror(errno);
+            break;
+        }
+        if (numReady == 0 && timeoutMs == TIMEOUT_MS) {
+            result.error = "Timed out waiting for the server";
+            break;
+        }
+
+        if ((pollFd.revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+            auto numRead = recv(fd, buffer, sizeof(buffer), 0);
+            if (numRead == 0) {
+                break;
+            }
+            if (numRead < 0 && errno != EAGAIN && errno != EINTR) {
+                result.error = std::strerror(errno);
+                break;
+            }
+            if (numRead > 0) {
+                result.bytesReceived += numRead;
+                received.append(buffer, static_cast<size_t>(numRead));
+                size_t lineStart{0}, lineEnd;
+                while ((lineEnd = received.find('\n', lineStart)) != std::string::npos) {
+                    handleLine(juce::String::fromUTF8(received.data() + lineStart,
+                                                      static_cast<int>(lineEnd - lineStart)));
+                    lineStart = lineEnd + 1;
+                }
+                received.erase(0, lineStart);
+            }
+        }
+
+        if ((pollFd.revents & POLLOUT) != 0) {
+            auto numSent = send(fd, unsent.data() + unsentOffset, unsent.size() - unsentOffset, 0);
+            if (numSent < 0 && errno != EAGAIN && errno != EINTR) {
+                result.error = std::strerror(errno);
+                break;
+            }
+            if (numSent > 0) {
+                result.bytesSent += numSent;
+                unsentOffset += static_cast<size_t>(numSent);
+                if (unsentOffset == unsent.size()) {
+                    unsent.clear();
+                    unsentOffset = 0;
+                }
+            }
+        }
+    }
+
+    close(fd);
+    if (result.error.isEmpty() && !result.statsReceived) {
+        result.error = "The server closed the connection early";
+    }
+
+    result.toeOffsExpected = static_cast<int>(expectedToeOffs.size());
+    result.toeOffsDetected = static_cast<int>(detectedToeOffs.size());
+    result.toeOffsMatched = countMatchedToeOffs(expectedToeOffs, detectedToeOffs);
+    result.elapsedMs = juce::Time::getMillisecondCounterHiRes() - startMs;
+    return result;
+}
+
+int StressClient::connectToServer() {
+    auto fd{-1};
+    auto connected{false};
+    if (options.socketPath.isNotEmpty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        options.socketPath.copyToUTF8(address.sun_path, sizeof(address.sun_path));
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        connected = fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+    } else {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<uint16_t>(options.port));
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        connected = fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+    }
+
+    if (!connected) {
+        result.error = juce::String("Failed to connect: ") + std::strerror(errno);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+
+#ifdef SO_NOSIGPIPE
+    auto noSigPipe{1};
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+void StressClient::generateFrames(double elapsedMs) {
+    for (auto f = 0; f < FRAMES_PER_BATCH; ++f) {
+        if (nextSample.sampleIndex > endSample) {
+            isGenerated = true;
+            return;
+        }
+        if (options.realtime && nextSample.timeMs > elapsedMs) {
+            return;
+        }
+
+        GaitServer::appendFrame(unsent, nextSample.sampleIndex,
+                                {nextSample.accelX, nextSample.accelY, nextSample.accelZ,
+                                 nextSample.gyroX, nextSample.gyroY, nextSample.gyroZ});
+        ++result.framesSent;
+
+        nextSample = generator.getNextSample();
+        for (auto &event: generator.getNewEvents()) {
+            if (event.type == GaitEventDetector::GaitEventType::ToeOff && event.sampleIndex <= endSample) {
+                expectedToeOffs.push_back(event.sampleIndex);
+            }
+        }
+    }
+}
+
+void StressClient::handleLine(const juce::String &line) {
+    auto reply = juce::JSON::parse(line);
+    auto type = reply["type"].toString();
+    if (type == "toe-off") {
+        detectedToeOffs.push_back(static_cast<juce::int64>(reply["sample"]));
+    } else if (type == "metrics") {
+        ++result.metricsReceived;
+    } else if (type == "stats") {
+        result.statsReceived = true;
+    } else if (type == "error") {
+        result.error = reply["message"].toString();
+    }
+}
+
+int StressClient::countMatchedToeOffs(const std::vector<juce::int64> &expected,
+                                      const std::vector<juce::int64> &detected) {
+    // Both are in order; each expected toe-off matches at most one detected.
+    auto numMatched = 0;
+    size_t e{0};
+    for (auto sample: detected) {
+        while (e < expected.size() && expected[e] < sample - MATCH_TOLERANCE_SAMPLES) {
+            ++e;
+        }
+        if (e < expected.size() && expected[e] <= sample + MATCH_TOLERANCE_SAMPLES) {
+            ++numMatched;
+            ++e;
+        }
+    }
+    return numMatched;
+}
@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    StressClient.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../Workload/ImuGenerator.h"
+
+/**
+ * A client of GaitServer for stress tests: streams a generated runner's IMU data to the server, as fast as it will take
+ * it or at the IMU rate, reads the replies as they come, and checks the toe-offs the server finds against those in the
+ * data.
+ */
+class StressClient {
+public:
+    struct Options {
+        // Connect to the Unix domain socket if there is one, otherwise the localhost TCP port.
+        juce::String socketPath;
+        int port{0};
+        ImuGenerator::Options generator;
+        int runnerIndex{0};
+        double minutes{1.0};
+        bool realtime{false};
+    };
+
+    struct Result {
+        juce::String error;
+        juce::int64 framesSent{0};
+        juce::int64 bytesSent{0};
+        juce::int64 bytesReceived{0};
+        int toeOffsExpected{0};
+        int toeOffsDetected{0};
+        // Detected within MATCH_TOLERANCE_SAMPLES of one expected.
+        int toeOffsMatched{0};
+        int metricsReceived{0};
+        bool statsReceived{false};
+        double elapsedMs{0.0};
+    };
+
+    explicit StressClient(const Options &optionsToUse);
+
+    /**
+     * Connect, stream the data, and wait for the server to finish with it.
+     */
+    Result run();
+
+    static constexpr juce::int64 MATCH_TOLERANCE_SAMPLES{5};
+
+    /**
+     * @param expected The samples of the toe-offs in the data, in order.
+     * @param detected The samples of the toe-offs found in it, in order.
+     * @return How many were found within MATCH_TOLERANCE_SAMPLES of one in the data, each matching at most one.
+     */
+    static int countMatchedToeOffs(const std::vector<juce::int64> &expected, const std::vector<juce::int64> &detected);
+
+private:
+    // Frames generated at a time, if not in real time.
+    static constexpr int FRAMES_PER_BATCH{512};
+    // Unsent data beyond which no more is generated.
+    static constexpr size_t MAX_UNSENT_BYTES{1 << 16};
+    // How long to wait for the server, when there's nothing else to do.
+    static constexpr int TIMEOUT_MS{30000};
+
+    int connectToServer();
+
+    void generateFrames(double elapsedMs);
+
+    void handleLine(const juce::String &line);
+
+    Options options;
+    ImuGenerator generator;
+    juce::int64 endSample;
+    ImuGenerator::Sample nextSample;
+    bool isGenerated{false};
+
+    std::string unsent;
+    size_t unsentOffset{0};
+    std::string received;
+
+    std::vector<juce::int64> expectedToeOffs, detectedToeOffs;
+    Result result;
+};
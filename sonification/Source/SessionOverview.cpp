@@ -0,0 +1,68 @@
+#include "SessionOverview.h"
+
+juce::uint32 SessionOverview::getNumEvents(juce::int64 start, juce::int64 end) const {
+    if (cumulativeEvents.empty()) {
+        return 0;
+    }
+
+    auto last = static_cast<juce::int64>(cumulativeEvents.size()) - 1;
+    start = juce::jlimit<juce::int64>(0, last, start);
+    end = juce::jlimit<juce::int64>(start, last + 1, end);
+
+    auto before = start > 0 ? cumulativeEvents[static_cast<size_t>(start - 1)] : 0;
+    auto upTo = end > 0 ? cumulativeEvents[static_cast<size_t>(end - 1)] : 0;
+    return upTo - before;
+}
+
+SessionOverviewBuilder::SessionOverviewBuilder(const juce::File &file, Callback onBuilt) :
+        juce::Thread("Session overview builder"),
+        captureFile(file),
+        callback(std::move(onBuilt)) {
+}
+
+SessionOverviewBuilder::~SessionOverviewBuilder() {
+    stopThread(STOP_TIMEOUT_MS);
+}
+
+void SessionOverviewBuilder::run() {
+    GaitEventDetector detector{captureFile};
+    if (!detector.prepareToProcess()) {
+        return;
+    }
+
+    std::vector<float> accelY, balance;
+    std::vector<juce::uint32> cumulativeEvents;
+    juce::uint32 numEvents{0};
+
+    while (!threadShouldExit()) {
+        detector.processNextSample();
+        if (detector.isDoneProcessing()) {
+            break;
+        }
+
+        if (detector.hasEventNow(GaitEventDetector::GaitEventType::ToeOff)) {
+            ++numEvents;
+        }
+        if (detector.hasEventNow(GaitEventDetector::GaitEventType::InitialContact)) {
+            ++numEvents;
+        }
+
+        accelY.push_back(detector.getCurrentSample().accelY);
+        balance.push_back(detector.getGtcBalance());
+        cumulativeEvents.push_back(numEvents);
+    }
+
+    if (threadShouldExit()) {
+        return;
+    }
+
+    auto overview = std::make_shared<SessionOverview>();
+    overview->numSamples = static_cast<juce::int64>(accelY.size());
+    overview->accelY.build(accelY);
+    overview->balance.build(balance);
+    overview->cumulativeEvents = std::move(cumulativeEvents);
+
+    if (!threadShouldExit()) {
+        juce::MessageManager::callAsync([cb = callback, overview] { cb(overview); });
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef GAIT_SONIFICATION_SESSIONOVERVIEW_H
+#define GAIT_SONIFICATION_SESSIONOVERVIEW_H
+
+#include <JuceHeader.h>
+#include "GaitEventDetector.h"
+#include "MinMaxPyramid.h"
+
+/**
+ * Summary of a whole capture, for the overview timeline: min/max pyramids of accelY and GCT balance, and a running count
+ * of gait events from which the event density over any span can be read in constant time.
+ */
+struct SessionOverview {
+    juce::int64 numSamples{0};
+    MinMaxPyramid accelY;
+    MinMaxPyramid balance;
+    // Number of gait events detected up to and including each sample.
+    std::vector<juce::uint32> cumulativeEvents;
+
+    /**
+     * @return The number of gait events detected in samples [start, end).
+     */
+    juce::uint32 getNumEvents(juce::int64 start, juce::int64 end) const;
+};
+
+/**
+ * Builds a SessionOverview on a background thread, by running a detector of its own over the capture file.
+ */
+class SessionOverviewBuilder : public juce::Thread {
+public:
+    using Callback = std::function<void(std::shared_ptr<const SessionOverview>)>;
+
+    /**
+     * @param onBuilt Called on the message thread once the overview has been built. Not called if the build fails or
+     * is stopped.
+     */
+    SessionOverviewBuilder(const juce::File &file, Callback onBuilt);
+
+    ~SessionOverviewBuilder() override;
+
+    void run() override;
+
+private:
+    static constexpr int STOP_TIMEOUT_MS{2000};
+
+    juce::File captureFile;
+    Callback callback;
+};
+
+
+#endif //GAIT_SONIFICATION_SESSIONOVERVIEW_H
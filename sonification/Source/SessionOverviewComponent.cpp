@@ -0,0 +1,234 @@
+#include "SessionOverviewComponent.h"
+#include "Trace.h"
+
+SessionOverviewComponent::SessionOverviewComponent() {
+    setOpaque(true);
+}
+
+SessionOverviewComponent::~SessionOverviewComponent() {
+    builder.reset();
+}
+
+void SessionOverviewComponent::loadCapture(const juce::File &file) {
+    builder.reset();
+    overview.reset();
+    playhead = 0;
+    followPlayhead = true;
+    lanesLayerIsValid = false;
+
+    auto id = ++buildId;
+    builder = std::make_unique<SessionOverviewBuilder>(
+            file,
+            [safeThis = SafePointer<SessionOverviewComponent>(this), id](
+                    std::shared_ptr<const SessionOverview> built) {
+                if (safeThis == nullptr || safeThis->buildId != id) {
+                    return;
+                }
+                safeThis->overview = std::move(built);
+                safeThis->setView(0.0, static_cast<double>(safeThis->overview->numSamples));
+            });
+    builder->startThread();
+
+    repaint();
+}
+
+void SessionOverviewComponent::setPlayhead(juce::int64 sampleIndex) {
+    if (sampleIndex == playhead) {
+        return;
+    }
+
+    auto previousX = sampleToX(static_cast<double>(playhead));
+    playhead = sampleIndex;
+
+    // Page the view along when the playhead runs out of it.
+    if (followPlayhead && overview != nullptr &&
+        (static_cast<double>(playhead) < viewStart || static_cast<double>(playhead) > viewStart + viewLength)) {
+        setView(static_cast<double>(playhead), viewLength);
+        return;
+    }
+
+    auto x = sampleToX(static_cast<double>(playhead));
+    if (static_cast<int>(x) != static_cast<int>(previousX)) {
+        repaint(static_cast<int>(previousX) - 1, 0, 3, getHeight());
+        repaint(static_cast<int>(x) - 1, 0, 3, getHeight());
+    }
+}
+
+void SessionOverviewComponent::paint(Graphics &g) {
+    TRACE_SCOPE("SessionOverviewComponent::paint");
+    if (overview == nullptr) {
+        g.fillAll(Colours::black);
+        g.setColour(Colours::grey);
+        g.drawRect(getLocalBounds());
+        g.drawText(builder != nullptr && builder->isThreadRunning() ? "Building session overview..."
+                                                                    : "No session overview",
+                   getLocalBounds(),
+                   juce::Justification::centred);
+        return;
+    }
+
+    auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (!lanesLayerIsValid || lanesLayer.getWidth() != juce::roundToInt(static_cast<float>(getWidth()) * scale)) {
+        renderLanes(scale);
+    }
+    g.drawImage(lanesLayer, getLocalBounds().toFloat());
+
+    auto x = sampleToX(static_cast<double>(playhead));
+    g.setColour(Colours::white);
+    g.drawVerticalLine(static_cast<int>(x), 0.f, static_cast<float>(getHeight()));
+}
+
+void SessionOverviewComponent::resized() {
+    lanesLayerIsValid = false;
+}
+
+void SessionOverviewComponent::mouseWheelMove(const MouseEvent &event, const MouseWheelDetails &wheel) {
+    if (overview == nullptr) {
+        return;
+    }
+
+    auto anchor = xToSample(static_cast<float>(event.x));
+    auto length = viewLength * std::pow(ZOOM_RATE, -wheel.deltaY);
+    auto proportion = (anchor - viewStart) / viewLength;
+    setView(anchor - proportion * length, length);
+}
+
+void SessionOverviewComponent::mouseDown(const MouseEvent &) {
+    dragStartViewStart = viewStart;
+}
+
+void SessionOverviewComponent::mouseDrag(const MouseEvent &event) {
+    if (overview == nullptr || getWidth() == 0) {
+        return;
+    }
+
+    followPlayhead = false;
+    auto samplesPerPixel = viewLength / getWidth();
+    setView(dragStartViewStart - event.getDistanceFromDragStartX() * samplesPerPixel, viewLength);
+}
+
+void SessionOverviewComponent::mouseDoubleClick(const MouseEvent &) {
+    if (overview == nullptr) {
+        return;
+    }
+
+    followPlayhead = true;
+    setView(0.0, static_cast<double>(overview->numSamples));
+}
+
+void SessionOverviewComponent::setView(double start, double length) {
+    auto numSamples = static_cast<double>(overview->numSamples);
+    viewLength = juce::jlimit(std::min(static_cast<double>(MIN_VIEW_LENGTH), numSamples), numSamples, length);
+    viewStart = juce::jlimit(0.0, numSamples - viewLength, start);
+    lanesLayerIsValid = false;
+    repaint();
+}
+
+void SessionOverviewComponent::renderLanes(float scale) {
+    auto width = juce::roundToInt(static_cast<float>(getWidth()) * scale);
+    auto height = juce::roundToInt(static_cast<float>(getHeight()) * scale);
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    if (!lanesLayer.isValid() || lanesLayer.getWidth() != width || lanesLayer.getHeight() != height) {
+        lanesLayer = juce::Image{juce::Image::ARGB, width, height, true};
+    }
+    lanesLayer.clear(lanesLayer.getBounds(), Colours::black);
+
+    juce::Graphics g{lanesLayer};
+
+    auto accelHeight = static_cast<float>(height) * ACCEL_LANE_PROPORTION;
+    auto balanceTop = accelHeight;
+    auto balanceHeight = static_cast<float>(height) * BALANCE_LANE_PROPORTION;
+    auto densityTop = balanceTop + balanceHeight;
+    auto densityHeight = static_cast<float>(height) - densityTop;
+
+    auto accelRange = overview->accelY.getOverallRange();
+    auto accelSpan = std::max(accelRange.getLength(), 1e-6f);
+
+    // Each column covers at least two samples, so a closely zoomed plot is still continuous.
+    auto samplesPerColumn = viewLength / width;
+    auto span = [&](int column) {
+        auto start = static_cast<juce::int64>(viewStart + column * samplesPerColumn);
+        auto end = static_cast<juce::int64>(viewStart + (column + 1) * samplesPerColumn) + 1;
+        return std::make_pair(start, std::max(end, start + 2));
+    };
+
+    juce::RectangleList<float> accelColumns, leftColumns, rightColumns, densityColumns;
+    std::vector<juce::uint32> eventCounts(static_cast<size_t>(width));
+    juce::uint32 maxEventCount{1};
+
+    for (auto column = 0; column < width; ++column) {
+        auto [start, end] = span(column);
+        auto x = static_cast<float>(column);
+
+        auto accel = overview->accelY.getRange(start, end);
+        auto top = accelHeight * (1.f - (accel.getEnd() - accelRange.getStart()) / accelSpan);
+        auto bottom = accelHeight * (1.f - (accel.getStart() - accelRange.getStart()) / accelSpan);
+        accelColumns.addWithoutMerging({x, top, 1.f, std::max(bottom - top, 1.f)});
+
+        // Balance runs 0 (L) to 1 (R); shade from the centre towards whichever foot dominates.
+        auto balance = overview->balance.getRange(start, end);
+        auto centre = balanceTop + balanceHeight * .5f;
+        auto balanceTopY = balanceTop + balanceHeight * (1.f - balance.getEnd());
+        auto balanceBottomY = balanceTop + balanceHeight * (1.f - balance.getStart());
+        if (balanceTopY < centre) {
+            rightColumns.addWithoutMerging({x, balanceTopY, 1.f, std::min(balanceBottomY, centre) - balanceTopY});
+        }
+        if (balanceBottomY > centre) {
+            leftColumns.addWithoutMerging({x, std::max(balanceTopY, centre), 1.f,
+                                           balanceBottomY - std::max(balanceTopY, centre)});
+        }
+
+        eventCounts[static_cast<size_t>(column)] = overview->getNumEvents(start, end);
+        maxEventCount = std::max(maxEventCount, eventCounts[static_cast<size_t>(column)]);
+    }
+
+    for (auto column = 0; column < width; ++column) {
+        auto barHeight = densityHeight * static_cast<float>(eventCounts[static_cast<size_t>(column)]) /
+                         static_cast<float>(maxEventCount);
+        densityColumns.addWithoutMerging({static_cast<float>(column), densityTop + densityHeight - barHeight,
+                                          1.f, barHeight});
+    }
+
+    g.setColour(Colours::lightgreen);
+    g.fillRectList(accelColumns);
+    g.setColour(RIGHT_COLOUR);
+    g.fillRectList(rightColumns);
+    g.setColour(LEFT_COLOUR);
+    g.fillRectList(leftColumns);
+    g.setColour(Colours::lightcoral);
+    g.fillRectList(densityColumns);
+
+    // Lane dividers and labels.
+    g.setColour(Colours::grey);
+    g.drawHorizontalLine(juce::roundToInt(balanceTop), 0.f, static_cast<float>(width));
+    g.drawHorizontalLine(juce::roundToInt(densityTop), 0.f, static_cast<float>(width));
+    g.setColour(Colours::darkgrey);
+    g.drawHorizontalLine(juce::roundToInt(balanceTop + balanceHeight * .5f), 0.f, static_cast<float>(width));
+    g.setColour(Colours::grey);
+    g.drawRect(lanesLayer.getBounds());
+
+    g.setColour(Colours::white);
+    g.setFont(10.f * scale);
+    auto labelWidth = juce::roundToInt(80 * scale), labelHeight = juce::roundToInt(12 * scale);
+    auto labelX = juce::roundToInt(3 * scale);
+    g.drawText("accelY", labelX, 0, labelWidth, labelHeight, juce::Justification::left);
+    g.drawText("GCT balance", labelX, juce::roundToInt(balanceTop), labelWidth, labelHeight,
+               juce::Justification::left);
+    g.drawText("Events", labelX, juce::roundToInt(densityTop), labelWidth, labelHeight, juce::Justification::left);
+
+    lanesLayerIsValid = true;
+}
+
+float SessionOverviewComponent::sampleToX(double sampleIndex) const {
+    if (viewLength <= 0.0) {
+        return 0.f;
+    }
+    return static_cast<float>((sampleIndex - viewStart) / viewLength * getWidth());
+}
+
+double SessionOverviewComponent::xToSample(float x) const {
+    return viewStart + static_cast<double>(x) / std::max(getWidth(), 1) * viewLength;
+}
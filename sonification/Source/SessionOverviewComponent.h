@@ -0,0 +1,84 @@
+#ifndef GAIT_SONIFICATION_SESSIONOVERVIEWCOMPONENT_H
+#define GAIT_SONIFICATION_SESSIONOVERVIEWCOMPONENT_H
+
+#include <JuceHeader.h>
+#include "SessionOverview.h"
+
+/**
+ * Zoomable, scrollable timeline of a whole capture: accelY, GCT balance and gait event density, with a playhead.
+ *
+ * Each column is drawn from the SessionOverview's pyramids at the resolution closest to the number of samples per
+ * column, so a frame costs the same whether it shows the whole session or a few strides.
+ */
+class SessionOverviewComponent : public juce::Component {
+public:
+    // Zoom in no further than this many samples across the component.
+    static constexpr int MIN_VIEW_LENGTH{50};
+
+    SessionOverviewComponent();
+
+    ~SessionOverviewComponent() override;
+
+    /**
+     * Start building an overview of a capture file in the background, replacing the current one.
+     */
+    void loadCapture(const juce::File &file);
+
+    void setPlayhead(juce::int64 sampleIndex);
+
+    void paint(Graphics &g) override;
+
+    void resized() override;
+
+    /**
+     * Zoom in and out around the mouse position.
+     */
+    void mouseWheelMove(const MouseEvent &event, const MouseWheelDetails &wheel) override;
+
+    void mouseDown(const MouseEvent &event) override;
+
+    /**
+     * Scroll through the session.
+     */
+    void mouseDrag(const MouseEvent &event) override;
+
+    /**
+     * Zoom out to the whole session and follow the playhead again.
+     */
+    void mouseDoubleClick(const MouseEvent &event) override;
+
+private:
+    static constexpr float ZOOM_RATE{2.f};
+    static constexpr float ACCEL_LANE_PROPORTION{.5f};
+    static constexpr float BALANCE_LANE_PROPORTION{.25f};
+
+    const juce::Colour LEFT_COLOUR{juce::Colours::skyblue};
+    const juce::Colour RIGHT_COLOUR{juce::Colours::palegoldenrod};
+
+    void setView(double start, double length);
+
+    /**
+     * Render the lanes for the current view to lanesLayer.
+     */
+    void renderLanes(float scale);
+
+    float sampleToX(double sampleIndex) const;
+
+    double xToSample(float x) const;
+
+    std::unique_ptr<SessionOverviewBuilder> builder;
+    // Distinguishes the overview being built from any superseded builds still posting results.
+    unsigned int buildId{0};
+    std::shared_ptr<const SessionOverview> overview;
+
+    double viewStart{0.0}, viewLength{0.0};
+    double dragStartViewStart{0.0};
+    bool followPlayhead{true};
+    juce::int64 playhead{0};
+
+    juce::Image lanesLayer;
+    bool lanesLayerIsValid{false};
+};
+
+
+#endif //GAIT_SONIFICATION_SESSIONOVERVIEWCOMPONENT_H
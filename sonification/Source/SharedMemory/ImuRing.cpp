@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+    ImuRing.cpp
+
+    Built into producers outside the app, so it doesn't use JUCE.
+
+  ==============================================================================
+*/
+
+#include "ImuRing.h"
+#include "ImuRingLayout.h"
+#include <algorithm>
+#include <cerrno>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+struct ImuRingProducer {
+    ImuRingLayout::Header *header;
+    ImuRingLayout::Slot *slots;
+    size_t sizeInBytes;
+    uint32_t mask;
+    // Mirrors header->writeIndex, which only the producer writes.
+    uint64_t writeIndex;
+};
+
+namespace {
+    uint32_t roundUpToPowerOfTwo(uint32_t value) {
+        uint32_t rounded{1};
+        while (rounded < value) {
+            rounded <<= 1;
+        }
+        return rounded;
+    }
+
+    void writeSlot(ImuRingLayout::Slot &slot, uint64_t index, const ImuRingFrame &frame) {
+        slot.frame = frame;
+        slot.sequence.store(ImuRingLayout::getSequence(index), std::memory_order_release);
+    }
+
+    /**
+     * Write a slot the consumer may be reading: mark it as being written first, so the consumer can tell.
+     */
+    void overwriteSlot(ImuRingLayout::Slot &slot, uint64_t index, const ImuRingFrame &frame) {
+        slot.sequence.store(ImuRingLayout::getSequence(index) - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        writeSlot(slot, index, frame);
+    }
+}
+
+ImuRingProducer *imuRingCreate(const char *name, uint32_t capacity, ImuRingOverflowPolicy policy,
+                               float samplePeriodMs) {
+    if (name == nullptr || capacity == 0 || capacity > (1u << 30) || policy < IMU_RING_REJECT ||
+        policy > IMU_RING_OVERWRITE) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    capacity = roundUpToPowerOfTwo(capacity);
+    auto sizeInBytes = ImuRingLayout::getSizeInBytes(capacity);
+
+    // A consumer still attached to a ring left behind keeps it until it lets go.
+    shm_unlink(name);
+    auto fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (ftruncate(fd, static_cast<off_t>(sizeInBytes)) != 0) {
+        auto error = errno;
+        close(fd);
+        shm_unlink(name);
+        errno = error;
+        return nullptr;
+    }
+    auto *memory = mmap(nullptr, sizeInBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        auto error = errno;
+        shm_unlink(name);
+        errno = error;
+        return nullptr;
+    }
+
+    // The memory is zeroed; nothing has been written, and every slot's sequence says so.
+    auto *header = new(memory) ImuRingLayout::Header();
+    header->version = ImuRingLayout::VERSION;
+    header->capacity = capacity;
+    header->overflowPolicy = static_cast<uint32_t>(policy);
+    header->samplePeriodMs = samplePeriodMs;
+    header->producerPid = static_cast<int32_t>(getpid());
+    header->producerState.store(ImuRingLayout::Open, std::memory_order_relaxed);
+    header->producerActiveNs.store(ImuRingLayout::getMonotonicNs(), std::memory_order_relaxed);
+    header->magic.store(ImuRingLayout::MAGIC, std::memory_order_release);
+
+    return new ImuRingProducer{header, ImuRingLayout::getSlots(header), sizeInBytes, capacity - 1, 0};
+}
+
+size_t imuRingWrite(ImuRingProducer *producer, const ImuRingFrame *frames, size_t numFrames) {
+    auto &header = *producer->header;
+    auto capacity = static_cast<uint64_t>(header.capacity);
+    auto writeIndex = producer->writeIndex;
+    auto numToWrite = static_cast<uint64_t>(numFrames);
+
+    if (header.overflowPolicy == IMU_RING_OVERWRITE) {
+        // Only the last capacity frames would survive anyway.
+        auto numSkipped = numToWrite > capacity ? numToWrite - capacity : 0;
+        writeIndex += numSkipped;
+        for (auto f = numSkipped; f < numToWrite; ++f, ++writeIndex) {
+            overwriteSlot(producer->slots[writeIndex & producer->mask], writeIndex, frames[f]);
+        }
+    } else {
+        auto readIndex = header.readIndex.load(std::memory_order_acquire);
+        numToWrite = std::min(numToWrite, capacity - (writeIndex - readIndex));
+        for (uint64_t f = 0; f < numToWrite; ++f, ++writeIndex) {
+            writeSlot(producer->slots[writeIndex & producer->mask], writeIndex, frames[f]);
+        }
+        if (header.overflowPolicy == IMU_RING_DROP_NEWEST && numToWrite < numFrames) {
+            header.framesDropped.fetch_add(numFrames - numToWrite, std::memory_order_relaxed);
+            numToWrite = numFrames;
+        }
+    }
+
+    producer->writeIndex = writeIndex;
+    header.writeIndex.store(writeIndex, std::memory_order_release);
+    header.producerActiveNs.store(ImuRingLayout::getMonotonicNs(), std::memory_order_relaxed);
+    return static_cast<size_t>(numToWrite);
+}
+
+void imuRingHeartbeat(ImuRingProducer *producer) {
+    producer->header->producerActiveNs.store(ImuRingLayout::getMonotonicNs(), std::memory_order_relaxed);
+}
+
+uint32_t imuRingGetFillLevel(const ImuRingProducer *producer) {
+    auto readIndex = producer->header->readIndex.load(std::memory_order_acquire);
+    return static_cast<uint32_t>(std::min<uint64_t>(producer->writeIndex - readIndex, producer->header->capacity));
+}
+
+uint32_t imuRingGetCapacity(const ImuRingProducer *producer) {
+    return producer->header->capacity;
+}
+
+uint64_t imuRingGetFramesDropped(const ImuRingProducer *producer) {
+    return producer->header->framesDropped.load(std::memory_order_relaxed);
+}
+
+void imuRingClose(ImuRingProducer *producer) {
+    if (producer == nullptr) {
+        return;
+    }
+
+    // The name stays until the consumer, having read what's left, removes it, or the next ring replaces it.
+    producer->header->producerState.store(ImuRingLayout::Closed, std::memory_order_release);
+    munmap(producer->header, producer->sizeInBytes);
+    delete producer;
+}
@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    ImuRing.h
+
+    C API for producing IMU frames into a shared-memory ring, for an
+    acquisition process on the same host as the analysis. One producer
+    creates the ring and writes to it; one consumer, ImuRingConsumer, reads
+    from it in place. Neither side makes a system call per frame.
+
+    Build ImuRing.cpp into the producer; it needs nothing but POSIX shared
+    memory (link with -lrt on older Linux).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * One IMU sample, laid out as in GaitSonificationWorkload's binary captures.
+ */
+typedef struct ImuRingFrame {
+    /* Must increase; gaps are dropouts. */
+    int64_t sampleIndex;
+    float accelX, accelY, accelZ, gyroX, gyroY, gyroZ;
+} ImuRingFrame;
+
+/**
+ * What happens to frames written when the ring is full.
+ */
+typedef enum ImuRingOverflowPolicy {
+    /* imuRingWrite() writes what fits and says how many; the producer holds on to the rest. */
+    IMU_RING_REJECT = 0,
+    /* What doesn't fit is dropped, and counted. */
+    IMU_RING_DROP_NEWEST = 1,
+    /* The oldest unread frames are overwritten; the consumer counts the frames it missed. */
+    IMU_RING_OVERWRITE = 2
+} ImuRingOverflowPolicy;
+
+typedef struct ImuRingProducer ImuRingProducer;
+
+/**
+ * Create a ring, replacing any left behind under the same name.
+ * @param name A POSIX shared memory name, e.g. "/gait-imu".
+ * @param capacity In frames; rounded up to a power of two.
+ * @return NULL on failure, with errno set.
+ */
+ImuRingProducer *imuRingCreate(const char *name, uint32_t capacity, ImuRingOverflowPolicy policy,
+                               float samplePeriodMs);
+
+/**
+ * Write frames to the ring, and mark the producer as active.
+ * @return The number of frames written, or with IMU_RING_DROP_NEWEST and IMU_RING_OVERWRITE, numFrames.
+ */
+size_t imuRingWrite(ImuRingProducer *producer, const ImuRingFrame *frames, size_t numFrames);
+
+/**
+ * Mark the producer as active without writing, so the consumer doesn't take a pause in the data for a stall.
+ */
+void imuRingHeartbeat(ImuRingProducer *producer);
+
+/**
+ * @return Frames written but not yet read.
+ */
+uint32_t imuRingGetFillLevel(const ImuRingProducer *producer);
+
+uint32_t imuRingGetCapacity(const ImuRingProducer *producer);
+
+/**
+ * @return Frames dropped with IMU_RING_DROP_NEWEST.
+ */
+uint64_t imuRingGetFramesDropped(const ImuRingProducer *producer);
+
+/**
+ * Tell the consumer there's no more to come, and free the producer. The ring outlives the producer: a consumer, even
+ * one that attaches afterwards, can still read what's left, and removes the ring when it detaches. Otherwise the next
+ * imuRingCreate() under the same name replaces it.
+ */
+void imuRingClose(ImuRingProducer *producer);
+
+#ifdef __cplusplus
+}
+#endif
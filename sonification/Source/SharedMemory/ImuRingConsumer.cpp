@@ -0,0 +1,164 @@
+/*
+  ==============================================================================
+
+    ImuRingConsumer.cpp
+
+  ==============================================================================
+*/
+
+#include "ImuRingConsumer.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ImuRingConsumer::ImuRingConsumer(const juce::String &nameToUse) : name(nameToUse) {
+}
+
+ImuRingConsumer::~ImuRingConsumer() {
+    close();
+}
+
+juce::Result ImuRingConsumer::open() {
+    close();
+
+    auto fd = shm_open(name.toRawUTF8(), O_RDWR, 0);
+    if (fd < 0) {
+        return juce::Result::fail("Failed to open ring " + name + ": " + std::strerror(errno));
+    }
+
+    struct stat status{};
+    auto size = fstat(fd, &status) == 0 ? static_cast<size_t>(status.st_size) : 0;
+    auto *memory = size >= sizeof(ImuRingLayout::Header)
+                   ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        return juce::Result::fail("Failed to map ring " + name);
+    }
+
+    header = static_cast<ImuRingLayout::Header *>(memory);
+    sizeInBytes = size;
+    device = static_cast<uint64_t>(status.st_dev);
+    inode = static_cast<uint64_t>(status.st_ino);
+
+    // The producer writes the magic once the header is ready.
+    if (header->magic.load(std::memory_order_acquire) != ImuRingLayout::MAGIC ||
+        header->version != ImuRingLayout::VERSION) {
+        close();
+        return juce::Result::fail("Ring " + name + " isn't ready, or isn't an IMU ring");
+    }
+    auto capacity = header->capacity;
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 || size < ImuRingLayout::getSizeInBytes(capacity)) {
+        close();
+        return juce::Result::fail("Ring " + name + " is corrupt");
+    }
+
+    slots = ImuRingLayout::getSlots(header);
+    mask = capacity - 1;
+    isOverwriting = header->overflowPolicy == IMU_RING_OVERWRITE;
+    readIndex = header->readIndex.load(std::memory_order_acquire);
+    isStalled = false;
+    metrics = {};
+    metrics.capacity = capacity;
+    return juce::Result::ok();
+}
+
+bool ImuRingConsumer::isOpen() const {
+    return header != nullptr;
+}
+
+ImuRingOverflowPolicy ImuRingConsumer::getOverflowPolicy() const {
+    return header != nullptr ? static_cast<ImuRingOverflowPolicy>(header->overflowPolicy) : IMU_RING_REJECT;
+}
+
+float ImuRingConsumer::getSamplePeriodMs() const {
+    return header != nullptr ? header->samplePeriodMs : 0.f;
+}
+
+ImuRingConsumer::ProducerState ImuRingConsumer::checkProducer(double stallTimeoutMs) {
+    if (header == nullptr) {
+        return ProducerState::Gone;
+    }
+
+    // The state first: once it says closed, the write index read after it includes the producer's last write.
+    auto isClosed = header->producerState.load(std::memory_order_acquire) == ImuRingLayout::Closed;
+    auto fillLevel = header->writeIndex.load(std::memory_order_acquire) - readIndex;
+    metrics.fillLevel = static_cast<uint32_t>(std::min<uint64_t>(fillLevel, metrics.capacity));
+
+    if (isClosed) {
+        isStalled = false;
+        return ProducerState::Closed;
+    }
+
+    auto nowNs = ImuRingLayout::getMonotonicNs();
+    auto activeNs = header->producerActiveNs.load(std::memory_order_relaxed);
+    auto silentMs = nowNs > activeNs ? static_cast<double>(nowNs - activeNs) * 1e-6 : 0.0;
+    if (silentMs <= stallTimeoutMs) {
+        isStalled = false;
+        return ProducerState::Active;
+    }
+
+    if (!isStalled) {
+        isStalled = true;
+        stallStartNs = activeNs;
+        ++metrics.numStalls;
+    }
+    metrics.longestStallMs = std::max(metrics.longestStallMs, static_cast<double>(nowNs - stallStartNs) * 1e-6);
+
+    // Only now is it worth a system call.
+    if (kill(static_cast<pid_t>(header->producerPid), 0) != 0 && errno == ESRCH) {
+        return ProducerState::Gone;
+    }
+    return ProducerState::Stalled;
+}
+
+ImuRingConsumer::Metrics ImuRingConsumer::getMetrics() const {
+    auto current = metrics;
+    if (header != nullptr) {
+        current.framesDropped = static_cast<juce::int64>(header->framesDropped.load(std::memory_order_relaxed));
+    }
+    return current;
+}
+
+void ImuRingConsumer::close() {
+    if (header != nullptr) {
+        if (header->producerState.load(std::memory_order_acquire) == ImuRingLayout::Closed && isStillNamed()) {
+            shm_unlink(name.toRawUTF8());
+        }
+        munmap(header, sizeInBytes);
+        header = nullptr;
+        slots = nullptr;
+    }
+}
+
+bool ImuRingConsumer::isStillNamed() const {
+    auto fd = shm_open(name.toRawUTF8(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat status{};
+    auto isSame = fstat(fd, &status) == 0 && static_cast<uint64_t>(status.st_dev) == device &&
+                  static_cast<uint64_t>(status.st_ino) == inode;
+    ::close(fd);
+    return isSame;
+}
+
+uint64_t ImuRingConsumer::getWriteIndex() {
+    auto writeIndex = header->writeIndex.load(std::memory_order_acquire);
+    auto fillLevel = writeIndex - readIndex;
+    auto capacity = static_cast<uint64_t>(metrics.capacity);
+
+    // Lapped: the oldest unread frames are gone.
+    if (isOverwriting && fillLevel > capacity) {
+        metrics.framesOverwritten += static_cast<juce::int64>(fillLevel - capacity);
+        readIndex = writeIndex - capacity;
+        fillLevel = capacity;
+    }
+
+    metrics.maxFillLevel = std::max(metrics.maxFillLevel, static_cast<uint32_t>(fillLevel));
+    return writeIndex;
+}
@@ -0,0 +1,152 @@
+/*
+  ==============================================================================
+
+    ImuRingConsumer.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ImuRingLayout.h"
+
+/**
+ * Reads IMU frames from a shared-memory ring created by a producer through the ImuRing C API.
+ *
+ * Frames are handed to a callback where they lie in the ring, and released once it returns; reading makes no system
+ * calls. With IMU_RING_OVERWRITE the producer may overwrite a frame while it's being read, so each frame is checked
+ * and copied out before the callback sees it, and any the producer got to first are counted as overwritten.
+ *
+ * Not thread-safe; one thread opens and consumes.
+ */
+class ImuRingConsumer {
+public:
+    enum class ProducerState {
+        // Writing, or sending heartbeats.
+        Active,
+        // Silent for longer than the stall timeout.
+        Stalled,
+        // Closed the ring; what's left can still be read.
+        Closed,
+        // Stalled, and the process has exited.
+        Gone
+    };
+
+    struct Metrics {
+        uint32_t capacity{0};
+        // Frames waiting to be read, as of the last consume() or checkProducer().
+        uint32_t fillLevel{0};
+        uint32_t maxFillLevel{0};
+        juce::int64 framesRead{0};
+        // Dropped by the producer with IMU_RING_DROP_NEWEST.
+        juce::int64 framesDropped{0};
+        // Overwritten before they were read, with IMU_RING_OVERWRITE.
+        juce::int64 framesOverwritten{0};
+        int numStalls{0};
+        double longestStallMs{0.0};
+    };
+
+    explicit ImuRingConsumer(const juce::String &nameToUse);
+
+    ~ImuRingConsumer();
+
+    /**
+     * Attach to the ring, detaching from any attached to before; reading starts from the oldest unread frame.
+     */
+    juce::Result open();
+
+    bool isOpen() const;
+
+    ImuRingOverflowPolicy getOverflowPolicy() const;
+
+    float getSamplePeriodMs() const;
+
+    /**
+     * Pass up to maxFrames frames, oldest first, to callback(const ImuRingFrame &).
+     * @return The number of frames passed.
+     */
+    template<typename Callback>
+    int consume(int maxFrames, Callback &&callback);
+
+    /**
+     * Check on the producer, and update the stall metrics. Once the producer is Closed or Gone nothing more will be
+     * written, but frames written since the last consume() may still be waiting; consume() until it returns 0.
+     * @param stallTimeoutMs How long the producer can be silent before it's stalled.
+     */
+    ProducerState checkProducer(double stallTimeoutMs);
+
+    Metrics getMetrics() const;
+
+private:
+    /**
+     * Detach from the ring. If the producer has closed it, remove its name too; the producer leaves that to the
+     * consumer, so that one attaching late can still read what's left.
+     */
+    void close();
+
+    /**
+     * @return true if the name still refers to the ring attached to, not one created under it since.
+     */
+    bool isStillNamed() const;
+
+    /**
+     * Called at the start of consume(): how far the producer has got, and where reading resumes.
+     */
+    uint64_t getWriteIndex();
+
+    juce::String name;
+    ImuRingLayout::Header *header{nullptr};
+    ImuRingLayout::Slot *slots{nullptr};
+    size_t sizeInBytes{0};
+    // Identify the shared memory object attached to.
+    uint64_t device{0}, inode{0};
+    uint64_t mask{0};
+    bool isOverwriting{false};
+
+    // Mirrors header->readIndex, which only the consumer writes.
+    uint64_t readIndex{0};
+    bool isStalled{false};
+    uint64_t stallStartNs{0};
+    Metrics metrics;
+};
+
+template<typename Callback>
+int ImuRingConsumer::consume(int maxFrames, Callback &&callback) {
+    if (header == nullptr) {
+        return 0;
+    }
+
+    auto writeIndex = getWriteIndex();
+    auto endIndex = std::min(writeIndex, readIndex + static_cast<uint64_t>(juce::jmax(0, maxFrames)));
+    auto numPassed{0};
+
+    for (; readIndex < endIndex; ++readIndex) {
+        auto &slot = slots[readIndex & mask];
+        if (!isOverwriting) {
+            callback(static_cast<const ImuRingFrame &>(slot.frame));
+            ++numPassed;
+            continue;
+        }
+
+        // A seqlock: the frame is good if its sequence was this index's before and after copying it.
+        auto expected = ImuRingLayout::getSequence(readIndex);
+        if (slot.sequence.load(std::memory_order_acquire) != expected) {
+            ++metrics.framesOverwritten;
+            continue;
+        }
+        auto frame = slot.frame;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != expected) {
+            ++metrics.framesOverwritten;
+            continue;
+        }
+        callback(static_cast<const ImuRingFrame &>(frame));
+        ++numPassed;
+    }
+
+    header->readIndex.store(readIndex, std::memory_order_release);
+    metrics.framesRead += numPassed;
+    metrics.fillLevel = static_cast<uint32_t>(writeIndex - readIndex);
+    return numPassed;
+}
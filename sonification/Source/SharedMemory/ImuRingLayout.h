@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    ImuRingLayout.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include "ImuRing.h"
+
+/**
+ * The shared memory behind an ImuRing: a header, then a power-of-two number of slots.
+ *
+ * Indices count frames from the start and never wrap; a frame's slot is its index modulo the capacity. The producer
+ * owns the write index and the consumer the read index, each on its own cache line. Each slot carries a sequence
+ * number, odd while the producer is writing it and 2 * (index + 1) once written, so that with IMU_RING_OVERWRITE the
+ * consumer can tell a frame that was overwritten while it read it.
+ */
+namespace ImuRingLayout {
+    // "IMURING1"
+    constexpr uint64_t MAGIC{0x31474e4952554d49};
+    constexpr uint32_t VERSION{1};
+    constexpr size_t CACHE_LINE_BYTES{64};
+
+    enum ProducerState : uint32_t {
+        Open = 1,
+        Closed = 2
+    };
+
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        ImuRingFrame frame;
+    };
+
+    struct Header {
+        // Written last by the producer, once the rest of the header is ready.
+        std::atomic<uint64_t> magic;
+        uint32_t version;
+        uint32_t capacity;
+        uint32_t overflowPolicy;
+        float samplePeriodMs;
+        int32_t producerPid;
+        std::atomic<uint32_t> producerState;
+
+        alignas(CACHE_LINE_BYTES) std::atomic<uint64_t> writeIndex;
+        // CLOCK_MONOTONIC, as of the producer's last write or heartbeat.
+        std::atomic<uint64_t> producerActiveNs;
+        std::atomic<uint64_t> framesDropped;
+
+        alignas(CACHE_LINE_BYTES) std::atomic<uint64_t> readIndex;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared-memory atomics must be lock-free");
+    static_assert(sizeof(Header) % CACHE_LINE_BYTES == 0, "Slots must start on a cache line");
+
+    inline size_t getSizeInBytes(uint32_t capacity) {
+        return sizeof(Header) + static_cast<size_t>(capacity) * sizeof(Slot);
+    }
+
+    inline Slot *getSlots(Header *header) {
+        return reinterpret_cast<Slot *>(header + 1);
+    }
+
+    inline uint64_t getSequence(uint64_t index) {
+        return 2 * (index + 1);
+    }
+
+    /**
+     * Shared by every process on the host; read without a system call on Linux and macOS.
+     */
+    inline uint64_t getMonotonicNs() {
+        timespec now{};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+    }
+}
@@ -0,0 +1,382 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Command-line tool for the shared-memory IMU ring. By default it is the
+    consumer: it waits for a producer to create the ring, runs gait event
+    detection on the frames as they arrive, and reports the ring's fill
+    level. With --replay it is instead a test producer, which replays a
+    capture into the ring through the ImuRing C API:
+
+        GaitSonificationRing [options]
+        GaitSonificationRing --replay=capture.csv [options]
+
+        --ring=<name>                   Shared memory name (default
+                                        /gait-imu)
+
+    Consumer:
+        --stall=<ms>                    Producer silence taken for a stall
+                                        (default 100)
+        --stats=<s>                     Print the fill level and counts this
+                                        often; 0 for never (default 1)
+        --events=<file>                 Write the events detected as CSV
+        --wait=<s>                      How long to wait for the ring
+                                        (default 10)
+
+    Producer:
+        --capacity=<frames>             Ring capacity, rounded up to a power
+                                        of two (default 4096)
+        --policy=reject|drop-newest|overwrite
+                                        When the ring is full: wait for
+                                        space, drop new frames, or overwrite
+                                        old ones (default reject)
+        --speed=<x>                     Replay at x times the IMU rate; 0 for
+                                        as fast as possible (default 1)
+        --batch=<frames>                Frames per write (default 1)
+        --capture-timestamps            Index samples by the capture's own
+                                        sample numbers, not the sample count
+
+    The consumer exits once the producer has closed the ring, or gone away,
+    and the ring is empty.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include "../GaitEventDetector.h"
+#include "ImuRing.h"
+#include "ImuRingConsumer.h"
+
+namespace {
+    struct Settings {
+        juce::String ringName{"/gait-imu"};
+        double stallTimeoutMs{100.0};
+        double statsIntervalSeconds{1.0};
+        double waitSeconds{10.0};
+        juce::uint32 capacity{4096};
+        ImuRingOverflowPolicy policy{IMU_RING_REJECT};
+        double speed{1.0};
+        int batchSize{1};
+        bool useCaptureTimestamps{false};
+    };
+
+    // Frames read at a time, between checks on the producer.
+    constexpr int MAX_FRAMES_PER_READ{4096};
+
+    std::atomic<bool> shouldExit{false};
+
+    void printUsage() {
+        std::cerr << "Usage: GaitSonificationRing [--ring=<name>] [--stall=<ms>] [--stats=<s>] [--events=<file>]"
+                     " [--wait=<s>]\n"
+                     "       GaitSonificationRing --replay=capture.csv [--ring=<name>] [--capacity=<frames>]"
+                     " [--policy=reject|drop-newest|overwrite] [--speed=<x>] [--batch=<frames>]"
+                     " [--capture-timestamps]" << std::endl;
+    }
+
+    bool parseOptions(const juce::ArgumentList &args, Settings &settings) {
+        auto parseDouble = [&args](const juce::String &option, double &value, double minimum, double maximum) {
+            if (!args.containsOption(option)) {
+                return true;
+            }
+            value = args.getValueForOption(option).getDoubleValue();
+            if (value < minimum || value > maximum) {
+                std::cerr << option << " must be between " << minimum << " and " << maximum << std::endl;
+                return false;
+            }
+            return true;
+        };
+
+        auto capacity = static_cast<double>(settings.capacity);
+        auto batchSize = static_cast<double>(settings.batchSize);
+        if (!parseDouble("--stall", settings.stallTimeoutMs, 1.0, 60000.0) ||
+            !parseDouble("--stats", settings.statsIntervalSeconds, 0.0, 3600.0) ||
+            !parseDouble("--wait", settings.waitSeconds, 0.0, 3600.0) ||
+            !parseDouble("--capacity", capacity, 2.0, 1 << 30) ||
+            !parseDouble("--speed", settings.speed, 0.0, 1000.0) ||
+            !parseDouble("--batch", batchSize, 1.0, 1 << 16)) {
+            return false;
+        }
+        settings.capacity = static_cast<juce::uint32>(capacity);
+        settings.batchSize = static_cast<int>(batchSize);
+
+        if (args.containsOption("--ring")) {
+            settings.ringName = args.getValueForOption("--ring");
+        }
+
+        if (args.containsOption("--policy")) {
+            auto policy = args.getValueForOption("--policy");
+            if (policy == "reject") {
+                settings.policy = IMU_RING_REJECT;
+            } else if (policy == "drop-newest") {
+                settings.policy = IMU_RING_DROP_NEWEST;
+            } else if (policy == "overwrite") {
+                settings.policy = IMU_RING_OVERWRITE;
+            } else {
+                std::cerr << "Unknown policy: " << policy << std::endl;
+                return false;
+            }
+        }
+        settings.useCaptureTimestamps = args.containsOption("--capture-timestamps");
+
+        return true;
+    }
+
+    /**
+     * Write frames, waiting for space if the ring rejects them.
+     */
+    void writeFrames(ImuRingProducer *producer, const std::vector<ImuRingFrame> &frames) {
+        size_t numWritten{0};
+        while (numWritten < frames.size() && !shouldExit) {
+            numWritten += imuRingWrite(producer, frames.data() + numWritten, frames.size() - numWritten);
+            if (numWritten < frames.size()) {
+                juce::Thread::sleep(1);
+            }
+        }
+    }
+
+    int replay(const Settings &settings, juce::File capture) {
+        juce::FileInputStream stream{capture};
+        if (!stream.openedOk()) {
+            std::cerr << "Failed to open " << capture.getFullPathName() << std::endl;
+            return 1;
+        }
+        for (unsigned int l = 0; l < GaitEventDetector::NUM_HEADER_LINES; ++l) {
+            stream.readNextLine();
+        }
+
+        const auto samplePeriodMs = GaitEventDetector::IMU_SAMPLE_PERIOD_MS;
+        auto *producer = imuRingCreate(settings.ringName.toRawUTF8(), settings.capacity, settings.policy,
+                                       samplePeriodMs);
+        if (producer == nullptr) {
+            std::cerr << "Failed to create ring " << settings.ringName << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+
+        std::vector<ImuRingFrame> batch;
+        batch.reserve(static_cast<size_t>(settings.batchSize));
+        juce::int64 numFrames{0};
+        // Below any index, so a capture numbered from 0 keeps its first frame.
+        auto lastSampleIndex = std::numeric_limits<juce::int64>::min();
+        auto startMs = juce::Time::getMillisecondCounterHiRes();
+
+        while (!stream.isExhausted() && !shouldExit) {
+            auto fields = juce::StringArray::fromTokens(stream.readNextLine(), ",", "");
+            if (fields.size() <= static_cast<int>(GaitEventDetector::TRUNK_GYRO_Z_INDEX)) {
+                continue;
+            }
+
+            ImuRingFrame frame{};
+            frame.sampleIndex = settings.useCaptureTimestamps
+                                ? std::llround(fields[GaitEventDetector::TRUNK_ACCEL_Y_SAMPLE_INDEX].getDoubleValue())
+                                : numFrames + 1;
+            if (frame.sampleIndex <= lastSampleIndex) {
+                continue;
+            }
+            lastSampleIndex = frame.sampleIndex;
+            frame.accelX = fields[GaitEventDetector::TRUNK_ACCEL_X_INDEX].getFloatValue();
+            frame.accelY = fields[GaitEventDetector::TRUNK_ACCEL_Y_INDEX].getFloatValue();
+            frame.accelZ = fields[GaitEventDetector::TRUNK_ACCEL_Z_INDEX].getFloatValue();
+            frame.gyroX = fields[GaitEventDetector::TRUNK_GYRO_X_INDEX].getFloatValue();
+            frame.gyroY = fields[GaitEventDetector::TRUNK_GYRO_Y_INDEX].getFloatValue();
+            frame.gyroZ = fields[GaitEventDetector::TRUNK_GYRO_Z_INDEX].getFloatValue();
+            batch.push_back(frame);
+            ++numFrames;
+
+            if (batch.size() < static_cast<size_t>(settings.batchSize)) {
+                continue;
+            }
+
+            // Hold each batch until its last sample is due.
+            if (settings.speed > 0.0) {
+                auto dueMs = startMs + static_cast<double>(numFrames) * samplePeriodMs / settings.speed;
+                auto waitMs = dueMs - juce::Time::getMillisecondCounterHiRes();
+                if (waitMs > 1.0) {
+                    juce::Thread::sleep(static_cast<int>(waitMs));
+                }
+            }
+            writeFrames(producer, batch);
+            batch.clear();
+        }
+        writeFrames(producer, batch);
+
+        auto elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startMs) * .001;
+        std::cout << "Replayed " << numFrames << " frames in " << juce::String(elapsedSeconds, 2) << " s; "
+                  << imuRingGetFramesDropped(producer) << " dropped, " << imuRingGetFillLevel(producer) << "/"
+                  << imuRingGetCapacity(producer) << " unread" << std::endl;
+        imuRingClose(producer);
+        return 0;
+    }
+
+    /**
+     * Runs the detector on frames from the ring, and writes the events it finds.
+     */
+    class RingDetector {
+    public:
+        RingDetector(float samplePeriodMsToUse, juce::OutputStream *eventsToUse) :
+                samplePeriodMs(samplePeriodMsToUse),
+                events(eventsToUse) {
+            detector.setTimestampSource(GaitEventDetector::TimestampSource::Capture);
+            detector.prepareToProcessSamples();
+            if (events != nullptr) {
+                *events << "sample,time_ms,event,foot\n";
+            }
+        }
+
+        void process(const ImuRingFrame &frame) {
+            if (detector.getElapsedSamples() == 0) {
+                timeOffsetMs = static_cast<double>(frame.sampleIndex) * samplePeriodMs -
+                               GaitEventDetector::IMU_SAMPLE_PERIOD_MS;
+            }
+            detector.processSample(frame.accelY, frame.gyroY, static_cast<double>(frame.sampleIndex) * samplePeriodMs);
+
+            for (auto type: {GaitEventDetector::GaitEventType::ToeOff,
+                             GaitEventDetector::GaitEventType::InitialContact}) {
+                auto event = detector.getLastEvent(type);
+                auto &lastSample = type == GaitEventDetector::GaitEventType::ToeOff ? lastToeOffSample
+                                                                                  : lastInitialContactSample;
+                if (event.type != type || event.sampleIndex == lastSample) {
+                    continue;
+                }
+                lastSample = event.sampleIndex;
+                ++numEvents;
+
+                if (events != nullptr) {
+                    // Back on the producer's clock.
+                    auto timeMs = event.timeStampMs + timeOffsetMs;
+                    *events << juce::String(std::llround(timeMs / samplePeriodMs)) << "," << juce::String(timeMs, 3)
+                            << "," << (type == GaitEventDetector::GaitEventType::ToeOff ? "toe-off" : "initial contact")
+                            << "," << (event.foot == GaitEventDetector::Foot::Left ? "left" : "right") << "\n";
+                }
+            }
+        }
+
+        juce::int64 getNumEvents() const {
+            return numEvents;
+        }
+
+        float getCadence() {
+            return detector.getCadence();
+        }
+
+    private:
+        GaitEventDetector detector;
+        float samplePeriodMs;
+        juce::OutputStream *events;
+        double timeOffsetMs{0.0};
+        juce::int64 lastToeOffSample{0}, lastInitialContactSample{0};
+        juce::int64 numEvents{0};
+    };
+
+    const char *getStateName(ImuRingConsumer::ProducerState state) {
+        switch (state) {
+            case ImuRingConsumer::ProducerState::Active:
+                return "active";
+            case ImuRingConsumer::ProducerState::Stalled:
+                return "stalled";
+            case ImuRingConsumer::ProducerState::Closed:
+                return "closed";
+            case ImuRingConsumer::ProducerState::Gone:
+                break;
+        }
+        return "gone";
+    }
+
+    void printMetrics(const ImuRingConsumer &consumer, ImuRingConsumer::ProducerState state,
+                      RingDetector &detector) {
+        auto metrics = consumer.getMetrics();
+        std::cout << "Fill " << metrics.fillLevel << "/" << metrics.capacity << " (max " << metrics.maxFillLevel
+                  << "), " << metrics.framesRead << " frames read, " << metrics.framesDropped << " dropped, "
+                  << metrics.framesOverwritten << " overwritten, " << metrics.numStalls << " stalls (longest "
+                  << juce::String(metrics.longestStallMs, 0) << " ms), producer " << getStateName(state) << "; "
+                  << detector.getNumEvents() << " events, cadence " << juce::String(detector.getCadence(), 1)
+                  << std::endl;
+    }
+
+    int consume(const Settings &settings, juce::OutputStream *events) {
+        ImuRingConsumer consumer{settings.ringName};
+        auto giveUpMs = juce::Time::getMillisecondCounterHiRes() + settings.waitSeconds * 1000.0;
+        auto result = consumer.open();
+        while (result.failed() && !shouldExit && juce::Time::getMillisecondCounterHiRes() < giveUpMs) {
+            juce::Thread::sleep(100);
+            result = consumer.open();
+        }
+        if (result.failed()) {
+            std::cerr << result.getErrorMessage() << std::endl;
+            return 1;
+        }
+
+        RingDetector detector{consumer.getSamplePeriodMs(), events};
+        auto state = ImuRingConsumer::ProducerState::Active;
+        auto nextStatsMs = juce::Time::getMillisecondCounterHiRes() + settings.statsIntervalSeconds * 1000.0;
+
+        auto process = [&detector](const ImuRingFrame &frame) { detector.process(frame); };
+        while (!shouldExit) {
+            auto numRead = consumer.consume(MAX_FRAMES_PER_READ, process);
+
+            auto previousState = state;
+            state = consumer.checkProducer(settings.stallTimeoutMs);
+            if (state != previousState) {
+                std::cout << "Producer " << getStateName(state) << std::endl;
+            }
+
+            if (numRead == 0) {
+                if (state == ImuRingConsumer::ProducerState::Closed ||
+                    state == ImuRingConsumer::ProducerState::Gone) {
+                    // The producer may have written its last frames between the read and the check.
+                    while (consumer.consume(MAX_FRAMES_PER_READ, process) > 0) {
+                    }
+                    break;
+                }
+                juce::Thread::sleep(1);
+            }
+
+            if (settings.statsIntervalSeconds > 0.0 && juce::Time::getMillisecondCounterHiRes() >= nextStatsMs) {
+                printMetrics(consumer, state, detector);
+                nextStatsMs += settings.statsIntervalSeconds * 1000.0;
+            }
+        }
+
+        printMetrics(consumer, state, detector);
+        return 0;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    juce::ArgumentList args{argc, argv};
+
+    Settings settings;
+    if (!parseOptions(args, settings)) {
+        printUsage();
+        return 1;
+    }
+
+    std::signal(SIGINT, [](int) { shouldExit = true; });
+    std::signal(SIGTERM, [](int) { shouldExit = true; });
+
+    if (args.containsOption("--replay")) {
+        return replay(settings, args.getFileForOption("--replay"));
+    }
+
+    std::unique_ptr<juce::FileOutputStream> events;
+    if (args.containsOption("--events")) {
+        auto file = args.getFileForOption("--events");
+        file.deleteFile();
+        events = std::make_unique<juce::FileOutputStream>(file);
+        if (!events->openedOk()) {
+            std::cerr << "Failed to open " << file.getFullPathName() << " for writing" << std::endl;
+            return 1;
+        }
+    }
+
+    auto exitCode = consume(settings, events.get());
+    if (events != nullptr) {
+        events->flush();
+    }
+    return exitCode;
+}
@@ -0,0 +1,101 @@
+#include "SlidingMedian.h"
+
+template<typename T>
+SlidingMedian<T>::SlidingMedian(unsigned int windowSize) {
+    length = windowSize;
+}
+
+template<typename T>
+void SlidingMedian<T>::clear() {
+    values.clear();
+    lower.clear();
+    upper.clear();
+}
+
+template<typename T>
+void SlidingMedian<T>::write(T valueToWrite) {
+    if (length == 0) {
+        return;
+    }
+
+    while (values.size() >= length) {
+        erase(values.front());
+        values.pop_front();
+    }
+
+    values.push_back(valueToWrite);
+    insert(valueToWrite);
+}
+
+template<typename T>
+void SlidingMedian<T>::setWindowSize(unsigned int newWindowSize) {
+    length = newWindowSize;
+
+    while (values.size() > length) {
+        erase(values.front());
+        values.pop_front();
+    }
+}
+
+template<typename T>
+unsigned int SlidingMedian<T>::getWindowSize() const {
+    return length;
+}
+
+template<typename T>
+unsigned int SlidingMedian<T>::getNumValues() const {
+    return static_cast<unsigned int>(values.size());
+}
+
+template<typename T>
+T SlidingMedian<T>::getMedian(T defaultValue) const {
+    if (lower.empty()) {
+        return defaultValue;
+    }
+
+    if (lower.size() > upper.size()) {
+        return *lower.rbegin();
+    }
+
+    return (*lower.rbegin() + *upper.begin()) / static_cast<T>(2);
+}
+
+template<typename T>
+void SlidingMedian<T>::insert(T value) {
+    if (lower.empty() || value <= *lower.rbegin()) {
+        lower.insert(value);
+    } else {
+        upper.insert(value);
+    }
+
+    rebalance();
+}
+
+template<typename T>
+void SlidingMedian<T>::erase(T value) {
+    // Everything in upper is >= the largest value in lower, so a value no greater than that must be in lower.
+    if (!lower.empty() && value <= *lower.rbegin()) {
+        lower.erase(lower.find(value));
+    } else {
+        upper.erase(upper.find(value));
+    }
+
+    rebalance();
+}
+
+template<typename T>
+void SlidingMedian<T>::rebalance() {
+    // Keep lower the same size as upper, or one larger.
+    if (lower.size() > upper.size() + 1) {
+        auto largest = std::prev(lower.end());
+        upper.insert(*largest);
+        lower.erase(largest);
+    } else if (upper.size() > lower.size()) {
+        auto smallest = upper.begin();
+        lower.insert(*smallest);
+        upper.erase(smallest);
+    }
+}
+
+template
+class SlidingMedian<float>;
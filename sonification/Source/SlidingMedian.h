@@ -0,0 +1,50 @@
+#ifndef GAIT_SONIFICATION_SLIDINGMEDIAN_H
+#define GAIT_SONIFICATION_SLIDINGMEDIAN_H
+
+#include <deque>
+#include <iterator>
+#include <set>
+
+/**
+ * Median over the most recent windowSize values written.
+ *
+ * Values are held in two ordered sets, every value in the lower set being <= every value in the upper set, with the
+ * lower set holding the extra value when the count is odd. Writing a value (and evicting the oldest) is O(log w).
+ */
+template<typename T>
+class SlidingMedian {
+public:
+    explicit SlidingMedian(unsigned int windowSize);
+
+    void clear();
+
+    void write(T valueToWrite);
+
+    /**
+     * Change the window size. Shrinking the window evicts the oldest values immediately.
+     */
+    void setWindowSize(unsigned int newWindowSize);
+
+    unsigned int getWindowSize() const;
+
+    unsigned int getNumValues() const;
+
+    /**
+     * @return The median of the values in the window, or defaultValue if the window is empty.
+     */
+    T getMedian(T defaultValue = T{}) const;
+
+private:
+    void insert(T value);
+
+    void erase(T value);
+
+    void rebalance();
+
+    unsigned int length{0};
+    std::deque<T> values;
+    std::multiset<T> lower, upper;
+};
+
+
+#endif //GAIT_SONIFICATION_SLIDINGMEDIAN_H
@@ -0,0 +1,295 @@
+#include "SonificationEngine.h"
+#include "Trace.h"
+#include "Utils.h"
+
+SonificationEngine::SonificationEngine() :
+        panParameter(parameters.add(0.f, PAN_RAMP_MS)),
+        reverbAmountParameter(parameters.add(0.f, REVERB_RAMP_MS)),
+        reverb(parameters, reverbAmountParameter),
+        pan(parameters, panParameter),
+        gain(OUTPUT_GAIN / ReverbNode::LEVEL_SCALE) {
+    effects.add(reverb, AudioLoadMonitor::Reverb);
+    effects.add(pan, AudioLoadMonitor::Pan);
+    effects.add(gain, AudioLoadMonitor::Gain);
+    setSynthPatch(PatchDefault, Settings{}.synthDecayTime);
+    setMappingDesign(createDefaultMappingDesign());
+}
+
+void SonificationEngine::prepareToPlay(double sampleRate, int samplesPerBlockExpected) {
+    auto spec = juce::dsp::ProcessSpec{sampleRate, static_cast<uint32>(samplesPerBlockExpected), NUM_OUTPUT_CHANNELS};
+    loadMonitor.prepare(sampleRate);
+    parameters.prepareToPlay(sampleRate);
+    effects.prepare(spec);
+
+    synth.setModulationAmount(0.f);
+    synth.prepareToPlay(sampleRate, samplesPerBlockExpected, NUM_OUTPUT_CHANNELS);
+
+    allpass1.reset();
+    allpass2.reset();
+}
+
+void SonificationEngine::getNextAudioBlock(const juce::AudioSourceChannelInfo &bufferToFill) {
+    TRACE_SCOPE("SonificationEngine::getNextAudioBlock");
+    loadMonitor.beginBlock(bufferToFill.numSamples);
+
+    juce::dsp::AudioBlock<float> block(*bufferToFill.buffer,
+                                       (size_t) bufferToFill.startSample);
+    block = block.getSubBlock(0, (size_t) bufferToFill.numSamples);
+
+    switch (mode.load()) {
+        case SonificationMode::SynthConstant:
+        case SonificationMode::SynthRhythmic: {
+            // The oversampling factor rarely changes, so the last block's is a good guess at this one's.
+            AudioLoadMonitor::ScopedStage stage{loadMonitor, synth.getOversamplingFactor() > 1
+                                                             ? AudioLoadMonitor::SynthOversampled
+                                                             : AudioLoadMonitor::Synth};
+            bufferToFill.clearActiveBufferRegion();
+            synth.renderNextBlock(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+            break;
+        }
+        case SonificationMode::AudioFile:
+            if (audioFileSource == nullptr) {
+                bufferToFill.clearActiveBufferRegion();
+                loadMonitor.endBlock();
+                return;
+            }
+
+            {
+                AudioLoadMonitor::ScopedStage stage{loadMonitor, AudioLoadMonitor::AudioFile};
+                audioFileSource->getNextAudioBlock(bufferToFill);
+            }
+            {
+                AudioLoadMonitor::ScopedStage stage{loadMonitor, AudioLoadMonitor::AllpassCascade};
+                AllpassFilter::processCascade(allpass1, allpass2, block);
+            }
+            break;
+    }
+
+    effects.process(block, loadMonitor);
+
+    loadMonitor.endBlock();
+}
+
+void SonificationEngine::setMode(SonificationMode newMode) {
+    mode = newMode;
+    synth.enableEnvelope(newMode == SynthRhythmic);
+}
+
+SonificationEngine::SonificationMode SonificationEngine::getMode() const {
+    return mode.load();
+}
+
+AudioLoadMonitor &SonificationEngine::getLoadMonitor() {
+    return loadMonitor;
+}
+
+void SonificationEngine::setSynthPatch(SynthPatch patch, float decayTime) {
+    synth.setParameters(createSynthPatch(patch, decayTime));
+}
+
+void SonificationEngine::setAudioFileSource(juce::AudioSource *source) {
+    audioFileSource = source;
+}
+
+void SonificationEngine::start(const Settings &settings) {
+    if (mode.load() == SynthConstant) {
+        synth.startNote(settings.carrierFrequencyRange.first, .5);
+    }
+}
+
+void SonificationEngine::stop() {
+    if (mode.load() != AudioFile) {
+        synth.stopPlaying();
+        synth.setModulationAmount(0.f);
+    }
+}
+
+void SonificationEngine::update(GaitEventDetector &detector, const Settings &settings) {
+    TRACE_SCOPE("SonificationEngine::update");
+    using Mapping = SonificationMapping;
+
+    mappingPrograms.fetch();
+    auto currentMode = mode.load();
+    auto &program = mappingPrograms.getReadBuffer()[static_cast<size_t>(currentMode)];
+
+    auto balance = detector.getGtcBalance();
+    Mapping::Variables variables{};
+    variables[Mapping::Cadence] = detector.getCadence();
+    variables[Mapping::Balance] = balance;
+    variables[Mapping::Asymmetry] = balance - .5f;
+    variables[Mapping::AbsAsymmetry] = fabsf(balance - .5f);
+    variables[Mapping::AsymmetryThresholdLow] = settings.asymmetryThresholdLow;
+    variables[Mapping::AsymmetryThresholdHigh] = settings.asymmetryThresholdHigh;
+    variables[Mapping::FmModMultiplier] = settings.fmModMultiplier;
+    variables[Mapping::ReverbAmountMultiplier] = settings.reverbAmountMultiplier;
+    variables[Mapping::CarrierFrequencyLow] = settings.carrierFrequencyRange.first;
+    variables[Mapping::CarrierFrequencyHigh] = settings.carrierFrequencyRange.second;
+
+    program.evaluate(variables, mappingOutputs);
+    for (auto target: program) {
+        applyMappingOutput(target, mappingOutputs[static_cast<size_t>(target)]);
+    }
+
+    if (currentMode == SynthRhythmic) {
+        if (detector.hasEventNow(GaitEventDetector::GaitEventType::ToeOff)) {
+            auto freq = program.drives(Mapping::NoteFrequency) ? mappingOutputs[Mapping::NoteFrequency]
+                                                               : settings.carrierFrequencyRange.first;
+            // Tag notes by foot, so each foot's notes can ring on under the other's.
+            auto foot = detector.getLastEvent(GaitEventDetector::GaitEventType::ToeOff).foot;
+            synth.startNote(freq, NOTE_AMPLITUDE, static_cast<int>(foot));
+        }
+        synth.setEnvelope({0.f, .05f, settings.synthDecayTime});
+    }
+
+    allpass1.setGain(1.f - settings.allpass1Gain);
+    allpass2.setGain(1.f - settings.allpass2Gain);
+}
+
+void SonificationEngine::applyMappingOutput(SonificationMapping::Target target, float value) {
+    switch (target) {
+        case SonificationMapping::NoteFrequency:
+            // Used when the next note starts.
+            break;
+        case SonificationMapping::CarrierFrequency:
+            synth.setCarrierFrequency(value);
+            break;
+        case SonificationMapping::ModulationAmount:
+            synth.setModulationAmount(value);
+            break;
+        case SonificationMapping::AllpassOrder1:
+            allpass1.setOrder(static_cast<unsigned int>(std::max(0.f, value)));
+            break;
+        case SonificationMapping::AllpassOrder2:
+            allpass2.setOrder(static_cast<unsigned int>(std::max(0.f, value)));
+            break;
+        case SonificationMapping::Pan:
+            parameters.set(panParameter, Utils::clamp(value, -1.f, 1.f));
+            break;
+        case SonificationMapping::ReverbAmount:
+            parameters.set(reverbAmountParameter, Utils::clamp(value, 0.f, 1.f));
+            break;
+        case SonificationMapping::NUM_TARGETS:
+        default:
+            jassertfalse;
+    }
+}
+
+void SonificationEngine::setMappingDesign(const SonificationMapping::Design &design) {
+    mappingPrograms.getWriteBuffer() = SonificationMapping::compile(design);
+    mappingPrograms.publish();
+}
+
+juce::Result SonificationEngine::loadMappingDesign(const juce::File &file) {
+    if (!file.existsAsFile()) {
+        return juce::Result::fail("No such file: " + file.getFullPathName());
+    }
+
+    SonificationMapping::Design design;
+    auto result = SonificationMapping::parseDesign(file.loadFileAsString(), getModeNames(), design);
+    if (result.wasOk()) {
+        setMappingDesign(design);
+    }
+    return result;
+}
+
+SonificationMapping::Design SonificationEngine::createDefaultMappingDesign() {
+    using Mapping = SonificationMapping;
+
+    // Asymmetry beyond each threshold, 0 at the threshold to 1 at half a unit beyond it.
+    auto beyondLow = std::make_pair(Mapping::Bound{Mapping::AsymmetryThresholdLow, 1.f, -.5f},
+                                    Mapping::Bound{Mapping::AsymmetryThresholdLow, 1.f, .5f});
+    auto beyondHigh = std::make_pair(Mapping::Bound{Mapping::AsymmetryThresholdHigh, 1.f, -.5f},
+                                     Mapping::Bound{Mapping::AsymmetryThresholdHigh, 1.f, .5f});
+    // Cadence is imagined to be limited to 100-300 bpm.
+    auto cadence = std::make_pair(Mapping::Bound{100.f}, Mapping::Bound{300.f});
+    auto carrierFrequency = std::make_pair(Mapping::Bound{Mapping::CarrierFrequencyLow},
+                                           Mapping::Bound{Mapping::CarrierFrequencyHigh});
+
+    auto mapping = [](juce::uint32 modes, Mapping::Variable source, std::pair<Mapping::Bound, Mapping::Bound> input,
+                      std::pair<Mapping::Bound, Mapping::Bound> output, Mapping::Target target) {
+        SonificationMapping::Mapping m;
+        m.modes = modes;
+        m.source = source;
+        m.inputLow = input.first;
+        m.inputHigh = input.second;
+        m.outputLow = output.first;
+        m.outputHigh = output.second;
+        m.target = target;
+        return m;
+    };
+
+    Mapping::Design design;
+    design.name = "Default";
+    design.mappings = {
+            mapping(1u << SynthRhythmic, Mapping::Cadence, cadence, carrierFrequency, Mapping::NoteFrequency),
+            // Modulation jumps in at 2 as soon as asymmetry passes the low threshold.
+            mapping(1u << SynthRhythmic, Mapping::AbsAsymmetry, beyondLow,
+                    {2.f, {Mapping::FmModMultiplier, 1.f, 2.f}}, Mapping::ModulationAmount),
+            mapping(1u << SynthConstant, Mapping::Cadence, cadence, carrierFrequency, Mapping::CarrierFrequency),
+            mapping(1u << SynthConstant, Mapping::AbsAsymmetry, beyondLow,
+                    {0.f, {Mapping::FmModMultiplier, .5f}}, Mapping::ModulationAmount),
+            mapping(1u << AudioFile, Mapping::AbsAsymmetry, beyondLow, {0.f, 5000.f}, Mapping::AllpassOrder1),
+            mapping(1u << AudioFile, Mapping::AbsAsymmetry, beyondLow, {1.f, 5501.f}, Mapping::AllpassOrder2),
+            mapping(Mapping::ALL_MODES, Mapping::Asymmetry, {-1.f / 30.f, 1.f / 30.f}, {-1.f, 1.f}, Mapping::Pan),
+            mapping(Mapping::ALL_MODES, Mapping::AbsAsymmetry, beyondHigh,
+                    {0.f, Mapping::ReverbAmountMultiplier}, Mapping::ReverbAmount)
+    };
+    design.mappings[1].zeroBelowRange = true;
+    design.mappings[5].zeroBelowRange = true;
+    design.mappings[7].outputMin = 0.f;
+    design.mappings[7].outputMax = 1.f;
+    return design;
+}
+
+juce::StringArray SonificationEngine::getModeNames() {
+    // Indexed by SonificationMode.
+    return {"", "synthRhythmic", "synthConstant", "audioFile"};
+}
+
+juce::StringArray SonificationEngine::getPatchNames() {
+    // Indexed by SynthPatch.
+    return {"", "default", "bell", "reed", "vibrato"};
+}
+
+juce::Result SonificationEngine::parsePatchName(const juce::String &name, SynthPatch &patch) {
+    auto index = getPatchNames().indexOf(name);
+    if (index < PatchDefault) {
+        return juce::Result::fail("Unknown patch: " + name);
+    }
+    patch = static_cast<SynthPatch>(index);
+    return juce::Result::ok();
+}
+
+juce::Result SonificationEngine::parseSampleRate(const juce::String &text, double &sampleRate) {
+    auto value = text.getDoubleValue();
+    if (value < MIN_SAMPLE_RATE) {
+        return juce::Result::fail("Sample rate too low: " + juce::String(value));
+    }
+    sampleRate = value;
+    return juce::Result::ok();
+}
+
+FMSynth::Parameters SonificationEngine::createSynthPatch(SynthPatch patch, float decayTime) {
+    auto envParams = OADEnv::Parameters(0.f, 0.05f, decayTime);
+
+    switch (patch) {
+        case PatchBell:
+            return {FMOsc::LINEAR, {FMOsc::Parameters(3.5, 800.)}, envParams};
+        case PatchReed:
+            return {FMOsc::LINEAR, {FMOsc::Parameters(1., 300., .3)}, envParams};
+        case PatchVibrato:
+            return {FMOsc::LINEAR, {FMOsc::Parameters(FMOsc::FIXED, 6., 20.)}, envParams};
+        case PatchDefault:
+        default:
+            return {
+                    FMOsc::LINEAR,
+                    {
+                            FMOsc::Parameters(1.4, 500., 0.1, FMOsc::EXPONENTIAL, nullptr, {
+                                    FMOsc::Parameters(1.4, 1.9)
+                            }),
+                            FMOsc::Parameters(1.35, .5)
+                    },
+                    envParams
+            };
+    }
+}
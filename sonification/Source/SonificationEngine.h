@@ -0,0 +1,179 @@
+#ifndef GAIT_SONIFICATION_SONIFICATIONENGINE_H
+#define GAIT_SONIFICATION_SONIFICATIONENGINE_H
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <utility>
+#include "GaitEventDetector.h"
+#include "SonificationMapping.h"
+#include "TripleBuffer.h"
+#include "Synthesis/FMSynth.h"
+#include "Processing/AllpassFilter.h"
+#include "Processing/ParameterStore.h"
+#include "Processing/AudioLoadMonitor.h"
+#include "Processing/EffectsChain.h"
+#include "Processing/EffectNodes.h"
+
+/**
+ * Maps the state of a GaitEventDetector to sound, and renders it: FM synth or filtered audio file, then reverb, pan
+ * and gain. Effects with nothing to do for a block are skipped, as are silent blocks once the reverb has rung out.
+ *
+ * How gait metrics map to sound parameters is given by a SonificationMapping design, compiled when it's set.
+ *
+ * Knows nothing of audio devices or timers, so the same chain can be driven in real time by the app or offline by the
+ * renderer. update() is called after each IMU sample, from the thread processing the detector; getNextAudioBlock()
+ * from the audio thread.
+ */
+class SonificationEngine {
+public:
+    static constexpr int NUM_OUTPUT_CHANNELS{2};
+    // Level at which the audio file source should play.
+    static constexpr float AUDIO_FILE_GAIN{.75f};
+    // The lowest sample rate the offline tools will render at.
+    static constexpr double MIN_SAMPLE_RATE{8000.0};
+
+    enum SonificationMode {
+        SynthRhythmic = 1,
+        SynthConstant,
+        AudioFile
+    };
+
+    enum SynthPatch {
+        PatchDefault = 1,
+        PatchBell,
+        PatchReed,
+        PatchVibrato
+    };
+
+    /**
+     * Values mapping designs can refer to, and the allpass gains.
+     */
+    struct Settings {
+        float asymmetryThresholdLow{.515f},
+                asymmetryThresholdHigh{.53f},
+                fmModMultiplier{70.f},
+                synthDecayTime{.2f},
+                reverbAmountMultiplier{100.f},
+                allpass1Gain{.23f},
+                allpass2Gain{.71f};
+        std::pair<float, float> carrierFrequencyRange{300.f, 600.f};
+    };
+
+    SonificationEngine();
+
+    void prepareToPlay(double sampleRate, int samplesPerBlockExpected);
+
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo &bufferToFill);
+
+    void setMode(SonificationMode newMode);
+
+    SonificationMode getMode() const;
+
+    /**
+     * @return Timing of the audio callbacks and of each stage of the chain.
+     */
+    AudioLoadMonitor &getLoadMonitor();
+
+    /**
+     * Set the synth patch; swapped in as by FMSynth::loadPatch() if the engine has been prepared.
+     */
+    void setSynthPatch(SynthPatch patch, float decayTime);
+
+    /**
+     * Set the source played through the allpass filters in AudioFile mode. The caller prepares and owns it. Call before
+     * the engine is prepared.
+     */
+    void setAudioFileSource(juce::AudioSource *source);
+
+    /**
+     * Start sounding, e.g. the constant synth tone.
+     *
+     * start() and stop() queue notes, as update() does, and the synth's note queue takes one thread at a time: call
+     * start() before the thread calling update() starts, and stop() once it has stopped.
+     */
+    void start(const Settings &settings);
+
+    void stop();
+
+    /**
+     * Map the detector's state after its latest sample to sound, through the current mapping design.
+     */
+    void update(GaitEventDetector &detector, const Settings &settings);
+
+    /**
+     * Compile a mapping design for update() to pick up. Call from the message thread.
+     */
+    void setMappingDesign(const SonificationMapping::Design &design);
+
+    /**
+     * Load a mapping design from a JSON file, as described in SonificationMapping. Call from the message thread.
+     */
+    juce::Result loadMappingDesign(const juce::File &file);
+
+    /**
+     * The design the engine starts with.
+     */
+    static SonificationMapping::Design createDefaultMappingDesign();
+
+    /**
+     * @return The names mapping designs use for the modes, indexed by mode.
+     */
+    static juce::StringArray getModeNames();
+
+    /**
+     * @return The names the command-line tools use for the patches, indexed by patch.
+     */
+    static juce::StringArray getPatchNames();
+
+    /**
+     * Look a patch up by its name in getPatchNames().
+     */
+    static juce::Result parsePatchName(const juce::String &name, SynthPatch &patch);
+
+    /**
+     * Parse a sample rate given on the command line, rejecting any below MIN_SAMPLE_RATE.
+     */
+    static juce::Result parseSampleRate(const juce::String &text, double &sampleRate);
+
+    /**
+     * Build the synth parameters for one of the preset patches.
+     */
+    static FMSynth::Parameters createSynthPatch(SynthPatch patch, float decayTime);
+
+private:
+    static constexpr double PAN_RAMP_MS{50.0};
+    static constexpr double REVERB_RAMP_MS{50.0};
+    // Applied after the reverb, along with the dry gain the reverb leaves out; see ReverbNode.
+    static constexpr float OUTPUT_GAIN{.5f};
+    static constexpr float NOTE_AMPLITUDE{.5f};
+    static_assert(AudioFile < SonificationMapping::MAX_MODES, "Mapping programs must cover every mode");
+
+    /**
+     * Pass a mapping output on to whatever it drives.
+     */
+    void applyMappingOutput(SonificationMapping::Target target, float value);
+
+    std::atomic<SonificationMode> mode{SynthRhythmic};
+
+    FMSynth synth;
+    AllpassFilter allpass1{NUM_OUTPUT_CHANNELS};
+    AllpassFilter allpass2{NUM_OUTPUT_CHANNELS};
+    juce::AudioSource *audioFileSource{nullptr};
+
+    // Set by update(), ramped on the audio thread.
+    ParameterStore parameters;
+    int panParameter, reverbAmountParameter;
+
+    ReverbNode reverb;
+    PanNode pan;
+    GainNode gain;
+    EffectsChain effects;
+
+    AudioLoadMonitor loadMonitor;
+
+    // Written by setMappingDesign(), read by update().
+    TripleBuffer<SonificationMapping::ProgramSet> mappingPrograms;
+    SonificationMapping::Outputs mappingOutputs{};
+};
+
+#endif //GAIT_SONIFICATION_SONIFICATIONENGINE_H
@@ -0,0 +1,232 @@
+#include "SonificationMapping.h"
+
+namespace {
+    // JSON names, indexed by enum value.
+    const juce::StringArray VARIABLE_NAMES{
+            "zero", "cadence", "balance", "asymmetry", "absAsymmetry", "asymmetryThresholdLow",
+            "asymmetryThresholdHigh", "fmModMultiplier", "reverbAmountMultiplier", "carrierFrequencyLow",
+            "carrierFrequencyHigh"
+    };
+    const juce::StringArray TARGET_NAMES{
+            "noteFrequency", "carrierFrequency", "modulationAmount", "allpassOrder1", "allpassOrder2", "pan",
+            "reverbAmount"
+    };
+    const juce::StringArray CURVE_NAMES{"linear", "exponential"};
+}
+
+SonificationMapping::Program SonificationMapping::Program::compile(const Design &design, int mode) {
+    // The last mapping to each target in this mode.
+    std::array<const Mapping *, NUM_TARGETS> mappings{};
+    for (auto &mapping: design.mappings) {
+        if ((mapping.modes >> mode) & 1u) {
+            mappings[static_cast<size_t>(mapping.target)] = &mapping;
+        }
+    }
+
+    Program program;
+    for (auto curve: {Linear, Exponential}) {
+        for (auto *mapping: mappings) {
+            if (mapping == nullptr || mapping->curve != curve) {
+                continue;
+            }
+            program.instructions[static_cast<size_t>(program.numInstructions++)] = {
+                    mapping->source,
+                    mapping->inputLow, mapping->inputHigh, mapping->outputLow, mapping->outputHigh,
+                    mapping->zeroBelowRange ? 1.f : 0.f,
+                    mapping->outputMin, mapping->outputMax,
+                    mapping->target
+            };
+            program.targets[static_cast<size_t>(program.numTargets++)] = mapping->target;
+        }
+        if (curve == Linear) {
+            program.numLinear = program.numInstructions;
+        }
+    }
+    return program;
+}
+
+void SonificationMapping::Program::evaluate(const Variables &variables, Outputs &outputs) const noexcept {
+    for (auto i = 0; i < numLinear; ++i) {
+        auto &instruction = instructions[static_cast<size_t>(i)];
+        auto x = normalise(instruction, variables);
+        auto low = evaluate(instruction.outputLow, variables);
+        auto high = evaluate(instruction.outputHigh, variables);
+        store(instruction, x, low + (high - low) * x, outputs);
+    }
+
+    for (auto i = numLinear; i < numInstructions; ++i) {
+        auto &instruction = instructions[static_cast<size_t>(i)];
+        auto x = normalise(instruction, variables);
+        auto low = evaluate(instruction.outputLow, variables);
+        auto high = evaluate(instruction.outputHigh, variables);
+        // Settings can put a bound at or across 0, where the log would be NaN.
+        auto sign = std::copysign(1.f, low + high);
+        low = sign * std::max(MIN_EXPONENTIAL_BOUND, sign * low);
+        high = sign * std::max(MIN_EXPONENTIAL_BOUND, sign * high);
+        store(instruction, x, low * std::exp2(x * std::log2(high / low)), outputs);
+    }
+}
+
+bool SonificationMapping::Program::drives(Target target) const {
+    return std::find(begin(), end(), target) != end();
+}
+
+float SonificationMapping::Program::normalise(const Instruction &instruction, const Variables &variables) noexcept {
+    auto low = evaluate(instruction.inputLow, variables);
+    auto high = evaluate(instruction.inputHigh, variables);
+    auto x = (variables[static_cast<size_t>(instruction.source)] - low) / (high - low);
+    // In this order, NaN from an empty range comes out as 0.
+    return std::min(1.f, std::max(0.f, x));
+}
+
+void SonificationMapping::Program::store(const Instruction &instruction, float x, float y, Outputs &outputs) noexcept {
+    y *= 1.f - instruction.gate * static_cast<float>(x <= 0.f);
+    outputs[static_cast<size_t>(instruction.target)] = std::min(std::max(y, instruction.outputMin),
+                                                                instruction.outputMax);
+}
+
+float SonificationMapping::Program::evaluate(const Bound &bound, const Variables &variables) noexcept {
+    return bound.offset + bound.scale * variables[static_cast<size_t>(bound.variable)];
+}
+
+SonificationMapping::ProgramSet SonificationMapping::compile(const Design &design) {
+    ProgramSet programs;
+    for (auto mode = 0; mode < MAX_MODES; ++mode) {
+        programs[static_cast<size_t>(mode)] = Program::compile(design, mode);
+    }
+    return programs;
+}
+
+juce::Result SonificationMapping::parseDesign(const juce::String &json, const juce::StringArray &modeNames,
+                                              Design &design) {
+    juce::var root;
+    auto result = juce::JSON::parse(json, root);
+    if (result.failed()) {
+        return result;
+    }
+
+    auto *mappings = root["mappings"].getArray();
+    if (mappings == nullptr) {
+        return juce::Result::fail("A design needs a \"mappings\" array");
+    }
+
+    Design parsed;
+    parsed.name = root.getProperty("name", "Untitled").toString();
+    for (auto &mappingJson: *mappings) {
+        Mapping mapping;
+        result = parseMapping(mappingJson, modeNames, mapping);
+        if (result.failed()) {
+            return juce::Result::fail("Mapping " + juce::String(parsed.mappings.size() + 1) + ": " +
+                                      result.getErrorMessage());
+        }
+        parsed.mappings.push_back(mapping);
+    }
+
+    design = std::move(parsed);
+    return juce::Result::ok();
+}
+
+juce::Result SonificationMapping::parseMapping(const juce::var &json, const juce::StringArray &modeNames,
+                                               Mapping &mapping) {
+    if (!json.isObject()) {
+        return juce::Result::fail("not an object");
+    }
+
+    if (json.hasProperty("modes")) {
+        auto *modes = json["modes"].getArray();
+        if (modes == nullptr) {
+            return juce::Result::fail("\"modes\" must be an array of mode names");
+        }
+        mapping.modes = 0;
+        for (auto &mode: *modes) {
+            auto index = modeNames.indexOf(mode.toString());
+            if (index < 0 || index >= MAX_MODES) {
+                return juce::Result::fail("unknown mode \"" + mode.toString() + "\"");
+            }
+            mapping.modes |= 1u << index;
+        }
+    }
+
+    auto result = parseVariable(json["source"], mapping.source);
+    if (result.failed()) {
+        return result;
+    }
+
+    auto *input = json["input"].getArray();
+    auto *output = json["output"].getArray();
+    if (input == nullptr || input->size() != 2 || output == nullptr || output->size() != 2) {
+        return juce::Result::fail("\"input\" and \"output\" must each be a pair of bounds");
+    }
+    for (auto &[bound, boundJson]: {std::make_pair(&mapping.inputLow, (*input)[0]),
+                                    std::make_pair(&mapping.inputHigh, (*input)[1]),
+                                    std::make_pair(&mapping.outputLow, (*output)[0]),
+                                    std::make_pair(&mapping.outputHigh, (*output)[1])}) {
+        result = parseBound(boundJson, *bound);
+        if (result.failed()) {
+            return result;
+        }
+    }
+
+    auto inputIsConstant = mapping.inputLow.scale == 0.f && mapping.inputHigh.scale == 0.f;
+    if (inputIsConstant && mapping.inputLow.offset == mapping.inputHigh.offset) {
+        return juce::Result::fail("empty input range");
+    }
+
+    auto curve = CURVE_NAMES.indexOf(json.getProperty("curve", "linear").toString());
+    if (curve < 0) {
+        return juce::Result::fail("unknown curve \"" + json["curve"].toString() + "\"");
+    }
+    mapping.curve = static_cast<Curve>(curve);
+    auto outputIsConstant = mapping.outputLow.scale == 0.f && mapping.outputHigh.scale == 0.f;
+    if (mapping.curve == Exponential && outputIsConstant &&
+        !(mapping.outputLow.offset * mapping.outputHigh.offset > 0.f)) {
+        return juce::Result::fail("an exponential output range can't include 0");
+    }
+
+    mapping.zeroBelowRange = json.getProperty("zeroBelowRange", false);
+
+    if (json.hasProperty("limit")) {
+        auto *limit = json["limit"].getArray();
+        if (limit == nullptr || limit->size() != 2) {
+            return juce::Result::fail("\"limit\" must be a pair of numbers");
+        }
+        mapping.outputMin = static_cast<float>((*limit)[0]);
+        mapping.outputMax = static_cast<float>((*limit)[1]);
+    }
+
+    auto target = TARGET_NAMES.indexOf(json["target"].toString());
+    if (target < 0) {
+        return juce::Result::fail("unknown target \"" + json["target"].toString() + "\"");
+    }
+    mapping.target = static_cast<Target>(target);
+
+    return juce::Result::ok();
+}
+
+juce::Result SonificationMapping::parseBound(const juce::var &json, Bound &bound) {
+    if (json.isDouble() || json.isInt() || json.isInt64()) {
+        bound = Bound{static_cast<float>(json)};
+        return juce::Result::ok();
+    }
+    if (!json.isObject()) {
+        return juce::Result::fail("a bound must be a number or an object");
+    }
+
+    Variable variable;
+    auto result = parseVariable(json["variable"], variable);
+    if (result.failed()) {
+        return result;
+    }
+    bound = Bound{variable, static_cast<float>(json.getProperty("scale", 1.f)),
+                  static_cast<float>(json.getProperty("offset", 0.f))};
+    return juce::Result::ok();
+}
+
+juce::Result SonificationMapping::parseVariable(const juce::var &json, Variable &variable) {
+    auto index = VARIABLE_NAMES.indexOf(json.toString());
+    if (index < 0) {
+        return juce::Result::fail("unknown variable \"" + json.toString() + "\"");
+    }
+    variable = static_cast<Variable>(index);
+    return juce::Result::ok();
+}
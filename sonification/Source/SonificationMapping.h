@@ -0,0 +1,210 @@
+#ifndef GAIT_SONIFICATION_SONIFICATIONMAPPING_H
+#define GAIT_SONIFICATION_SONIFICATIONMAPPING_H
+
+#include <JuceHeader.h>
+#include <array>
+#include <limits>
+#include <vector>
+
+/**
+ * Declarative mappings from gait metrics to sound parameters, and the programs they compile to.
+ *
+ * A Design is a list of Mappings, each taking a source variable over an input range, through a curve, to an output
+ * range, and on to a target parameter. Range bounds may follow settings, e.g. the asymmetry thresholds. Designs are
+ * compiled, once per sonification mode, to fixed-size Programs, which evaluate without branching or allocating, so
+ * the cost of mapping an IMU sample is bounded by the number of targets.
+ *
+ * Designs can be loaded from JSON:
+ *
+ *     {
+ *       "name": "Cadence to pitch",
+ *       "mappings": [
+ *         {
+ *           "modes": ["synthRhythmic"],
+ *           "source": "cadence",
+ *           "input": [100, 300],
+ *           "curve": "exponential",
+ *           "output": [{"variable": "carrierFrequencyLow"}, {"variable": "carrierFrequencyHigh"}],
+ *           "target": "noteFrequency"
+ *         },
+ *         {
+ *           "source": "absAsymmetry",
+ *           "input": [{"variable": "asymmetryThresholdHigh", "offset": -0.5},
+ *                     {"variable": "asymmetryThresholdHigh", "offset": 0.5}],
+ *           "output": [0, {"variable": "reverbAmountMultiplier"}],
+ *           "limit": [0, 1],
+ *           "target": "reverbAmount"
+ *         }
+ *       ]
+ *     }
+ *
+ * A bound is a number, or {"variable", "scale" (default 1), "offset" (default 0)}. "modes" defaults to every mode,
+ * "curve" to "linear". "zeroBelowRange": true outputs 0 while the source is at or below the bottom of its input range.
+ * "limit" clamps the output.
+ */
+class SonificationMapping {
+public:
+    // Programs are compiled for modes 0 to MAX_MODES - 1.
+    static constexpr int MAX_MODES{4};
+    static constexpr juce::uint32 ALL_MODES{~0u};
+
+    /**
+     * What mappings read: gait metrics, then settings.
+     */
+    enum Variable {
+        // Always 0; the variable of a constant bound.
+        Zero,
+        // Steps/min.
+        Cadence,
+        // GCT balance, 0 (L) to 1 (R).
+        Balance,
+        // Balance - .5.
+        Asymmetry,
+        AbsAsymmetry,
+        AsymmetryThresholdLow,
+        AsymmetryThresholdHigh,
+        FmModMultiplier,
+        ReverbAmountMultiplier,
+        CarrierFrequencyLow,
+        CarrierFrequencyHigh,
+        NUM_VARIABLES
+    };
+
+    /**
+     * What mappings drive.
+     */
+    enum Target {
+        // Frequency of notes started on toe-off.
+        NoteFrequency,
+        // Frequency of the sounding note, ramped.
+        CarrierFrequency,
+        ModulationAmount,
+        AllpassOrder1,
+        AllpassOrder2,
+        // -1 (L) to 1 (R).
+        Pan,
+        ReverbAmount,
+        NUM_TARGETS
+    };
+
+    enum Curve {
+        Linear,
+        // Equal ratios of output for equal steps of input; both output bounds must have the same sign. Bounds that
+        // follow variables are held to the sign of their sum, and at least MIN_EXPONENTIAL_BOUND from 0.
+        Exponential
+    };
+
+    static constexpr float MIN_EXPONENTIAL_BOUND{1.0e-6f};
+
+    /**
+     * A range bound: offset + scale * variable.
+     */
+    struct Bound {
+        Bound() = default;
+
+        Bound(float constant) : offset(constant) {}
+
+        Bound(Variable variableToFollow, float scaleToUse = 1.f, float offsetToUse = 0.f)
+                : variable(variableToFollow), scale(scaleToUse), offset(offsetToUse) {
+        }
+
+        Variable variable{Zero};
+        float scale{0.f};
+        float offset{0.f};
+    };
+
+    struct Mapping {
+        // Bit n set for mode n.
+        juce::uint32 modes{ALL_MODES};
+        Variable source{Zero};
+        Bound inputLow, inputHigh;
+        Curve curve{Linear};
+        Bound outputLow, outputHigh;
+        bool zeroBelowRange{false};
+        float outputMin{std::numeric_limits<float>::lowest()};
+        float outputMax{std::numeric_limits<float>::max()};
+        Target target{NoteFrequency};
+    };
+
+    struct Design {
+        juce::String name;
+        std::vector<Mapping> mappings;
+    };
+
+    using Variables = std::array<float, NUM_VARIABLES>;
+    using Outputs = std::array<float, NUM_TARGETS>;
+
+    /**
+     * A design compiled for one mode.
+     */
+    class Program {
+    public:
+        /**
+         * Compile the mappings of a design that apply in a mode. A mapping replaces any earlier one to the same target.
+         */
+        static Program compile(const Design &design, int mode);
+
+        /**
+         * Evaluate every mapping, writing the targets this program drives to outputs.
+         */
+        void evaluate(const Variables &variables, Outputs &outputs) const noexcept;
+
+        bool drives(Target target) const;
+
+        /**
+         * The targets this program drives, each once.
+         */
+        const Target *begin() const { return targets.data(); }
+
+        const Target *end() const { return targets.data() + numTargets; }
+
+    private:
+        struct Instruction {
+            int source;
+            Bound inputLow, inputHigh, outputLow, outputHigh;
+            // 1 to zero the output at the bottom of the input range, else 0.
+            float gate;
+            float outputMin, outputMax;
+            int target;
+        };
+
+        /**
+         * Map the source to 0-1 through the input range.
+         */
+        static float normalise(const Instruction &instruction, const Variables &variables) noexcept;
+
+        static void store(const Instruction &instruction, float x, float y, Outputs &outputs) noexcept;
+
+        static float evaluate(const Bound &bound, const Variables &variables) noexcept;
+
+        // Linear mappings first, then exponential, so each group runs in its own branch-free loop. At most one per
+        // target.
+        std::array<Instruction, NUM_TARGETS> instructions{};
+        int numLinear{0};
+        int numInstructions{0};
+        std::array<Target, NUM_TARGETS> targets{};
+        int numTargets{0};
+    };
+
+    using ProgramSet = std::array<Program, MAX_MODES>;
+
+    /**
+     * Compile a design for every mode.
+     */
+    static ProgramSet compile(const Design &design);
+
+    /**
+     * Parse a design from JSON, as described above.
+     * @param modeNames The name of each mode, indexed by mode.
+     */
+    static juce::Result parseDesign(const juce::String &json, const juce::StringArray &modeNames, Design &design);
+
+private:
+    static juce::Result parseMapping(const juce::var &json, const juce::StringArray &modeNames, Mapping &mapping);
+
+    static juce::Result parseBound(const juce::var &json, Bound &bound);
+
+    static juce::Result parseVariable(const juce::var &json, Variable &variable);
+};
+
+#endif //GAIT_SONIFICATION_SONIFICATIONMAPPING_H
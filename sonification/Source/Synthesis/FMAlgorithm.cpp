@@ -0,0 +1,310 @@
+/*
+  ==============================================================================
+
+    FMAlgorithm.cpp
+
+  ==============================================================================
+*/
+
+#include "FMAlgorithm.h"
+
+FMAlgorithm::FMAlgorithm(FMOsc::FMMode carrierMode,
+                         const std::vector<FMOsc::Parameters> &modulatorParameters,
+                         const OADEnv::Parameters &envParams) {
+    // Lay the tree out depth-first, parents before children...
+    appendOperator(carrierMode, -1);
+    for (auto &params: modulatorParameters) {
+        addOperator(params, 0);
+    }
+
+    // ...then reverse it, so that every operator comes after all of its modulators.
+    auto lastIndex = getCarrierIndex();
+    for (auto &t: target) {
+        t = t < 0 ? -1 : lastIndex - t;
+    }
+    std::reverse(target.begin(), target.end());
+    std::reverse(mode.begin(), mode.end());
+    std::reverse(modMode.begin(), modMode.end());
+    std::reverse(modulationFrequencyRatio.begin(), modulationFrequencyRatio.end());
+    std::reverse(modulationFrequency.begin(), modulationFrequency.end());
+    std::reverse(peakDeviation.begin(), peakDeviation.end());
+    std::reverse(feedback.begin(), feedback.end());
+    std::reverse(envelopeIsSet.begin(), envelopeIsSet.end());
+    std::reverse(envelopes.begin(), envelopes.end());
+
+    auto numOperators = target.size();
+    currentAngle.assign(numOperators, 0.0);
+    angleDelta.assign(numOperators, 0.0);
+    amplitude.assign(numOperators, 1.0);
+    prevSample.assign(numOperators, 0.0);
+
+    setEnvelope(envParams);
+}
+
+void FMAlgorithm::addOperator(const FMOsc::Parameters &params, int targetIndex) {
+    auto index = static_cast<int>(target.size());
+    appendOperator(params.mode, targetIndex);
+    modMode.back() = params.modMode;
+    modulationFrequencyRatio.back() = params.modFreqRatio;
+    modulationFrequency.back() = params.modFreq;
+    peakDeviation.back() = params.peakDeviation;
+    feedback.back() = params.feedback;
+    if (params.envelope) {
+        envelopes.back().setParameters(*params.envelope);
+        envelopeIsSet.back() = true;
+    }
+
+    for (auto &modulatorParams: params.modulatorParams) {
+        addOperator(modulatorParams, index);
+    }
+}
+
+void FMAlgorithm::appendOperator(FMOsc::FMMode operatorMode, int targetIndex) {
+    target.push_back(targetIndex);
+    mode.push_back(operatorMode);
+    modMode.push_back(FMOsc::PROPORTIONAL);
+    modulationFrequencyRatio.push_back(0.0);
+    modulationFrequency.push_back(0.0);
+    peakDeviation.push_back(0.0);
+    feedback.push_back(0.0);
+    envelopeIsSet.push_back(false);
+    envelopes.emplace_back();
+}
+
+void FMAlgorithm::prepareToPlay(double newSampleRate, int maximumBlockSize) {
+    sampleRate = newSampleRate;
+    maxBlockSize = maximumBlockSize;
+
+    reset();
+    for (auto &envelope: envelopes) {
+        envelope.setSampleRate(sampleRate);
+    }
+
+    modulationBlocks.assign(target.size() * static_cast<size_t>(maxBlockSize), 0.f);
+    operatorBlock.assign(static_cast<size_t>(maxBlockSize), 0.f);
+    envelopeBlock.assign(static_cast<size_t>(maxBlockSize), 0.f);
+    operatorIsSilent.assign(target.size(), 0);
+}
+
+void FMAlgorithm::setSampleRate(double newSampleRate) {
+    jassert(sampleRate > 0.0 && newSampleRate > 0.0);
+    auto ratio = sampleRate / newSampleRate;
+    for (auto &delta: angleDelta) {
+        delta *= ratio;
+    }
+    sampleRate = newSampleRate;
+
+    for (auto &envelope: envelopes) {
+        envelope.setSampleRate(sampleRate);
+    }
+}
+
+void FMAlgorithm::setupNote(double frequency, float noteAmplitude) {
+    if (target.empty()) {
+        return;
+    }
+
+    amplitude[static_cast<size_t>(getCarrierIndex())] = noteAmplitude;
+
+    setFrequency(frequency);
+
+    if (envelopeEnabled) {
+        envelopes[static_cast<size_t>(getCarrierIndex())].noteOn();
+    }
+}
+
+void FMAlgorithm::setFrequency(double frequency) {
+    if (target.empty()) {
+        return;
+    }
+
+    auto carrier = static_cast<size_t>(getCarrierIndex());
+    angleDelta[carrier] = frequency / sampleRate * juce::MathConstants<double>::twoPi;
+
+    // Work down from the carrier, so each operator's target is set up before it is.
+    for (auto op = carrier; op-- > 0;) {
+        auto t = static_cast<size_t>(target[op]);
+        auto targetFrequency = angleDelta[t] * sampleRate / juce::MathConstants<double>::twoPi;
+        auto modFreq = modMode[op] == FMOsc::PROPORTIONAL ? targetFrequency * modulationFrequencyRatio[op]
+                                                          : modulationFrequency[op];
+        // modulation index, I = d/m; d, peak deviation; m, modulation frequency;
+        amplitude[op] = amplitude[t] * modulationAmount * (peakDeviation[op] / modFreq);
+        angleDelta[op] = modFreq / sampleRate * juce::MathConstants<double>::twoPi;
+
+        if (envelopeEnabled) {
+            envelopes[op].noteOn();
+        }
+    }
+}
+
+void FMAlgorithm::setModulationAmount(float newModulationAmount) {
+    modulationAmount = newModulationAmount;
+}
+
+void FMAlgorithm::setEnvelope(const OADEnv::Parameters &newParams, bool forceUpdateModulators) {
+    for (size_t op = 0; op < envelopes.size(); ++op) {
+        if (target[op] < 0 || !envelopeIsSet[op] || forceUpdateModulators) {
+            envelopes[op].setParameters(newParams);
+        }
+    }
+}
+
+void FMAlgorithm::enableEnvelope(bool shouldEnable) {
+    envelopeEnabled = shouldEnable;
+}
+
+void FMAlgorithm::stopNote() {
+    std::fill(angleDelta.begin(), angleDelta.end(), 0.0);
+    for (auto &envelope: envelopes) {
+        envelope.noteOff();
+    }
+}
+
+void FMAlgorithm::reset() {
+    std::fill(currentAngle.begin(), currentAngle.end(), 0.0);
+}
+
+bool FMAlgorithm::isActive() const {
+    return !target.empty() && (!envelopeEnabled || envelopes.back().isActive());
+}
+
+bool FMAlgorithm::isPlaying() const {
+    return !target.empty() && angleDelta.back() != 0.0;
+}
+
+float FMAlgorithm::getLevel() const {
+    if (target.empty()) {
+        return 0.f;
+    }
+    auto level = static_cast<float>(amplitude.back());
+    return envelopeEnabled ? level * envelopes.back().getCurrentValue() : level;
+}
+
+int FMAlgorithm::getNumOperators() const {
+    return static_cast<int>(target.size());
+}
+
+double FMAlgorithm::getUpperFrequency() const {
+    if (target.empty()) {
+        return 0.0;
+    }
+
+    auto radiansToHz = sampleRate / juce::MathConstants<double>::twoPi;
+    auto frequency = angleDelta.back() * radiansToHz;
+    for (size_t op = 0; op + 1 < target.size(); ++op) {
+        // A modulator's amplitude is its modulation index; one that isn't modulating adds no sidebands.
+        auto index = std::abs(amplitude[op]);
+        if (index > 0.0) {
+            frequency += (index + 1.0) * angleDelta[op] * radiansToHz;
+        }
+    }
+    return frequency;
+}
+
+void FMAlgorithm::renderNextBlock(float *output, int numSamples) {
+    if (target.empty() || maxBlockSize == 0) {
+        return;
+    }
+
+    while (numSamples > 0) {
+        auto blockSize = std::min(numSamples, maxBlockSize);
+
+        for (size_t op = 0; op < target.size(); ++op) {
+            std::fill_n(modulationBlocks.begin() + static_cast<long>(op) * maxBlockSize, blockSize, 0.f);
+        }
+
+        // An operator is silent for this block if its envelope has finished, or if whatever it modulates is silent;
+        // work down from the carrier so each operator's target is marked first.
+        for (auto op = target.size(); op-- > 0;) {
+            operatorIsSilent[op] = envelopeEnabled &&
+                                   (!envelopes[op].isActive() ||
+                                    (target[op] >= 0 && operatorIsSilent[static_cast<size_t>(target[op])]));
+        }
+
+        // One pass over the table; each operator's modulators have been rendered by the time it's reached.
+        for (size_t op = 0; op < target.size(); ++op) {
+            if (operatorIsSilent[op]) {
+                skipOperator(op, blockSize);
+                continue;
+            }
+
+            renderOperator(op, &modulationBlocks[op * static_cast<size_t>(maxBlockSize)], operatorBlock.data(),
+                           blockSize);
+
+            auto destination = target[op] < 0
+                               ? output
+                               : &modulationBlocks[static_cast<size_t>(target[op]) *
+                                                   static_cast<size_t>(maxBlockSize)];
+            juce::FloatVectorOperations::add(destination, operatorBlock.data(), blockSize);
+        }
+
+        output += blockSize;
+        numSamples -= blockSize;
+    }
+}
+
+void FMAlgorithm::renderOperator(size_t op, const float *modulation, float *output, int numSamples) {
+    // Compute the sine arguments into output...
+    switch (mode[op]) {
+        case FMOsc::LINEAR: {
+            for (auto n = 0; n < numSamples; ++n) {
+                output[n] = static_cast<float>(currentAngle[op] + n * angleDelta[op]) + modulation[n];
+            }
+            // Keep the phase small, so the float arguments stay precise.
+            currentAngle[op] = std::fmod(currentAngle[op] + numSamples * angleDelta[op],
+                                         juce::MathConstants<double>::twoPi);
+            break;
+        }
+        case FMOsc::EXPONENTIAL: {
+            // The phase is scaled here, so it can't be wrapped without changing the sound; reduce the scaled phase in
+            // double precision instead.
+            FastMath::exp2(modulation, output, numSamples);
+            for (auto n = 0; n < numSamples; ++n) {
+                auto angle = (currentAngle[op] + n * angleDelta[op]) * output[n];
+                angle -= juce::MathConstants<double>::twoPi *
+                         std::floor(angle * (1.0 / juce::MathConstants<double>::twoPi));
+                output[n] = static_cast<float>(angle);
+            }
+            currentAngle[op] += numSamples * angleDelta[op];
+            break;
+        }
+        default:
+            jassertfalse;
+    }
+
+    // ...then take the sine. Feedback makes each sample depend on the last, so can't be done a block at a time.
+    auto amp = static_cast<float>(amplitude[op]);
+    auto fb = static_cast<float>(feedback[op] * modulationAmount);
+    if (fb != 0.f) {
+        auto prev = static_cast<float>(prevSample[op]);
+        for (auto n = 0; n < numSamples; ++n) {
+            prev = amp * FastMath::sin(output[n] + fb * prev);
+            output[n] = prev;
+        }
+        prevSample[op] = prev;
+    } else {
+        FastMath::sin(output, output, numSamples);
+        juce::FloatVectorOperations::multiply(output, amp, numSamples);
+        prevSample[op] = output[numSamples - 1];
+    }
+
+    if (envelopeEnabled) {
+        envelopes[op].getNextBlock(envelopeBlock.data(), numSamples);
+        juce::FloatVectorOperations::multiply(output, envelopeBlock.data(), numSamples);
+    }
+}
+
+void FMAlgorithm::skipOperator(size_t op, int numSamples) {
+    // Keep the phase running, so the operator picks up where it would have been if its envelope restarts.
+    if (mode[op] == FMOsc::LINEAR) {
+        currentAngle[op] = std::fmod(currentAngle[op] + numSamples * angleDelta[op],
+                                     juce::MathConstants<double>::twoPi);
+    } else {
+        currentAngle[op] += numSamples * angleDelta[op];
+    }
+    prevSample[op] = 0.0;
+    // Advance the envelope too, in case it's only silent because its target is.
+    if (envelopes[op].isActive()) {
+        envelopes[op].getNextBlock(envelopeBlock.data(), numSamples);
+    }
+}
@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    FMAlgorithm.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FMOsc.h"
+#include "OADEnv.h"
+#include "FastMath.h"
+
+/**
+ * An FM patch compiled to a flat table of operators, a la DX7 algorithms.
+ *
+ * The operator tree described by FMOsc::Parameters is flattened so that every operator comes after all of its
+ * modulators, with the carrier last. Operator state is held in structure-of-arrays form, and a block is rendered in a
+ * single pass over the table: each operator renders from the modulation its modulators have summed into its slot, then
+ * adds its output to its own target's slot.
+ */
+class FMAlgorithm {
+public:
+    FMAlgorithm() = default;
+
+    FMAlgorithm(FMOsc::FMMode carrierMode,
+                const std::vector<FMOsc::Parameters> &modulatorParameters,
+                const OADEnv::Parameters &envParams);
+
+    void prepareToPlay(double sampleRate, int maximumBlockSize);
+
+    /**
+     * Change the rate the patch is rendered at without interrupting it, e.g. to oversample. Operator frequencies and
+     * envelope times are kept; so is the phase of every operator.
+     */
+    void setSampleRate(double newSampleRate);
+
+    void setupNote(double frequency, float noteAmplitude);
+
+    void setFrequency(double frequency);
+
+    void setModulationAmount(float newModulationAmount);
+
+    /**
+     * Set the amplitude envelope of the carrier, and of any modulators that weren't given their own.
+     * @param forceUpdateModulators Set the envelope of every modulator.
+     */
+    void setEnvelope(const OADEnv::Parameters &, bool forceUpdateModulators = false);
+
+    void enableEnvelope(bool shouldEnable);
+
+    void stopNote();
+
+    void reset();
+
+    bool isActive() const;
+
+    /**
+     * @return true if a note has been set up and not stopped.
+     */
+    bool isPlaying() const;
+
+    /**
+     * @return The current amplitude of the carrier, envelope included.
+     */
+    float getLevel() const;
+
+    int getNumOperators() const;
+
+    /**
+     * Estimate the highest frequency the patch is currently producing, in Hz, by Carson's rule: each modulator with
+     * modulation index I and frequency f spreads its target's spectrum by (I + 1) * f. Approximate for exponential FM
+     * and for modulators of modulators, but cheap enough to call every block.
+     */
+    double getUpperFrequency() const;
+
+    /**
+     * Add the next numSamples samples of the patch to output.
+     */
+    void renderNextBlock(float *output, int numSamples);
+
+private:
+    /**
+     * Append the operator described by params, and its modulators, in depth-first order; parents before children.
+     */
+    void addOperator(const FMOsc::Parameters &params, int target);
+
+    void appendOperator(FMOsc::FMMode operatorMode, int target);
+
+    /**
+     * Render numSamples samples of an operator, given the modulation summed into its slot, to output.
+     */
+    void renderOperator(size_t op, const float *modulation, float *output, int numSamples);
+
+    /**
+     * Advance an operator by numSamples without rendering it, for when it would contribute nothing to the output.
+     */
+    void skipOperator(size_t op, int numSamples);
+
+    int getCarrierIndex() const { return static_cast<int>(target.size()) - 1; }
+
+    //==============================================================================
+    // The patch. Operators are ordered so that each comes after all its modulators; the carrier is last.
+
+    // Index of the operator each operator modulates, or -1 for the carrier.
+    std::vector<int> target;
+    std::vector<FMOsc::FMMode> mode;
+    std::vector<FMOsc::ModulationMode> modMode;
+    std::vector<double> modulationFrequencyRatio;
+    std::vector<double> modulationFrequency;
+    std::vector<double> peakDeviation;
+    std::vector<double> feedback;
+    std::vector<char> envelopeIsSet;
+
+    //==============================================================================
+    // Operator state.
+
+    std::vector<double> currentAngle;
+    std::vector<double> angleDelta;
+    std::vector<double> amplitude;
+    std::vector<double> prevSample;
+    std::vector<OADEnv> envelopes;
+
+    double sampleRate{0.0};
+    bool envelopeEnabled{true};
+    // A scaling factor applied to peak deviation and feedback.
+    double modulationAmount{1.0};
+
+    //==============================================================================
+    // Scratch space for rendering, allocated in prepareToPlay. Operator n sums its modulation into
+    // modulationBlocks[n * maxBlockSize].
+    int maxBlockSize{0};
+    std::vector<float> modulationBlocks, operatorBlock, envelopeBlock;
+    // Operators being skipped for the current block.
+    std::vector<char> operatorIsSilent;
+};
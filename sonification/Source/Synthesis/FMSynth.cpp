@@ -1,62 +1,570 @@
-
 #include "FMSynth.h"
 
 #include <utility>
 
+FMSynth::FMSynth() :
+        modulationAmountParameter(controls.add(1.f, MODULATION_RAMP_MS)),
+        carrierFrequencyParameter(controls.add(0.f, CARRIER_FREQUENCY_RAMP_MS, ParameterStore::Ramp::Exponential)) {
+}
+
 FMSynth::~FMSynth() {
+    patchBuilder.removeAllJobs(true, -1);
+    delete pendingPool.exchange(nullptr);
+    deleteRetiredPools();
+}
+
+void FMSynth::setParameters(const Parameters &params) {
+    if (this->isPrepared) {
+        loadPatch(params);
+    } else {
+        this->patchParameters = params;
+    }
 }
 
-void FMSynth::setCarrier(FMOsc newCarrier) {
-    this->carrier = std::move(newCarrier);
+void FMSynth::loadPatch(const Parameters &params) {
+    deleteRetiredPools();
+
+    this->patchParameters = params;
+    patchBuilder.addJob([this, params, rate = sampleRate.load(), blockSize = maxBlockSize.load()] {
+        auto pool = createVoicePool(params, rate, blockSize);
+        // If the audio thread hasn't picked up the last patch yet, this one supersedes it.
+        delete pendingPool.exchange(pool.release());
+    });
 }
 
-void FMSynth::prepareToPlay(double sampleRate, int samplesPerBlock, int numOutputChannels) {
-    juce::dsp::ProcessSpec spec{sampleRate, static_cast<uint32>(samplesPerBlock), static_cast<uint32>(numOutputChannels)};
+void FMSynth::prepareToPlay(double newSampleRate, int samplesPerBlock, int numOutputChannels) {
+    juce::ignoreUnused(numOutputChannels);
+
+    // The audio thread isn't running, so pools can be replaced directly.
+    patchBuilder.removeAllJobs(true, -1);
+    delete pendingPool.exchange(nullptr);
+    deleteRetiredPools();
+
+    this->sampleRate = newSampleRate;
+    this->maxBlockSize = samplesPerBlock;
+    this->buffer.assign(static_cast<size_t>(samplesPerBlock), 0.f);
+    this->fadeBuffer.assign(static_cast<size_t>(samplesPerBlock), 0.f);
+    this->crossfadeLength = std::max(1, juce::roundToInt(PATCH_CROSSFADE_MS * .001 * newSampleRate));
+    this->crossfadeRemaining = 0;
+    controls.prepareToPlay(newSampleRate);
+    this->carrierFrequencyIsSet = false;
+
+    auto oversampledBlockSize = std::min(samplesPerBlock, CONTROL_INTERVAL) * MAX_OVERSAMPLING_FACTOR;
+    this->oversampledBuffer.assign(static_cast<size_t>(oversampledBlockSize), 0.f);
+    this->oversampledFadeBuffer.assign(static_cast<size_t>(oversampledBlockSize), 0.f);
+    this->oversamplingMixStep = 1.f / std::max(1.f, static_cast<float>(OVERSAMPLING_FADE_MS * .001 * newSampleRate));
+    this->oversamplingFactor = 1;
+    this->oversamplingFactorInUse = 1;
+    this->oversamplingMix = 0.f;
+    this->oversamplingMixTarget = 0.f;
 
-    this->carrier.prepareToPlay(spec);
+    this->currentPool = createVoicePool(this->patchParameters, newSampleRate, samplesPerBlock);
+    this->fadingPool.reset();
+    applySettings(*this->currentPool, true);
 
     this->isPrepared = true;
 }
 
+std::unique_ptr<FMSynth::VoicePool>
+FMSynth::createVoicePool(const Parameters &params, double rate, int blockSize) const {
+    auto pool = std::make_unique<VoicePool>();
+    pool->sampleRate = rate;
+    pool->maxBlockSize = blockSize;
+
+    pool->patch = FMAlgorithm(params.carrierMode, params.modulatorParameters, params.envParams);
+    pool->patch.prepareToPlay(rate, blockSize);
+
+    // Everything a note-on needs is allocated here, so starting one never allocates.
+    pool->voices.assign(NUM_VOICES, Voice{pool->patch});
+    pool->activeVoices.reserve(NUM_VOICES);
+
+    return pool;
+}
+
 void FMSynth::renderNextBlock(juce::AudioBuffer<float> &outputBuffer, int startSample, int numSamples) {
     jassert(this->isPrepared);
 
-    // Prevent discontinuities by writing to a temp buffer...
-    this->buffer.setSize(outputBuffer.getNumChannels(), numSamples, false, false, true);
-    this->buffer.clear();
+    if (this->currentPool == nullptr) {
+        return;
+    }
+
+    swapInPendingPool();
+
+    auto applyEnvelope = envelopeChanged.exchange(false);
+    applySettings(*this->currentPool, applyEnvelope);
+    if (this->fadingPool != nullptr) {
+        applySettings(*this->fadingPool, applyEnvelope);
+    }
+
+    if (carrierFrequencyChanged.exchange(false)) {
+        this->carrierFrequencyIsSet = true;
+    }
+
+    // A note started in the same block takes precedence over a carrier frequency change.
+    handleNoteEvents();
+
+    // Oversample while the voices would otherwise alias.
+    auto wantedOversamplingFactor = chooseOversamplingFactor(getUpperFrequency());
+
+    auto blockSizeLimit = static_cast<int>(this->buffer.size());
+    while (numSamples > 0 && blockSizeLimit > 0) {
+        auto blockSize = std::min({numSamples, blockSizeLimit, CONTROL_INTERVAL});
+        updateControls(blockSize);
+        updateOversampling(wantedOversamplingFactor);
 
-    this->carrier.computeNextBlock(this->buffer, 0, this->buffer.getNumSamples());
+        auto factor = this->oversamplingFactor;
+        auto renderSize = blockSize * factor;
+        auto *rendered = factor > 1 ? this->oversampledBuffer.data() : this->buffer.data();
 
-    for (int channel = 0; channel < outputBuffer.getNumChannels(); ++channel) {
-        outputBuffer.addFrom(channel, startSample, this->buffer, channel, 0, numSamples);
+        std::fill_n(rendered, renderSize, 0.f);
+        renderVoices(*this->currentPool, rendered, renderSize);
 
-        if (!carrier.isActive()) {
-            carrier.reset();
+        if (this->fadingPool != nullptr) {
+            auto *fadeRendered = factor > 1 ? this->oversampledFadeBuffer.data() : this->fadeBuffer.data();
+            std::fill_n(fadeRendered, renderSize, 0.f);
+            renderVoices(*this->fadingPool, fadeRendered, renderSize);
+
+            // Linear crossfade from the old patch to the new, stepped at the device rate.
+            auto step = 1.f / static_cast<float>(this->crossfadeLength);
+            for (auto n = 0; n < blockSize; ++n) {
+                auto fadeIn = std::max(0, this->crossfadeLength - this->crossfadeRemaining);
+                auto gainIn = std::min(1.f, static_cast<float>(fadeIn) * step);
+                for (auto i = n * factor; i < (n + 1) * factor; ++i) {
+                    rendered[i] = gainIn * rendered[i] + (1.f - gainIn) * fadeRendered[i];
+                }
+                this->crossfadeRemaining = std::max(0, this->crossfadeRemaining - 1);
+            }
+
+            if (this->crossfadeRemaining == 0) {
+                retire(std::move(this->fadingPool));
+            }
+        }
+
+        if (factor > 1) {
+            decimate(rendered, this->buffer.data(), blockSize);
+        }
+
+        for (int channel = 0; channel < outputBuffer.getNumChannels(); ++channel) {
+            outputBuffer.addFrom(channel, startSample, this->buffer.data(), blockSize);
+        }
+
+        startSample += blockSize;
+        numSamples -= blockSize;
+    }
+
+    releaseFinishedVoices(*this->currentPool);
+    if (this->fadingPool != nullptr) {
+        releaseFinishedVoices(*this->fadingPool);
+    }
+}
+
+void FMSynth::swapInPendingPool() {
+    auto *incoming = pendingPool.exchange(nullptr);
+    if (incoming == nullptr) {
+        return;
+    }
+
+    std::unique_ptr<VoicePool> pool{incoming};
+    // A patch built for a previous device setup is no use.
+    if (pool->sampleRate != this->currentPool->sampleRate || pool->maxBlockSize != this->currentPool->maxBlockSize) {
+        retire(std::move(pool));
+        return;
+    }
+
+    applySettings(*pool, true);
+    setPoolOversamplingFactor(*pool, this->oversamplingFactor);
+
+    // Notes without an envelope would otherwise fall silent; carry them over to the new patch.
+    if (!envelopeEnabled.load()) {
+        for (auto v: this->currentPool->activeVoices) {
+            auto &voice = this->currentPool->voices[static_cast<size_t>(v)];
+            startVoice(*pool, {NoteEvent::Type::Start, voice.frequency, voice.amplitude, voice.tag});
+        }
+    }
+
+    // If a crossfade is already in progress, cut it short.
+    if (this->fadingPool != nullptr) {
+        retire(std::move(this->fadingPool));
+    }
+    this->fadingPool = std::move(this->currentPool);
+    this->currentPool = std::move(pool);
+    this->crossfadeRemaining = this->crossfadeLength;
+}
+
+void FMSynth::applySettings(VoicePool &pool, bool applyEnvelope) {
+    auto amount = controls.getCurrent(modulationAmountParameter);
+    auto enabled = envelopeEnabled.load();
+    OADEnv::Parameters envParams{envelopeOnset.load(), envelopeAttack.load(), envelopeDecay.load(),
+                                 envelopeAttackCurve.load(), envelopeDecayCurve.load()};
+    applyEnvelope = applyEnvelope && envelopeIsSet.load();
+
+    pool.patch.setModulationAmount(amount);
+    pool.patch.enableEnvelope(enabled);
+    if (applyEnvelope) {
+        pool.patch.setEnvelope(envParams, true);
+    }
+
+    for (auto &voice: pool.voices) {
+        voice.algorithm.setModulationAmount(amount);
+        voice.algorithm.enableEnvelope(enabled);
+        if (applyEnvelope) {
+            voice.algorithm.setEnvelope(envParams, true);
+        }
+    }
+}
+
+void FMSynth::updateControls(int numSamples) {
+    auto previousAmount = controls.getCurrent(modulationAmountParameter);
+    auto amount = controls.skip(modulationAmountParameter, numSamples);
+    auto amountChanged = amount != previousAmount;
+
+    // Until the carrier frequency is set, notes keep the frequency they were started with.
+    auto frequencyChanged{false};
+    auto frequency{0.f};
+    if (this->carrierFrequencyIsSet) {
+        auto previousFrequency = controls.getCurrent(carrierFrequencyParameter);
+        frequency = controls.skip(carrierFrequencyParameter, numSamples);
+        frequencyChanged = frequency != previousFrequency;
+    }
+    // Modulator amplitudes depend on the modulation amount, but are only recalculated along with the frequency.
+    auto applyFrequency = this->carrierFrequencyIsSet && (frequencyChanged || amountChanged);
+
+    if (!amountChanged && !applyFrequency) {
+        return;
+    }
+
+    for (auto *pool: {currentPool.get(), fadingPool.get()}) {
+        if (pool == nullptr) {
+            continue;
+        }
+        pool->patch.setModulationAmount(amount);
+        for (auto &voice: pool->voices) {
+            voice.algorithm.setModulationAmount(amount);
+            if (applyFrequency && voice.isActive) {
+                voice.algorithm.setFrequency(frequency);
+                voice.frequency = frequency;
+            }
+        }
+    }
+}
+
+void FMSynth::renderVoices(VoicePool &pool, float *output, int numSamples) {
+    for (auto v: pool.activeVoices) {
+        pool.voices[static_cast<size_t>(v)].algorithm.renderNextBlock(output, numSamples);
+    }
+}
+
+double FMSynth::getUpperFrequency() const {
+    auto frequency = 0.0;
+    for (auto *pool: {currentPool.get(), fadingPool.get()}) {
+        if (pool == nullptr) {
+            continue;
+        }
+        for (auto v: pool->activeVoices) {
+            frequency = std::max(frequency, pool->voices[static_cast<size_t>(v)].algorithm.getUpperFrequency());
+        }
+    }
+    return frequency;
+}
+
+int FMSynth::chooseOversamplingFactor(double upperFrequency) const {
+    auto rate = this->sampleRate.load();
+    auto maxFactor = maxOversamplingFactor.load();
+
+    for (auto factor = 1; factor < maxFactor; factor *= 2) {
+        // Anything above the oversampled Nyquist frequency folds back down; it's safe as long as it lands above the
+        // decimation filters' passband.
+        auto limit = (factor - 1 + ALIASING_LIMIT) * rate;
+        if (factor < this->oversamplingFactor) {
+            limit *= OVERSAMPLING_HYSTERESIS;
+        }
+        if (upperFrequency < limit) {
+            return factor;
         }
     }
+    return maxFactor;
+}
+
+void FMSynth::updateOversampling(int wantedFactor) {
+    if (wantedFactor != this->oversamplingFactor) {
+        if (this->oversamplingMix > 0.f) {
+            this->oversamplingMixTarget = 0.f;
+            return;
+        }
+        setOversamplingFactor(wantedFactor);
+    }
+    this->oversamplingMixTarget = this->oversamplingFactor > 1 ? 1.f : 0.f;
+}
+
+void FMSynth::setOversamplingFactor(int factor) {
+    this->oversamplingFactor = factor;
+    this->oversamplingFactorInUse = factor;
+    for (auto *pool: {currentPool.get(), fadingPool.get()}) {
+        if (pool != nullptr) {
+            setPoolOversamplingFactor(*pool, factor);
+        }
+    }
+    for (auto &decimator: this->decimators) {
+        decimator.reset();
+    }
+    this->oversamplingMix = 0.f;
+}
+
+void FMSynth::setPoolOversamplingFactor(VoicePool &pool, int factor) const {
+    auto rate = pool.sampleRate * factor;
+    pool.patch.setSampleRate(rate);
+    for (auto &voice: pool.voices) {
+        voice.algorithm.setSampleRate(rate);
+    }
+}
+
+void FMSynth::decimate(float *input, float *output, int numSamples) {
+    auto factor = this->oversamplingFactor;
+
+    // Every factor-th sample is exactly what rendering at the device rate would have given; fade from or to that.
+    for (auto n = 0; n < numSamples; ++n) {
+        output[n] = input[n * factor];
+    }
+
+    // Filter in place, halving the rate at each stage.
+    auto filtered = input;
+    for (auto stage = 0, length = numSamples * factor; length > numSamples; ++stage, length /= 2) {
+        decimators[static_cast<size_t>(stage)].process(filtered, filtered, length / 2);
+    }
+
+    for (auto n = 0; n < numSamples; ++n) {
+        if (this->oversamplingMix < this->oversamplingMixTarget) {
+            this->oversamplingMix = std::min(this->oversamplingMixTarget,
+                                             this->oversamplingMix + this->oversamplingMixStep);
+        } else if (this->oversamplingMix > this->oversamplingMixTarget) {
+            this->oversamplingMix = std::max(this->oversamplingMixTarget,
+                                             this->oversamplingMix - this->oversamplingMixStep);
+        }
+        output[n] += this->oversamplingMix * (filtered[n] - output[n]);
+    }
+}
+
+void FMSynth::releaseFinishedVoices(VoicePool &pool) {
+    auto end = std::remove_if(pool.activeVoices.begin(), pool.activeVoices.end(), [&pool](int v) {
+        auto &voice = pool.voices[static_cast<size_t>(v)];
+        if (voice.algorithm.isPlaying() && voice.algorithm.isActive()) {
+            return false;
+        }
+        voice.algorithm.reset();
+        voice.isActive = false;
+        return true;
+    });
+    pool.activeVoices.erase(end, pool.activeVoices.end());
+}
+
+void FMSynth::retire(std::unique_ptr<VoicePool> pool) {
+    int start1, size1, start2, size2;
+    retiredQueue.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 == 0) {
+        // Every loadPatch() empties the queue, so it can only fill if patches are swapped in faster than they can be
+        // loaded. Better to leak than to free on the audio thread.
+        jassertfalse;
+        pool.release();
+        return;
+    }
+    retiredPools[static_cast<size_t>(size1 > 0 ? start1 : start2)] = pool.release();
+    retiredQueue.finishedWrite(1);
+}
+
+void FMSynth::deleteRetiredPools() {
+    int start1, size1, start2, size2;
+    retiredQueue.prepareToRead(retiredQueue.getNumReady(), start1, size1, start2, size2);
+    for (auto i = 0; i < size1; ++i) {
+        delete retiredPools[static_cast<size_t>(start1 + i)];
+    }
+    for (auto i = 0; i < size2; ++i) {
+        delete retiredPools[static_cast<size_t>(start2 + i)];
+    }
+    retiredQueue.finishedRead(size1 + size2);
 }
 
 void FMSynth::setModulationAmount(float newModAmount) {
-    carrier.setModulationAmount(newModAmount);
+    controls.set(modulationAmountParameter, newModAmount);
 }
 
-void FMSynth::startNote(float freq, float amplitude) {
-    carrier.setupNote(freq, amplitude);
+void FMSynth::startNote(float freq, float amplitude, int tag) {
+    pushNoteEvent({NoteEvent::Type::Start, freq, amplitude, tag});
 }
 
 void FMSynth::stopPlaying() {
-    carrier.stopNote();
-    carrier.reset();
+    pushNoteEvent({NoteEvent::Type::StopAll, 0.f, 0.f, NO_TAG});
 }
 
 void FMSynth::setCarrierFrequency(float frequency) {
-    carrier.setFrequency(frequency);
+    controls.set(carrierFrequencyParameter, frequency);
+    carrierFrequencyChanged = true;
 }
 
 void FMSynth::setEnvelope(OADEnv::Parameters envParams) {
-    carrier.setEnvelope(envParams, true);
+    // Called for every IMU sample; only have the voices recalculate their envelopes when something has changed.
+    if (envelopeIsSet &&
+        envelopeOnset == envParams.onset &&
+        envelopeAttack == envParams.attack &&
+        envelopeDecay == envParams.decay &&
+        envelopeAttackCurve == envParams.attackCurve &&
+        envelopeDecayCurve == envParams.decayCurve) {
+        return;
+    }
+
+    envelopeOnset = envParams.onset;
+    envelopeAttack = envParams.attack;
+    envelopeDecay = envParams.decay;
+    envelopeAttackCurve = envParams.attackCurve;
+    envelopeDecayCurve = envParams.decayCurve;
+    envelopeIsSet = true;
+    envelopeChanged = true;
 }
 
 void FMSynth::enableEnvelope(bool shouldEnable) {
-    carrier.enableEnvelope(shouldEnable);
+    envelopeEnabled = shouldEnable;
+}
+
+void FMSynth::setMaxOversamplingFactor(int maxFactor) {
+    auto factor = 1;
+    while (factor * 2 <= std::min(maxFactor, MAX_OVERSAMPLING_FACTOR)) {
+        factor *= 2;
+    }
+    maxOversamplingFactor = factor;
+}
+
+int FMSynth::getOversamplingFactor() const {
+    return oversamplingFactorInUse.load();
+}
+
+void FMSynth::setVoiceStealing(VoiceStealing newVoiceStealing) {
+    voiceStealing = newVoiceStealing;
+}
+
+void FMSynth::setMaxVoicesPerTag(int maxVoices) {
+    maxVoicesPerTag = std::max(maxVoices, 0);
+}
+
+int FMSynth::getNumActiveVoices() const {
+    return currentPool != nullptr ? static_cast<int>(currentPool->activeVoices.size()) : 0;
+}
+
+void FMSynth::pushNoteEvent(const FMSynth::NoteEvent &event) {
+#if JUCE_DEBUG
+    // Notes queued from two threads at once; see startNote().
+    jassert(!isQueueingNote.exchange(true));
+    const juce::ScopeGuard doneQueueing{[this] { isQueueingNote = false; }};
+#endif
+
+    int start1, size1, start2, size2;
+    noteQueue.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 > 0) {
+        noteEvents[static_cast<size_t>(start1)] = event;
+    } else if (size2 > 0) {
+        noteEvents[static_cast<size_t>(start2)] = event;
+    }
+    // If the queue is full the event is dropped, rather than waiting for the audio thread.
+    noteQueue.finishedWrite(size1 + size2);
+}
+
+void FMSynth::handleNoteEvents() {
+    int start1, size1, start2, size2;
+    noteQueue.prepareToRead(noteQueue.getNumReady(), start1, size1, start2, size2);
+
+    auto handle = [this](const NoteEvent &event) {
+        switch (event.type) {
+            case NoteEvent::Type::Start:
+                startVoice(*currentPool, event);
+                // Carrier frequency changes ramp from the new note's frequency.
+                controls.snapTo(carrierFrequencyParameter, event.frequency);
+                carrierFrequencyIsSet = false;
+                break;
+            case NoteEvent::Type::StopAll:
+                for (auto *pool: {currentPool.get(), fadingPool.get()}) {
+                    if (pool == nullptr) {
+                        continue;
+                    }
+                    for (auto v: pool->activeVoices) {
+                        auto &voice = pool->voices[static_cast<size_t>(v)];
+                        voice.algorithm.stopNote();
+                        voice.algorithm.reset();
+                        voice.isActive = false;
+                    }
+                    pool->activeVoices.clear();
+                }
+                break;
+        }
+    };
+
+    for (auto i = 0; i < size1; ++i) {
+        handle(noteEvents[static_cast<size_t>(start1 + i)]);
+    }
+    for (auto i = 0; i < size2; ++i) {
+        handle(noteEvents[static_cast<size_t>(start2 + i)]);
+    }
+
+    noteQueue.finishedRead(size1 + size2);
+}
+
+void FMSynth::startVoice(VoicePool &pool, const FMSynth::NoteEvent &event) {
+    if (pool.voices.empty()) {
+        return;
+    }
+
+    auto v = allocateVoice(pool, event.tag);
+    auto &voice = pool.voices[static_cast<size_t>(v)];
+
+    voice.algorithm.setupNote(event.frequency, event.amplitude);
+    voice.tag = event.tag;
+    voice.frequency = event.frequency;
+    voice.amplitude = event.amplitude;
+    voice.startedAt = ++numNotesStarted;
+
+    if (!voice.isActive) {
+        voice.isActive = true;
+        // Capacity for every voice was reserved when the pool was created.
+        pool.activeVoices.push_back(v);
+    }
+}
+
+int FMSynth::allocateVoice(VoicePool &pool, int tag) {
+    // Re-use the oldest voice with this tag if the tag already has as many as it's allowed.
+    auto maxForTag = maxVoicesPerTag.load();
+    if (tag != NO_TAG && maxForTag > 0) {
+        auto numWithTag{0}, oldestWithTag{-1};
+        for (auto v: pool.activeVoices) {
+            auto &voice = pool.voices[static_cast<size_t>(v)];
+            if (voice.tag == tag) {
+                ++numWithTag;
+                if (oldestWithTag < 0 ||
+                    voice.startedAt < pool.voices[static_cast<size_t>(oldestWithTag)].startedAt) {
+                    oldestWithTag = v;
+                }
+            }
+        }
+        if (numWithTag >= maxForTag) {
+            return oldestWithTag;
+        }
+    }
+
+    // Otherwise a free voice...
+    for (size_t v = 0; v < pool.voices.size(); ++v) {
+        if (!pool.voices[v].isActive) {
+            return static_cast<int>(v);
+        }
+    }
+
+    // ...or steal one.
+    auto stealing = voiceStealing.load();
+    auto stolen = pool.activeVoices.front();
+    for (auto v: pool.activeVoices) {
+        auto &voice = pool.voices[static_cast<size_t>(v)];
+        auto &candidate = pool.voices[static_cast<size_t>(stolen)];
+        auto isBetter = stealing == VoiceStealing::Oldest
+                        ? voice.startedAt < candidate.startedAt
+                        : voice.algorithm.getLevel() < candidate.algorithm.getLevel();
+        if (isBetter) {
+            stolen = v;
+        }
+    }
+    return stolen;
 }
@@ -11,9 +11,14 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <array>
+#include <atomic>
 #include <utility>
 #include "FMOsc.h"
 #include "OADEnv.h"
+#include "FMAlgorithm.h"
+#include "../Processing/ParameterStore.h"
+#include "../Processing/HalfBandDecimator.h"
 
 class FMSynth {
 public:
@@ -33,31 +38,262 @@ public:
         OADEnv::Parameters envParams;
     };
 
+    /**
+     * How to choose a voice to steal when all are sounding.
+     */
+    enum class VoiceStealing {
+        Oldest,
+        Quietest
+    };
+
+    // The number of voices in the pool.
+    static constexpr int NUM_VOICES{8};
+    // Tag for notes that don't belong to any group.
+    static constexpr int NO_TAG{-1};
+    // Length of the crossfade from one patch to the next.
+    static constexpr double PATCH_CROSSFADE_MS{30.0};
+    // Ramp times for changes to the modulation amount and carrier frequency.
+    static constexpr double MODULATION_RAMP_MS{20.0};
+    static constexpr double CARRIER_FREQUENCY_RAMP_MS{10.0};
+    // Ramping parameters are applied to the voices this often, in samples.
+    static constexpr int CONTROL_INTERVAL{32};
+    // Oversampling: at most 4x; the fraction of the (oversampled) Nyquist frequency the patch may reach before
+    // aliasing into the audible band; how much further it must drop before the factor is reduced again; and how long
+    // the output takes to fade between the filtered and unfiltered signals when the factor changes.
+    static constexpr int MAX_OVERSAMPLING_FACTOR{4};
+    static constexpr double ALIASING_LIMIT{.45};
+    static constexpr double OVERSAMPLING_HYSTERESIS{.8};
+    static constexpr double OVERSAMPLING_FADE_MS{5.0};
+
+    FMSynth();
+
     ~FMSynth();
 
-    void setCarrier(FMOsc newCarrier);
+    /**
+     * Set the patch the synth is prepared with. If the synth has already been prepared, the patch is swapped in as by
+     * loadPatch().
+     */
+    void setParameters(const Parameters &params);
+
+    /**
+     * Compile and prepare a patch on a background thread, then crossfade to it from the audio thread. Call from the
+     * message thread.
+     */
+    void loadPatch(const Parameters &params);
 
+    /**
+     * Allocate the voice pool for the current patch.
+     */
     void prepareToPlay(double sampleRate, int samplesPerBlock, int numOutputChannels);
 
-    void startNote(float freq, float amplitude);
+    /**
+     * Queue a note to be started at the beginning of the next block. Never blocks or allocates.
+     * Notes may be queued from one thread at a time. Queueing can move from one thread to another, provided the first
+     * has finished before the second starts, e.g. when a timer thread is stopped.
+     * @param tag Group the note belongs to, e.g. the foot that triggered it; see setMaxVoicesPerTag().
+     */
+    void startNote(float freq, float amplitude, int tag = NO_TAG);
 
     void renderNextBlock(juce::AudioBuffer<float> &outputBuffer, int startSample, int numSamples);
 
-    void setModulationAmount(float newModAmount);
-
+    /**
+     * Queue all voices to be stopped at the beginning of the next block.
+     */
     void stopPlaying();
 
+    // The following may be called from any thread; they take effect at the beginning of the next block. Modulation
+    // amount and carrier frequency changes are ramped.
+
+    void setModulationAmount(float newModAmount);
+
     void setCarrierFrequency(float frequency);
 
     void setEnvelope(OADEnv::Parameters envParams);
 
     void enableEnvelope(bool shouldEnable);
 
+    void setVoiceStealing(VoiceStealing newVoiceStealing);
+
+    /**
+     * Limit the number of voices a tag can have sounding at once; a note beyond the limit takes over the oldest voice
+     * with the same tag. 0 for no limit.
+     */
+    void setMaxVoicesPerTag(int maxVoices);
+
+    int getNumActiveVoices() const;
+
+    /**
+     * Limit oversampling, e.g. to save CPU; 1 to disable it. Rounded down to a power of two. May be called from any
+     * thread.
+     */
+    void setMaxOversamplingFactor(int maxFactor);
+
+    /**
+     * @return The factor the voices were oversampled by in the last block, 1 if they weren't.
+     */
+    int getOversamplingFactor() const;
+
 protected:
-    FMOsc carrier;
+    struct Voice {
+        FMAlgorithm algorithm;
+        int tag{NO_TAG};
+        // When the voice's note was started, in notes.
+        juce::uint64 startedAt{0};
+        float frequency{0.f};
+        float amplitude{0.f};
+        bool isActive{false};
+    };
+
+    /**
+     * A prepared patch and the voices playing it.
+     */
+    struct VoicePool {
+        FMAlgorithm patch;
+        std::vector<Voice> voices;
+        // Indices of the sounding voices; only these are rendered.
+        std::vector<int> activeVoices;
+        double sampleRate{0.0};
+        int maxBlockSize{0};
+    };
+
+    std::unique_ptr<VoicePool> createVoicePool(const Parameters &params, double sampleRate, int maxBlockSize) const;
+
+    // The pool being played, and the one being faded out after a patch change. Owned by the audio thread.
+    std::unique_ptr<VoicePool> currentPool, fadingPool;
 
     bool isPrepared{false};
 
 private:
-    juce::AudioBuffer<float> buffer;
+    static constexpr int NOTE_QUEUE_SIZE{64};
+    static constexpr int RETIRED_QUEUE_SIZE{16};
+
+    struct NoteEvent {
+        enum class Type {
+            Start,
+            StopAll
+        };
+
+        Type type;
+        float frequency;
+        float amplitude;
+        int tag;
+    };
+
+    void pushNoteEvent(const NoteEvent &event);
+
+    /**
+     * Start and stop the notes queued since the last block.
+     */
+    void handleNoteEvents();
+
+    /**
+     * Swap in a patch published by loadPatch(), if there is one, and start fading out the current one.
+     */
+    void swapInPendingPool();
+
+    /**
+     * Apply settings set from other threads to a pool's voices.
+     */
+    void applySettings(VoicePool &pool, bool applyEnvelope);
+
+    /**
+     * Advance the modulation amount and carrier frequency ramps, and apply them to the voices.
+     */
+    void updateControls(int numSamples);
+
+    void startVoice(VoicePool &pool, const NoteEvent &event);
+
+    /**
+     * Find a voice for a new note: the oldest with the same tag if the tag is at its limit, else a free voice, else
+     * one stolen according to voiceStealing.
+     */
+    int allocateVoice(VoicePool &pool, int tag);
+
+    void renderVoices(VoicePool &pool, float *output, int numSamples);
+
+    /**
+     * @return The highest frequency any sounding voice is producing, by FMAlgorithm::getUpperFrequency().
+     */
+    double getUpperFrequency() const;
+
+    /**
+     * @return The lowest oversampling factor at which a patch producing frequencies up to upperFrequency won't alias.
+     */
+    int chooseOversamplingFactor(double upperFrequency) const;
+
+    /**
+     * Move towards the wanted oversampling factor. The filtered signal is faded out before the factor changes, and in
+     * after, so that the switch happens between unfiltered signals, which match at any factor.
+     */
+    void updateOversampling(int wantedFactor);
+
+    void setOversamplingFactor(int factor);
+
+    /**
+     * Render a pool at the device rate times factor, keeping its voices' phases.
+     */
+    void setPoolOversamplingFactor(VoicePool &pool, int factor) const;
+
+    /**
+     * Decimate numSamples * oversamplingFactor samples of input to output. Overwrites input.
+     */
+    void decimate(float *input, float *output, int numSamples);
+
+    void releaseFinishedVoices(VoicePool &pool);
+
+    /**
+     * Hand a pool to the message thread for deletion.
+     */
+    void retire(std::unique_ptr<VoicePool> pool);
+
+    /**
+     * Delete pools retired by the audio thread.
+     */
+    void deleteRetiredPools();
+
+    Parameters patchParameters;
+    juce::ThreadPool patchBuilder{1};
+    // Published by the patch builder, picked up by the audio thread.
+    std::atomic<VoicePool *> pendingPool{nullptr};
+
+    juce::AbstractFifo retiredQueue{RETIRED_QUEUE_SIZE};
+    std::array<VoicePool *, RETIRED_QUEUE_SIZE> retiredPools{};
+
+    juce::uint64 numNotesStarted{0};
+
+    juce::AbstractFifo noteQueue{NOTE_QUEUE_SIZE};
+    std::array<NoteEvent, NOTE_QUEUE_SIZE> noteEvents{};
+#if JUCE_DEBUG
+    // Catches two threads queueing notes at once.
+    std::atomic<bool> isQueueingNote{false};
+#endif
+
+    std::atomic<VoiceStealing> voiceStealing{VoiceStealing::Oldest};
+    std::atomic<int> maxVoicesPerTag{0};
+
+    ParameterStore controls;
+    int modulationAmountParameter, carrierFrequencyParameter;
+    std::atomic<bool> envelopeEnabled{true};
+    std::atomic<float> envelopeOnset{0.f}, envelopeAttack{.1f}, envelopeDecay{.1f};
+    std::atomic<OADEnv::Curve> envelopeAttackCurve{OADEnv::Curve::Linear}, envelopeDecayCurve{OADEnv::Curve::Linear};
+    // Whether setEnvelope() has overridden the patch's envelope, and whether it has since the last block.
+    std::atomic<bool> envelopeIsSet{false}, envelopeChanged{false};
+    // Whether setCarrierFrequency() has been called since the last block, and since the last note was started.
+    std::atomic<bool> carrierFrequencyChanged{false};
+    bool carrierFrequencyIsSet{false};
+
+    std::atomic<double> sampleRate{0.0};
+    std::atomic<int> maxBlockSize{0};
+    int crossfadeLength{0};
+    int crossfadeRemaining{0};
+    // Render buffers, allocated in prepareToPlay.
+    std::vector<float> buffer, fadeBuffer, oversampledBuffer, oversampledFadeBuffer;
+
+    std::atomic<int> maxOversamplingFactor{MAX_OVERSAMPLING_FACTOR};
+    std::atomic<int> oversamplingFactorInUse{1};
+    int oversamplingFactor{1};
+    // One half-band stage per halving of the rate.
+    std::array<HalfBandDecimator, 2> decimators;
+    // How much of the filtered, rather than the unfiltered, decimated signal to output; ramps towards its target.
+    float oversamplingMix{0.f}, oversamplingMixTarget{0.f}, oversamplingMixStep{0.f};
 };
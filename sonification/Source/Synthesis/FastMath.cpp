@@ -0,0 +1,24 @@
+/*
+  ==============================================================================
+
+    FastMath.cpp
+
+  ==============================================================================
+*/
+
+#include "FastMath.h"
+
+void FastMath::sin(const float *in, float *out, int numSamples) noexcept {
+    for (auto n = 0; n < numSamples; ++n) {
+        out[n] = sin(in[n]);
+    }
+}
+
+void FastMath::exp2(const float *in, float *out, int numSamples) noexcept {
+    for (auto n = 0; n < numSamples; ++n) {
+        out[n] = std::min(std::max(in[n], -126.f), 127.f);
+    }
+    for (auto n = 0; n < numSamples; ++n) {
+        out[n] = exp2InRange(out[n]);
+    }
+}
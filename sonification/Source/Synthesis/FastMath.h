@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    FastMath.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Polynomial approximations of sin and 2^x for the synth's inner loops.
+ *
+ * Both are branchless, so the block versions vectorise. Absolute error of sin is < 1e-6 for |x| < 10, growing with |x|
+ * as the argument itself loses precision, so keep phases wrapped. Relative error of exp2 is < 3e-7 over [-126, 127].
+ */
+class FastMath {
+public:
+    static float sin(float x) noexcept {
+        // Reduce to u in [-1, 1), where x = pi * u, then fold into [-.5, .5] using sin(pi - a) = sin(a).
+        auto u = x * INV_PI;
+        u -= 2.f * static_cast<float>(roundToInt(u * .5f));
+        auto a = .5f - std::abs(.5f - std::abs(u));
+        auto a2 = a * a;
+        auto s = a * (S1 + a2 * (S3 + a2 * (S5 + a2 * (S7 + a2 * (S9 + a2 * S11)))));
+        return u < 0.f ? -s : s;
+    }
+
+    static float exp2(float x) noexcept {
+        return exp2InRange(std::min(std::max(x, -126.f), 127.f));
+    }
+
+    /**
+     * out[n] = sin(in[n]); in and out may be the same.
+     */
+    static void sin(const float *in, float *out, int numSamples) noexcept;
+
+    /**
+     * out[n] = 2^in[n]; in and out may be the same.
+     */
+    static void exp2(const float *in, float *out, int numSamples) noexcept;
+
+private:
+    /**
+     * Round half away from zero. Unlike std::nearbyint, vectorises without fast-math flags.
+     */
+    static std::int32_t roundToInt(float x) noexcept {
+        return static_cast<std::int32_t>(x + (x < 0.f ? -.5f : .5f));
+    }
+
+    /**
+     * 2^x for x in [-126, 127]. Clamping is left to the caller, as GCC won't vectorise a loop that clamps x and then
+     * converts it to an integer.
+     */
+    static float exp2InRange(float x) noexcept {
+        auto i = roundToInt(x);
+        auto f = x - static_cast<float>(i);
+        auto p = 1.f + f * (E1 + f * (E2 + f * (E3 + f * (E4 + f * (E5 + f * E6)))));
+        // Scale by 2^i by adding i to the exponent.
+        std::int32_t bits;
+        std::memcpy(&bits, &p, sizeof(bits));
+        bits += i << 23;
+        std::memcpy(&p, &bits, sizeof(bits));
+        return p;
+    }
+
+    static constexpr float INV_PI{0.318309886183790671538f};
+    // Taylor coefficients of sin(pi * a), |a| <= .5.
+    static constexpr float S1{3.14159265358979323846f};
+    static constexpr float S3{-5.16771278004997002925f};
+    static constexpr float S5{2.55016403987734544240f};
+    static constexpr float S7{-0.59926452932079207688f};
+    static constexpr float S9{0.08214588661112822880f};
+    static constexpr float S11{-0.00737043094571435037f};
+    // Taylor coefficients of 2^f, |f| <= .5.
+    static constexpr float E1{0.693147180559945309417f};
+    static constexpr float E2{0.240226506959100712333f};
+    static constexpr float E3{0.0555041086648215799532f};
+    static constexpr float E4{0.00961812910762847716197f};
+    static constexpr float E5{0.00133335581464284434234f};
+    static constexpr float E6{0.000154035303933816099545f};
+};
@@ -11,26 +11,46 @@
 #include "OADEnv.h"
 
 float OADEnv::getNextSample() noexcept {
-    if (state == State::idle)
-        return 0.0f;
-
-    if (state == State::attack) {
-        envelopeVal += attackRate;
+    auto sample = 0.0f;
+    getNextBlock(&sample, 1);
+    return sample;
+}
 
-        if (envelopeVal >= 1.0f) {
-            envelopeVal = 1.0f;
-            state = State::decay;
+void OADEnv::getNextBlock(float *output, int numSamples) noexcept {
+    while (numSamples > 0) {
+        if (state == State::idle) {
+            juce::FloatVectorOperations::clear(output, numSamples);
+            return;
         }
-    } else if (state == State::decay) {
-        envelopeVal -= decayRate;
 
-        if (envelopeVal <= 0.0f) {
-            envelopeVal = 0.0f;
-            state = State::idle;
+        // Run the current segment up to its end, or the end of the block.
+        const auto &segment = state == State::attack ? attackSegment : decaySegment;
+        auto numToRender = std::min(numSamples, samplesUntilSegmentEnd);
+        auto multiplier = segment.multiplier;
+        auto increment = segment.increment;
+        auto value = envelopeVal;
+        for (auto n = 0; n < numToRender; ++n) {
+            value = value * multiplier + increment;
+            output[n] = value;
+        }
+        envelopeVal = value;
+        samplesUntilSegmentEnd -= numToRender;
+
+        if (samplesUntilSegmentEnd == 0) {
+            // Land exactly on the end value, whatever rounding has accumulated on the way.
+            if (state == State::attack) {
+                envelopeVal = 1.0f;
+                enterState(State::decay);
+            } else {
+                envelopeVal = 0.0f;
+                state = State::idle;
+            }
+            output[numToRender - 1] = envelopeVal;
         }
-    }
 
-    return envelopeVal;
+        output += numToRender;
+        numSamples -= numToRender;
+    }
 }
 
 void OADEnv::applyEnvelopeToBuffer(juce::AudioBuffer<float> &buffer, int startSample, int numSamples) {
@@ -42,38 +62,94 @@ void OADEnv::applyEnvelopeToBuffer(juce::AudioBuffer<float> &buffer, int startSa
     }
 
     auto numChannels = buffer.getNumChannels();
+    float envelope[APPLY_BLOCK_SIZE];
 
-    while (--numSamples >= 0) {
-        auto env = getNextSample();
+    while (numSamples > 0) {
+        auto blockSize = std::min(numSamples, APPLY_BLOCK_SIZE);
+        getNextBlock(envelope, blockSize);
 
         for (int i = 0; i < numChannels; ++i)
-            buffer.getWritePointer(i)[startSample] *= env;
+            juce::FloatVectorOperations::multiply(buffer.getWritePointer(i, startSample), envelope, blockSize);
 
-        ++startSample;
+        startSample += blockSize;
+        numSamples -= blockSize;
     }
 }
 
 void OADEnv::noteOn() noexcept {
-    if (attackRate > 0.0f) {
+    if (hasAttack) {
         envelopeVal = parameters.onset;
-        state = State::attack;
-    } else if (decayRate > 0.0f) {
+        enterState(State::attack);
+    } else if (hasDecay) {
         envelopeVal = 1.0f;
-        state = State::decay;
+        enterState(State::decay);
+    }
+}
+
+OADEnv::Segment OADEnv::makeSegment(Curve curve, float from, float to, float timeInSeconds, double sr) {
+    auto numSamples = timeInSeconds * sr;
+    if (curve == Curve::Linear) {
+        return {1.0f, static_cast<float>((to - from) / numSamples)};
+    }
+
+    // Approach a target overshooting the end value, arriving at the end value after numSamples.
+    auto ratio = from < to ? ATTACK_TARGET_RATIO : DECAY_TARGET_RATIO;
+    auto target = to + ratio * (to - from);
+    auto multiplier = std::exp(-std::log((target - from) / (target - to)) / numSamples);
+    return {static_cast<float>(multiplier), static_cast<float>(target * (1.0 - multiplier))};
+}
+
+void OADEnv::enterState(State newState) noexcept {
+    auto hasDuration = (newState == State::attack && hasAttack) || (newState == State::decay && hasDecay);
+    state = hasDuration ? newState : State::idle;
+
+    if (state != State::idle) {
+        samplesUntilSegmentEnd = getSamplesUntilSegmentEnd();
+    }
+}
+
+int OADEnv::getSamplesUntilSegmentEnd() const noexcept {
+    // From the curve as specified rather than the float recursion, whose rounding would stretch or shrink the segment
+    // by a sample or more; the recursion is landed on the end value regardless.
+    auto isAttack = state == State::attack;
+    auto from = isAttack ? 0.0 : 1.0;
+    auto to = isAttack ? 1.0 : 0.0;
+    auto length = (isAttack ? parameters.attack : parameters.decay) * sampleRate;
+    double fractionLeft;
+
+    if ((isAttack ? parameters.attackCurve : parameters.decayCurve) == Curve::Linear) {
+        fractionLeft = (to - envelopeVal) / (to - from);
+    } else {
+        // v - target falls by the same factor each sample, from from - target to to - target.
+        auto target = to + (isAttack ? ATTACK_TARGET_RATIO : DECAY_TARGET_RATIO) * (to - from);
+        fractionLeft = std::log((target - envelopeVal) / (target - to)) / std::log((target - from) / (target - to));
+    }
+
+    // Already at (or past) the end value; finish on the next sample.
+    auto numSamples = std::round(fractionLeft * length);
+    if (!(numSamples >= 1.0)) {
+        return 1;
     }
+    return static_cast<int>(std::min(numSamples, static_cast<double>(std::numeric_limits<int>::max())));
 }
 
 void OADEnv::recalculateRates() noexcept {
-    auto getRate = [](float distance, float timeInSeconds, double sr) {
-        return timeInSeconds > 0.0f ? (float) (distance / (timeInSeconds * sr)) : -1.0f;
-    };
+    hasAttack = parameters.attack > 0.0f;
+    hasDecay = parameters.decay > 0.0f;
 
-    attackRate = getRate(1.0f, parameters.attack, sampleRate);
-    decayRate = getRate(1.0f, parameters.decay, sampleRate);
+    if (hasAttack) {
+        attackSegment = makeSegment(parameters.attackCurve, 0.0f, 1.0f, parameters.attack, sampleRate);
+    }
+    if (hasDecay) {
+        decaySegment = makeSegment(parameters.decayCurve, 1.0f, 0.0f, parameters.decay, sampleRate);
+    }
 
-    if ((state == State::attack && attackRate <= 0.0f)
-        || (state == State::decay && (decayRate <= 0.0f || envelopeVal <= 0.0f))) {
+    if ((state == State::attack && !hasAttack)
+        || (state == State::decay && (!hasDecay || envelopeVal <= 0.0f))) {
         state = State::idle;
+    } else if (state != State::idle) {
+        // Carry on from the current value along the new curve.
+        samplesUntilSegmentEnd = getSamplesUntilSegmentEnd();
     }
 }
 
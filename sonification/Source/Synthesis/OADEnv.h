@@ -14,22 +14,35 @@
 
 /**
  * Onset-Attack-Decay envelope
- * TODO: support exponential curves
+ *
+ * Each segment is generated by the recursion v = v * multiplier + increment; a linear segment has a multiplier of 1, an
+ * exponential one approaches a target beyond its end value, so that it arrives in the given time. Envelopes are
+ * rendered a block at a time, the block being split wherever a segment ends.
  */
 class OADEnv {
 public:
+    enum class Curve {
+        Linear,
+        Exponential
+    };
+
     struct Parameters {
         Parameters() = default;
 
         Parameters(float onsetAmplitude,
                    float attackTimeSeconds,
-                   float decayTimeSeconds)
+                   float decayTimeSeconds,
+                   Curve attackCurveToUse = Curve::Linear,
+                   Curve decayCurveToUse = Curve::Linear)
                 : onset(onsetAmplitude),
                   attack(attackTimeSeconds),
-                  decay(decayTimeSeconds) {
+                  decay(decayTimeSeconds),
+                  attackCurve(attackCurveToUse),
+                  decayCurve(decayCurveToUse) {
         }
 
         float onset = 0.0f, attack = 0.1f, decay = 0.1f;
+        Curve attackCurve = Curve::Linear, decayCurve = Curve::Linear;
     };
 
     void setParameters(const Parameters &);
@@ -40,16 +53,25 @@ public:
     /** Returns true if the envelope is in its attack or decay stage. */
     bool isActive() const noexcept { return state != State::idle; }
 
+    /** Returns the most recent envelope value. */
+    float getCurrentValue() const noexcept { return envelopeVal; }
+
     /** Returns the next sample value for an OADEnv object.
 
-        @see applyEnvelopeToBuffer
+        @see getNextBlock, applyEnvelopeToBuffer
     */
     float getNextSample() noexcept;
 
+    /** Writes the next numSamples envelope values to output; zeros once the envelope is idle.
+
+        @see getNextSample
+    */
+    void getNextBlock(float *output, int numSamples) noexcept;
+
     /** This method will conveniently apply the next numSamples number of envelope values
         to an AudioBuffer.
 
-        @see getNextSample
+        @see getNextBlock
     */
     void applyEnvelopeToBuffer(juce::AudioBuffer<float> &buffer, int startSample, int numSamples);
 
@@ -63,12 +85,35 @@ public:
     void noteOff();
 
 private:
-    void recalculateRates() noexcept;
+    // How far beyond its end value an exponential segment aims, relative to the segment's height. Smaller is more
+    // curved; these give a snappy attack and a decay close to a true exponential.
+    static constexpr double ATTACK_TARGET_RATIO{.3};
+    static constexpr double DECAY_TARGET_RATIO{.001};
+    // Envelope values are computed on the stack this many at a time by applyEnvelopeToBuffer.
+    static constexpr int APPLY_BLOCK_SIZE{64};
 
     //==============================================================================
     enum class State {
         idle, attack, decay
     };
+
+    /** The recursion generating a segment. */
+    struct Segment {
+        float multiplier{1.0f};
+        float increment{0.0f};
+    };
+
+    void recalculateRates() noexcept;
+
+    static Segment makeSegment(Curve curve, float from, float to, float timeInSeconds, double sr);
+
+    /** Enters newState from the current envelope value, or goes idle if newState has no duration. */
+    void enterState(State newState) noexcept;
+
+    /** The number of samples the current segment takes to reach its end value from the current envelope value. */
+    int getSamplesUntilSegmentEnd() const noexcept;
+
+    //==============================================================================
     State state = State::idle;
 
     double sampleRate{44100.0};
@@ -76,6 +121,7 @@ private:
 
     Parameters parameters;
 
-    float attackRate{0.0f};
-    float decayRate{0.0f};
+    Segment attackSegment, decaySegment;
+    bool hasAttack{false}, hasDecay{false};
+    int samplesUntilSegmentEnd{0};
 };
@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    AllocationCounter.cpp
+
+  ==============================================================================
+*/
+
+#include "AllocationCounter.h"
+#include <cstdlib>
+#include <new>
+
+namespace {
+    thread_local int *currentCount{nullptr};
+
+    void *allocate(std::size_t size) {
+        if (currentCount != nullptr) {
+            ++*currentCount;
+        }
+        if (auto *p = std::malloc(size > 0 ? size : 1)) {
+            return p;
+        }
+        throw std::bad_alloc();
+    }
+}
+
+ScopedAllocationCounter::ScopedAllocationCounter() : previousCount(currentCount) {
+    currentCount = &numAllocations;
+}
+
+ScopedAllocationCounter::~ScopedAllocationCounter() {
+    currentCount = previousCount;
+}
+
+void *operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
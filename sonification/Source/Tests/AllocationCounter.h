@@ -0,0 +1,27 @@
+/*
+  ==============================================================================
+
+    AllocationCounter.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * Counts the heap allocations made on the calling thread while it is in scope. The tests replace the global operator
+ * new to do the counting. A counter nested in another takes over the counting until it goes out of scope.
+ */
+class ScopedAllocationCounter {
+public:
+    ScopedAllocationCounter();
+
+    ~ScopedAllocationCounter();
+
+    int getNumAllocations() const { return numAllocations; }
+
+private:
+    int numAllocations{0};
+    // The count of the counter this one is nested in, if any.
+    int *previousCount;
+};
@@ -0,0 +1,187 @@
+/*
+  ==============================================================================
+
+    AllpassFilterTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "AllocationCounter.h"
+#include "../Processing/AllpassFilter.h"
+
+namespace {
+    /**
+     * y[n] = gx[n] + x[n-N] - gy[n-N], with the whole history kept; the signal plus y[n] is output, as by
+     * AllpassFilter::processBlock().
+     */
+    class ReferenceAllpass {
+    public:
+        ReferenceAllpass(float gainToUse, unsigned int orderToUse) : gain(gainToUse), order(orderToUse) {}
+
+        float processSample(float inputSample) {
+            auto n = x.size();
+            auto outSample = inputSample;
+            if (order > 0) {
+                auto delayed = [this, n](const std::vector<float> &history) {
+                    return n >= order ? history[n - order] : 0.f;
+                };
+                outSample = gain * inputSample + delayed(x) - gain * delayed(y);
+            }
+            x.push_back(inputSample);
+            y.push_back(outSample);
+            return inputSample + outSample;
+        }
+
+    private:
+        float gain;
+        unsigned int order;
+        std::vector<float> x, y;
+    };
+}
+
+class AllpassFilterTests : public juce::UnitTest {
+public:
+    AllpassFilterTests() : juce::UnitTest("AllpassFilter", "Processing") {}
+
+    void runTest() override {
+        for (auto order: {0u, 1u, 7u, 512u, 513u, 5501u}) {
+            beginTest("Matches the direct form at order " + juce::String(order));
+            {
+                AllpassFilter filter{1};
+                filter.setGain(GAIN);
+                filter.setOrder(order);
+                filter.reset();
+                ReferenceAllpass reference{GAIN, order};
+
+                auto maxError = 0.f;
+                for (auto b = 0; b < NUM_BLOCKS; ++b) {
+                    fillBlock(b);
+                    filter.processBlock(block);
+                    for (auto n = 0; n < BLOCK_SIZE; ++n) {
+                        auto expected = reference.processSample(getInput(b * BLOCK_SIZE + n));
+                        maxError = std::max(maxError, std::abs(buffer.getSample(0, n) - expected));
+                    }
+                }
+                expectLessThan(maxError, TOLERANCE);
+            }
+        }
+
+        beginTest("A cascade matches two filters run one after the other");
+        {
+            AllpassFilter first{2}, second{2}, cascadeFirst{2}, cascadeSecond{2};
+            for (auto *filter: {&first, &cascadeFirst}) {
+                filter->setGain(GAIN);
+                filter->setOrder(300);
+            }
+            for (auto *filter: {&second, &cascadeSecond}) {
+                filter->setGain(-GAIN);
+                filter->setOrder(5501);
+            }
+
+            juce::AudioBuffer<float> cascadeBuffer{2, BLOCK_SIZE};
+            juce::dsp::AudioBlock<float> cascadeBlock{cascadeBuffer};
+            auto maxError = 0.f;
+            for (auto b = 0; b < NUM_BLOCKS; ++b) {
+                // Change the order part way through, to cover the crossfade.
+                if (b == NUM_BLOCKS / 2) {
+                    first.setOrder(1000);
+                    cascadeFirst.setOrder(1000);
+                }
+
+                fillBlock(b);
+                cascadeBuffer.makeCopyOf(buffer);
+                first.processBlock(block);
+                second.processBlock(block);
+                AllpassFilter::processCascade(cascadeFirst, cascadeSecond, cascadeBlock);
+
+                for (auto channel = 0; channel < 2; ++channel) {
+                    for (auto n = 0; n < BLOCK_SIZE; ++n) {
+                        maxError = std::max(maxError, std::abs(buffer.getSample(channel, n) -
+                                                               cascadeBuffer.getSample(channel, n)));
+                    }
+                }
+            }
+            expectLessThan(maxError, TOLERANCE);
+        }
+
+        beginTest("Changing the order crossfades, and doesn't allocate");
+        {
+            AllpassFilter filter{1};
+            filter.setGain(GAIN);
+            filter.setOrder(100);
+            for (auto b = 0; b < 4; ++b) {
+                fillBlock(b);
+                filter.processBlock(block);
+            }
+
+            ScopedAllocationCounter allocations;
+            auto previous = buffer.getSample(0, BLOCK_SIZE - 1);
+            auto maxStep = 0.f;
+            for (auto b = 4; b < NUM_BLOCKS; ++b) {
+                // A jump from order 100 to the maximum, and back again.
+                filter.setOrder(b % 2 == 0 ? 100 : 10000);
+                fillBlock(b);
+                filter.processBlock(block);
+                for (auto n = 0; n < BLOCK_SIZE; ++n) {
+                    maxStep = std::max(maxStep, std::abs(buffer.getSample(0, n) - previous));
+                    previous = buffer.getSample(0, n);
+                }
+            }
+            expectEquals(allocations.getNumAllocations(), 0);
+            // The input is a sum of low-frequency sines, so moves little from one sample to the next; so should the
+            // output, with the order changes crossfaded.
+            expectLessThan(maxStep, .1f);
+        }
+
+        beginTest("The order is clamped to the maximum");
+        {
+            AllpassFilter filter{1, 100};
+            filter.setGain(GAIN);
+            filter.setOrder(1000);
+            filter.reset();
+            ReferenceAllpass reference{GAIN, 100};
+
+            auto maxError = 0.f;
+            for (auto b = 0; b < 4; ++b) {
+                fillBlock(b);
+                filter.processBlock(block);
+                for (auto n = 0; n < BLOCK_SIZE; ++n) {
+                    auto expected = reference.processSample(getInput(b * BLOCK_SIZE + n));
+                    maxError = std::max(maxError, std::abs(buffer.getSample(0, n) - expected));
+                }
+            }
+            expectEquals(filter.getMaxOrder(), 100u);
+            expectLessThan(maxError, TOLERANCE);
+        }
+    }
+
+private:
+    static constexpr float GAIN{.7f};
+    static constexpr int BLOCK_SIZE{512};
+    static constexpr int NUM_BLOCKS{40};
+    // The same arithmetic, but the compiler may fuse multiply-adds differently.
+    static constexpr float TOLERANCE{1.0e-5f};
+
+    static float getInput(int n) {
+        auto t = static_cast<float>(n) / 44100.f;
+        return .3f * std::sin(juce::MathConstants<float>::twoPi * 110.f * t) +
+               .2f * std::sin(juce::MathConstants<float>::twoPi * 337.f * t);
+    }
+
+    /**
+     * Fill every channel of the buffer with block b of the input.
+     */
+    void fillBlock(int b) {
+        for (auto channel = 0; channel < buffer.getNumChannels(); ++channel) {
+            for (auto n = 0; n < BLOCK_SIZE; ++n) {
+                buffer.setSample(channel, n, getInput(b * BLOCK_SIZE + n));
+            }
+        }
+    }
+
+    juce::AudioBuffer<float> buffer{2, BLOCK_SIZE};
+    juce::dsp::AudioBlock<float> block{buffer};
+};
+
+static AllpassFilterTests allpassFilterTests;
@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+
+    ClockTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../MasterClock.h"
+#include "../ClockFollower.h"
+
+namespace {
+    /**
+     * A MasterClock running on simulated time.
+     */
+    class SimulatedClock : public MasterClock {
+    public:
+        void elapse(double seconds) {
+            elapsedSeconds += seconds;
+        }
+
+    protected:
+        juce::int64 getTicks() const noexcept override {
+            return static_cast<juce::int64>(
+                    elapsedSeconds * static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()));
+        }
+
+    private:
+        double elapsedSeconds{0.0};
+    };
+
+    /**
+     * A player that runs at drift times the rate it's asked for.
+     */
+    class SimulatedFollower : public ClockFollower::Follower {
+    public:
+        explicit SimulatedFollower(double driftToUse) : drift(driftToUse) {}
+
+        void elapse(double seconds) {
+            position += seconds * rate * drift;
+        }
+
+        double getPosition() override { return position; }
+
+        void setPosition(double seconds) override { position = seconds; }
+
+        void setRate(double newRate) override { rate = newRate; }
+
+    private:
+        double drift;
+        double position{0.0};
+        double rate{0.0};
+    };
+}
+
+class ClockTests : public juce::UnitTest {
+public:
+    ClockTests() : juce::UnitTest("MasterClock and ClockFollower", "Timing") {}
+
+    void runTest() override {
+        beginTest("The clock follows the samples rendered, scaled by speed");
+        {
+            SimulatedClock clock;
+            clock.prepare(SAMPLE_RATE);
+            clock.setSpeed(1.5);
+            clock.start();
+            for (auto i = 0; i < 1000; ++i) {
+                clock.elapse(BLOCK_SECONDS);
+                clock.advance(BLOCK_SIZE);
+            }
+            expectWithinAbsoluteError(clock.getTimeSeconds(), 1000 * BLOCK_SECONDS * 1.5, 1.0e-9);
+            expectEquals(clock.getDeviceSamples(), static_cast<juce::int64>(1000 * BLOCK_SIZE));
+        }
+
+        beginTest("Reads don't go backwards when the device runs slow");
+        {
+            // Callbacks arrive 1% late, so each re-anchors the clock behind where it was extrapolated to.
+            SimulatedClock clock;
+            clock.prepare(SAMPLE_RATE);
+            clock.start();
+            auto lastRead = clock.getTimeSeconds();
+            auto numBackwards = 0;
+            for (auto i = 0; i < 1000; ++i) {
+                for (auto j = 0; j < 4; ++j) {
+                    clock.elapse(BLOCK_SECONDS * 1.01 / 4);
+                    auto read = clock.getTimeSeconds();
+                    numBackwards += read < lastRead ? 1 : 0;
+                    lastRead = read;
+                }
+                clock.advance(BLOCK_SIZE);
+                auto read = clock.getTimeSeconds();
+                numBackwards += read < lastRead ? 1 : 0;
+                lastRead = read;
+            }
+            expectEquals(numBackwards, 0);
+            // Held back, rather than running ahead of the samples rendered.
+            expectLessOrEqual(lastRead, 1000 * BLOCK_SECONDS * 1.01);
+            expectGreaterOrEqual(lastRead, 1000 * BLOCK_SECONDS);
+        }
+
+        beginTest("Setting the time can move it backwards");
+        {
+            SimulatedClock clock;
+            clock.prepare(SAMPLE_RATE);
+            clock.start();
+            clock.elapse(10.0);
+            expectWithinAbsoluteError(clock.getTimeSeconds(), 10.0, 1.0e-9);
+            clock.setTime(2.0);
+            expectWithinAbsoluteError(clock.getTimeSeconds(), 2.0, 1.0e-9);
+        }
+
+        beginTest("A drifting follower is kept in step through a speed change, with one seek");
+        {
+            SimulatedClock clock;
+            SimulatedFollower video{FOLLOWER_DRIFT};
+            ClockFollower follower{clock, video};
+            clock.prepare(SAMPLE_RATE);
+            clock.setSpeed(1.5);
+            clock.start();
+            video.setPosition(3.0);
+
+            auto maxError = 0.0, maxSettledError = 0.0;
+            auto secondsSinceUpdate = 0.0;
+            auto numBlocks = static_cast<int>(SESSION_SECONDS / BLOCK_SECONDS);
+            for (auto i = 0; i < numBlocks; ++i) {
+                if (i == numBlocks / 2) {
+                    clock.setSpeed(.5);
+                    follower.update();
+                }
+
+                clock.elapse(BLOCK_SECONDS);
+                video.elapse(BLOCK_SECONDS);
+                clock.advance(BLOCK_SIZE);
+
+                secondsSinceUpdate += BLOCK_SECONDS;
+                if (secondsSinceUpdate >= 1.0 / ClockFollower::UPDATE_RATE_HZ) {
+                    secondsSinceUpdate = 0.0;
+                    // Skip the error up to the seek that fixes the starting offset.
+                    auto hasSeeked = follower.getNumSeeks() > 0;
+                    follower.update();
+                    if (hasSeeked) {
+                        maxError = std::max(maxError, std::abs(follower.getError()));
+                    }
+                    // Once the drift estimate has settled, through the speed change.
+                    if (i * BLOCK_SECONDS > SETTLING_SECONDS) {
+                        maxSettledError = std::max(maxSettledError, std::abs(follower.getError()));
+                    }
+                }
+            }
+
+            expectEquals(follower.getNumSeeks(), 1);
+            expectWithinAbsoluteError(follower.getDrift(), FOLLOWER_DRIFT, .001);
+            expectLessThan(maxError, MAX_FOLLOWER_ERROR);
+            expectLessThan(maxSettledError, MAX_SETTLED_FOLLOWER_ERROR);
+        }
+    }
+
+private:
+    static constexpr double SAMPLE_RATE{48000.0};
+    static constexpr int BLOCK_SIZE{512};
+    static constexpr double BLOCK_SECONDS{BLOCK_SIZE / SAMPLE_RATE};
+    static constexpr double FOLLOWER_DRIFT{1.02};
+    static constexpr double SESSION_SECONDS{60.0};
+    static constexpr double SETTLING_SECONDS{10.0};
+    static constexpr double MAX_FOLLOWER_ERROR{.02};
+    static constexpr double MAX_SETTLED_FOLLOWER_ERROR{.003};
+};
+
+static ClockTests clockTests;
@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    EffectNodesTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Processing/EffectNodes.h"
+
+class ReverbNodeTests : public juce::UnitTest {
+public:
+    ReverbNodeTests() : juce::UnitTest("ReverbNode", "Processing") {}
+
+    void runTest() override {
+        beginTest("Bypassing the reverb doesn't change the output level");
+        {
+            // The chain as it was before the reverb could be bypassed: always running, at wet 0 and dry 1. Fed the
+            // same input, block by block, as the chain under test.
+            juce::dsp::Reverb reference;
+            juce::dsp::Gain<float> referenceGain;
+            reference.prepare(spec);
+            reference.setParameters(juce::Reverb::Parameters{.5f, .25f, 0.f, 1.f, 0.f});
+            referenceGain.prepare(spec);
+            referenceGain.setGainLinear(OUTPUT_GAIN);
+
+            ParameterStore parameters;
+            auto wetLevelParameter = parameters.add(0.f, 50.0);
+            ReverbNode reverb{parameters, wetLevelParameter};
+            GainNode gain{OUTPUT_GAIN / ReverbNode::LEVEL_SCALE};
+            EffectsChain chain;
+            AudioLoadMonitor monitor;
+            chain.add(reverb, AudioLoadMonitor::Reverb);
+            chain.add(gain, AudioLoadMonitor::Gain);
+            parameters.prepareToPlay(spec.sampleRate);
+            monitor.prepare(spec.sampleRate);
+            chain.prepare(spec);
+
+            auto processBlocks = [&](int numBlocks, const juce::String &state) {
+                for (auto i = 0; i < numBlocks; ++i) {
+                    fillBlocks();
+                    auto referenceContext = juce::dsp::ProcessContextReplacing<float>(referenceBlock);
+                    reference.process(referenceContext);
+                    referenceGain.process(referenceContext);
+                    chain.process(block, monitor);
+
+                    // Skip the reference's first blocks, while juce::Reverb ramps up from its default dry level.
+                    if (i >= NUM_SETTLING_BLOCKS || state != "bypassed") {
+                        auto difference = buffer.getRMSLevel(0, 0, BLOCK_SIZE) /
+                                          referenceBuffer.getRMSLevel(0, 0, BLOCK_SIZE);
+                        expectWithinAbsoluteError(juce::Decibels::gainToDecibels(difference), 0.f, .05f, state);
+                    }
+                }
+            };
+
+            // Bypassed, at wet 0.
+            processBlocks(2 * NUM_SETTLING_BLOCKS, "bypassed");
+            expect(!reverb.isActive(false));
+
+            // Running, with next to no wet signal; the dry level shouldn't jump.
+            parameters.set(wetLevelParameter, .001f);
+            processBlocks(NUM_SETTLING_BLOCKS, "running");
+            expect(reverb.isActive(false));
+
+            // Back to wet 0, and bypassed again once the reverb's own smoothing has finished.
+            parameters.set(wetLevelParameter, 0.f);
+            processBlocks(NUM_SETTLING_BLOCKS, "turning off");
+            expect(!reverb.isActive(false));
+            processBlocks(1, "bypassed again");
+        }
+    }
+
+private:
+    static constexpr float OUTPUT_GAIN{.5f};
+    static constexpr int BLOCK_SIZE{512};
+    static constexpr int NUM_SETTLING_BLOCKS{20};
+
+    /**
+     * Fill both blocks with the next stretch of a steady 440 Hz sine.
+     */
+    void fillBlocks() {
+        for (auto n = 0; n < BLOCK_SIZE; ++n) {
+            auto sample = .5f * std::sin(phase);
+            phase = std::fmod(phase + juce::MathConstants<float>::twoPi * 440.f / static_cast<float>(spec.sampleRate),
+                              juce::MathConstants<float>::twoPi);
+            for (auto channel = 0; channel < static_cast<int>(spec.numChannels); ++channel) {
+                block.setSample(channel, n, sample);
+                referenceBlock.setSample(channel, n, sample);
+            }
+        }
+    }
+
+    juce::dsp::ProcessSpec spec{48000.0, BLOCK_SIZE, 2};
+    juce::AudioBuffer<float> buffer{2, BLOCK_SIZE}, referenceBuffer{2, BLOCK_SIZE};
+    juce::dsp::AudioBlock<float> block{buffer}, referenceBlock{referenceBuffer};
+    float phase{0.f};
+};
+
+static ReverbNodeTests reverbNodeTests;
@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    FMAlgorithmTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Synthesis/FMAlgorithm.h"
+
+class FMAlgorithmTests : public juce::UnitTest {
+public:
+    FMAlgorithmTests() : juce::UnitTest("FMAlgorithm", "Synthesis") {}
+
+    void runTest() override {
+        auto envelope = OADEnv::Parameters(0.f, .05f, 1.f);
+
+        beginTest("A single modulator matches FMOsc");
+        expectMatchesReference(FMOsc::LINEAR, {FMOsc::Parameters(3.5, 800.)}, envelope, 1.0, LINEAR_TOLERANCE);
+
+        beginTest("Fixed-frequency modulation matches FMOsc");
+        expectMatchesReference(FMOsc::LINEAR, {FMOsc::Parameters(FMOsc::FIXED, 6., 20.)}, envelope, 1.0,
+                               LINEAR_TOLERANCE);
+
+        beginTest("Feedback matches FMOsc");
+        expectMatchesReference(FMOsc::LINEAR, {FMOsc::Parameters(1., 300., .3)}, envelope, 1.0, LINEAR_TOLERANCE);
+
+        beginTest("Series and parallel modulators match FMOsc");
+        expectMatchesReference(FMOsc::LINEAR,
+                               {FMOsc::Parameters(1.4, 500., 0., FMOsc::LINEAR, nullptr, {FMOsc::Parameters(2., 300.)}),
+                                FMOsc::Parameters(3., 200.)},
+                               envelope, 1.0, LINEAR_TOLERANCE);
+
+        // Rendering of the modulator stops at the end of its envelope, while the carrier carries on.
+        beginTest("A modulator whose envelope has finished matches FMOsc");
+        {
+            auto shortEnvelope = OADEnv::Parameters(0.f, .01f, .05f);
+            expectMatchesReference(FMOsc::LINEAR, {FMOsc::Parameters(2., 400., 0., FMOsc::LINEAR, &shortEnvelope)},
+                                   envelope, 1.0, LINEAR_TOLERANCE);
+        }
+
+        // Exponential FM scales the phase by 2^modulation, so float rounding of the modulation grows with the phase;
+        // compare the start of a note only.
+        beginTest("Exponential modulation matches FMOsc at the start of a note");
+        expectMatchesReference(FMOsc::LINEAR,
+                               {FMOsc::Parameters(1.4, 500., .1, FMOsc::EXPONENTIAL, nullptr,
+                                                  {FMOsc::Parameters(1.4, 1.9)})},
+                               envelope, .05, EXPONENTIAL_TOLERANCE);
+    }
+
+private:
+    static constexpr double SAMPLE_RATE{44100.0};
+    static constexpr int BLOCK_SIZE{512};
+    static constexpr double FREQUENCY{220.0};
+    static constexpr float AMPLITUDE{.5f};
+    static constexpr float LINEAR_TOLERANCE{1.0e-5f};
+    static constexpr float EXPONENTIAL_TOLERANCE{1.0e-4f};
+
+    /**
+     * Render a note of the patch with FMAlgorithm, a block at a time, and with FMOsc, a sample at a time, and expect
+     * them to agree to within tolerance.
+     */
+    void expectMatchesReference(FMOsc::FMMode carrierMode,
+                                const std::vector<FMOsc::Parameters> &modulatorParameters,
+                                OADEnv::Parameters envParams,
+                                double seconds,
+                                float tolerance) {
+        auto reference = FMOsc(carrierMode);
+        for (auto params: modulatorParameters) {
+            reference.addModulator(params.generateOscillator());
+        }
+        reference.setEnvelope(envParams);
+        auto spec = juce::dsp::ProcessSpec{SAMPLE_RATE, BLOCK_SIZE, 1};
+        reference.prepareToPlay(spec);
+        reference.setupNote(FREQUENCY, AMPLITUDE);
+
+        auto algorithm = FMAlgorithm(carrierMode, modulatorParameters, envParams);
+        algorithm.prepareToPlay(SAMPLE_RATE, BLOCK_SIZE);
+        algorithm.setupNote(FREQUENCY, AMPLITUDE);
+
+        std::vector<float> block(BLOCK_SIZE);
+        auto maxError = 0.f;
+        for (auto remaining = static_cast<int>(seconds * SAMPLE_RATE); remaining > 0; remaining -= BLOCK_SIZE) {
+            auto numSamples = std::min(remaining, BLOCK_SIZE);
+            std::fill(block.begin(), block.end(), 0.f);
+            algorithm.renderNextBlock(block.data(), numSamples);
+            for (auto n = 0; n < numSamples; ++n) {
+                maxError = std::max(maxError, std::abs(block[static_cast<size_t>(n)] - reference.computeNextSample()));
+            }
+        }
+        expectLessThan(maxError, tolerance);
+    }
+};
+
+static FMAlgorithmTests fmAlgorithmTests;
@@ -0,0 +1,278 @@
+/*
+  ==============================================================================
+
+    FMSynthTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "AllocationCounter.h"
+#include "../Synthesis/FMSynth.h"
+
+namespace {
+    /**
+     * Exposes the voice pool's state.
+     */
+    class InspectableSynth : public FMSynth {
+    public:
+        /**
+         * @return The frequencies of the sounding voices, in ascending order.
+         */
+        std::vector<float> getActiveFrequencies() const {
+            std::vector<float> frequencies;
+            for (auto v: currentPool->activeVoices) {
+                frequencies.push_back(currentPool->voices[static_cast<size_t>(v)].frequency);
+            }
+            std::sort(frequencies.begin(), frequencies.end());
+            return frequencies;
+        }
+
+        int getNumActiveVoicesWithTag(int tag) const {
+            auto count = 0;
+            for (auto v: currentPool->activeVoices) {
+                count += currentPool->voices[static_cast<size_t>(v)].tag == tag ? 1 : 0;
+            }
+            return count;
+        }
+    };
+
+    /**
+     * @return The fraction of a signal's energy that isn't at a multiple of harmonicSpacing DFT bins, e.g. aliases
+     * folded back between the harmonics of a note that fits the signal a whole number of times.
+     */
+    double getInharmonicFraction(const std::vector<float> &signal, int harmonicSpacing) {
+        auto length = signal.size();
+        auto total = 0.0, inharmonic = 0.0;
+        for (size_t k = 1; k <= length / 2; ++k) {
+            auto re = 0.0, im = 0.0;
+            for (size_t n = 0; n < length; ++n) {
+                auto angle = juce::MathConstants<double>::twoPi * static_cast<double>((k * n) % length) /
+                             static_cast<double>(length);
+                re += static_cast<double>(signal[n]) * std::cos(angle);
+                im -= static_cast<double>(signal[n]) * std::sin(angle);
+            }
+            auto energy = re * re + im * im;
+            total += energy;
+            inharmonic += k % static_cast<size_t>(harmonicSpacing) == 0 ? 0.0 : energy;
+        }
+        return total > 0.0 ? inharmonic / total : 0.0;
+    }
+
+    /**
+     * @return The largest difference between consecutive samples.
+     */
+    float getMaxStep(const std::vector<float> &signal) {
+        auto maxStep = 0.f;
+        for (size_t n = 1; n < signal.size(); ++n) {
+            maxStep = std::max(maxStep, std::abs(signal[n] - signal[n - 1]));
+        }
+        return maxStep;
+    }
+}
+
+class FMSynthTests : public juce::UnitTest {
+public:
+    FMSynthTests() : juce::UnitTest("FMSynth", "Synthesis") {}
+
+    void runTest() override {
+        beginTest("Notes fill the pool, then steal the oldest voice");
+        {
+            InspectableSynth synth;
+            prepare(synth);
+            for (auto i = 0; i < FMSynth::NUM_VOICES; ++i) {
+                synth.startNote(getFrequency(i), AMPLITUDE);
+                renderBlock(synth);
+                expectEquals(synth.getNumActiveVoices(), i + 1);
+            }
+
+            synth.startNote(getFrequency(FMSynth::NUM_VOICES), AMPLITUDE);
+            renderBlock(synth);
+            expectEquals(synth.getNumActiveVoices(), FMSynth::NUM_VOICES);
+            auto frequencies = synth.getActiveFrequencies();
+            expectEquals(frequencies.front(), getFrequency(1));
+            expectEquals(frequencies.back(), getFrequency(FMSynth::NUM_VOICES));
+        }
+
+        beginTest("Quietest stealing takes the quietest voice");
+        {
+            InspectableSynth synth;
+            prepare(synth);
+            synth.setVoiceStealing(FMSynth::VoiceStealing::Quietest);
+            // Started in the same block, so their envelopes are level; the third note is the quietest.
+            for (auto i = 0; i < FMSynth::NUM_VOICES; ++i) {
+                synth.startNote(getFrequency(i), i == 2 ? AMPLITUDE * .1f : AMPLITUDE);
+            }
+            renderBlock(synth);
+
+            synth.startNote(getFrequency(FMSynth::NUM_VOICES), AMPLITUDE);
+            renderBlock(synth);
+            auto frequencies = synth.getActiveFrequencies();
+            expect(std::find(frequencies.begin(), frequencies.end(), getFrequency(2)) == frequencies.end());
+            expect(std::find(frequencies.begin(), frequencies.end(), getFrequency(0)) != frequencies.end());
+        }
+
+        beginTest("A tag at its voice limit takes over its own oldest voice");
+        {
+            InspectableSynth synth;
+            prepare(synth);
+            synth.setMaxVoicesPerTag(2);
+            synth.startNote(getFrequency(0), AMPLITUDE, 1);
+            for (auto i = 1; i <= 3; ++i) {
+                synth.startNote(getFrequency(i), AMPLITUDE, 0);
+                renderBlock(synth);
+            }
+            expectEquals(synth.getNumActiveVoicesWithTag(0), 2);
+            expectEquals(synth.getNumActiveVoicesWithTag(1), 1);
+            expect(synth.getActiveFrequencies() ==
+                   std::vector<float>{getFrequency(0), getFrequency(2), getFrequency(3)});
+        }
+
+        beginTest("A voice is released when its envelope ends");
+        {
+            InspectableSynth synth;
+            prepare(synth);
+            synth.startNote(getFrequency(0), AMPLITUDE);
+            auto numSamples = 0;
+            do {
+                renderBlock(synth);
+                numSamples += BLOCK_SIZE;
+            } while (synth.getNumActiveVoices() > 0 && numSamples < 2 * SAMPLE_RATE);
+
+            // Attack plus decay, to within a block.
+            auto seconds = static_cast<double>(numSamples) / SAMPLE_RATE;
+            auto envelopeSeconds = static_cast<double>(ATTACK + DECAY);
+            expectGreaterOrEqual(seconds, envelopeSeconds);
+            expectLessThan(seconds, envelopeSeconds + BLOCK_SIZE / SAMPLE_RATE);
+        }
+
+        beginTest("Starting, stealing, rendering and stopping notes doesn't allocate");
+        {
+            InspectableSynth synth;
+            prepare(synth);
+            synth.setMaxVoicesPerTag(2);
+            ScopedAllocationCounter allocations;
+            for (auto i = 0; i < 4 * FMSynth::NUM_VOICES; ++i) {
+                synth.startNote(getFrequency(i), AMPLITUDE, i % 3 == 0 ? FMSynth::NO_TAG : i % 2);
+                renderBlock(synth);
+            }
+            synth.stopPlaying();
+            renderBlock(synth);
+            expectEquals(allocations.getNumAllocations(), 0);
+        }
+
+        beginTest("Oversampling a high-index patch keeps its sidebands from folding back between the harmonics");
+        {
+            // A 1:1 patch, so the sidebands are harmonics of the note; those past the Nyquist frequency fold back
+            // between them at 44.1 kHz.
+            std::map<int, double> inharmonicFractions;
+            for (auto maxFactor: {1, FMSynth::MAX_OVERSAMPLING_FACTOR}) {
+                FMSynth synth;
+                synth.setParameters({FMOsc::LINEAR, {FMOsc::Parameters(1., HIGH_INDEX_DEVIATION)},
+                                     OADEnv::Parameters(0.f, ATTACK, DECAY)});
+                synth.enableEnvelope(false);
+                synth.setMaxOversamplingFactor(maxFactor);
+                synth.prepareToPlay(SAMPLE_RATE, BLOCK_SIZE, 1);
+                synth.startNote(HARMONIC_NOTE_FREQUENCY, AMPLITUDE);
+                // Past the fade into the oversampled signal.
+                render(synth, BLOCK_SIZE);
+
+                auto factor = synth.getOversamplingFactor();
+                expectEquals(factor, maxFactor == 1 ? 1 : 2);
+                auto signal = render(synth, SPECTRUM_LENGTH);
+                inharmonicFractions[factor] = getInharmonicFraction(signal, HARMONIC_SPACING_BINS);
+            }
+
+            // Without oversampling, some of the energy is folded; with it, only what's left in the decimation
+            // filters' transition band.
+            expectGreaterThan(inharmonicFractions[1], MIN_FOLDED_FRACTION);
+            expectLessThan(inharmonicFractions[2], inharmonicFractions[1] * MAX_FOLDED_FRACTION_RATIO);
+        }
+
+        beginTest("Changing the oversampling factor mid-note doesn't click");
+        {
+            // A sideband just past the Nyquist frequency, too quiet to make much of a step itself, but enough to have
+            // the synth oversample whenever it's modulating.
+            FMSynth synth;
+            synth.setParameters({FMOsc::LINEAR, {FMOsc::Parameters(SWITCHING_RATIO, SWITCHING_DEVIATION)},
+                                 OADEnv::Parameters(0.f, ATTACK, DECAY)});
+            synth.enableEnvelope(false);
+            synth.prepareToPlay(SAMPLE_RATE, BLOCK_SIZE, 1);
+            synth.startNote(SWITCHING_NOTE_FREQUENCY, AMPLITUDE);
+            render(synth, BLOCK_SIZE);
+            // Modulator amplitudes follow the modulation amount once the carrier frequency is being set.
+            synth.setCarrierFrequency(SWITCHING_NOTE_FREQUENCY);
+
+            std::vector<float> signal;
+            auto numChanges = 0, lastFactor = synth.getOversamplingFactor();
+            for (auto toggle = 0; toggle < NUM_TOGGLES; ++toggle) {
+                synth.setModulationAmount(toggle % 2 == 0 ? 0.f : 1.f);
+                // Just long enough for the ramp and the fade to finish, and for the factor to change, part way into
+                // a block.
+                auto part = render(synth, TOGGLE_INTERVAL + toggle % 7);
+                signal.insert(signal.end(), part.begin(), part.end());
+                numChanges += synth.getOversamplingFactor() == lastFactor ? 0 : 1;
+                lastFactor = synth.getOversamplingFactor();
+            }
+            expectEquals(numChanges, NUM_TOGGLES);
+
+            // No bigger than the note's own steepest step, plus a little for the sidebands and the filters' ripple.
+            auto noteStep = static_cast<float>(juce::MathConstants<double>::twoPi * SWITCHING_NOTE_FREQUENCY /
+                                               SAMPLE_RATE) * AMPLITUDE;
+            expectLessThan(getMaxStep(signal), noteStep * MAX_STEP_RATIO);
+        }
+    }
+
+private:
+    static constexpr double SAMPLE_RATE{44100.0};
+    static constexpr int BLOCK_SIZE{512};
+    static constexpr float AMPLITUDE{.5f};
+    static constexpr float ATTACK{.05f};
+    static constexpr float DECAY{1.f};
+
+    // Index 20 on a 1 kHz note reaches 22 kHz, so the synth oversamples by 2. A tenth of a second holds a whole
+    // number of its periods, so harmonics land every 100 bins.
+    static constexpr double HIGH_INDEX_DEVIATION{40000.0};
+    static constexpr float HARMONIC_NOTE_FREQUENCY{1000.f};
+    static constexpr int SPECTRUM_LENGTH{4410};
+    static constexpr int HARMONIC_SPACING_BINS{100};
+    static constexpr double MIN_FOLDED_FRACTION{.001};
+    static constexpr double MAX_FOLDED_FRACTION_RATIO{.001};
+
+    // Index .02 at 20 kHz on a 2 kHz note.
+    static constexpr double SWITCHING_RATIO{10.0};
+    static constexpr double SWITCHING_DEVIATION{800.0};
+    static constexpr float SWITCHING_NOTE_FREQUENCY{2000.f};
+    static constexpr int NUM_TOGGLES{20};
+    static constexpr int TOGGLE_INTERVAL{2048};
+    static constexpr float MAX_STEP_RATIO{1.2f};
+
+    static float getFrequency(int note) {
+        return 220.f + 10.f * static_cast<float>(note);
+    }
+
+    static void prepare(FMSynth &synth) {
+        synth.setParameters({FMOsc::LINEAR, {FMOsc::Parameters(1., 100.)}, OADEnv::Parameters(0.f, ATTACK, DECAY)});
+        synth.prepareToPlay(SAMPLE_RATE, BLOCK_SIZE, 1);
+    }
+
+    std::vector<float> render(FMSynth &synth, int numSamples) {
+        std::vector<float> signal;
+        for (auto start = 0; start < numSamples; start += BLOCK_SIZE) {
+            auto blockSize = std::min(BLOCK_SIZE, numSamples - start);
+            buffer.clear();
+            synth.renderNextBlock(buffer, 0, blockSize);
+            signal.insert(signal.end(), buffer.getReadPointer(0), buffer.getReadPointer(0) + blockSize);
+        }
+        return signal;
+    }
+
+    void renderBlock(FMSynth &synth) {
+        buffer.clear();
+        synth.renderNextBlock(buffer, 0, BLOCK_SIZE);
+    }
+
+    juce::AudioBuffer<float> buffer{1, BLOCK_SIZE};
+};
+
+static FMSynthTests fmSynthTests;
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    FastMathTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Synthesis/FastMath.h"
+
+class FastMathTests : public juce::UnitTest {
+public:
+    FastMathTests() : juce::UnitTest("FastMath", "Synthesis") {}
+
+    void runTest() override {
+        beginTest("sin is within 1e-6 of std::sin for |x| < 10");
+        {
+            auto maxError = 0.0;
+            for (auto i = -NUM_POINTS; i <= NUM_POINTS; ++i) {
+                auto x = 10.f * static_cast<float>(i) / NUM_POINTS;
+                maxError = std::max(maxError, std::abs(FastMath::sin(x) - std::sin(static_cast<double>(x))));
+            }
+            expectLessThan(maxError, 1.0e-6);
+        }
+
+        beginTest("exp2 is within a relative 3e-7 of std::exp2 over [-126, 127]");
+        {
+            auto maxError = 0.0;
+            for (auto i = 0; i <= NUM_POINTS; ++i) {
+                auto x = -126.f + 253.f * static_cast<float>(i) / NUM_POINTS;
+                auto exact = std::exp2(static_cast<double>(x));
+                maxError = std::max(maxError, std::abs(FastMath::exp2(x) - exact) / exact);
+            }
+            expectLessThan(maxError, 3.0e-7);
+        }
+
+        beginTest("exp2 clamps its argument");
+        {
+            expectEquals(FastMath::exp2(-1000.f), FastMath::exp2(-126.f));
+            expectEquals(FastMath::exp2(1000.f), FastMath::exp2(127.f));
+        }
+
+        beginTest("The block versions match the scalar ones, in place or not");
+        {
+            std::vector<float> input(BLOCK_SIZE), output(BLOCK_SIZE), inPlace(BLOCK_SIZE);
+            auto random = getRandom();
+            for (auto &x: input) {
+                x = 20.f * random.nextFloat() - 10.f;
+            }
+
+            inPlace = input;
+            FastMath::sin(input.data(), output.data(), BLOCK_SIZE);
+            FastMath::sin(inPlace.data(), inPlace.data(), BLOCK_SIZE);
+            for (size_t n = 0; n < input.size(); ++n) {
+                expectWithinAbsoluteError(output[n], FastMath::sin(input[n]), TOLERANCE);
+                expectEquals(inPlace[n], output[n]);
+            }
+
+            inPlace = input;
+            FastMath::exp2(input.data(), output.data(), BLOCK_SIZE);
+            FastMath::exp2(inPlace.data(), inPlace.data(), BLOCK_SIZE);
+            for (size_t n = 0; n < input.size(); ++n) {
+                expectWithinAbsoluteError(output[n] / FastMath::exp2(input[n]), 1.f, TOLERANCE);
+                expectEquals(inPlace[n], output[n]);
+            }
+        }
+    }
+
+private:
+    static constexpr int NUM_POINTS{1000000};
+    static constexpr int BLOCK_SIZE{509};
+    // Vectorised, the block versions may round differently, by an ulp or two.
+    static constexpr float TOLERANCE{2.5e-7f};
+};
+
+static FastMathTests fastMathTests;
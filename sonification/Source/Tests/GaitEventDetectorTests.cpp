@@ -0,0 +1,153 @@
+/*
+  ==============================================================================
+
+    GaitEventDetectorTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../GaitEventDetector.h"
+#include "../Workload/ImuGenerator.h"
+
+namespace {
+    constexpr double PERIOD_MS{GaitEventDetector::IMU_SAMPLE_PERIOD_MS};
+
+    /**
+     * @return How far a duration is from a whole number of sample periods, in periods.
+     */
+    double getOffGridPeriods(double durationMs) {
+        auto periods = durationMs / PERIOD_MS;
+        return std::abs(periods - std::round(periods));
+    }
+}
+
+class GaitEventDetectorTests : public juce::UnitTest {
+public:
+    GaitEventDetectorTests() : juce::UnitTest("GaitEventDetector", "Analysis") {}
+
+    void runTest() override {
+        beginTest("Over three hours, event times stay exactly on the sample clock, and GCTs as fine as at the start");
+        {
+            ImuGenerator generator{ImuGenerator::Options{}};
+            GaitEventDetector detector;
+            detector.prepareToProcessSamples();
+
+            auto numToeOffs = 0, numOffClock = 0;
+            juce::int64 lastToeOffSample{0};
+            unsigned int lastContactsWritten{0};
+            double earlyMaxOffGrid{0.0}, lateMaxOffGrid{0.0};
+            auto numEarlyContacts = 0, numLateContacts = 0;
+
+            for (juce::int64 n = 1; n <= LONG_RUN_SAMPLES; ++n) {
+                auto sample = generator.getNextSample();
+                detector.processSample(sample.accelY, sample.gyroY, 0.0);
+
+                for (auto type: {GaitEventDetector::GaitEventType::ToeOff,
+                                 GaitEventDetector::GaitEventType::InitialContact}) {
+                    auto event = detector.getLastEvent(type);
+                    if (event.type == type && detector.hasEventNow(type)) {
+                        // Sample n is at n periods, computed afresh rather than accumulated.
+                        numOffClock += event.timeStampMs == static_cast<double>(event.sampleIndex) * PERIOD_MS ? 0 : 1;
+                        if (type == GaitEventDetector::GaitEventType::ToeOff && event.sampleIndex != lastToeOffSample) {
+                            lastToeOffSample = event.sampleIndex;
+                            ++numToeOffs;
+                        }
+                    }
+                }
+
+                // Each new ground contact, in the first and last ten minutes.
+                auto isEarly = n <= WINDOW_SAMPLES, isLate = n > LONG_RUN_SAMPLES - WINDOW_SAMPLES;
+                auto *snapshot = detector.getLatestSnapshot();
+                if (snapshot != nullptr && snapshot->numGroundContactsWritten != lastContactsWritten) {
+                    lastContactsWritten = snapshot->numGroundContactsWritten;
+                    auto &contact = snapshot->groundContacts[snapshot->numGroundContacts - 1];
+                    auto offGrid = getOffGridPeriods(contact.duration);
+                    if (isEarly) {
+                        earlyMaxOffGrid = std::max(earlyMaxOffGrid, offGrid);
+                        ++numEarlyContacts;
+                    } else if (isLate) {
+                        lateMaxOffGrid = std::max(lateMaxOffGrid, offGrid);
+                        ++numLateContacts;
+                    }
+                }
+            }
+
+            // About 170 steps a minute.
+            expectGreaterThan(numToeOffs, static_cast<int>(LONG_RUN_MINUTES * 160));
+            expectEquals(numOffClock, 0);
+            expectEquals(detector.getCurrentTime(), static_cast<double>(LONG_RUN_SAMPLES) * PERIOD_MS);
+
+            // A GCT is a whole number of periods, to within the float it's stored in, however late in the run.
+            expectGreaterThan(numEarlyContacts, 1000);
+            expectGreaterThan(numLateContacts, 1000);
+            expectLessThan(earlyMaxOffGrid, MAX_OFF_GRID_PERIODS);
+            expectLessThan(lateMaxOffGrid, MAX_OFF_GRID_PERIODS);
+        }
+
+        beginTest("Capture timestamps follow the capture's numbering, gaps included");
+        {
+            ImuGenerator::Options options;
+            options.dropoutsPerMinute = 4.0;
+            ImuGenerator generator{options};
+            GaitEventDetector detector;
+            detector.setTimestampSource(GaitEventDetector::TimestampSource::Capture);
+            detector.prepareToProcessSamples();
+
+            // The capture's number for each sample processed, from 1; numbered from well above 0, as a capture is.
+            std::vector<juce::int64> captureNumbers{0};
+            auto numEvents = 0, numMistimed = 0;
+            juce::int64 firstNumber{0}, numSkipped{0};
+            juce::int64 lastEventSample[2]{0, 0};
+
+            while (static_cast<juce::int64>(captureNumbers.size()) <= CAPTURE_SAMPLES) {
+                auto sample = generator.getNextSample();
+                auto number = CAPTURE_FIRST_NUMBER + sample.sampleIndex;
+                if (firstNumber == 0) {
+                    firstNumber = number;
+                }
+                numSkipped += number - (captureNumbers.back() == 0 ? number : captureNumbers.back() + 1);
+                captureNumbers.push_back(number);
+                detector.processSample(sample.accelY, sample.gyroY, static_cast<double>(number) * PERIOD_MS);
+
+                for (auto type: {GaitEventDetector::GaitEventType::ToeOff,
+                                 GaitEventDetector::GaitEventType::InitialContact}) {
+                    auto event = detector.getLastEvent(type);
+                    auto &last = lastEventSample[type == GaitEventDetector::GaitEventType::ToeOff ? 0 : 1];
+                    if (event.type != type || event.sampleIndex == last) {
+                        continue;
+                    }
+                    last = event.sampleIndex;
+                    ++numEvents;
+
+                    // Relative to the first sample, at one period.
+                    auto captureNumber = captureNumbers[static_cast<size_t>(event.sampleIndex)];
+                    auto expectedMs = static_cast<double>(captureNumber - firstNumber + 1) * PERIOD_MS;
+                    numMistimed += std::abs(event.timeStampMs - expectedMs) <= CAPTURE_TOLERANCE_MS ? 0 : 1;
+                }
+            }
+
+            expectGreaterThan(numSkipped, juce::int64{0});
+            expectGreaterThan(numEvents, static_cast<int>(CAPTURE_MINUTES * 300));
+            expectEquals(numMistimed, 0);
+            expectWithinAbsoluteError(detector.getCurrentTime(),
+                                      static_cast<double>(captureNumbers.back() - firstNumber + 1) * PERIOD_MS,
+                                      CAPTURE_TOLERANCE_MS);
+        }
+    }
+
+private:
+    static constexpr double LONG_RUN_MINUTES{180.0};
+    static constexpr juce::int64 LONG_RUN_SAMPLES{static_cast<juce::int64>(LONG_RUN_MINUTES * 60000.0 / PERIOD_MS)};
+    static constexpr juce::int64 WINDOW_SAMPLES{static_cast<juce::int64>(10.0 * 60000.0 / PERIOD_MS)};
+    // A GCT of under a second, as a float, is within about 1e-7 periods of the grid.
+    static constexpr double MAX_OFF_GRID_PERIODS{1.0e-5};
+
+    static constexpr double CAPTURE_MINUTES{20.0};
+    static constexpr juce::int64 CAPTURE_SAMPLES{static_cast<juce::int64>(CAPTURE_MINUTES * 60000.0 / PERIOD_MS)};
+    // Large enough that the capture's times are well above the run's.
+    static constexpr juce::int64 CAPTURE_FIRST_NUMBER{1000000};
+    static constexpr double CAPTURE_TOLERANCE_MS{1.0e-6};
+};
+
+static GaitEventDetectorTests gaitEventDetectorTests;
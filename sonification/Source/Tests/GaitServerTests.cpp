@@ -0,0 +1,301 @@
+/*
+  ==============================================================================
+
+    GaitServerTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <cerrno>
+#include <set>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#if JUCE_LINUX
+#include <dirent.h>
+#endif
+#include "../Server/GaitServer.h"
+#include "../Server/StressClient.h"
+#include "../Workload/ImuGenerator.h"
+
+namespace {
+#if JUCE_LINUX
+    constexpr int SEND_FLAGS{MSG_NOSIGNAL};
+#else
+    constexpr int SEND_FLAGS{0};
+#endif
+    // How long to wait for the server to reply.
+    constexpr int TIMEOUT_MS{10000};
+
+    std::string makeHeader() {
+        std::string out;
+        GaitServer::appendStreamHeader(out, GaitEventDetector::IMU_SAMPLE_PERIOD_MS);
+        return out;
+    }
+
+    void appendFrame(std::string &out, juce::int64 sampleIndex, const ImuGenerator::Sample &sample) {
+        GaitServer::appendFrame(out, sampleIndex, {sample.accelX, sample.accelY, sample.accelZ,
+                                                   sample.gyroX, sample.gyroY, sample.gyroZ});
+    }
+
+    /**
+     * @return A socket connected to the server, or -1.
+     */
+    int connectTo(const juce::String &socketPath) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        socketPath.copyToUTF8(address.sun_path, sizeof(address.sun_path));
+        auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return -1;
+        }
+#ifdef SO_NOSIGPIPE
+        auto noSigPipe{1};
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+        return fd;
+    }
+
+    /**
+     * Read until the server closes the connection.
+     * @return The replies, one per line; empty if the server didn't close in time.
+     */
+    std::vector<juce::var> readReplies(int fd) {
+        std::string received;
+        auto isClosed{false};
+        char buffer[1 << 14];
+        while (!isClosed) {
+            pollfd pollFd{fd, POLLIN, 0};
+            if (poll(&pollFd, 1, TIMEOUT_MS) <= 0) {
+                break;
+            }
+            auto n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                received.append(buffer, static_cast<size_t>(n));
+            }
+            isClosed = n == 0 || (n < 0 && errno != EINTR);
+        }
+
+        std::vector<juce::var> replies;
+        size_t lineStart{0}, lineEnd;
+        while (isClosed && (lineEnd = received.find('\n', lineStart)) != std::string::npos) {
+            replies.push_back(juce::JSON::parse(juce::String::fromUTF8(received.data() + lineStart,
+                                                                       static_cast<int>(lineEnd - lineStart))));
+            lineStart = lineEnd + 1;
+        }
+        return replies;
+    }
+
+    /**
+     * Send a stream to the server, shut down the sending side, and read the replies until the server closes.
+     * @return The replies; empty if the server couldn't be reached or didn't close in time.
+     */
+    std::vector<juce::var> exchange(const juce::String &socketPath, const std::string &stream) {
+        auto fd = connectTo(socketPath);
+        if (fd < 0) {
+            return {};
+        }
+
+        // The replies are small enough for the socket to hold while the stream is sent. The server stops reading
+        // after an error, so a failed send just ends the stream early.
+        size_t numSent{0};
+        while (numSent < stream.size()) {
+            auto n = send(fd, stream.data() + numSent, stream.size() - numSent, SEND_FLAGS);
+            if (n < 0 && errno != EINTR) {
+                break;
+            }
+            numSent += static_cast<size_t>(juce::jmax<ssize_t>(n, 0));
+        }
+        shutdown(fd, SHUT_WR);
+
+        auto replies = readReplies(fd);
+        close(fd);
+        return replies;
+    }
+
+#if JUCE_LINUX
+    /**
+     * @return This process's open epoll descriptors.
+     */
+    std::set<int> getEpollFds() {
+        std::set<int> fds;
+        auto *dir = opendir("/proc/self/fd");
+        if (dir == nullptr) {
+            return fds;
+        }
+        while (auto *entry = readdir(dir)) {
+            char target[64]{};
+            auto path = juce::String("/proc/self/fd/") + entry->d_name;
+            if (readlink(path.toRawUTF8(), target, sizeof(target) - 1) > 0 &&
+                juce::String(target) == "anon_inode:[eventpoll]") {
+                fds.insert(juce::String(entry->d_name).getIntValue());
+            }
+        }
+        closedir(dir);
+        return fds;
+    }
+#endif
+
+    int countReplies(const std::vector<juce::var> &replies, const juce::String &type) {
+        return static_cast<int>(std::count_if(replies.begin(), replies.end(), [&type](const juce::var &reply) {
+            return reply["type"].toString() == type;
+        }));
+    }
+}
+
+class GaitServerTests : public juce::UnitTest {
+public:
+    GaitServerTests() : juce::UnitTest("GaitServer", "Server") {}
+
+    void runTest() override {
+        auto socketFile = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                .getNonexistentChildFile("GaitServerTests", ".sock", false);
+        GaitServer::Options options;
+        options.socketPath = socketFile.getFullPathName();
+        options.numWorkers = 2;
+        GaitServer server{options};
+        auto started = server.start();
+        expect(started.wasOk(), started.getErrorMessage());
+        if (started.failed()) {
+            return;
+        }
+
+        beginTest("A stream starting at sample 0 gets its events, metrics and stats");
+        {
+            // Numbered from 0, where the generator counts from 1.
+            ImuGenerator generator{ImuGenerator::Options{}};
+            auto stream = makeHeader();
+            std::vector<juce::int64> expectedToeOffs;
+            juce::int64 numFrames{0};
+            for (auto sample = generator.getNextSample(); sample.sampleIndex <= NUM_FRAMES;
+                 sample = generator.getNextSample()) {
+                appendFrame(stream, sample.sampleIndex - 1, sample);
+                ++numFrames;
+                for (auto &event: generator.getNewEvents()) {
+                    if (event.type == GaitEventDetector::GaitEventType::ToeOff && event.sampleIndex <= NUM_FRAMES) {
+                        expectedToeOffs.push_back(event.sampleIndex - 1);
+                    }
+                }
+            }
+
+            auto replies = exchange(options.socketPath, stream);
+            expect(!replies.empty(), "No replies before the server closed");
+            expectEquals(countReplies(replies, "error"), 0);
+
+            std::vector<juce::int64> detectedToeOffs;
+            for (auto &reply: replies) {
+                if (reply["type"].toString() == "toe-off") {
+                    detectedToeOffs.push_back(static_cast<juce::int64>(reply["sample"]));
+                }
+            }
+            auto numMatched = StressClient::countMatchedToeOffs(expectedToeOffs, detectedToeOffs);
+            expectGreaterOrEqual(numMatched, static_cast<int>(expectedToeOffs.size()) - MAX_MISSED_TOE_OFFS,
+                                 "Toe-offs matched");
+            expectLessOrEqual(static_cast<int>(detectedToeOffs.size()) - numMatched, MAX_SPURIOUS_TOE_OFFS,
+                              "Spurious toe-offs");
+
+            // Metrics once every METRICS_INTERVAL frames, numbered as sent.
+            expectEquals(countReplies(replies, "metrics"), static_cast<int>(numFrames / METRICS_INTERVAL));
+            auto firstMetrics = std::find_if(replies.begin(), replies.end(), [](const juce::var &reply) {
+                return reply["type"].toString() == "metrics";
+            });
+            expect(firstMetrics != replies.end() &&
+                   static_cast<juce::int64>((*firstMetrics)["sample"]) == METRICS_INTERVAL - 1);
+
+            // The stats come last, and account for everything sent and replied.
+            expect(!replies.empty() && replies.back()["type"].toString() == "stats", "The last reply is the stats");
+            if (!replies.empty()) {
+                auto &stats = replies.back();
+                expectEquals(static_cast<juce::int64>(stats["framesReceived"]), numFrames);
+                expectEquals(static_cast<juce::int64>(stats["framesProcessed"]), numFrames);
+                expectEquals(static_cast<juce::int64>(stats["bytesReceived"]), static_cast<juce::int64>(stream.size()));
+                expectEquals(static_cast<int>(stats["eventsSent"]),
+                             countReplies(replies, "toe-off") + countReplies(replies, "initial-contact"));
+            }
+        }
+
+        beginTest("A repeated sample index is an error, after which the frames before it are still processed");
+        {
+            ImuGenerator generator{ImuGenerator::Options{}};
+            auto stream = makeHeader();
+            for (auto sampleIndex: {0, 1, 2, 2, 3}) {
+                appendFrame(stream, sampleIndex, generator.getNextSample());
+            }
+
+            auto replies = exchange(options.socketPath, stream);
+            expectEquals(static_cast<int>(replies.size()), 2);
+            if (replies.size() == 2) {
+                expectEquals(replies[0]["type"].toString(), juce::String{"error"});
+                expectEquals(replies[0]["message"].toString(), juce::String{"Sample indices must increase"});
+                expectEquals(replies[1]["type"].toString(), juce::String{"stats"});
+                expectEquals(static_cast<juce::int64>(replies[1]["framesReceived"]), juce::int64{3});
+                expectEquals(static_cast<juce::int64>(replies[1]["framesProcessed"]), juce::int64{3});
+            }
+        }
+
+        auto stats = server.getStats();
+        expectEquals(stats.connectionsAccepted, juce::int64{2});
+        expectEquals(stats.protocolErrors, juce::int64{1});
+        server.stop();
+        expect(!socketFile.existsAsFile(), "The socket is removed on stopping");
+
+#if JUCE_LINUX
+        beginTest("If the server can't wait on its sockets, it says why and closes its connections");
+        {
+            // The one epoll descriptor the server creates, which is then replaced by a pipe for it to fail on.
+            auto fdsBefore = getEpollFds();
+            GaitServer failingServer{options};
+            auto fdsAfter = getEpollFds();
+            std::vector<int> pollFds;
+            std::set_difference(fdsAfter.begin(), fdsAfter.end(), fdsBefore.begin(), fdsBefore.end(),
+                                std::back_inserter(pollFds));
+            expectEquals(static_cast<int>(pollFds.size()), 1);
+            expect(failingServer.start().wasOk());
+
+            auto fd = connectTo(options.socketPath);
+            auto header = makeHeader();
+            expect(fd >= 0 && send(fd, header.data(), header.size(), SEND_FLAGS) ==
+                              static_cast<ssize_t>(header.size()));
+            auto deadlineMs = juce::Time::getMillisecondCounterHiRes() + TIMEOUT_MS;
+            while (failingServer.getStats().connectionsOpen == 0 &&
+                   juce::Time::getMillisecondCounterHiRes() < deadlineMs) {
+                juce::Thread::sleep(1);
+            }
+            expectEquals(failingServer.getError(), juce::String{});
+
+            int pipeFds[2];
+            if (pollFds.size() == 1 && fd >= 0 && pipe(pipeFds) == 0) {
+                dup2(pipeFds[0], pollFds[0]);
+                close(pipeFds[0]);
+                close(pipeFds[1]);
+
+                auto replies = readReplies(fd);
+                expectEquals(static_cast<int>(replies.size()), 1);
+                expect(!replies.empty() && replies[0]["type"].toString() == "error" &&
+                       replies[0]["message"].toString() == failingServer.getError());
+                expect(failingServer.getError().startsWith("Failed to wait for connections"),
+                       failingServer.getError());
+                expectEquals(failingServer.getStats().connectionsOpen, juce::int64{0});
+            }
+            if (fd >= 0) {
+                close(fd);
+            }
+            failingServer.stop();
+        }
+#endif
+    }
+
+private:
+    // A minute of data.
+    static constexpr juce::int64 NUM_FRAMES{8889};
+    static constexpr juce::int64 METRICS_INTERVAL{148};
+    static constexpr int MAX_MISSED_TOE_OFFS{2};
+    static constexpr int MAX_SPURIOUS_TOE_OFFS{2};
+};
+
+static GaitServerTests gaitServerTests;
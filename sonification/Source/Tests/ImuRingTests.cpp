@@ -0,0 +1,268 @@
+/*
+  ==============================================================================
+
+    ImuRingTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include "../SharedMemory/ImuRing.h"
+#include "../SharedMemory/ImuRingConsumer.h"
+
+namespace {
+    /**
+     * A frame whose every field is derived from its index, so a torn read shows.
+     */
+    ImuRingFrame makeFrame(int64_t sampleIndex) {
+        auto value = static_cast<float>(sampleIndex);
+        return {sampleIndex, value, -value, value + 1.f, value + 2.f, value + 3.f, value + 4.f};
+    }
+
+    bool isIntact(const ImuRingFrame &frame) {
+        auto expected = makeFrame(frame.sampleIndex);
+        return std::memcmp(&frame, &expected, sizeof(frame)) == 0;
+    }
+
+    size_t writeFrames(ImuRingProducer *producer, int64_t firstIndex, int64_t numFrames) {
+        std::vector<ImuRingFrame> frames;
+        for (auto i = firstIndex; i < firstIndex + numFrames; ++i) {
+            frames.push_back(makeFrame(i));
+        }
+        return imuRingWrite(producer, frames.data(), frames.size());
+    }
+
+    /**
+     * @return The indices of the frames consumed.
+     */
+    std::vector<int64_t> readFrames(ImuRingConsumer &consumer, int maxFrames = 1 << 20) {
+        std::vector<int64_t> indices;
+        consumer.consume(maxFrames, [&indices](const ImuRingFrame &frame) {
+            indices.push_back(isIntact(frame) ? frame.sampleIndex : -1);
+        });
+        return indices;
+    }
+
+    std::vector<int64_t> range(int64_t first, int64_t end) {
+        std::vector<int64_t> indices;
+        for (auto i = first; i < end; ++i) {
+            indices.push_back(i);
+        }
+        return indices;
+    }
+}
+
+class ImuRingTests : public juce::UnitTest {
+public:
+    ImuRingTests() : juce::UnitTest("ImuRing and ImuRingConsumer", "Shared memory") {}
+
+    void runTest() override {
+        auto name = "/GaitImuRingTests-" + juce::String(static_cast<int>(getpid()));
+
+        beginTest("REJECT writes what fits, and keeps the rest back for the producer");
+        {
+            auto *producer = imuRingCreate(name.toRawUTF8(), 6, IMU_RING_REJECT, PERIOD_MS);
+            expect(producer != nullptr);
+            ImuRingConsumer consumer{name};
+            expect(consumer.open().wasOk());
+            expectEquals(imuRingGetCapacity(producer), CAPACITY);
+
+            expectEquals(writeFrames(producer, 0, 12), static_cast<size_t>(CAPACITY));
+            expectEquals(writeFrames(producer, 8, 4), size_t{0});
+            expectEquals(imuRingGetFillLevel(producer), CAPACITY);
+
+            expect(readFrames(consumer, 3) == range(0, 3));
+            // Room for three of the five.
+            expectEquals(writeFrames(producer, 8, 5), size_t{3});
+            expect(readFrames(consumer) == range(3, 11));
+
+            auto metrics = consumer.getMetrics();
+            expectEquals(metrics.framesRead, juce::int64{11});
+            expectEquals(metrics.framesDropped, juce::int64{0});
+            expectEquals(metrics.framesOverwritten, juce::int64{0});
+            expectEquals(metrics.maxFillLevel, CAPACITY);
+            imuRingClose(producer);
+        }
+
+        beginTest("DROP_NEWEST drops what doesn't fit, and counts it");
+        {
+            auto *producer = imuRingCreate(name.toRawUTF8(), CAPACITY, IMU_RING_DROP_NEWEST, PERIOD_MS);
+            ImuRingConsumer consumer{name};
+            expect(consumer.open().wasOk());
+
+            // Everything is taken; the last four are dropped.
+            expectEquals(writeFrames(producer, 0, 12), size_t{12});
+            expectEquals(imuRingGetFramesDropped(producer), uint64_t{4});
+            expect(readFrames(consumer) == range(0, 8));
+
+            // The producer carries on from where the dropped frames would have been.
+            expectEquals(writeFrames(producer, 12, 10), size_t{10});
+            expectEquals(imuRingGetFramesDropped(producer), uint64_t{6});
+            expect(readFrames(consumer) == range(12, 20));
+
+            auto metrics = consumer.getMetrics();
+            expectEquals(metrics.framesRead, juce::int64{16});
+            expectEquals(metrics.framesDropped, juce::int64{6});
+            expectEquals(metrics.framesOverwritten, juce::int64{0});
+            imuRingClose(producer);
+        }
+
+        beginTest("OVERWRITE keeps the newest frames, and the consumer counts the ones it was lapped past");
+        {
+            auto *producer = imuRingCreate(name.toRawUTF8(), CAPACITY, IMU_RING_OVERWRITE, PERIOD_MS);
+            ImuRingConsumer consumer{name};
+            expect(consumer.open().wasOk());
+
+            // More than the ring holds in one write.
+            expectEquals(writeFrames(producer, 0, 20), size_t{20});
+            expect(readFrames(consumer) == range(12, 20));
+            expectEquals(consumer.getMetrics().framesOverwritten, juce::int64{12});
+
+            // Lapped part way through reading.
+            writeFrames(producer, 20, 5);
+            expect(readFrames(consumer, 2) == range(20, 22));
+            writeFrames(producer, 25, 10);
+            expect(readFrames(consumer) == range(27, 35));
+
+            auto metrics = consumer.getMetrics();
+            expectEquals(metrics.framesRead, juce::int64{18});
+            expectEquals(metrics.framesOverwritten, juce::int64{17});
+            expectEquals(metrics.framesDropped, juce::int64{0});
+            imuRingClose(producer);
+        }
+
+        beginTest("OVERWRITE skips a frame the producer is part way through writing");
+        {
+            auto *producer = imuRingCreate(name.toRawUTF8(), CAPACITY, IMU_RING_OVERWRITE, PERIOD_MS);
+            ImuRingConsumer consumer{name};
+            expect(consumer.open().wasOk());
+            writeFrames(producer, 0, 4);
+
+            // Mark frame 2 as being written, as the producer does before overwriting it.
+            auto fd = shm_open(name.toRawUTF8(), O_RDWR, 0);
+            auto size = ImuRingLayout::getSizeInBytes(CAPACITY);
+            auto *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            expect(memory != MAP_FAILED);
+            if (memory != MAP_FAILED) {
+                auto *slots = ImuRingLayout::getSlots(static_cast<ImuRingLayout::Header *>(memory));
+                slots[2].sequence.store(ImuRingLayout::getSequence(2) - 1);
+                munmap(memory, size);
+            }
+
+            expect(readFrames(consumer) == std::vector<int64_t>{0, 1, 3});
+            expectEquals(consumer.getMetrics().framesOverwritten, juce::int64{1});
+            imuRingClose(producer);
+        }
+
+        beginTest("Frames written just before closing are still read");
+        {
+            auto *producer = imuRingCreate(name.toRawUTF8(), CAPACITY, IMU_RING_REJECT, PERIOD_MS);
+            ImuRingConsumer consumer{name};
+            expect(consumer.open().wasOk());
+            writeFrames(producer, 0, 4);
+            expect(readFrames(consumer) == range(0, 4));
+
+            // The producer's last write and close land between a read and the check that follows it.
+            writeFrames(producer, 4, 3);
+            imuRingClose(producer);
+            expect(consumer.checkProducer(1000.0) == ImuRingConsumer::ProducerState::Closed);
+            expectEquals(consumer.getMetrics().fillLevel, uint32_t{3});
+
+            expect(readFrames(consumer) == range(4, 7));
+            expect(readFrames(consumer).empty());
+            expectEquals(consumer.getMetrics().framesRead, juce::int64{7});
+        }
+
+        beginTest("A consumer that attaches after the producer has closed reads everything, then removes the ring");
+        {
+            auto *producer = imuRingCreate(name.toRawUTF8(), CAPACITY, IMU_RING_REJECT, PERIOD_MS);
+            writeFrames(producer, 0, 5);
+            imuRingClose(producer);
+
+            {
+                ImuRingConsumer consumer{name};
+                expect(consumer.open().wasOk());
+                expect(readFrames(consumer) == range(0, 5));
+                expect(consumer.checkProducer(1000.0) == ImuRingConsumer::ProducerState::Closed);
+            }
+
+            expect(ImuRingConsumer{name}.open().failed());
+        }
+
+        beginTest("A consumer leaves a ring created since it attached");
+        {
+            auto *producer = imuRingCreate(name.toRawUTF8(), CAPACITY, IMU_RING_REJECT, PERIOD_MS);
+            imuRingClose(producer);
+            {
+                ImuRingConsumer consumer{name};
+                expect(consumer.open().wasOk());
+                producer = imuRingCreate(name.toRawUTF8(), CAPACITY, IMU_RING_REJECT, PERIOD_MS);
+                writeFrames(producer, 0, 2);
+            }
+
+            ImuRingConsumer consumer{name};
+            expect(consumer.open().wasOk());
+            expect(readFrames(consumer) == range(0, 2));
+            imuRingClose(producer);
+        }
+
+        beginTest("OVERWRITE never passes on a torn frame, with the producer writing as the consumer reads");
+        {
+            auto *producer = imuRingCreate(name.toRawUTF8(), CAPACITY, IMU_RING_OVERWRITE, PERIOD_MS);
+            ImuRingConsumer consumer{name};
+            expect(consumer.open().wasOk());
+
+            // Kept about a ring's length ahead of the consumer, so that it overwrites frames while they're being read.
+            // Stops early on a slow machine, e.g. a single core, where the two threads take turns.
+            juce::int64 numWritten{0};
+            std::thread producerThread{[producer, &numWritten] {
+                auto deadline = juce::Time::getMillisecondCounterHiRes() + STRESS_TIME_LIMIT_MS;
+                while (numWritten < NUM_STRESS_FRAMES && juce::Time::getMillisecondCounterHiRes() < deadline) {
+                    while (imuRingGetFillLevel(producer) > CAPACITY - 3) {
+                        std::this_thread::yield();
+                    }
+                    numWritten += static_cast<juce::int64>(writeFrames(producer, numWritten, 3));
+                }
+                imuRingClose(producer);
+            }};
+
+            auto numTorn = 0, numOutOfOrder = 0;
+            int64_t lastIndex{-1};
+            auto isClosed = false;
+            while (true) {
+                // Once the producer has closed, one more read drains the ring.
+                auto isLastRead = isClosed;
+                consumer.consume(CAPACITY, [&](const ImuRingFrame &frame) {
+                    numTorn += isIntact(frame) ? 0 : 1;
+                    numOutOfOrder += frame.sampleIndex > lastIndex ? 0 : 1;
+                    lastIndex = frame.sampleIndex;
+                });
+                if (isLastRead) {
+                    break;
+                }
+                isClosed = consumer.checkProducer(1000.0) == ImuRingConsumer::ProducerState::Closed;
+            }
+            producerThread.join();
+
+            expectEquals(numTorn, 0);
+            expectEquals(numOutOfOrder, 0);
+            // Every frame was either read or counted as overwritten.
+            auto metrics = consumer.getMetrics();
+            expectEquals(metrics.framesRead + metrics.framesOverwritten, numWritten);
+            expectEquals(static_cast<juce::int64>(lastIndex), numWritten - 1);
+        }
+    }
+
+private:
+    static constexpr uint32_t CAPACITY{8};
+    static constexpr float PERIOD_MS{6.75f};
+    static constexpr juce::int64 NUM_STRESS_FRAMES{300000};
+    static constexpr double STRESS_TIME_LIMIT_MS{2000.0};
+};
+
+static ImuRingTests imuRingTests;
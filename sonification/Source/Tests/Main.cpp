@@ -0,0 +1,23 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Runs the unit tests; exits non-zero if any fail.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+int main() {
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    runner.runAllTests();
+
+    auto numFailures = 0;
+    for (auto i = 0; i < runner.getNumResults(); ++i) {
+        numFailures += runner.getResult(i)->failures;
+    }
+    return numFailures > 0 ? 1 : 0;
+}
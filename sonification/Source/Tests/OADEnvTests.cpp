@@ -0,0 +1,134 @@
+/*
+  ==============================================================================
+
+    OADEnvTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Synthesis/OADEnv.h"
+
+namespace {
+    OADEnv makeEnvelope(const OADEnv::Parameters &parameters, double sampleRate) {
+        OADEnv envelope;
+        envelope.setSampleRate(sampleRate);
+        envelope.setParameters(parameters);
+        envelope.noteOn();
+        return envelope;
+    }
+
+    /**
+     * @return The index of the first value of at least threshold, or -1.
+     */
+    int findFirstAtLeast(const std::vector<float> &values, float threshold) {
+        auto it = std::find_if(values.begin(), values.end(), [threshold](float v) { return v >= threshold; });
+        return it == values.end() ? -1 : static_cast<int>(it - values.begin());
+    }
+}
+
+class OADEnvTests : public juce::UnitTest {
+public:
+    OADEnvTests() : juce::UnitTest("OADEnv", "Synthesis") {}
+
+    void runTest() override {
+        using Curve = OADEnv::Curve;
+        const std::vector<OADEnv::Parameters> envelopes{
+                {0.f, .01f, .1f},
+                {.2f, .02f, .05f, Curve::Exponential, Curve::Exponential},
+                {0.f, .013f, .07f, Curve::Linear, Curve::Exponential},
+                {.5f, 0.f, .03f},
+                {0.f, .03f, 0.f, Curve::Exponential}
+        };
+
+        beginTest("getNextBlock matches getNextSample, however the blocks are split");
+        {
+            auto random = getRandom();
+            for (auto &parameters: envelopes) {
+                auto reference = makeEnvelope(parameters, SAMPLE_RATE);
+                std::vector<float> expected(NUM_SAMPLES);
+                for (auto &value: expected) {
+                    value = reference.getNextSample();
+                }
+
+                for (auto trial = 0; trial < NUM_TRIALS; ++trial) {
+                    auto envelope = makeEnvelope(parameters, SAMPLE_RATE);
+                    std::vector<float> rendered(NUM_SAMPLES);
+                    for (auto start = 0; start < NUM_SAMPLES;) {
+                        auto numSamples = std::min(NUM_SAMPLES - start, 1 + random.nextInt(MAX_BLOCK_SIZE));
+                        envelope.getNextBlock(rendered.data() + start, numSamples);
+                        start += numSamples;
+                    }
+                    expect(rendered == expected, "Attack " + juce::String(parameters.attack) + " s, decay " +
+                                                 juce::String(parameters.decay) + " s");
+                }
+            }
+        }
+
+        beginTest("Each segment reaches its end value at its duration");
+        {
+            for (auto sampleRate: {44100.0, 48000.0}) {
+                for (auto &parameters: envelopes) {
+                    auto envelope = makeEnvelope(parameters, sampleRate);
+                    std::vector<float> values;
+                    while (envelope.isActive() && static_cast<int>(values.size()) < NUM_SAMPLES) {
+                        values.push_back(envelope.getNextSample());
+                    }
+
+                    auto attackSamples = juce::roundToInt(parameters.attack * sampleRate);
+                    auto decaySamples = juce::roundToInt(parameters.decay * sampleRate);
+                    auto description = juce::String(sampleRate) + " Hz, onset " + juce::String(parameters.onset) +
+                                       ", attack " + juce::String(parameters.attack) + " s, decay " +
+                                       juce::String(parameters.decay) + " s";
+
+                    // From an onset above 0, the attack starts part way along its curve, so it's shorter.
+                    if (attackSamples > 0 && parameters.onset == 0.f) {
+                        // The peak is the last sample of the attack, and nothing before it reaches 1.
+                        expectEquals(findFirstAtLeast(values, 1.f), attackSamples - 1, "Peak, " + description);
+                        expectEquals(static_cast<int>(values.size()), attackSamples + decaySamples,
+                                     "Length, " + description);
+                    }
+                    if (attackSamples == 0) {
+                        expectEquals(static_cast<int>(values.size()), decaySamples, "Length, " + description);
+                    }
+                    if (decaySamples > 0) {
+                        expect(!values.empty() && values.back() == 0.f, "End, " + description);
+                    }
+                }
+            }
+        }
+
+        beginTest("An envelope reports idle once it's finished, so its operator can be skipped");
+        {
+            auto envelope = makeEnvelope({.3f, .01f, .02f}, SAMPLE_RATE);
+            expect(envelope.isActive());
+            std::vector<float> block(static_cast<size_t>(juce::roundToInt(.03 * SAMPLE_RATE)));
+            envelope.getNextBlock(block.data(), static_cast<int>(block.size()));
+            expect(!envelope.isActive());
+            expectEquals(block.back(), 0.f);
+            expectEquals(envelope.getCurrentValue(), 0.f);
+
+            std::fill(block.begin(), block.end(), 1.f);
+            envelope.getNextBlock(block.data(), static_cast<int>(block.size()));
+            expect(std::all_of(block.begin(), block.end(), [](float v) { return v == 0.f; }));
+
+            // Until the next note.
+            envelope.noteOn();
+            expect(envelope.isActive());
+            envelope.noteOff();
+            expect(!envelope.isActive());
+
+            // With neither attack nor decay, there's nothing to play.
+            expect(!makeEnvelope({1.f, 0.f, 0.f}, SAMPLE_RATE).isActive());
+        }
+    }
+
+private:
+    static constexpr double SAMPLE_RATE{44100.0};
+    // Longer than any of the envelopes.
+    static constexpr int NUM_SAMPLES{8192};
+    static constexpr int MAX_BLOCK_SIZE{700};
+    static constexpr int NUM_TRIALS{20};
+};
+
+static OADEnvTests oadEnvTests;
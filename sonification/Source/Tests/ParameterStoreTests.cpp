@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    ParameterStoreTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Processing/ParameterStore.h"
+
+namespace {
+    enum class Advance {
+        GetNext,
+        Skip,
+        FillRamp
+    };
+
+    /**
+     * Advance a parameter by numSamples, one of the three ways the audio thread can.
+     * @return The value at the end.
+     */
+    float advance(ParameterStore &store, int id, int numSamples, Advance how) {
+        switch (how) {
+            case Advance::GetNext: {
+                auto value = store.getCurrent(id);
+                for (auto n = 0; n < numSamples; ++n) {
+                    value = store.getNext(id);
+                }
+                return value;
+            }
+            case Advance::Skip:
+                return store.skip(id, numSamples);
+            case Advance::FillRamp: {
+                std::vector<float> block(static_cast<size_t>(numSamples));
+                store.fillRamp(id, block.data(), numSamples);
+                return block.empty() ? store.getCurrent(id) : block.back();
+            }
+        }
+        return 0.f;
+    }
+}
+
+class ParameterStoreTests : public juce::UnitTest {
+public:
+    ParameterStoreTests() : juce::UnitTest("ParameterStore", "Processing") {}
+
+    void runTest() override {
+        beginTest("A linear ramp reaches its target after the ramp time, whatever the block sizes");
+        {
+            auto random = getRandom();
+            for (auto sampleRate: {44100.0, 48000.0, 96000.0}) {
+                auto rampSamples = juce::roundToInt(RAMP_TIME_MS * .001 * sampleRate);
+                for (auto trial = 0; trial < NUM_TRIALS; ++trial) {
+                    ParameterStore store;
+                    auto id = store.add(0.f, RAMP_TIME_MS);
+                    store.prepareToPlay(sampleRate);
+                    store.set(id, 1.f);
+
+                    // Blocks of random sizes, advanced at random by sample, by skipping or by filling.
+                    auto numDone = 0;
+                    auto isOnLine = true, reachedEarly = false;
+                    while (numDone < rampSamples + MAX_BLOCK_SIZE) {
+                        auto numSamples = 1 + random.nextInt(MAX_BLOCK_SIZE);
+                        auto value = advance(store, id, numSamples, static_cast<Advance>(random.nextInt(3)));
+                        numDone += numSamples;
+                        auto expected = std::min(1.f, static_cast<float>(numDone) / static_cast<float>(rampSamples));
+                        isOnLine = isOnLine && std::abs(value - expected) <= TOLERANCE;
+                        reachedEarly = reachedEarly || (numDone < rampSamples && value == 1.f);
+                    }
+                    expect(isOnLine, "Off the line at " + juce::String(sampleRate) + " Hz");
+                    expect(!reachedEarly, "Reached the target early at " + juce::String(sampleRate) + " Hz");
+                    expectEquals(store.getCurrent(id), 1.f);
+                }
+
+                // Exactly at the ramp time, one sample at a time.
+                ParameterStore store;
+                auto id = store.add(0.f, RAMP_TIME_MS);
+                store.prepareToPlay(sampleRate);
+                store.set(id, -2.f);
+                expectGreaterThan(advance(store, id, rampSamples - 1, Advance::GetNext), -2.f);
+                expectEquals(store.getNext(id), -2.f);
+            }
+        }
+
+        beginTest("An exponential ramp is 1 - 1/e of the way to its target after one time constant");
+        {
+            auto expected = 1.f - std::exp(-1.f);
+            for (auto how: {Advance::GetNext, Advance::Skip, Advance::FillRamp}) {
+                ParameterStore store;
+                auto id = store.add(0.f, RAMP_TIME_MS, ParameterStore::Ramp::Exponential);
+                store.prepareToPlay(SAMPLE_RATE);
+                store.set(id, 1.f);
+                auto timeConstantSamples = juce::roundToInt(RAMP_TIME_MS * .001 * SAMPLE_RATE);
+                expectWithinAbsoluteError(advance(store, id, timeConstantSamples, how), expected, TOLERANCE);
+                // Another time constant takes it as far again, of what's left.
+                expectWithinAbsoluteError(advance(store, id, timeConstantSamples, how),
+                                          1.f - (1.f - expected) * (1.f - expected), TOLERANCE);
+            }
+        }
+
+        beginTest("fillRamp matches stepping a sample at a time, as targets change");
+        {
+            auto random = getRandom();
+            for (auto ramp: {ParameterStore::Ramp::Linear, ParameterStore::Ramp::Exponential}) {
+                ParameterStore filled, stepped;
+                auto filledId = filled.add(.5f, RAMP_TIME_MS, ramp);
+                auto steppedId = stepped.add(.5f, RAMP_TIME_MS, ramp);
+                filled.prepareToPlay(SAMPLE_RATE);
+                stepped.prepareToPlay(SAMPLE_RATE);
+
+                std::vector<float> block(MAX_BLOCK_SIZE);
+                auto maxError = 0.f;
+                for (auto b = 0; b < NUM_BLOCKS; ++b) {
+                    // A new target now and then, often before the last ramp has finished.
+                    if (random.nextInt(8) == 0) {
+                        auto target = random.nextFloat() * 4.f - 2.f;
+                        filled.set(filledId, target);
+                        stepped.set(steppedId, target);
+                    }
+                    auto numSamples = 1 + random.nextInt(MAX_BLOCK_SIZE);
+                    filled.fillRamp(filledId, block.data(), numSamples);
+                    for (auto n = 0; n < numSamples; ++n) {
+                        maxError = std::max(maxError, std::abs(block[static_cast<size_t>(n)] -
+                                                               stepped.getNext(steppedId)));
+                    }
+                }
+                expectLessOrEqual(maxError, TOLERANCE);
+            }
+        }
+    }
+
+private:
+    static constexpr double SAMPLE_RATE{48000.0};
+    static constexpr double RAMP_TIME_MS{10.0};
+    static constexpr int MAX_BLOCK_SIZE{300};
+    static constexpr int NUM_TRIALS{50};
+    static constexpr int NUM_BLOCKS{2000};
+    // Float rounding, accumulated over a ramp.
+    static constexpr float TOLERANCE{1.0e-4f};
+};
+
+static ParameterStoreTests parameterStoreTests;
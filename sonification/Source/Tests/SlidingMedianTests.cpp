@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    SlidingMedianTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../SlidingMedian.h"
+
+namespace {
+    /**
+     * The median of a window the slow way: sorted afresh, the lower middle value for an even count averaged with the
+     * upper as SlidingMedian does.
+     */
+    float getBruteForceMedian(const std::deque<float> &window, float defaultValue) {
+        if (window.empty()) {
+            return defaultValue;
+        }
+        std::vector<float> sorted{window.begin(), window.end()};
+        std::sort(sorted.begin(), sorted.end());
+        auto middle = sorted.size() / 2;
+        return sorted.size() % 2 == 1 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2.f;
+    }
+}
+
+class SlidingMedianTests : public juce::UnitTest {
+public:
+    SlidingMedianTests() : juce::UnitTest("SlidingMedian", "Analysis") {}
+
+    void runTest() override {
+        beginTest("Odd and even counts, and an empty window");
+        {
+            SlidingMedian<float> median{4};
+            expectEquals(median.getMedian(-1.f), -1.f);
+            median.write(3.f);
+            expectEquals(median.getMedian(), 3.f);
+            median.write(1.f);
+            expectEquals(median.getMedian(), 2.f);
+            median.write(2.f);
+            expectEquals(median.getMedian(), 2.f);
+            median.write(10.f);
+            expectEquals(median.getMedian(), 2.5f);
+            // 3 leaves.
+            median.write(0.f);
+            expectEquals(median.getMedian(), 1.5f);
+            median.clear();
+            expectEquals(median.getNumValues(), 0u);
+            expectEquals(median.getMedian(-1.f), -1.f);
+        }
+
+        beginTest("Shrinking the window evicts the oldest values, and regrowing it doesn't bring them back");
+        {
+            SlidingMedian<float> median{5};
+            for (auto value: {9.f, 8.f, 1.f, 2.f, 3.f}) {
+                median.write(value);
+            }
+            expectEquals(median.getMedian(), 3.f);
+            median.setWindowSize(3);
+            expectEquals(median.getNumValues(), 3u);
+            expectEquals(median.getMedian(), 2.f);
+            median.setWindowSize(6);
+            expectEquals(median.getNumValues(), 3u);
+            expectEquals(median.getMedian(), 2.f);
+            median.write(7.f);
+            expectEquals(median.getMedian(), 2.5f);
+        }
+
+        beginTest("Matches a brute-force median over random writes and window sizes");
+        {
+            auto random = getRandom();
+            SlidingMedian<float> median{INITIAL_WINDOW_SIZE};
+            std::deque<float> window;
+            auto windowSize = INITIAL_WINDOW_SIZE;
+            auto numMismatches = 0;
+
+            for (auto step = 0; step < NUM_STEPS; ++step) {
+                auto choice = random.nextInt(100);
+                if (choice < 3) {
+                    // Including 0, which takes nothing.
+                    windowSize = static_cast<unsigned int>(random.nextInt(MAX_WINDOW_SIZE + 1));
+                    median.setWindowSize(windowSize);
+                    while (window.size() > windowSize) {
+                        window.pop_front();
+                    }
+                } else if (choice < 4) {
+                    median.clear();
+                    window.clear();
+                } else {
+                    // Mostly from a few levels, so that duplicates are common, both in the window and at its middle.
+                    auto value = random.nextInt(4) == 0 ? random.nextFloat() * 10.f
+                                                        : static_cast<float>(random.nextInt(NUM_LEVELS));
+                    median.write(value);
+                    if (windowSize > 0) {
+                        while (window.size() >= windowSize) {
+                            window.pop_front();
+                        }
+                        window.push_back(value);
+                    }
+                }
+
+                if (median.getNumValues() != window.size() ||
+                    median.getMedian(-1.f) != getBruteForceMedian(window, -1.f)) {
+                    ++numMismatches;
+                }
+            }
+
+            expectEquals(numMismatches, 0);
+            expectEquals(median.getWindowSize(), windowSize);
+        }
+    }
+
+private:
+    static constexpr unsigned int INITIAL_WINDOW_SIZE{7};
+    static constexpr int MAX_WINDOW_SIZE{24};
+    static constexpr int NUM_LEVELS{5};
+    static constexpr int NUM_STEPS{200000};
+};
+
+static SlidingMedianTests slidingMedianTests;
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    SonificationMappingTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../SonificationMapping.h"
+
+namespace {
+    using Mapping = SonificationMapping;
+
+    /**
+     * A design mapping cadence over 100-300 exponentially to the note frequency, between the given bounds.
+     */
+    Mapping::Design makeExponentialDesign(const Mapping::Bound &outputLow, const Mapping::Bound &outputHigh) {
+        Mapping::Mapping mapping;
+        mapping.source = Mapping::Cadence;
+        mapping.inputLow = 100.f;
+        mapping.inputHigh = 300.f;
+        mapping.curve = Mapping::Exponential;
+        mapping.outputLow = outputLow;
+        mapping.outputHigh = outputHigh;
+        mapping.target = Mapping::NoteFrequency;
+        return {"Exponential", {mapping}};
+    }
+
+    float evaluate(const Mapping::Program &program, Mapping::Variables variables, float cadence) {
+        variables[Mapping::Cadence] = cadence;
+        Mapping::Outputs outputs{};
+        program.evaluate(variables, outputs);
+        return outputs[Mapping::NoteFrequency];
+    }
+}
+
+class SonificationMappingTests : public juce::UnitTest {
+public:
+    SonificationMappingTests() : juce::UnitTest("SonificationMapping", "Mapping") {}
+
+    void runTest() override {
+        beginTest("An exponential mapping takes equal ratios for equal steps");
+        {
+            auto program = Mapping::Program::compile(makeExponentialDesign(100.f, 400.f), 0);
+            Mapping::Variables variables{};
+            expectWithinAbsoluteError(evaluate(program, variables, 100.f), 100.f, TOLERANCE * 100.f);
+            expectWithinAbsoluteError(evaluate(program, variables, 200.f), 200.f, TOLERANCE * 200.f);
+            expectWithinAbsoluteError(evaluate(program, variables, 300.f), 400.f, TOLERANCE * 400.f);
+        }
+
+        beginTest("An exponential mapping stays finite with a variable bound at or across 0");
+        {
+            auto program = Mapping::Program::compile(
+                    makeExponentialDesign(Mapping::Bound{Mapping::CarrierFrequencyLow},
+                                          Mapping::Bound{Mapping::CarrierFrequencyHigh}), 0);
+            Mapping::Variables variables{};
+            for (auto [low, high]: {std::make_pair(0.f, 400.f), std::make_pair(-50.f, 400.f),
+                                    std::make_pair(400.f, 0.f), std::make_pair(0.f, 0.f),
+                                    std::make_pair(0.f, -400.f), std::make_pair(50.f, -400.f)}) {
+                variables[Mapping::CarrierFrequencyLow] = low;
+                variables[Mapping::CarrierFrequencyHigh] = high;
+                for (auto cadence: {50.f, 100.f, 150.f, 200.f, 300.f, 350.f}) {
+                    auto output = evaluate(program, variables, cadence);
+                    expect(std::isfinite(output), "Output for bounds " + juce::String(low) + " and " +
+                                                  juce::String(high) + " at cadence " + juce::String(cadence));
+                    // Held to the sign of the larger bound.
+                    expect(output * (low + high) >= 0.f);
+                }
+                // The bound that was in range is still reached.
+                auto larger = std::abs(high) > std::abs(low) ? high : low;
+                auto reached = evaluate(program, variables, std::abs(high) > std::abs(low) ? 300.f : 100.f);
+                expectWithinAbsoluteError(reached, larger,
+                                          TOLERANCE * std::abs(larger) + 2.f * Mapping::MIN_EXPONENTIAL_BOUND);
+            }
+        }
+
+        beginTest("Parsing rejects a constant exponential output range that includes 0");
+        {
+            Mapping::Design design;
+            auto result = Mapping::parseDesign(R"({"mappings": [{"source": "cadence", "input": [100, 300],
+                                                   "curve": "exponential", "output": [0, 400],
+                                                   "target": "noteFrequency"}]})", {"mode"}, design);
+            expect(result.failed());
+            expect(result.getErrorMessage().contains("can't include 0"), result.getErrorMessage());
+
+            result = Mapping::parseDesign(R"({"mappings": [{"source": "cadence", "input": [100, 300],
+                                              "curve": "exponential",
+                                              "output": [{"variable": "carrierFrequencyLow"}, 400],
+                                              "target": "noteFrequency"}]})", {"mode"}, design);
+            expect(result.wasOk(), result.getErrorMessage());
+        }
+    }
+
+private:
+    static constexpr float TOLERANCE{1.0e-5f};
+};
+
+static SonificationMappingTests sonificationMappingTests;
@@ -0,0 +1,127 @@
+#include "Trace.h"
+
+#include <vector>
+
+#if GAIT_SONIFICATION_TRACING
+// Value-initialised, so the memory is in use before any thread records into it.
+Trace::ThreadBuffer *const Trace::threadBuffers{new ThreadBuffer[MAX_THREADS]()};
+#else
+Trace::ThreadBuffer *const Trace::threadBuffers{nullptr};
+#endif
+std::atomic<int> Trace::numThreads{0};
+std::atomic<bool> Trace::recording{true};
+
+void Trace::setThreadName(const char *name) {
+    if (auto *buffer = getThreadBuffer()) {
+        buffer->threadName = name;
+    }
+}
+
+void Trace::setRecording(bool shouldRecord) {
+    recording = shouldRecord;
+}
+
+void Trace::clear() {
+    for (auto i = 0; threadBuffers != nullptr && i < MAX_THREADS; ++i) {
+        auto &buffer = threadBuffers[i];
+        buffer.firstValid = buffer.numWritten.load(std::memory_order_acquire);
+    }
+}
+
+juce::Result Trace::writeChromeTrace(const juce::File &file) {
+    auto stream = file.createOutputStream();
+    if (stream == nullptr) {
+        return juce::Result::fail("Failed to open " + file.getFullPathName() + " for writing");
+    }
+    stream->setPosition(0);
+    stream->truncate();
+
+    auto ticksPerMicrosecond = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()) * 1e-6;
+    auto separator = "\n";
+    *stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+    std::vector<Event> events;
+    for (auto b = 0; threadBuffers != nullptr && b < MAX_THREADS; ++b) {
+        auto *buffer = &threadBuffers[b];
+        auto threadIndex = buffer->threadIndex.load(std::memory_order_acquire);
+        if (threadIndex == 0) {
+            continue;
+        }
+
+        auto threadName = buffer->threadName.load();
+        *stream << separator << R"({"ph": "M", "name": "thread_name", "pid": 1, "tid": )" << threadIndex
+                << R"(, "args": {"name": )"
+                << juce::JSON::toString(threadName != nullptr ? juce::String{threadName}
+                                                              : "Thread " + juce::String{threadIndex})
+                << "}}";
+        separator = ",\n";
+
+        // Copy out what's there, then drop whatever the thread overwrote meanwhile.
+        auto end = buffer->numWritten.load(std::memory_order_acquire);
+        auto begin = std::max(buffer->firstValid.load(), end > EVENTS_PER_THREAD ? end - EVENTS_PER_THREAD : 0);
+        events.clear();
+        for (auto n = begin; n < end; ++n) {
+            events.push_back(buffer->events[n % EVENTS_PER_THREAD]);
+        }
+        auto endAfterCopy = buffer->numWritten.load(std::memory_order_acquire);
+        auto numOverwritten = endAfterCopy > begin + EVENTS_PER_THREAD ? endAfterCopy - begin - EVENTS_PER_THREAD : 0;
+
+        auto firstIntact = static_cast<size_t>(std::min<juce::uint64>(numOverwritten, events.size()));
+        for (auto i = firstIntact; i < events.size(); ++i) {
+            auto &event = events[i];
+            *stream << separator << R"({"ph": "X", "pid": 1, "tid": )" << threadIndex
+                    << R"(, "name": ")" << event.name
+                    << R"(", "ts": )" << juce::String(static_cast<double>(event.startTicks) / ticksPerMicrosecond, 3)
+                    << R"(, "dur": )"
+                    << juce::String(static_cast<double>(event.endTicks - event.startTicks) / ticksPerMicrosecond, 3)
+                    << "}";
+        }
+    }
+
+    *stream << "\n]}\n";
+    stream->flush();
+    return stream->getStatus();
+}
+
+void Trace::record(const char *name, juce::int64 startTicks, juce::int64 endTicks) noexcept {
+    if (!recording.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    auto *buffer = getThreadBuffer();
+    if (buffer == nullptr) {
+        return;
+    }
+    // Only this thread writes its buffer, so a plain load and store will do.
+    auto n = buffer->numWritten.load(std::memory_order_relaxed);
+    buffer->events[n % EVENTS_PER_THREAD] = {name, startTicks, endTicks};
+    buffer->numWritten.store(n + 1, std::memory_order_release);
+}
+
+Trace::ThreadBuffer *Trace::getThreadBuffer() noexcept {
+    thread_local ThreadBufferHold hold;
+    if (hold.hasTried || threadBuffers == nullptr) {
+        return hold.buffer;
+    }
+
+    // Once per thread: take the first free buffer, dropping whatever an exited thread left in it.
+    hold.hasTried = true;
+    for (auto i = 0; i < MAX_THREADS; ++i) {
+        auto &buffer = threadBuffers[i];
+        auto isTaken = false;
+        if (buffer.isTaken.compare_exchange_strong(isTaken, true, std::memory_order_acquire)) {
+            buffer.firstValid = buffer.numWritten.load(std::memory_order_relaxed);
+            buffer.threadName = nullptr;
+            buffer.threadIndex.store(++numThreads, std::memory_order_release);
+            hold.buffer = &buffer;
+            break;
+        }
+    }
+    return hold.buffer;
+}
+
+Trace::ThreadBufferHold::~ThreadBufferHold() {
+    if (buffer != nullptr) {
+        buffer->isTaken.store(false, std::memory_order_release);
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef GAIT_SONIFICATION_TRACE_H
+#define GAIT_SONIFICATION_TRACE_H
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+/**
+ * Scoped trace instrumentation for the hot paths, exported as Chrome trace-event JSON (chrome://tracing, Perfetto).
+ *
+ * Build with GAIT_SONIFICATION_TRACING=1 (the CMake option of the same name) to record; otherwise TRACE_SCOPE and
+ * TRACE_THREAD compile to nothing.
+ *
+ * Each thread records into its own fixed-size ring of events, so recording never locks. The rings are allocated up
+ * front, when tracing is built in; a thread takes one with its first event, and hands it back when it exits, so a
+ * restarted audio thread re-uses the one its predecessor had. The oldest events are overwritten once a ring is full.
+ * Events from threads beyond MAX_THREADS at once are dropped. writeChromeTrace() may be called from any thread while
+ * others are recording.
+ */
+#if GAIT_SONIFICATION_TRACING
+// Time from here to the end of the enclosing scope. The name must be a string literal.
+#define TRACE_SCOPE(name) const Trace::Scope JUCE_JOIN_MACRO(traceScope_, __LINE__){name}
+// Name the calling thread in exported traces. The name must be a string literal.
+#define TRACE_THREAD(name) Trace::setThreadName(name)
+#else
+#define TRACE_SCOPE(name) static_cast<void>(0)
+#define TRACE_THREAD(name) static_cast<void>(0)
+#endif
+
+class Trace {
+public:
+    // Events held per thread.
+    static constexpr size_t EVENTS_PER_THREAD{1 << 16};
+    // Threads that can record at once.
+    static constexpr int MAX_THREADS{16};
+
+    class Scope {
+    public:
+        explicit Scope(const char *nameToRecord) noexcept
+                : name(nameToRecord), startTicks(juce::Time::getHighResolutionTicks()) {
+        }
+
+        ~Scope() noexcept {
+            record(name, startTicks, juce::Time::getHighResolutionTicks());
+        }
+
+    private:
+        const char *name;
+        juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE(Scope)
+    };
+
+    static void setThreadName(const char *name);
+
+    /**
+     * Start or stop recording, on every thread. Recording is on to begin with.
+     */
+    static void setRecording(bool shouldRecord);
+
+    /**
+     * Forget everything recorded so far.
+     */
+    static void clear();
+
+    /**
+     * Write the events held, from every thread, as Chrome trace-event JSON.
+     */
+    static juce::Result writeChromeTrace(const juce::File &file);
+
+private:
+    struct Event {
+        const char *name;
+        juce::int64 startTicks;
+        juce::int64 endTicks;
+    };
+
+    /**
+     * One thread's events. A buffer keeps the events of a thread that has exited until another thread takes it.
+     */
+    struct ThreadBuffer {
+        std::array<Event, EVENTS_PER_THREAD> events;
+        // The total number written; event n is at n % EVENTS_PER_THREAD.
+        std::atomic<juce::uint64> numWritten{0};
+        // Events before this were cleared.
+        std::atomic<juce::uint64> firstValid{0};
+        std::atomic<const char *> threadName{nullptr};
+        // 0 until a thread first takes the buffer.
+        std::atomic<int> threadIndex{0};
+        std::atomic<bool> isTaken{false};
+    };
+
+    /**
+     * A thread's hold on its buffer; hands it back when the thread exits.
+     */
+    struct ThreadBufferHold {
+        ~ThreadBufferHold();
+
+        ThreadBuffer *buffer{nullptr};
+        bool hasTried{false};
+    };
+
+    static void record(const char *name, juce::int64 startTicks, juce::int64 endTicks) noexcept;
+
+    /**
+     * @return The calling thread's buffer, taking a free one if it has none; nullptr if tracing isn't built in, or
+     * every buffer is taken.
+     */
+    static ThreadBuffer *getThreadBuffer() noexcept;
+
+    // MAX_THREADS buffers if tracing is built in. Never freed, so threads that exit during shutdown can still hand
+    // theirs back.
+    static ThreadBuffer *const threadBuffers;
+    static std::atomic<int> numThreads;
+    static std::atomic<bool> recording;
+};
+
+#endif //GAIT_SONIFICATION_TRACE_H
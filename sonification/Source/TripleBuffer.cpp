@@ -0,0 +1,37 @@
+#include "TripleBuffer.h"
+#include "GaitEventDetector.h"
+#include "SonificationMapping.h"
+
+template<typename T>
+T &TripleBuffer<T>::getWriteBuffer() {
+    return buffers[writeIndex];
+}
+
+template<typename T>
+void TripleBuffer<T>::publish() {
+    // Hand over the freshly written buffer; take back whichever was in transit.
+    auto previous = sharedIndex.exchange(writeIndex | FRESH, std::memory_order_acq_rel);
+    writeIndex = previous & INDEX_MASK;
+}
+
+template<typename T>
+bool TripleBuffer<T>::fetch() {
+    if ((sharedIndex.load(std::memory_order_relaxed) & FRESH) == 0) {
+        return false;
+    }
+
+    auto previous = sharedIndex.exchange(readIndex, std::memory_order_acq_rel);
+    readIndex = previous & INDEX_MASK;
+    return true;
+}
+
+template<typename T>
+const T &TripleBuffer<T>::getReadBuffer() const {
+    return buffers[readIndex];
+}
+
+template
+class TripleBuffer<GaitEventDetector::Snapshot>;
+
+template
+class TripleBuffer<SonificationMapping::ProgramSet>;
@@ -0,0 +1,54 @@
+#ifndef GAIT_SONIFICATION_TRIPLEBUFFER_H
+#define GAIT_SONIFICATION_TRIPLEBUFFER_H
+
+#include <array>
+#include <atomic>
+
+/**
+ * Lock-free, wait-free handoff of the latest value of T from one writer thread to one reader thread.
+ *
+ * The writer fills the write buffer and publishes it; the reader fetches the most recently published buffer. Neither
+ * side ever waits for the other, and the reader never sees a buffer that is being written. Intermediate values
+ * published between two fetches are skipped.
+ */
+template<typename T>
+class TripleBuffer {
+public:
+    /**
+     * Writer only.
+     * @return The buffer to fill before the next call to publish(). Holds whatever was last written to it, which may be
+     * several publications old.
+     */
+    T &getWriteBuffer();
+
+    /**
+     * Writer only. Make the write buffer available to the reader.
+     */
+    void publish();
+
+    /**
+     * Reader only. Pick up the most recently published buffer, if there is one that hasn't already been picked up.
+     * @return true if the read buffer changed.
+     */
+    bool fetch();
+
+    /**
+     * Reader only.
+     * @return The buffer picked up by the last successful call to fetch().
+     */
+    const T &getReadBuffer() const;
+
+private:
+    // Set in the shared index when the buffer it refers to has been published but not yet fetched.
+    static constexpr int FRESH{4};
+    static constexpr int INDEX_MASK{3};
+
+    std::array<T, 3> buffers{};
+    int writeIndex{0};
+    int readIndex{1};
+    // Index of the buffer in transit between the writer and the reader.
+    std::atomic<int> sharedIndex{2};
+};
+
+
+#endif //GAIT_SONIFICATION_TRIPLEBUFFER_H
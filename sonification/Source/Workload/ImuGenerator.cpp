@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    ImuGenerator.cpp
+
+  ==============================================================================
+*/
+
+#include "ImuGenerator.h"
+
+namespace {
+    // Scales a uniform variable on [-.5, .5) to unit standard deviation.
+    const float UNIFORM_TO_UNIT_SD{std::sqrt(12.f)};
+}
+
+ImuGenerator::ImuGenerator(const Options &optionsToUse) :
+        options(optionsToUse),
+        random(optionsToUse.seed),
+        samplePeriodMs(GaitEventDetector::IMU_SAMPLE_PERIOD_MS) {
+    auto samplesPerMinute = 60000.0 / samplePeriodMs;
+    biasStep = options.driftPerMinute / static_cast<float>(std::sqrt(samplesPerMinute));
+    dropoutProbability = options.dropoutsPerMinute / samplesPerMinute;
+    leftToeOffPhase = options.groundContactMs * (1.0 - options.gctBalance) * options.cadence / 60000.0;
+
+    // Two events a step; a dropout's events all arrive with the sample after it.
+    auto longestGapMs = 2.0 * options.dropoutMs + samplePeriodMs;
+    newEvents.reserve(2 * static_cast<size_t>(longestGapMs / (MIN_STANCE_MS + MIN_FLIGHT_MS) + 2.0));
+}
+
+ImuGenerator::Options ImuGenerator::forRunner(const Options &options, int runnerIndex) {
+    juce::Random runnerRandom{options.seed * 1000003 + runnerIndex};
+    auto runnerOptions = options;
+    runnerOptions.cadence *= 1.0 + .1 * (runnerRandom.nextDouble() - .5);
+    runnerOptions.groundContactMs *= 1.0 + .1 * (runnerRandom.nextDouble() - .5);
+    runnerOptions.seed = runnerRandom.nextInt64();
+    return runnerOptions;
+}
+
+ImuGenerator::Sample ImuGenerator::getNextSample() {
+    newEvents.clear();
+
+    auto timeMs{0.0};
+    while (true) {
+        ++numSamples;
+        timeMs = static_cast<double>(numSamples) * samplePeriodMs;
+
+        if (toeOffPending && timeMs >= stepStartMs + stanceMs) {
+            newEvents.push_back({GaitEventDetector::GaitEventType::ToeOff,
+                                 rightFoot ? GaitEventDetector::Foot::Right : GaitEventDetector::Foot::Left,
+                                 numSamples, stepStartMs + stanceMs});
+            toeOffPending = false;
+        }
+        if (timeMs >= stepStartMs + stepPeriodMs) {
+            stepStartMs += stepPeriodMs;
+            startStep();
+        }
+
+        for (auto &b: bias) {
+            b += biasStep * UNIFORM_TO_UNIT_SD * (random.nextFloat() - .5f);
+        }
+
+        if (numSamplesToDrop > 0) {
+            --numSamplesToDrop;
+            continue;
+        }
+        if (dropoutProbability > 0.0 && random.nextDouble() < dropoutProbability) {
+            // This sample and those to follow; uniform, so the mean is as asked for.
+            numSamplesToDrop = static_cast<juce::int64>(2.0 * random.nextDouble() * options.dropoutMs / samplePeriodMs);
+            continue;
+        }
+        break;
+    }
+
+    // Vertical acceleration through the step, in raised-cosine segments.
+    const auto pi = juce::MathConstants<float>::pi;
+    auto tau = timeMs - stepStartMs;
+    float accelY;
+    if (tau < IMPACT_MS) {
+        accelY = impactAccel * .5f * (1.f - std::cos(pi * static_cast<float>(tau / IMPACT_MS)));
+    } else if (tau < stanceMs) {
+        auto u = static_cast<float>((tau - IMPACT_MS) / (stanceMs - IMPACT_MS));
+        accelY = impactAccel + (TOE_OFF_ACCEL - impactAccel) * .5f * (1.f - std::cos(pi * u));
+    } else {
+        auto u = static_cast<float>((tau - stanceMs) / (SETTLE_FRACTION * (stepPeriodMs - stanceMs)));
+        accelY = u < 1.f ? TOE_OFF_ACCEL * .5f * (1.f + std::cos(pi * u)) : 0.f;
+    }
+
+    // Stride phase: the left foot's step is the first half, the right's the second.
+    auto phase = (rightFoot ? .5 : 0.) + .5 * tau / stepPeriodMs;
+    auto strideSin = static_cast<float>(std::sin(juce::MathConstants<double>::twoPi * phase));
+    auto strideCos = static_cast<float>(std::cos(juce::MathConstants<double>::twoPi * phase));
+    auto stepSin = 2.f * strideSin * strideCos;
+    auto stepCos = strideCos * strideCos - strideSin * strideSin;
+    // Positive towards the left foot's toe-off, negative towards the right's.
+    auto gyroPhase = static_cast<float>(phase - leftToeOffPhase + GYRO_LEAD);
+    auto gyroY = std::cos(juce::MathConstants<float>::twoPi * gyroPhase);
+
+    std::array<float, 6> values{.3f * strideSin, accelY, .4f * stepSin, .6f * stepCos, 1.5f * gyroY, .8f * strideSin};
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] += bias[i] + options.noise * nextGaussian();
+    }
+    return {numSamples, timeMs, values[0], values[1], values[2], values[3], values[4], values[5]};
+}
+
+const std::vector<ImuGenerator::Event> &ImuGenerator::getNewEvents() const {
+    return newEvents;
+}
+
+void ImuGenerator::startStep() {
+    rightFoot = !rightFoot;
+
+    auto nominalPeriodMs = 60000.0 / options.cadence;
+    auto nominalStanceMs = 2.0 * options.groundContactMs * (rightFoot ? options.gctBalance : 1.0 - options.gctBalance);
+    stepPeriodMs = std::max(nominalPeriodMs * (1.0 + options.stepVariability * nextGaussian()),
+                            MIN_STANCE_MS + MIN_FLIGHT_MS);
+    stanceMs = juce::jlimit(MIN_STANCE_MS, stepPeriodMs - MIN_FLIGHT_MS,
+                            nominalStanceMs * (1.0 + options.stepVariability * nextGaussian()));
+    impactAccel = IMPACT_ACCEL * (1.f + static_cast<float>(options.stepVariability) * nextGaussian());
+
+    newEvents.push_back({GaitEventDetector::GaitEventType::InitialContact,
+                         rightFoot ? GaitEventDetector::Foot::Right : GaitEventDetector::Foot::Left,
+                         numSamples, stepStartMs});
+    toeOffPending = true;
+}
+
+float ImuGenerator::nextGaussian() {
+    // Box-Muller, a pair at a time.
+    if (hasSpareGaussian) {
+        hasSpareGaussian = false;
+        return spareGaussian;
+    }
+
+    auto radius = std::sqrt(-2.f * std::log(1.f - random.nextFloat()));
+    auto angle = juce::MathConstants<float>::twoPi * random.nextFloat();
+    spareGaussian = radius * std::sin(angle);
+    hasSpareGaussian = true;
+    return radius * std::cos(angle);
+}
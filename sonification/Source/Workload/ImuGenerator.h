@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    ImuGenerator.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../GaitEventDetector.h"
+
+/**
+ * Generates trunk IMU data for a runner, one sample at a time, along with the gait events it contains.
+ *
+ * Each step's vertical acceleration drops sharply at initial contact, rises through stance to a peak at toe-off and
+ * settles during flight; the other axes sway at the step and stride frequencies, and the vertical gyroscope changes
+ * sign with the stance foot. On top of that come step-to-step variability, sensor noise, a slowly drifting bias on
+ * every axis, and dropouts, where samples are lost.
+ *
+ * The output depends only on the options, seed included, so datasets can be regenerated rather than stored. Nothing
+ * is allocated after construction.
+ */
+class ImuGenerator {
+public:
+    struct Options {
+        // Steps per minute.
+        double cadence{170.0};
+        // Mean ground contact time over both feet.
+        double groundContactMs{250.0};
+        // The right foot's share of the total GCT, as GaitEventDetector measures it.
+        double gctBalance{.5};
+        // Coefficient of variation of the step period and GCT, from step to step.
+        double stepVariability{.02};
+        // Standard deviation of the noise on each axis.
+        float noise{.01f};
+        // Standard deviation the bias on each axis wanders by over a minute.
+        float driftPerMinute{.02f};
+        double dropoutsPerMinute{0.0};
+        // Mean length of a dropout.
+        double dropoutMs{200.0};
+        juce::int64 seed{1};
+    };
+
+    struct Sample {
+        // As counted by the detector, from 1; gaps are dropouts.
+        juce::int64 sampleIndex;
+        // Ms since the start; the first sample is at IMU_SAMPLE_PERIOD_MS.
+        double timeMs;
+        float accelX, accelY, accelZ, gyroX, gyroY, gyroZ;
+    };
+
+    struct Event {
+        GaitEventDetector::GaitEventType type;
+        GaitEventDetector::Foot foot;
+        // The first sample at or after the event, which may have been dropped.
+        juce::int64 sampleIndex;
+        double timeMs;
+    };
+
+    explicit ImuGenerator(const Options &optionsToUse);
+
+    /**
+     * Vary a set of options for one of a population of runners: cadence and GCT spread by a few percent around the
+     * given values, and each runner gets its own seed.
+     */
+    static Options forRunner(const Options &options, int runnerIndex);
+
+    /**
+     * Generate the next sample that isn't lost to a dropout.
+     */
+    Sample getNextSample();
+
+    /**
+     * @return The events that happened between the previous sample and the last one generated, dropped samples
+     * included.
+     */
+    const std::vector<Event> &getNewEvents() const;
+
+private:
+    // How long the vertical acceleration takes to drop at initial contact.
+    static constexpr double IMPACT_MS{20.0};
+    // Shortest stance and flight; the detector needs at least 125 ms and 75 ms.
+    static constexpr double MIN_STANCE_MS{140.0};
+    static constexpr double MIN_FLIGHT_MS{90.0};
+    // Share of flight over which the vertical acceleration settles after toe-off.
+    static constexpr double SETTLE_FRACTION{.6};
+    // Vertical acceleration at the end of the impact, and at toe-off.
+    static constexpr float IMPACT_ACCEL{-2.5f};
+    static constexpr float TOE_OFF_ACCEL{.5f};
+    // Raw gyroscope phase leads toe-off by this much of a stride, to allow for the detector's filter.
+    static constexpr double GYRO_LEAD{.15};
+
+    void startStep();
+
+    float nextGaussian();
+
+    Options options;
+    juce::Random random;
+
+    double samplePeriodMs;
+    juce::int64 numSamples{0};
+
+    // The current step, in ms from the start. The first starts with the first sample.
+    double stepStartMs{0.0}, stepPeriodMs{0.0}, stanceMs{0.0};
+    bool rightFoot{true};
+    bool toeOffPending{false};
+    float impactAccel{IMPACT_ACCEL};
+    // Nominal stride phase of the left foot's toe-off.
+    double leftToeOffPhase;
+
+    // Per axis, in the order of Sample.
+    std::array<float, 6> bias{};
+    float biasStep;
+    double dropoutProbability;
+    juce::int64 numSamplesToDrop{0};
+
+    bool hasSpareGaussian{false};
+    float spareGaussian{0.f};
+
+    std::vector<Event> newEvents;
+};
@@ -0,0 +1,405 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Command-line tool that generates synthetic trunk IMU captures, with their
+    gait events, for benchmarks and soak tests:
+
+        GaitSonificationWorkload [options]
+
+        --runners=<n>                   Runners to generate (default 1)
+        --minutes=<m>                   Length of each capture (default 10)
+        --seed=<n>                      Seed; the same seed, the same data
+                                        (default 1)
+        --cadence=<steps/min>           Cadence (default 170)
+        --gct=<ms>                      Mean ground contact time (default 250)
+        --balance=<0-1>                 Right foot's share of the GCT
+                                        (default 0.5)
+        --variability=<cv>              Step-to-step variability (default 0.02)
+        --noise=<sd>                    Sensor noise (default 0.01)
+        --drift=<sd>                    Bias drift per minute (default 0.02)
+        --dropouts=<per minute>         Dropouts (default 0)
+        --dropout-length=<ms>           Mean dropout length (default 200)
+        --format=csv|binary|stream      Output format (default csv)
+        --output=<directory>            Where to write runner_<n>.csv or .bin,
+                                        and runner_<n>_events.csv (default
+                                        the working directory)
+        --jobs=<n>                      Runners generated at once (default:
+                                        number of CPUs)
+        --realtime                      With --format=stream, emit samples at
+                                        the IMU rate
+        --events=<file>                 With --format=stream, where to write
+                                        the events
+
+    Each runner's cadence and GCT are spread by up to 5% around those given.
+
+    csv is the layout GaitEventDetector reads, with each sample's index in
+    the accel Y channel's X field. binary is "GAITIMU1", the sample period
+    in ms as a float, then for each sample its index as an int64 and accelX,
+    accelY, accelZ, gyroX, gyroY, gyroZ as floats, all little-endian. stream
+    writes one runner's csv to standard output. Samples lost to dropouts are
+    missing from the output.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <cstdio>
+#include <iostream>
+#include "ImuGenerator.h"
+
+namespace {
+    enum class Format {
+        Csv,
+        Binary,
+        Stream
+    };
+
+    struct Settings {
+        ImuGenerator::Options generator;
+        int numRunners{1};
+        double minutes{10.0};
+        Format format{Format::Csv};
+        bool realtime{false};
+    };
+
+    struct Job {
+        int runnerIndex;
+        juce::File dataFile, eventsFile;
+        juce::Result result{juce::Result::ok()};
+        juce::int64 numSamples{0};
+    };
+
+    /**
+     * Standard output, unbuffered by JUCE; stdio does the buffering.
+     */
+    class StandardOutputStream : public juce::OutputStream {
+    public:
+        void flush() override {
+            std::fflush(stdout);
+        }
+
+        bool setPosition(juce::int64) override {
+            return false;
+        }
+
+        juce::int64 getPosition() override {
+            return position;
+        }
+
+        bool write(const void *data, size_t numBytes) override {
+            position += static_cast<juce::int64>(numBytes);
+            return std::fwrite(data, 1, numBytes, stdout) == numBytes;
+        }
+
+    private:
+        juce::int64 position{0};
+    };
+
+    void printUsage() {
+        std::cerr << "Usage: GaitSonificationWorkload [--runners=<n>] [--minutes=<m>] [--seed=<n>]"
+                     " [--cadence=<steps/min>] [--gct=<ms>] [--balance=<0-1>] [--variability=<cv>] [--noise=<sd>]"
+                     " [--drift=<sd>] [--dropouts=<per minute>] [--dropout-length=<ms>]"
+                     " [--format=csv|binary|stream] [--output=<directory>] [--jobs=<n>] [--realtime]"
+                     " [--events=<file>]" << std::endl;
+    }
+
+    bool parseOptions(const juce::ArgumentList &args, Settings &settings) {
+        auto &generator = settings.generator;
+        auto parseDouble = [&args](const juce::String &option, double &value, double minimum, double maximum) {
+            if (!args.containsOption(option)) {
+                return true;
+            }
+            value = args.getValueForOption(option).getDoubleValue();
+            if (value < minimum || value > maximum) {
+                std::cerr << option << " must be between " << minimum << " and " << maximum << std::endl;
+                return false;
+            }
+            return true;
+        };
+
+        auto noise = static_cast<double>(generator.noise);
+        auto drift = static_cast<double>(generator.driftPerMinute);
+        auto numRunners = static_cast<double>(settings.numRunners);
+        if (!parseDouble("--runners", numRunners, 1.0, 1e6) ||
+            !parseDouble("--minutes", settings.minutes, 0.0, 1e5) ||
+            !parseDouble("--cadence", generator.cadence, 60.0, 260.0) ||
+            !parseDouble("--gct", generator.groundContactMs, 140.0, 1000.0) ||
+            !parseDouble("--balance", generator.gctBalance, .25, .75) ||
+            !parseDouble("--variability", generator.stepVariability, 0.0, .2) ||
+            !parseDouble("--noise", noise, 0.0, 1.0) ||
+            !parseDouble("--drift", drift, 0.0, 1.0) ||
+            !parseDouble("--dropouts", generator.dropoutsPerMinute, 0.0, 600.0) ||
+            !parseDouble("--dropout-length", generator.dropoutMs, 0.0, 60000.0)) {
+            return false;
+        }
+        generator.noise = static_cast<float>(noise);
+        generator.driftPerMinute = static_cast<float>(drift);
+        settings.numRunners = static_cast<int>(numRunners);
+
+        if (args.containsOption("--seed")) {
+            generator.seed = args.getValueForOption("--seed").getLargeIntValue();
+        }
+
+        if (args.containsOption("--format")) {
+            auto format = args.getValueForOption("--format");
+            if (format == "csv") {
+                settings.format = Format::Csv;
+            } else if (format == "binary") {
+                settings.format = Format::Binary;
+            } else if (format == "stream") {
+                settings.format = Format::Stream;
+            } else {
+                std::cerr << "Unknown format: " << format << std::endl;
+                return false;
+            }
+        }
+
+        settings.realtime = args.containsOption("--realtime");
+        if (settings.format == Format::Stream && settings.numRunners != 1) {
+            std::cerr << "--format=stream emits one runner" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Append a value with four decimals; printf is too slow for datasets of this size.
+     */
+    char *appendFixed(char *out, double value) {
+        auto scaled = std::llround(value * 10000.0);
+        if (scaled < 0) {
+            *out++ = '-';
+            scaled = -scaled;
+        }
+        char digits[24];
+        auto numDigits{0};
+        do {
+            digits[numDigits++] = static_cast<char>('0' + scaled % 10);
+            scaled /= 10;
+        } while (scaled > 0 || numDigits < 5);
+        while (numDigits > 4) {
+            *out++ = digits[--numDigits];
+        }
+        *out++ = '.';
+        while (numDigits > 0) {
+            *out++ = digits[--numDigits];
+        }
+        return out;
+    }
+
+    char *appendInteger(char *out, juce::int64 value) {
+        char digits[24];
+        auto numDigits{0};
+        do {
+            digits[numDigits++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        while (numDigits > 0) {
+            *out++ = digits[--numDigits];
+        }
+        return out;
+    }
+
+    void writeHeader(juce::OutputStream &stream, Format format) {
+        if (format == Format::Binary) {
+            stream.write("GAITIMU1", 8);
+            stream.writeFloat(GaitEventDetector::IMU_SAMPLE_PERIOD_MS);
+            return;
+        }
+        for (unsigned int l = 0; l < GaitEventDetector::NUM_HEADER_LINES; ++l) {
+            stream << "Generated by GaitSonificationWorkload\n";
+        }
+    }
+
+    void writeSample(juce::OutputStream &stream, Format format, const ImuGenerator::Sample &sample) {
+        if (format == Format::Binary) {
+            stream.writeInt64(sample.sampleIndex);
+            for (auto value: {sample.accelX, sample.accelY, sample.accelZ, sample.gyroX, sample.gyroY, sample.gyroZ}) {
+                stream.writeFloat(value);
+            }
+            return;
+        }
+
+        // Each value in its field, and the sample index in accelY's X field; the fields between are unused.
+        char line[256];
+        auto *out = line;
+        std::pair<unsigned int, float> fields[]{{GaitEventDetector::TRUNK_ACCEL_X_INDEX, sample.accelX},
+                                                {GaitEventDetector::TRUNK_ACCEL_Y_INDEX, sample.accelY},
+                                                {GaitEventDetector::TRUNK_ACCEL_Z_INDEX, sample.accelZ},
+                                                {GaitEventDetector::TRUNK_GYRO_X_INDEX, sample.gyroX},
+                                                {GaitEventDetector::TRUNK_GYRO_Y_INDEX, sample.gyroY},
+                                                {GaitEventDetector::TRUNK_GYRO_Z_INDEX, sample.gyroZ}};
+        auto fieldIndex{0u};
+        for (auto &field: fields) {
+            for (; fieldIndex < field.first; ++fieldIndex) {
+                if (fieldIndex == GaitEventDetector::TRUNK_ACCEL_Y_SAMPLE_INDEX) {
+                    out = appendInteger(out, sample.sampleIndex);
+                } else {
+                    *out++ = '0';
+                }
+                *out++ = ',';
+            }
+            out = appendFixed(out, field.second);
+            if (++fieldIndex <= GaitEventDetector::TRUNK_GYRO_Z_INDEX) {
+                *out++ = ',';
+            }
+        }
+        *out++ = '\n';
+        stream.write(line, static_cast<size_t>(out - line));
+    }
+
+    void writeEvent(juce::OutputStream &stream, const ImuGenerator::Event &event) {
+        stream << juce::String(event.sampleIndex) << "," << juce::String(event.timeMs, 3) << ","
+               << (event.type == GaitEventDetector::GaitEventType::ToeOff ? "toe-off" : "initial contact") << ","
+               << (event.foot == GaitEventDetector::Foot::Left ? "left" : "right") << "\n";
+    }
+
+    /**
+     * Generate one runner's capture.
+     */
+    juce::int64 generate(const Settings &settings, int runnerIndex, juce::OutputStream &data,
+                         juce::OutputStream *events) {
+        ImuGenerator generator{ImuGenerator::forRunner(settings.generator, runnerIndex)};
+        auto endSample = static_cast<juce::int64>(settings.minutes * 60000.0 / GaitEventDetector::IMU_SAMPLE_PERIOD_MS);
+
+        writeHeader(data, settings.format);
+        if (events != nullptr) {
+            *events << "sample,time_ms,event,foot\n";
+        }
+
+        auto startMs = juce::Time::getMillisecondCounterHiRes();
+        juce::int64 numSamples{0};
+        while (true) {
+            auto sample = generator.getNextSample();
+            if (sample.sampleIndex > endSample) {
+                break;
+            }
+
+            if (settings.realtime) {
+                auto dueMs = startMs + sample.timeMs;
+                auto waitMs = dueMs - juce::Time::getMillisecondCounterHiRes();
+                if (waitMs > 1.0) {
+                    juce::Thread::sleep(static_cast<int>(waitMs));
+                }
+            }
+
+            if (events != nullptr) {
+                for (auto &event: generator.getNewEvents()) {
+                    writeEvent(*events, event);
+                }
+            }
+            writeSample(data, settings.format, sample);
+            ++numSamples;
+
+            if (settings.realtime) {
+                data.flush();
+            }
+        }
+
+        data.flush();
+        if (events != nullptr) {
+            events->flush();
+        }
+        return numSamples;
+    }
+
+    juce::Result openForWriting(const juce::File &file, std::unique_ptr<juce::FileOutputStream> &stream) {
+        file.deleteFile();
+        stream = std::make_unique<juce::FileOutputStream>(file, 1 << 16);
+        if (!stream->openedOk()) {
+            return juce::Result::fail("Failed to open " + file.getFullPathName() + " for writing");
+        }
+        return juce::Result::ok();
+    }
+
+    void runJob(const Settings &settings, Job &job) {
+        std::unique_ptr<juce::FileOutputStream> data, events;
+        job.result = openForWriting(job.dataFile, data);
+        if (job.result.wasOk()) {
+            job.result = openForWriting(job.eventsFile, events);
+        }
+        if (job.result.failed()) {
+            return;
+        }
+
+        job.numSamples = generate(settings, job.runnerIndex, *data, events.get());
+        if (data->getStatus().failed()) {
+            job.result = data->getStatus();
+        } else if (events->getStatus().failed()) {
+            job.result = events->getStatus();
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    juce::ArgumentList args{argc, argv};
+
+    Settings settings;
+    if (!parseOptions(args, settings)) {
+        printUsage();
+        return 1;
+    }
+
+    if (settings.format == Format::Stream) {
+        StandardOutputStream data;
+        std::unique_ptr<juce::FileOutputStream> events;
+        if (args.containsOption("--events")) {
+            auto result = openForWriting(args.getFileForOption("--events"), events);
+            if (result.failed()) {
+                std::cerr << result.getErrorMessage() << std::endl;
+                return 1;
+            }
+        }
+        generate(settings, 0, data, events.get());
+        return 0;
+    }
+
+    auto outputDirectory = args.containsOption("--output") ? args.getFileForOption("--output")
+                                                           : juce::File::getCurrentWorkingDirectory();
+    if (!outputDirectory.createDirectory()) {
+        std::cerr << "Failed to create " << outputDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    std::vector<Job> jobs;
+    auto extension = settings.format == Format::Binary ? ".bin" : ".csv";
+    for (auto runnerIndex = 0; runnerIndex < settings.numRunners; ++runnerIndex) {
+        auto name = "runner_" + juce::String(runnerIndex + 1).paddedLeft('0', 4);
+        jobs.push_back({runnerIndex, outputDirectory.getChildFile(name + extension),
+                        outputDirectory.getChildFile(name + "_events.csv")});
+    }
+
+    auto numThreads = args.containsOption("--jobs") ? args.getValueForOption("--jobs").getIntValue()
+                                                    : juce::SystemStats::getNumCpus();
+    juce::ThreadPool pool{juce::jlimit(1, static_cast<int>(jobs.size()), numThreads)};
+
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+    for (auto &job: jobs) {
+        pool.addJob([&job, &settings] { runJob(settings, job); });
+    }
+    while (pool.getNumJobs() > 0) {
+        juce::Thread::sleep(10);
+    }
+    auto elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * .001;
+
+    auto numFailed{0};
+    juce::int64 totalSamples{0};
+    for (auto &job: jobs) {
+        if (job.result.failed()) {
+            std::cerr << job.result.getErrorMessage() << std::endl;
+            ++numFailed;
+            continue;
+        }
+        totalSamples += job.numSamples;
+    }
+    auto hours = static_cast<double>(totalSamples) * GaitEventDetector::IMU_SAMPLE_PERIOD_MS / 3.6e6;
+    std::cout << "Generated " << jobs.size() - static_cast<size_t>(numFailed) << " runners, "
+              << juce::String(hours, 1) << " hours of data, in " << juce::String(elapsedSeconds, 2) << " s ("
+              << juce::String(static_cast<double>(totalSamples) / std::max(elapsedSeconds, 1e-3), 0)
+              << " samples/s)" << std::endl;
+
+    return numFailed == 0 ? 0 : 1;
+}